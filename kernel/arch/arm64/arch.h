@@ -65,6 +65,20 @@ static inline void arm64_invalidate_tlb(void) {
     asm volatile("isb");
 }
 
+static inline void arm64_invalidate_tlb_page(uintptr_t addr) {
+    asm volatile("dsb ishst; tlbi vaae1, %0; dsb ish; isb" : : "r"(addr >> 12) : "memory");
+}
+
+// Широковещательные варианты (Inner Shareable): аппаратура сама
+// сбрасывает TLB всех CPU, IPI для этого не нужны
+static inline void arm64_invalidate_tlb_all_cpus(void) {
+    asm volatile("dsb ishst; tlbi vmalle1is; dsb ish; isb" : : : "memory");
+}
+
+static inline void arm64_invalidate_tlb_page_all_cpus(uintptr_t addr) {
+    asm volatile("dsb ishst; tlbi vaae1is, %0; dsb ish; isb" : : "r"(addr >> 12) : "memory");
+}
+
 static inline void arm64_invalidate_icache(void) {
     asm volatile("ic ialluis");
     asm volatile("dsb ish");
@@ -81,4 +95,11 @@ static inline void arm64_clean_invalidate_dcache(void) {
     asm volatile("isb");
 }
 
+// Частота системного счётчика (CNTVCT_EL0), Гц
+static inline uint64_t arm64_read_cntfrq(void) {
+    uint64_t freq;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    return freq;
+}
+
 #endif // ARCH_ARM64_H
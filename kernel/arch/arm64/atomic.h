@@ -0,0 +1,166 @@
+// atomic.h — атомарные операции ARM64
+//
+// Если процессор поддерживает LSE (ARMv8.1 Large System Extensions),
+// используются одиночные инструкции ldadd/swp/cas/ldset/ldclr: они не
+// крутятся в цикле при конкуренции и выполняются «рядом с памятью».
+// Иначе — классические пары LL/SC (ldxr/stlxr). Выбор делается по флагу
+// arm64_has_lse, который выставляет arm64_cpu_features_init(); при сборке
+// с -march=armv8.1-a и выше используется только LSE.
+#ifndef ARCH_ARM64_ATOMIC_H
+#define ARCH_ARM64_ATOMIC_H
+
+#include <stdint.h>
+
+extern uint8_t arm64_has_lse;
+
+// Определить наличие LSE (arch/arm64/cpufeature.c)
+void arm64_cpu_features_init(void);
+
+#ifdef __ARM_FEATURE_ATOMICS
+#define ARM64_HAS_LSE() 1
+#else
+#define ARM64_HAS_LSE() (arm64_has_lse)
+#endif
+
+// Разрешает ассемблеру инструкции LSE независимо от -march
+#define ARM64_LSE ".arch_extension lse\n"
+
+static inline void arm64_smp_mb(void) {
+    asm volatile("dmb ish" : : : "memory");
+}
+
+// Упорядочивает загрузки с последующими загрузками и сохранениями
+static inline void arm64_smp_rmb(void) {
+    asm volatile("dmb ishld" : : : "memory");
+}
+
+static inline void arm64_smp_wmb(void) {
+    asm volatile("dmb ishst" : : : "memory");
+}
+
+static inline void arm64_cpu_relax(void) {
+    asm volatile("yield" : : : "memory");
+}
+
+// Полностью упорядоченные RMW: LSE-вариант с суффиксом "al", LL/SC —
+// ldxr/stlxr с завершающим dmb ish (как в Linux).
+#define ARM64_ATOMIC_OPS(bits, type, R)                                                 \
+static inline type arm64_load##bits##_acquire(const volatile type *p) {                \
+    type v;                                                                             \
+    asm volatile("ldar %" R "0, %1" : "=r"(v) : "Q"(*p) : "memory");                    \
+    return v;                                                                           \
+}                                                                                       \
+static inline void arm64_store##bits##_release(volatile type *p, type v) {             \
+    asm volatile("stlr %" R "1, %0" : "=Q"(*p) : "r"(v) : "memory");                    \
+}                                                                                       \
+static inline type arm64_fetch_add##bits(volatile type *p, type v) {                   \
+    type old, tmp;                                                                      \
+    uint32_t st;                                                                        \
+    if (ARM64_HAS_LSE()) {                                                              \
+        asm volatile(ARM64_LSE "ldaddal %" R "[v], %" R "[old], %[p]"                   \
+                     : [old] "=r"(old), [p] "+Q"(*p) : [v] "r"(v) : "memory");          \
+        return old;                                                                     \
+    }                                                                                   \
+    asm volatile("1: ldxr %" R "[old], %[p]\n"                                          \
+                 "   add %" R "[tmp], %" R "[old], %" R "[v]\n"                         \
+                 "   stlxr %w[st], %" R "[tmp], %[p]\n"                                 \
+                 "   cbnz %w[st], 1b\n"                                                 \
+                 "   dmb ish"                                                           \
+                 : [old] "=&r"(old), [tmp] "=&r"(tmp), [st] "=&r"(st), [p] "+Q"(*p)     \
+                 : [v] "r"(v) : "memory");                                              \
+    return old;                                                                         \
+}                                                                                       \
+static inline type arm64_fetch_add##bits##_relaxed(volatile type *p, type v) {         \
+    type old, tmp;                                                                      \
+    uint32_t st;                                                                        \
+    if (ARM64_HAS_LSE()) {                                                              \
+        asm volatile(ARM64_LSE "ldadd %" R "[v], %" R "[old], %[p]"                     \
+                     : [old] "=r"(old), [p] "+Q"(*p) : [v] "r"(v));                     \
+        return old;                                                                     \
+    }                                                                                   \
+    asm volatile("1: ldxr %" R "[old], %[p]\n"                                          \
+                 "   add %" R "[tmp], %" R "[old], %" R "[v]\n"                         \
+                 "   stxr %w[st], %" R "[tmp], %[p]\n"                                  \
+                 "   cbnz %w[st], 1b"                                                   \
+                 : [old] "=&r"(old), [tmp] "=&r"(tmp), [st] "=&r"(st), [p] "+Q"(*p)     \
+                 : [v] "r"(v));                                                         \
+    return old;                                                                         \
+}                                                                                       \
+static inline type arm64_xchg##bits(volatile type *p, type v) {                        \
+    type old;                                                                           \
+    uint32_t st;                                                                        \
+    if (ARM64_HAS_LSE()) {                                                              \
+        asm volatile(ARM64_LSE "swpal %" R "[v], %" R "[old], %[p]"                     \
+                     : [old] "=r"(old), [p] "+Q"(*p) : [v] "r"(v) : "memory");          \
+        return old;                                                                     \
+    }                                                                                   \
+    asm volatile("1: ldxr %" R "[old], %[p]\n"                                          \
+                 "   stlxr %w[st], %" R "[v], %[p]\n"                                   \
+                 "   cbnz %w[st], 1b\n"                                                 \
+                 "   dmb ish"                                                           \
+                 : [old] "=&r"(old), [st] "=&r"(st), [p] "+Q"(*p)                       \
+                 : [v] "r"(v) : "memory");                                              \
+    return old;                                                                         \
+}                                                                                       \
+static inline type arm64_cmpxchg##bits(volatile type *p, type old, type new_val) {     \
+    type prev;                                                                          \
+    uint32_t st;                                                                        \
+    if (ARM64_HAS_LSE()) {                                                              \
+        /* casal: регистр old заменяется текущим значением памяти */                     \
+        prev = old;                                                                     \
+        asm volatile(ARM64_LSE "casal %" R "[prev], %" R "[new], %[p]"                  \
+                     : [prev] "+r"(prev), [p] "+Q"(*p) : [new] "r"(new_val)             \
+                     : "memory");                                                       \
+        return prev;                                                                    \
+    }                                                                                   \
+    asm volatile("1: ldxr %" R "[prev], %[p]\n"                                         \
+                 "   cmp %" R "[prev], %" R "[old]\n"                                   \
+                 "   b.ne 2f\n"                                                         \
+                 "   stlxr %w[st], %" R "[new], %[p]\n"                                 \
+                 "   cbnz %w[st], 1b\n"                                                 \
+                 "   dmb ish\n"                                                         \
+                 "2:"                                                                   \
+                 : [prev] "=&r"(prev), [st] "=&r"(st), [p] "+Q"(*p)                     \
+                 : [old] "r"(old), [new] "r"(new_val) : "memory", "cc");                \
+    return prev;                                                                        \
+}                                                                                       \
+static inline void arm64_or##bits(volatile type *p, type v) {                          \
+    type old, tmp;                                                                      \
+    uint32_t st;                                                                        \
+    if (ARM64_HAS_LSE()) {                                                              \
+        asm volatile(ARM64_LSE "ldsetal %" R "[v], %" R "[old], %[p]"                   \
+                     : [old] "=r"(old), [p] "+Q"(*p) : [v] "r"(v) : "memory");          \
+        return;                                                                         \
+    }                                                                                   \
+    asm volatile("1: ldxr %" R "[old], %[p]\n"                                          \
+                 "   orr %" R "[tmp], %" R "[old], %" R "[v]\n"                         \
+                 "   stlxr %w[st], %" R "[tmp], %[p]\n"                                 \
+                 "   cbnz %w[st], 1b\n"                                                 \
+                 "   dmb ish"                                                           \
+                 : [old] "=&r"(old), [tmp] "=&r"(tmp), [st] "=&r"(st), [p] "+Q"(*p)     \
+                 : [v] "r"(v) : "memory");                                              \
+}                                                                                       \
+static inline void arm64_and##bits(volatile type *p, type v) {                         \
+    type old, tmp;                                                                      \
+    uint32_t st;                                                                        \
+    if (ARM64_HAS_LSE()) {                                                              \
+        /* LSE умеет только сбрасывать биты: and(v) == clr(~v) */                        \
+        asm volatile(ARM64_LSE "ldclral %" R "[v], %" R "[old], %[p]"                   \
+                     : [old] "=r"(old), [p] "+Q"(*p) : [v] "r"((type)~v) : "memory");   \
+        return;                                                                         \
+    }                                                                                   \
+    asm volatile("1: ldxr %" R "[old], %[p]\n"                                          \
+                 "   and %" R "[tmp], %" R "[old], %" R "[v]\n"                         \
+                 "   stlxr %w[st], %" R "[tmp], %[p]\n"                                 \
+                 "   cbnz %w[st], 1b\n"                                                 \
+                 "   dmb ish"                                                           \
+                 : [old] "=&r"(old), [tmp] "=&r"(tmp), [st] "=&r"(st), [p] "+Q"(*p)     \
+                 : [v] "r"(v) : "memory");                                              \
+}
+
+ARM64_ATOMIC_OPS(32, uint32_t, "w")
+ARM64_ATOMIC_OPS(64, uint64_t, "x")
+
+#undef ARM64_ATOMIC_OPS
+
+#endif // ARCH_ARM64_ATOMIC_H
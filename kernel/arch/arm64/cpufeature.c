@@ -0,0 +1,18 @@
+// cpufeature.c — определение возможностей процессора ARM64
+#include "../../include/arch.h"
+
+// 1, если доступны атомарные инструкции LSE (ARMv8.1). До вызова
+// arm64_cpu_features_init() используются LL/SC — они есть всегда.
+uint8_t arm64_has_lse = 0;
+
+// Поле Atomic (биты 23:20) регистра ID_AA64ISAR0_EL1:
+// 0b0010 — LDADD/SWP/CAS и др., 0b0011 — плюс 128-битные операции
+#define ARM64_ISAR0_ATOMIC_SHIFT 20
+#define ARM64_ISAR0_ATOMIC_LSE   2
+
+void arm64_cpu_features_init(void) {
+    uint64_t isar0;
+    ARM64_READ_SYSREG(id_aa64isar0_el1, isar0);
+    uint32_t atomic = (uint32_t)(isar0 >> ARM64_ISAR0_ATOMIC_SHIFT) & 0xF;
+    arm64_has_lse = atomic >= ARM64_ISAR0_ATOMIC_LSE;
+}
@@ -28,49 +28,74 @@ typedef uint32_t riscv64_inst_t;
 #define RISCV64_MIP_MTIP (1 << 7)  // Machine timer interrupt
 #define RISCV64_MIP_MEIP (1 << 11) // Machine external interrupt
 
-// Функции для работы с системными регистрами
-static inline riscv64_reg_t riscv64_read_csr(const char* csr) {
-    riscv64_reg_t val;
-    asm volatile("csrr %0, " csr : "=r"(val));
-    return val;
-}
-
-static inline void riscv64_write_csr(const char* csr, riscv64_reg_t val) {
-    asm volatile("csrw " csr ", %0" : : "r"(val));
-}
-
-static inline riscv64_reg_t riscv64_set_csr(const char* csr, riscv64_reg_t val) {
-    riscv64_reg_t old;
-    asm volatile("csrrs %0, " csr ", %1" : "=r"(old) : "r"(val));
-    return old;
-}
-
-static inline riscv64_reg_t riscv64_clear_csr(const char* csr, riscv64_reg_t val) {
-    riscv64_reg_t old;
-    asm volatile("csrrc %0, " csr ", %1" : "=r"(old) : "r"(val));
-    return old;
-}
-
-// Функции для работы с прерываниями
+// Регистры S-режима (ядро работает под OpenSBI)
+#define RISCV64_SSTATUS     "sstatus"
+#define RISCV64_SIE         "sie"
+#define RISCV64_SIP         "sip"
+#define RISCV64_STVEC       "stvec"
+#define RISCV64_SCAUSE      "scause"
+
+#define RISCV64_SSTATUS_SIE (1 << 1)   // Supervisor interrupt enable
+#define RISCV64_SIE_SSIE    (1 << 1)   // Supervisor software interrupt (IPI)
+#define RISCV64_SIE_STIE    (1 << 5)   // Supervisor timer interrupt
+#define RISCV64_SIE_SEIE    (1 << 9)   // Supervisor external interrupt
+
+// Функции для работы с системными регистрами.
+// Имя CSR должно быть известно на этапе компиляции, поэтому это макросы
+// (аналогично ARM64_READ_SYSREG).
+#define riscv64_read_csr(csr) ({ \
+    riscv64_reg_t __v; \
+    asm volatile("csrr %0, " #csr : "=r"(__v)); \
+    __v; })
+
+#define riscv64_write_csr(csr, val) \
+    asm volatile("csrw " #csr ", %0" : : "r"((riscv64_reg_t)(val)))
+
+#define riscv64_set_csr(csr, val) ({ \
+    riscv64_reg_t __old; \
+    asm volatile("csrrs %0, " #csr ", %1" : "=r"(__old) : "r"((riscv64_reg_t)(val))); \
+    __old; })
+
+#define riscv64_clear_csr(csr, val) ({ \
+    riscv64_reg_t __old; \
+    asm volatile("csrrc %0, " #csr ", %1" : "=r"(__old) : "r"((riscv64_reg_t)(val))); \
+    __old; })
+
+// Функции для работы с прерываниями (S-режим)
 static inline void riscv64_enable_interrupts(void) {
-    asm volatile("csrsi mstatus, 0x8");
+    asm volatile("csrsi sstatus, 0x2" : : : "memory");
 }
 
 static inline void riscv64_disable_interrupts(void) {
-    asm volatile("csrci mstatus, 0x8");
+    asm volatile("csrci sstatus, 0x2" : : : "memory");
 }
 
 static inline void riscv64_enable_timer_interrupt(void) {
-    riscv64_set_csr("mie", RISCV64_MIP_MTIP);
+    riscv64_set_csr(sie, RISCV64_SIE_STIE);
 }
 
 static inline void riscv64_disable_timer_interrupt(void) {
-    riscv64_clear_csr("mie", RISCV64_MIP_MTIP);
+    riscv64_clear_csr(sie, RISCV64_SIE_STIE);
+}
+
+// Указатель на per-CPU данные текущего hart'а хранится в tp
+static inline void *riscv64_get_tp(void) {
+    void *tp;
+    asm volatile("mv %0, tp" : "=r"(tp));
+    return tp;
+}
+
+static inline void riscv64_set_tp(void *tp) {
+    asm volatile("mv tp, %0" : : "r"(tp) : "memory");
 }
 
 // Функции для работы с памятью
 static inline void riscv64_sfence_vma(void) {
-    asm volatile("sfence.vma");
+    asm volatile("sfence.vma" : : : "memory");
+}
+
+static inline void riscv64_sfence_vma_addr(uintptr_t addr) {
+    asm volatile("sfence.vma %0" : : "r"(addr) : "memory");
 }
 
 static inline void riscv64_fence_i(void) {
@@ -92,14 +117,14 @@ static inline void riscv64_invalidate_icache(void) {
     riscv64_fence_i();
 }
 
-// Функции для работы с таймером
-static inline void riscv64_set_timer(riscv64_reg_t value) {
-    asm volatile("csrw mtimecmp, %0" : : "r"(value));
-}
+// Частота rdtime на QEMU virt (timebase-frequency из device tree)
+#define RISCV64_TIMEBASE_HZ 10000000ULL
 
+// Функции для работы с таймером: mtime/mtimecmp недоступны из S-режима,
+// время читается через rdtime, а компаратор ставится вызовом SBI
 static inline riscv64_reg_t riscv64_read_timer(void) {
     riscv64_reg_t value;
-    asm volatile("csrr %0, mtime" : "=r"(value));
+    asm volatile("rdtime %0" : "=r"(value));
     return value;
 }
 
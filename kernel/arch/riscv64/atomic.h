@@ -0,0 +1,86 @@
+// atomic.h — атомарные операции RISC-V64 (расширение A)
+//
+// RMW-операции — инструкции AMO с битами .aqrl (полный порядок) или без
+// них (relaxed). Сравнение с обменом — цикл LR/SC. Барьеры выбираются
+// минимальные: acquire = "fence r,rw", release = "fence rw,w".
+#ifndef ARCH_RISCV64_ATOMIC_H
+#define ARCH_RISCV64_ATOMIC_H
+
+#include <stdint.h>
+
+static inline void riscv64_smp_mb(void) {
+    asm volatile("fence rw,rw" : : : "memory");
+}
+
+static inline void riscv64_smp_rmb(void) {
+    asm volatile("fence r,r" : : : "memory");
+}
+
+static inline void riscv64_smp_wmb(void) {
+    asm volatile("fence w,w" : : : "memory");
+}
+
+static inline void riscv64_cpu_relax(void) {
+    // pause (Zihintpause) кодируется как fence w,0 и безопасен везде
+    asm volatile(".4byte 0x0100000f" : : : "memory");
+}
+
+// lr.w/amo*.w расширяют 32-битное значение знаком, поэтому ожидаемое
+// значение для сравнения в cmpxchg32 приводится к long так же
+#define RISCV64_ATOMIC_OPS(bits, type, S, L, ST, sext)                                  \
+static inline type riscv64_load##bits##_acquire(const volatile type *p) {              \
+    type v;                                                                             \
+    asm volatile(L " %0, %1\n"                                                          \
+                 "fence r,rw" : "=r"(v) : "m"(*p) : "memory");                          \
+    return v;                                                                           \
+}                                                                                       \
+static inline void riscv64_store##bits##_release(volatile type *p, type v) {           \
+    asm volatile("fence rw,w\n"                                                         \
+                 ST " %1, %0" : "=m"(*p) : "r"(v) : "memory");                          \
+}                                                                                       \
+static inline type riscv64_fetch_add##bits(volatile type *p, type v) {                 \
+    type old;                                                                           \
+    asm volatile("amoadd." S ".aqrl %0, %2, %1"                                         \
+                 : "=r"(old), "+A"(*p) : "r"(v) : "memory");                            \
+    return old;                                                                         \
+}                                                                                       \
+static inline type riscv64_fetch_add##bits##_relaxed(volatile type *p, type v) {       \
+    type old;                                                                           \
+    asm volatile("amoadd." S " %0, %2, %1" : "=r"(old), "+A"(*p) : "r"(v));             \
+    return old;                                                                         \
+}                                                                                       \
+static inline type riscv64_xchg##bits(volatile type *p, type v) {                      \
+    type old;                                                                           \
+    asm volatile("amoswap." S ".aqrl %0, %2, %1"                                        \
+                 : "=r"(old), "+A"(*p) : "r"(v) : "memory");                            \
+    return old;                                                                         \
+}                                                                                       \
+static inline type riscv64_cmpxchg##bits(volatile type *p, type old, type new_val) {   \
+    type prev;                                                                          \
+    long fail;                                                                          \
+    asm volatile("1: lr." S " %0, %2\n"                                                 \
+                 "   bne %0, %3, 2f\n"                                                  \
+                 "   sc." S ".rl %1, %4, %2\n"                                          \
+                 "   bnez %1, 1b\n"                                                     \
+                 "   fence rw,rw\n"                                                     \
+                 "2:"                                                                   \
+                 : "=&r"(prev), "=&r"(fail), "+A"(*p)                                   \
+                 : "r"((long)sext(old)), "r"(new_val) : "memory");                      \
+    return prev;                                                                        \
+}                                                                                       \
+static inline void riscv64_or##bits(volatile type *p, type v) {                        \
+    asm volatile("amoor." S ".aqrl zero, %1, %0" : "+A"(*p) : "r"(v) : "memory");       \
+}                                                                                       \
+static inline void riscv64_and##bits(volatile type *p, type v) {                       \
+    asm volatile("amoand." S ".aqrl zero, %1, %0" : "+A"(*p) : "r"(v) : "memory");      \
+}
+
+#define RISCV64_SEXT32(x) ((int32_t)(x))
+#define RISCV64_SEXT64(x) ((int64_t)(x))
+
+RISCV64_ATOMIC_OPS(32, uint32_t, "w", "lw", "sw", RISCV64_SEXT32)
+RISCV64_ATOMIC_OPS(64, uint64_t, "d", "ld", "sd", RISCV64_SEXT64)
+
+#undef RISCV64_ATOMIC_OPS
+
+#endif // ARCH_RISCV64_ATOMIC_H
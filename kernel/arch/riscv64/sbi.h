@@ -0,0 +1,72 @@
+// sbi.h — вызовы Supervisor Binary Interface (OpenSBI) для RISC-V64
+#ifndef SBI_H
+#define SBI_H
+
+#include <stdint.h>
+
+// Идентификаторы расширений SBI (EID)
+#define SBI_EXT_TIME 0x54494D45  // "TIME"
+#define SBI_EXT_IPI  0x735049    // "sPI"
+#define SBI_EXT_HSM  0x48534D    // "HSM"
+
+// Функции расширения HSM (Hart State Management)
+#define SBI_HSM_HART_START      0
+#define SBI_HSM_HART_STOP       1
+#define SBI_HSM_HART_GET_STATUS 2
+
+// Состояния hart'а, возвращаемые SBI_HSM_HART_GET_STATUS
+#define SBI_HSM_STATE_STARTED        0
+#define SBI_HSM_STATE_STOPPED        1
+#define SBI_HSM_STATE_START_PENDING  2
+#define SBI_HSM_STATE_STOP_PENDING   3
+
+// Коды ошибок SBI
+#define SBI_SUCCESS            0
+#define SBI_ERR_FAILED        -1
+#define SBI_ERR_NOT_SUPPORTED -2
+#define SBI_ERR_INVALID_PARAM -3
+#define SBI_ERR_ALREADY_AVAILABLE -6
+
+struct sbiret {
+    long error;
+    long value;
+};
+
+// Вызов SBI: a7 = EID, a6 = FID, аргументы в a0..a2
+static inline struct sbiret sbi_ecall(long ext, long fid, long arg0, long arg1, long arg2) {
+    register long a0 asm("a0") = arg0;
+    register long a1 asm("a1") = arg1;
+    register long a2 asm("a2") = arg2;
+    register long a6 asm("a6") = fid;
+    register long a7 asm("a7") = ext;
+    asm volatile("ecall"
+                 : "+r"(a0), "+r"(a1)
+                 : "r"(a2), "r"(a6), "r"(a7)
+                 : "memory");
+    struct sbiret ret = { a0, a1 };
+    return ret;
+}
+
+// Запустить hart: он начнёт выполнение с start_addr в S-режиме,
+// a0 = hartid, a1 = opaque
+static inline long sbi_hart_start(unsigned long hartid, unsigned long start_addr, unsigned long opaque) {
+    return sbi_ecall(SBI_EXT_HSM, SBI_HSM_HART_START, hartid, start_addr, opaque).error;
+}
+
+// Состояние hart'а (SBI_HSM_STATE_*) или отрицательный код ошибки
+static inline long sbi_hart_get_status(unsigned long hartid) {
+    struct sbiret ret = sbi_ecall(SBI_EXT_HSM, SBI_HSM_HART_GET_STATUS, hartid, 0, 0);
+    return ret.error ? ret.error : ret.value;
+}
+
+// Программное прерывание (SSIP) для hart'ов из маски hart_mask,
+// сдвинутой на hart_mask_base
+static inline long sbi_send_ipi(unsigned long hart_mask, unsigned long hart_mask_base) {
+    return sbi_ecall(SBI_EXT_IPI, 0, hart_mask, hart_mask_base, 0).error;
+}
+
+static inline long sbi_set_timer(uint64_t stime_value) {
+    return sbi_ecall(SBI_EXT_TIME, 0, (long)stime_value, 0, 0).error;
+}
+
+#endif // SBI_H
@@ -0,0 +1,100 @@
+// smp.c — запуск вторичных hart'ов RISC-V64 через SBI HSM и IPI через SBI
+#include "../../include/arch.h"
+#include "../../include/smp.h"
+#include "../../include/atomic.h"
+#include "sbi.h"
+#include "../../lib/sync/rcu.h"
+
+// Размер стека ядра на один hart (должен совпадать с entry.S)
+#define RISCV64_STACK_SIZE 0x4000
+
+// Hart'ы с ID выше этого значения не опрашиваются
+#define RISCV64_MAX_HARTID 32
+
+// Стеки всех CPU резервируются в entry.S
+extern uint8_t riscv64_stacks[];
+extern void riscv64_secondary_entry(void);
+extern void riscv64_trap_vector(void);
+
+// Количество логических CPU, которым уже назначен номер
+static uint32_t cpus_assigned = 1;
+
+// Первичная настройка per-CPU данных; вызывается из entry.S до перехода
+// в C‑код с hartid и логическим номером CPU. Указатель на cpu_info_t
+// кладётся в tp, поэтому smp_cpu_id() — одна загрузка без обращения
+// к общей памяти.
+void riscv64_percpu_init(unsigned long hartid, unsigned long cpu) {
+    cpu_info_t *info = &smp_cpus[cpu];
+    info->id = (uint32_t)cpu;
+    info->hwid = (uint32_t)hartid;
+    info->stack_top = (uintptr_t)&riscv64_stacks[(cpu + 1) * RISCV64_STACK_SIZE];
+    riscv64_set_tp(info);
+
+    // Ловушки и программные прерывания (IPI) от SBI
+    riscv64_write_csr(stvec, (uintptr_t)riscv64_trap_vector);
+    riscv64_write_csr(sip, 0);
+    riscv64_set_csr(sie, RISCV64_SIE_SSIE);
+}
+
+uint32_t smp_cpu_id(void) {
+    return ((cpu_info_t *)riscv64_get_tp())->id;
+}
+
+cpu_info_t *smp_this_cpu(void) {
+    return (cpu_info_t *)riscv64_get_tp();
+}
+
+void arch_smp_send_ipi(uint32_t hwid) {
+    // Маска задаётся относительно hart_mask_base, так что hartid > 63
+    // не требует особой обработки
+    sbi_send_ipi(1UL, hwid);
+}
+
+// Точка входа вторичного hart'а после entry.S (стек и tp уже настроены)
+void riscv64_secondary_main(void) {
+    smp_secondary_idle();
+}
+
+void arch_smp_boot_secondaries(void) {
+    uint32_t boot_hart = smp_this_cpu()->hwid;
+
+    for (unsigned long hartid = 0; hartid < RISCV64_MAX_HARTID; hartid++) {
+        if (hartid == boot_hart) continue;
+        if (cpus_assigned >= SMP_MAX_CPUS) break;
+
+        // Несуществующий hart возвращает SBI_ERR_INVALID_PARAM
+        if (sbi_hart_get_status(hartid) != SBI_HSM_STATE_STOPPED) continue;
+
+        uint32_t cpu = cpus_assigned;
+        if (sbi_hart_start(hartid, (uintptr_t)riscv64_secondary_entry, cpu) != SBI_SUCCESS) {
+            continue;
+        }
+        cpus_assigned++;
+
+        // Ждём, пока hart отметится, чтобы логические номера шли подряд
+        // и smp_num_cpus() сразу после smp_init() был точным
+        while (!atomic_load32_acquire(&smp_cpus[cpu].online)) {
+            cpu_relax();
+        }
+    }
+}
+
+// Общий обработчик ловушек S-режима (вызывается из riscv64_trap_vector)
+void riscv64_trap_handler(riscv64_reg_t scause, riscv64_reg_t sepc, riscv64_reg_t stval) {
+    (void)sepc;
+    (void)stval;
+
+    if (scause == ((1UL << 63) | 1)) {
+        // Supervisor software interrupt — IPI от другого hart'а
+        riscv64_clear_csr(sip, RISCV64_SIE_SSIE);
+        int was_idle = rcu_irq_enter();
+        smp_handle_ipi();
+        rcu_irq_exit(was_idle);
+        return;
+    }
+
+    // Прочие ловушки пока не обрабатываются: паркуем hart
+    for (;;) {
+        asm volatile("wfi");
+    }
+}
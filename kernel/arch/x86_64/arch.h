@@ -83,9 +83,33 @@ static inline void x86_64_hlt(void) {
     asm volatile("hlt");
 }
 
+// CPUID: регистры eax, ebx, ecx, edx листа leaf (подлист 0)
+static inline void x86_64_cpuid(uint32_t leaf, uint32_t regs[4]) {
+    asm volatile("cpuid"
+                 : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3])
+                 : "a"(leaf), "c"(0));
+}
+
+// MONITOR/MWAIT: взвести наблюдение за строкой кэша addr и остановить
+// CPU до записи в неё (или прерывания). sti действует после mwait,
+// поэтому прерывание между проверкой и остановкой не теряется.
+static inline void x86_64_monitor(const volatile void *addr) {
+    asm volatile("monitor" : : "a"(addr), "c"(0), "d"(0) : "memory");
+}
+
+static inline void x86_64_sti_mwait(uint32_t hint) {
+    asm volatile("sti; mwait" : : "a"(hint), "c"(0) : "memory");
+}
+
 // Функции для работы с памятью
+// Полный сброс TLB текущего CPU (кроме глобальных страниц): перезапись CR3
 static inline void x86_64_invalidate_tlb(void) {
-    asm volatile("invlpg (%0)" : : "r" (0) : "memory");
+    x86_64_reg_t cr3;
+    asm volatile("mov %%cr3, %0; mov %0, %%cr3" : "=r"(cr3) : : "memory");
+}
+
+static inline void x86_64_invlpg(uintptr_t addr) {
+    asm volatile("invlpg (%0)" : : "r"(addr) : "memory");
 }
 
 static inline void x86_64_invalidate_icache(void) {
@@ -145,4 +169,20 @@ static inline void x86_64_outl(uint16_t port, uint32_t val) {
     asm volatile("outl %0, %1" : : "a"(val), "Nd"(port));
 }
 
+// Строковый ввод-вывод: count слов подряд из порта / в порт (rep insw/outsw)
+static inline void x86_64_insw(uint16_t port, void *buf, uint32_t count) {
+    asm volatile("rep insw" : "+D"(buf), "+c"(count) : "d"(port) : "memory");
+}
+
+static inline void x86_64_outsw(uint16_t port, const void *buf, uint32_t count) {
+    asm volatile("rep outsw" : "+S"(buf), "+c"(count) : "d"(port) : "memory");
+}
+
+// Частота TSC в тактах на микросекунду: калибруется по каналу 2 PIT
+// при первом вызове (tsc.c)
+uint64_t x86_64_tsc_per_us(void);
+
+// Прерывание таймера APIC к моменту TSC (lapic.c). -1 — APIC нет.
+int x86_64_timer_wake_at(uint64_t tsc);
+
 #endif // ARCH_X86_64_H
@@ -0,0 +1,62 @@
+// atomic.h — атомарные операции x86_64
+//
+// x86 — модель TSO: обычные загрузки уже имеют семантику acquire, а
+// сохранения — release, поэтому им нужен только барьер компилятора.
+// Переупорядочиться может лишь store→load, его закрывает smp_mb().
+#ifndef ARCH_X86_64_ATOMIC_H
+#define ARCH_X86_64_ATOMIC_H
+
+#include <stdint.h>
+
+#define x86_64_compiler_barrier() asm volatile("" : : : "memory")
+
+// Полный барьер: lock-операция над стеком дешевле mfence и достаточна
+// для обычной (WB) памяти. mfence нужен только для WC/non-temporal.
+static inline void x86_64_smp_mb(void) {
+    asm volatile("lock; addl $0, -4(%%rsp)" : : : "memory", "cc");
+}
+
+static inline void x86_64_cpu_relax(void) {
+    asm volatile("pause" : : : "memory");
+}
+
+#define X86_64_ATOMIC_OPS(bits, type, sfx)                                              \
+static inline type x86_64_load##bits##_acquire(const volatile type *p) {               \
+    type v = *p;                                                                        \
+    x86_64_compiler_barrier();                                                          \
+    return v;                                                                           \
+}                                                                                       \
+static inline void x86_64_store##bits##_release(volatile type *p, type v) {            \
+    x86_64_compiler_barrier();                                                          \
+    *p = v;                                                                             \
+}                                                                                       \
+static inline type x86_64_fetch_add##bits(volatile type *p, type v) {                  \
+    asm volatile("lock; xadd" sfx " %0, %1" : "+r"(v), "+m"(*p) : : "memory", "cc");   \
+    return v;                                                                           \
+}                                                                                       \
+static inline type x86_64_xchg##bits(volatile type *p, type v) {                       \
+    /* xchg с памятью всегда выполняется с неявным lock */                               \
+    asm volatile("xchg" sfx " %0, %1" : "+r"(v), "+m"(*p) : : "memory");                \
+    return v;                                                                           \
+}                                                                                       \
+static inline type x86_64_cmpxchg##bits(volatile type *p, type old, type new_val) {    \
+    type prev;                                                                          \
+    asm volatile("lock; cmpxchg" sfx " %2, %1"                                          \
+                 : "=a"(prev), "+m"(*p)                                                 \
+                 : "r"(new_val), "0"(old)                                               \
+                 : "memory", "cc");                                                     \
+    return prev;                                                                        \
+}                                                                                       \
+static inline void x86_64_or##bits(volatile type *p, type v) {                         \
+    asm volatile("lock; or" sfx " %1, %0" : "+m"(*p) : "r"(v) : "memory", "cc");        \
+}                                                                                       \
+static inline void x86_64_and##bits(volatile type *p, type v) {                        \
+    asm volatile("lock; and" sfx " %1, %0" : "+m"(*p) : "r"(v) : "memory", "cc");       \
+}
+
+X86_64_ATOMIC_OPS(32, uint32_t, "l")
+X86_64_ATOMIC_OPS(64, uint64_t, "q")
+
+#undef X86_64_ATOMIC_OPS
+
+#endif // ARCH_X86_64_ATOMIC_H
@@ -0,0 +1,39 @@
+// boot.c — разбор информации Multiboot, сохранённой в entry.S
+#include "../../include/boot.h"
+
+#define MULTIBOOT_BOOTLOADER_MAGIC  0x2BADB002
+#define MULTIBOOT_INFO_MODS         (1u << 3)
+
+// Начало структуры multiboot_info; дальше поля не нужны
+typedef struct multiboot_info {
+    uint32_t flags;
+    uint32_t mem_lower;
+    uint32_t mem_upper;
+    uint32_t boot_device;
+    uint32_t cmdline;
+    uint32_t mods_count;
+    uint32_t mods_addr;
+} __attribute__((packed)) multiboot_info_t;
+
+typedef struct multiboot_module {
+    uint32_t mod_start;
+    uint32_t mod_end;
+    uint32_t string;
+    uint32_t reserved;
+} __attribute__((packed)) multiboot_module_t;
+
+// EAX и EBX при входе в _start
+extern uint32_t multiboot_magic;
+extern uint32_t multiboot_info;
+
+int boot_module(uint32_t i, boot_module_t *mod) {
+    if (multiboot_magic != MULTIBOOT_BOOTLOADER_MAGIC || !multiboot_info) return -1;
+    const multiboot_info_t *mbi = (const multiboot_info_t *)(uintptr_t)multiboot_info;
+    if (!(mbi->flags & MULTIBOOT_INFO_MODS) || i >= mbi->mods_count) return -1;
+
+    const multiboot_module_t *m = (const multiboot_module_t *)(uintptr_t)mbi->mods_addr + i;
+    mod->start = m->mod_start;
+    mod->end = m->mod_end;
+    mod->cmdline = m->string ? (const char *)(uintptr_t)m->string : "";
+    return 0;
+}
@@ -1,6 +1,9 @@
 // idt.c — реализация IDT
 #include "idt.h"
+#include "lapic.h"
 #include "../../lib/string.h"
+#include "../../lib/sync/spinlock.h"
+#include "../../lib/sync/rcu.h"
 
 extern void load_idt(void*);  // Ассемблерная функция, выполняющая lidt [rdi]
 
@@ -19,12 +22,91 @@ static void set_idt_entry(int idx, uint64_t offset, uint16_t selector, uint8_t t
     idt_entries[idx].zero          = 0;
 }
 
-// Массив указателей на функции-обработчики (ISR)
-void (*interrupt_handlers[IDT_ENTRIES])();
+// Цепочки обработчиков: на один вектор может быть несколько
+// устройств (разделяемые IRQ). Цепочки читаются в каждом прерывании
+// без блокировок (RCU), а меняются редко — под irq_actions_lock.
+typedef struct irq_action {
+    void (*handler)();
+    struct irq_action *next;
+    rcu_head_t rcu;
+} irq_action_t;
 
-// Регистрация обработчика
-void register_interrupt_handler(int n, void (*handler)()) {
-    interrupt_handlers[n] = handler;
+static irq_action_t *interrupt_chains[IDT_ENTRIES];
+
+static irq_action_t irq_action_pool[IRQ_MAX_ACTIONS];
+static irq_action_t *irq_action_free;
+static spinlock_t irq_actions_lock = SPINLOCK_INIT("irq_actions");
+
+static void irq_actions_init(void) {
+    irq_action_free = NULL;
+    for (int i = IRQ_MAX_ACTIONS - 1; i >= 0; i--) {
+        irq_action_pool[i].next = irq_action_free;
+        irq_action_free = &irq_action_pool[i];
+    }
+}
+
+// Регистрация обработчика (добавляется в конец цепочки вектора n)
+int register_interrupt_handler(int n, void (*handler)()) {
+    if (n < 0 || n >= IDT_ENTRIES || !handler) return -1;
+
+    arch_irqflags_t flags = spin_lock_irqsave(&irq_actions_lock);
+    irq_action_t *action = irq_action_free;
+    if (!action) {
+        spin_unlock_irqrestore(&irq_actions_lock, flags);
+        return -1;
+    }
+    irq_action_free = action->next;
+    action->handler = handler;
+    action->next = NULL;
+
+    irq_action_t **link = &interrupt_chains[n];
+    while (*link) {
+        link = &(*link)->next;
+    }
+    rcu_assign_pointer(*link, action);
+    spin_unlock_irqrestore(&irq_actions_lock, flags);
+    return 0;
+}
+
+static void irq_action_release(rcu_head_t *head) {
+    irq_action_t *action = rcu_container_of(head, irq_action_t, rcu);
+    arch_irqflags_t flags = spin_lock_irqsave(&irq_actions_lock);
+    action->next = irq_action_free;
+    irq_action_free = action;
+    spin_unlock_irqrestore(&irq_actions_lock, flags);
+}
+
+// Удаление обработчика. Узел возвращается в пул после периода
+// отсрочки: другой CPU может прямо сейчас идти по цепочке.
+int unregister_interrupt_handler(int n, void (*handler)()) {
+    if (n < 0 || n >= IDT_ENTRIES) return -1;
+
+    arch_irqflags_t flags = spin_lock_irqsave(&irq_actions_lock);
+    irq_action_t **link = &interrupt_chains[n];
+    while (*link && (*link)->handler != handler) {
+        link = &(*link)->next;
+    }
+    irq_action_t *action = *link;
+    if (action) {
+        rcu_assign_pointer(*link, action->next);
+    }
+    spin_unlock_irqrestore(&irq_actions_lock, flags);
+
+    if (!action) return -1;
+    call_rcu(&action->rcu, irq_action_release);
+    return 0;
+}
+
+// Вызвать все обработчики вектора n. Возвращает их число.
+int interrupt_dispatch(int n) {
+    int handled = 0;
+    rcu_read_lock();
+    for (irq_action_t *a = rcu_dereference(interrupt_chains[n]); a; a = rcu_dereference(a->next)) {
+        a->handler();
+        handled++;
+    }
+    rcu_read_unlock();
+    return handled;
 }
 
 // Вспомогательная функция для отправки команд в порты
@@ -50,15 +132,62 @@ static void remap_pic() {
     outb(0x21, 0x01);  // мастер: 8086 режим
     outb(0xA1, 0x01);  // слейв: 8086 режим
     
-    // Маскируем все IRQ кроме клавиатуры (IRQ1)
+    // Маскируем все IRQ кроме клавиатуры (IRQ1); драйверы открывают
+    // свои линии через pic_unmask_irq()
     outb(0x21, 0xFD);  // мастер: разрешаем только IRQ1 (клавиатура)
     outb(0xA1, 0xFF);  // слейв: маскируем все
 }
 
+static inline uint8_t inb(uint16_t port) {
+    uint8_t val;
+    asm volatile("inb %1, %0" : "=a"(val) : "Nd"(port));
+    return val;
+}
+
+static spinlock_t pic_mask_lock = SPINLOCK_INIT("pic_mask");
+
+void pic_unmask_irq(uint8_t irq) {
+    if (irq >= 16) return;
+
+    arch_irqflags_t flags = spin_lock_irqsave(&pic_mask_lock);
+    if (irq >= 8) {
+        outb(0xA1, inb(0xA1) & ~(1u << (irq - 8)));
+        irq = 2;  // слейв подключён к IRQ2 мастера
+    }
+    outb(0x21, inb(0x21) & ~(1u << irq));
+    spin_unlock_irqrestore(&pic_mask_lock, flags);
+}
+
+// Занятые векторы MSI, бит i — вектор LAPIC_VECTOR_BASE + i. Драйвер
+// возвращает вектор, если не смог настроить прерывание.
+static uint32_t msi_vectors_used;
+
+int idt_alloc_vector(void) {
+    arch_irqflags_t flags = spin_lock_irqsave(&irq_actions_lock);
+    int vector = -1;
+    for (int v = LAPIC_VECTOR_BASE; v < LAPIC_TIMER_VECTOR; v++) {
+        if (!(msi_vectors_used & (1u << (v - LAPIC_VECTOR_BASE)))) {
+            msi_vectors_used |= 1u << (v - LAPIC_VECTOR_BASE);
+            vector = v;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&irq_actions_lock, flags);
+    return vector;
+}
+
+void idt_free_vector(int vector) {
+    if (vector < LAPIC_VECTOR_BASE || vector >= LAPIC_SPURIOUS_VECTOR) return;
+    arch_irqflags_t flags = spin_lock_irqsave(&irq_actions_lock);
+    msi_vectors_used &= ~(1u << (vector - LAPIC_VECTOR_BASE));
+    spin_unlock_irqrestore(&irq_actions_lock, flags);
+}
+
 // Инициализационная функция
 void idt_init() {
     // Обнуляем таблицу
     memset(&idt_entries, 0, sizeof(idt_entries));
+    irq_actions_init();
 
     // Ремап PIC
     remap_pic();
@@ -80,16 +209,20 @@ void idt_init() {
         set_idt_entry(i, (uint64_t)isr_stubs[i], 0x08, 0x8E);
     }
 
-    // Устанавливаем IRQ заглушки (32-47)
+    // Устанавливаем IRQ заглушки (32-47 — PIC, 48-63 — MSI)
     extern void irq0(), irq1(), irq2(), irq3(), irq4(), irq5(), irq6(), irq7();
     extern void irq8(), irq9(), irq10(), irq11(), irq12(), irq13(), irq14(), irq15();
+    extern void irq16(), irq17(), irq18(), irq19(), irq20(), irq21(), irq22(), irq23();
+    extern void irq24(), irq25(), irq26(), irq27(), irq28(), irq29(), irq30(), irq31();
     
     void* irq_stubs[] = {
         irq0, irq1, irq2, irq3, irq4, irq5, irq6, irq7,
-        irq8, irq9, irq10, irq11, irq12, irq13, irq14, irq15
+        irq8, irq9, irq10, irq11, irq12, irq13, irq14, irq15,
+        irq16, irq17, irq18, irq19, irq20, irq21, irq22, irq23,
+        irq24, irq25, irq26, irq27, irq28, irq29, irq30, irq31
     };
     
-    for (int i = 0; i < 16; i++) {
+    for (int i = 0; i < 32; i++) {
         set_idt_entry(32 + i, (uint64_t)irq_stubs[i], 0x08, 0x8E);
     }
 
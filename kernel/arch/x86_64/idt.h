@@ -26,7 +26,23 @@ struct IDTPtr {
 // Инициализация IDT
 void idt_init();
 
-// Регистрация обработчиков
-void register_interrupt_handler(int n, void (*handler)());
+// Максимум обработчиков во всех цепочках вместе
+#define IRQ_MAX_ACTIONS 64
+
+// Регистрация обработчиков: 0 — успех, -1 — ошибка/нет места
+int register_interrupt_handler(int n, void (*handler)());
+int unregister_interrupt_handler(int n, void (*handler)());
+
+// Разрешить линию IRQ 0..15 в PIC (вектор 32 + irq)
+void pic_unmask_irq(uint8_t irq);
+
+// Свободный вектор 48..61 для MSI или -1
+int idt_alloc_vector(void);
+
+// Вернуть вектор от idt_alloc_vector (обработчики уже сняты)
+void idt_free_vector(int vector);
+
+// Вызвать обработчики вектора n (из irq_handler), вернуть их число
+int interrupt_dispatch(int n);
 
 #endif // IDT_H
\ No newline at end of file
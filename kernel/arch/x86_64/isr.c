@@ -3,6 +3,10 @@
 #include "../../drivers/serial.h"
 #include "../../drivers/vga.h"
 #include "../../lib/printf.h"
+#include "../../lib/sync/rcu.h"
+#include "../../lib/stats/stat.h"
+#include "idt.h"
+#include "lapic.h"
 
 // Массив с сообщениями об исключениях CPU (0..31)
 const char* exception_messages[] = {
@@ -42,6 +46,11 @@ const char* exception_messages[] = {
 
 // Общий обработчик исключений
 void isr_handler(registers_t* regs) {
+    stat_irq((uint32_t)regs->int_no);
+    if (regs->int_no == 14) {
+        stat_inc(STAT_PAGE_FAULTS);
+    }
+
     // Остановим таймер или задачи, и выведем сообщение
     // Используем упрощённый printf
     printf("Received Interrupt: %d\n", regs->int_no);
@@ -56,7 +65,15 @@ void isr_handler(registers_t* regs) {
 
 // Общий обработчик IRQ
 void irq_handler(registers_t* regs) {
-    if (regs->int_no == 32) {
+    // Ложное прерывание APIC: не обрабатывается и не подтверждается
+    if (regs->int_no == LAPIC_SPURIOUS_VECTOR) return;
+
+    int was_idle = rcu_irq_enter();
+    stat_irq((uint32_t)regs->int_no);
+
+    if (interrupt_dispatch((int)regs->int_no)) {
+        // Обработано зарегистрированными драйверами
+    } else if (regs->int_no == 32) {
         // обработка таймера
         // можно увеличить счетчик «тик-тайма» и переключить задачи
         printf("Timer interrupt!\n");
@@ -68,6 +85,13 @@ void irq_handler(registers_t* regs) {
         printf("Keyboard interrupt! Scancode: %x\n", scancode);
     }
 
+    // MSI подтверждается локальному APIC, линии PIC — контроллеру PIC
+    if (regs->int_no >= LAPIC_VECTOR_BASE) {
+        lapic_eoi();
+        rcu_irq_exit(was_idle);
+        return;
+    }
+
     // Отправляем EOI (End Of Interrupt) контроллеру PIC
     if (regs->int_no >= 40) {
         // Слейв PIC
@@ -75,4 +99,6 @@ void irq_handler(registers_t* regs) {
     }
     // Мастер PIC (всегда)
     asm volatile("movb $0x20, %%al; outb %%al, $0x20" : : : "al");
+
+    rcu_irq_exit(was_idle);
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+// lapic.c — локальный APIC загрузочного CPU
+#include "lapic.h"
+#include "arch.h"
+#include "paging.h"
+#include "../../include/atomic.h"
+#include "../../lib/printf.h"
+
+#include <stddef.h>
+
+#define IA32_APIC_BASE      0x1B
+#define APIC_BASE_ENABLE    (1u << 11)
+#define APIC_BASE_ADDR      0xFFFFFF000ull
+
+#define LAPIC_REG_ID        0x020
+#define LAPIC_REG_TPR       0x080
+#define LAPIC_REG_EOI       0x0B0
+#define LAPIC_REG_SVR       0x0F0
+#define LAPIC_SVR_ENABLE    0x100
+
+// Таймер: однократный режим по счётчику или по TSC (TSC-deadline)
+#define LAPIC_REG_LVT_TIMER 0x320
+#define LAPIC_REG_TIMER_INIT 0x380
+#define LAPIC_REG_TIMER_CUR 0x390
+#define LAPIC_REG_TIMER_DIV 0x3E0
+#define LAPIC_LVT_MASKED    (1u << 16)
+#define LAPIC_TIMER_TSC_DEADLINE (2u << 17)
+#define LAPIC_TIMER_DIV_16  0x3
+#define IA32_TSC_DEADLINE   0x6E0
+#define TIMER_CALIBRATE_US  1000
+
+#define MSI_ADDRESS_BASE    0xFEE00000u
+
+static volatile uint32_t *lapic_regs;
+static int timer_tsc_deadline;          // 1 — таймер сравнивает с TSC сам
+static uint64_t timer_ticks_per_us;     // однократный режим: тиков счётчика
+
+static inline uint32_t lapic_read(uint32_t reg) {
+    return lapic_regs[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t val) {
+    lapic_regs[reg / 4] = val;
+}
+
+// Таймер будит CPU, остановленный hlt, к сроку. Без TSC-deadline
+// частота счётчика (шина / 16) меряется по TSC.
+static void lapic_timer_init(uint32_t cpuid1_ecx) {
+    if (cpuid1_ecx & (1u << 24)) {           // CPUID.1:ECX.TSC-Deadline
+        timer_tsc_deadline = 1;
+        lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_TSC_DEADLINE | LAPIC_TIMER_VECTOR);
+        return;
+    }
+
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0xFFFFFFFFu);
+    uint64_t end = arch_cycles() + TIMER_CALIBRATE_US * x86_64_tsc_per_us();
+    while (arch_cycles() < end) {
+        cpu_relax();
+    }
+    uint32_t elapsed = 0xFFFFFFFFu - lapic_read(LAPIC_REG_TIMER_CUR);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+    timer_ticks_per_us = elapsed / TIMER_CALIBRATE_US;
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_VECTOR);
+}
+
+int lapic_init(void) {
+    uint32_t regs[4];
+    x86_64_cpuid(1, regs);
+    if (!(regs[3] & (1u << 9))) return -1;   // CPUID.1:EDX.APIC
+
+    uint64_t base = x86_64_read_msr(IA32_APIC_BASE);
+    uint64_t phys = base & APIC_BASE_ADDR;
+    lapic_regs = (volatile uint32_t *)ioremap(phys, 4096);
+    if (!lapic_regs) return -1;
+
+    x86_64_write_msr(IA32_APIC_BASE, base | APIC_BASE_ENABLE);
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+    lapic_timer_init(regs[2]);
+
+    printf("LAPIC: id %u at 0x%lx, timer %s\n", lapic_id(), phys,
+           timer_tsc_deadline ? "TSC-deadline" : timer_ticks_per_us ? "one-shot" : "none");
+    return 0;
+}
+
+int lapic_enabled(void) {
+    return lapic_regs != NULL;
+}
+
+uint32_t lapic_id(void) {
+    return lapic_regs ? lapic_read(LAPIC_REG_ID) >> 24 : 0;
+}
+
+void lapic_eoi(void) {
+    if (lapic_regs) lapic_write(LAPIC_REG_EOI, 0);
+}
+
+uint64_t lapic_msi_address(void) {
+    return MSI_ADDRESS_BASE | (lapic_id() << 12);
+}
+
+uint32_t lapic_msi_data(uint8_t vector) {
+    return vector;   // фиксированная доставка, фронт
+}
+
+int x86_64_timer_wake_at(uint64_t tsc) {
+    if (!lapic_regs) return -1;
+    if (timer_tsc_deadline) {
+        x86_64_write_msr(IA32_TSC_DEADLINE, tsc ? tsc : 1);   // 0 останавливает таймер
+        return 0;
+    }
+    if (!timer_ticks_per_us) return -1;
+
+    // С округлением вверх: раньше срока CPU проснулся бы зря. Дальний
+    // срок урезается — CPU проснётся, перепроверит и взведёт снова.
+    uint64_t now = arch_cycles();
+    uint64_t per_us = x86_64_tsc_per_us();
+    uint64_t us = tsc > now ? (tsc - now + per_us - 1) / per_us : 0;
+    uint64_t ticks = us * timer_ticks_per_us + 1;
+    lapic_write(LAPIC_REG_TIMER_INIT, ticks > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)ticks);
+    return 0;
+}
@@ -0,0 +1,31 @@
+// lapic.h — локальный APIC: приём MSI и EOI для векторов 48..63, таймер
+//
+// Линии устройств по-прежнему идут через PIC (векторы 32..47). MSI
+// доставляется прямо в локальный APIC, и подтверждать такие
+// прерывания нужно ему, а не PIC.
+//
+// Таймер APIC однократно будит CPU к сроку (x86_64_timer_wake_at в
+// arch.h): обработчика у вектора нет, прерывание только выводит CPU из
+// hlt/mwait.
+#ifndef LAPIC_H
+#define LAPIC_H
+
+#include <stdint.h>
+
+// Первый вектор, обслуживаемый APIC (MSI), таймер APIC и ложный вектор
+#define LAPIC_VECTOR_BASE     48
+#define LAPIC_TIMER_VECTOR    62
+#define LAPIC_SPURIOUS_VECTOR 63
+
+// Включить APIC загрузочного CPU. 0 — успех, -1 — APIC нет.
+int lapic_init(void);
+
+int lapic_enabled(void);
+uint32_t lapic_id(void);
+void lapic_eoi(void);
+
+// Адрес и данные сообщения MSI: фиксированная доставка на этот CPU
+uint64_t lapic_msi_address(void);
+uint32_t lapic_msi_data(uint8_t vector);
+
+#endif // LAPIC_H
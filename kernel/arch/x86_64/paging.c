@@ -1,7 +1,28 @@
-// paging.c - x86_64 paging initialization status
+// paging.c - x86_64 paging: identity map for RAM and MMIO windows
 #include <stdint.h>
 #include "paging.h"
+#include "arch.h"
+#include "../../include/memory.h"
 #include "../../lib/printf.h"
+#include "../../lib/sync/spinlock.h"
+
+#define PAGE_PRESENT  0x001
+#define PAGE_WRITE    0x002
+#define PAGE_PWT      0x008
+#define PAGE_PCD      0x010
+#define PAGE_HUGE     0x080
+#define PAGE_ADDR     0x000FFFFFFFFFF000ull
+
+#define PAGE_2M       (2ull << 20)
+#define PAGE_1G       (1ull << 30)
+
+// Каталоги страниц для окон MMIO выше первого гигабайта: один на
+// гигабайт адресов (обычно хватает одного — под 4 ГиБ)
+#define PAGING_MMIO_PDS 4
+
+static uint64_t mmio_pds[PAGING_MMIO_PDS][512] __attribute__((aligned(4096)));
+static int mmio_pds_used;
+static spinlock_t paging_lock = SPINLOCK_INIT("paging");
 
 static inline uint64_t read_cr3(void) {
     uint64_t value;
@@ -9,7 +30,56 @@ static inline uint64_t read_cr3(void) {
     return value;
 }
 
+// PDPT первых 512 ГиБ: таблицы загрузчика лежат в отображённой памяти
+static uint64_t *boot_pdpt(void) {
+    uint64_t *pml4 = (uint64_t *)phys_to_virt(read_cr3() & PAGE_ADDR);
+    return (uint64_t *)phys_to_virt(pml4[0] & PAGE_ADDR);
+}
+
 void paging_init() {
     uint64_t cr3 = read_cr3();
-    printf("Paging enabled; CR3=0x%016lx (set up in entry.S)\n", cr3);
+
+    // entry.S уже отображает первый гигабайт страницами по 2 МиБ: там
+    // ядро, его .bss и буферы DMA. Недостающие записи (другой загрузочный
+    // код) дополняем здесь.
+    uint64_t *pd = (uint64_t *)phys_to_virt(boot_pdpt()[0] & PAGE_ADDR);
+    for (uint64_t i = 1; i < 512; i++) {
+        if (!(pd[i] & PAGE_PRESENT)) {
+            pd[i] = (i * PAGE_2M) | PAGE_PRESENT | PAGE_WRITE | PAGE_HUGE;
+        }
+    }
+    x86_64_invalidate_tlb();
+
+    printf("Paging enabled; CR3=0x%016lx, 1 GiB identity mapped\n", cr3);
+}
+
+void *ioremap(uint64_t phys, uint64_t size) {
+    if (size == 0 || phys + size > 512 * PAGE_1G) return NULL;
+
+    uint64_t *pdpt = boot_pdpt();
+    uint64_t start = phys & ~(PAGE_2M - 1);
+    uint64_t end = phys + size;
+
+    spin_lock(&paging_lock);
+    for (uint64_t addr = start; addr < end; addr += PAGE_2M) {
+        uint64_t *pde = &pdpt[addr / PAGE_1G];
+        if (!(*pde & PAGE_PRESENT)) {
+            if (mmio_pds_used >= PAGING_MMIO_PDS) {
+                spin_unlock(&paging_lock);
+                return NULL;
+            }
+            uint64_t *pd = mmio_pds[mmio_pds_used++];
+            *pde = virt_to_phys(pd) | PAGE_PRESENT | PAGE_WRITE;
+        }
+        uint64_t *pd = (uint64_t *)phys_to_virt(*pde & PAGE_ADDR);
+        uint64_t *e = &pd[(addr / PAGE_2M) & 511];
+        // Регистры устройств — без кэширования. Уже отображённую
+        // память (первый гигабайт) не трогаем.
+        if (!(*e & PAGE_PRESENT)) {
+            *e = addr | PAGE_PRESENT | PAGE_WRITE | PAGE_HUGE | PAGE_PCD | PAGE_PWT;
+            x86_64_invlpg(addr);
+        }
+    }
+    spin_unlock(&paging_lock);
+    return phys_to_virt(phys);
 }
@@ -7,4 +7,8 @@
 // Инициализация пейджинга
 void paging_init();
 
+// Отобразить регистры устройства [phys, phys + size) тождественно и без
+// кэширования; адрес для доступа или NULL
+void *ioremap(uint64_t phys, uint64_t size);
+
 #endif // PAGING_H
@@ -0,0 +1,46 @@
+// tsc.c — калибровка TSC по каналу 2 PIT
+#include "arch.h"
+#include "../../include/atomic.h"
+
+#define PIT_HZ           1193182ULL
+#define PIT_CH2_DATA     0x42
+#define PIT_COMMAND      0x43
+#define PIT_CH2_GATE     0x61   // бит 0 — gate канала 2, бит 1 — динамик,
+                                // бит 5 — выход канала 2
+#define CALIBRATE_MS     10
+
+static volatile uint64_t tsc_per_us;
+
+static uint64_t tsc_calibrate(void) {
+    uint32_t latch = (uint32_t)(PIT_HZ * CALIBRATE_MS / 1000);
+
+    // Gate включён, динамик выключен; режим 0: выход поднимется,
+    // когда счётчик дойдёт до нуля
+    x86_64_outb(PIT_CH2_GATE, (x86_64_inb(PIT_CH2_GATE) & ~0x02) | 0x01);
+    x86_64_outb(PIT_COMMAND, 0xB0);  // канал 2, lobyte/hibyte, режим 0
+    x86_64_outb(PIT_CH2_DATA, latch & 0xFF);
+    x86_64_outb(PIT_CH2_DATA, (latch >> 8) & 0xFF);
+
+    uint64_t start = arch_cycles();
+    uint32_t spins = 0;
+    while (!(x86_64_inb(PIT_CH2_GATE) & 0x20)) {
+        // Без PIT (некоторые гипервизоры) выход не поднимется никогда
+        if (++spins > 100000000u) return 0;
+    }
+    uint64_t elapsed = arch_cycles() - start;
+
+    return elapsed / (CALIBRATE_MS * 1000);
+}
+
+uint64_t x86_64_tsc_per_us(void) {
+    uint64_t per_us = atomic_load64(&tsc_per_us);
+    if (per_us) return per_us;
+
+    // Гонка двух первых вызовов безвредна: оба получат близкие значения
+    per_us = tsc_calibrate();
+    if (!per_us) {
+        per_us = 1000;  // PIT недоступен: считаем TSC 1 ГГц
+    }
+    atomic_store64(&tsc_per_us, per_us);
+    return per_us;
+}
@@ -0,0 +1,751 @@
+// ahci.c — AHCI: списки команд портов, NCQ (FPDMA QUEUED), MSI/INTx
+#include "ahci.h"
+
+#if defined(__x86_64__) || defined(__amd64__)
+
+#include "../include/arch.h"
+#include "../include/atomic.h"
+#include "../include/memory.h"
+#include "../arch/x86_64/idt.h"
+#include "../arch/x86_64/lapic.h"
+#include "../arch/x86_64/paging.h"
+#include "bio.h"
+#include "pci.h"
+#include "../lib/printf.h"
+#include "../lib/sync/spinlock.h"
+
+#include <stddef.h>
+
+// Общие регистры HBA (ABAR = BAR5)
+#define HBA_CAP           0x00
+#define HBA_GHC           0x04
+#define HBA_IS            0x08
+#define HBA_PI            0x0C
+#define HBA_PORT_BASE     0x100
+#define HBA_PORT_SIZE     0x80
+#define HBA_ABAR_SIZE     (HBA_PORT_BASE + 32 * HBA_PORT_SIZE)
+
+#define HBA_CAP_NCS_SHIFT 8      // слотов - 1, 5 бит
+#define HBA_CAP_SSS       (1u << 27)
+#define HBA_CAP_SNCQ      (1u << 30)
+#define HBA_CAP_S64A      (1u << 31)
+#define HBA_GHC_IE        (1u << 1)
+#define HBA_GHC_AE        (1u << 31)
+
+// Регистры порта
+#define PX_CLB            0x00
+#define PX_CLBU           0x04
+#define PX_FB             0x08
+#define PX_FBU            0x0C
+#define PX_IS             0x10
+#define PX_IE             0x14
+#define PX_CMD            0x18
+#define PX_TFD            0x20
+#define PX_SIG            0x24
+#define PX_SSTS           0x28
+#define PX_SERR           0x30
+#define PX_SACT           0x34
+#define PX_CI             0x38
+
+#define PX_CMD_ST         (1u << 0)
+#define PX_CMD_SUD        (1u << 1)
+#define PX_CMD_FRE        (1u << 4)
+#define PX_CMD_FR         (1u << 14)
+#define PX_CMD_CR         (1u << 15)
+
+#define PX_IS_DHRS        (1u << 0)   // D2H Register FIS
+#define PX_IS_PSS         (1u << 1)   // PIO Setup FIS
+#define PX_IS_DSS         (1u << 2)   // DMA Setup FIS
+#define PX_IS_SDBS        (1u << 3)   // Set Device Bits FIS (завершение NCQ)
+#define PX_IS_DPS         (1u << 5)
+#define PX_IS_IFS         (1u << 27)
+#define PX_IS_HBDS        (1u << 28)
+#define PX_IS_HBFS        (1u << 29)
+#define PX_IS_TFES        (1u << 30)
+#define PX_IS_ERRORS      (PX_IS_IFS | PX_IS_HBDS | PX_IS_HBFS | PX_IS_TFES)
+#define PX_IE_DEFAULT     (PX_IS_DHRS | PX_IS_PSS | PX_IS_DSS | PX_IS_SDBS | \
+                           PX_IS_DPS | PX_IS_ERRORS)
+
+#define PX_TFD_ERR        0x01
+#define PX_TFD_DRQ        0x08
+#define PX_TFD_BSY        0x80
+
+#define SATA_SIG_ATA      0x00000101u
+#define SSTS_DET_PRESENT  3
+#define SSTS_IPM_ACTIVE   1
+
+#define FIS_TYPE_REG_H2D  0x27
+#define FIS_H2D_COMMAND   0x80
+
+#define ATA_CMD_READ_DMA_EXT      0x25
+#define ATA_CMD_WRITE_DMA_EXT     0x35
+#define ATA_CMD_READ_FPDMA        0x60
+#define ATA_CMD_WRITE_FPDMA       0x61
+#define ATA_CMD_FLUSH_CACHE_EXT   0xEA
+#define ATA_CMD_IDENTIFY          0xEC
+
+// Заголовок команды: CFL — длина FIS в двойных словах
+#define CMD_HDR_CFL       (20 / 4)
+#define CMD_HDR_WRITE     (1u << 6)
+
+// Предел одной команды: 4 МиБ — одна запись PRD на непрерывный буфер
+#define AHCI_MAX_SECTORS  8192
+#define AHCI_PRD_MAX_BYTES (4u << 20)
+
+// Опрос регистров порта: предел итераций, чтобы зависший порт не
+// повесил загрузку
+#define AHCI_POLL_SPINS   10000000
+
+typedef struct ahci_cmd_header {
+    uint16_t flags;          // CFL, W, ...
+    uint16_t prdtl;          // записей PRD
+    volatile uint32_t prdbc; // передано байт (пишет HBA)
+    uint32_t ctba;
+    uint32_t ctbau;
+    uint32_t reserved[4];
+} __attribute__((packed)) ahci_cmd_header_t;
+
+typedef struct ahci_prd {
+    uint32_t dba;
+    uint32_t dbau;
+    uint32_t reserved;
+    uint32_t dbc;            // байт - 1, бит 31 — прерывание
+} __attribute__((packed)) ahci_prd_t;
+
+typedef struct ahci_cmd_table {
+    uint8_t cfis[64];
+    uint8_t acmd[16];
+    uint8_t reserved[48];
+    ahci_prd_t prdt[AHCI_PRDT_MAX];
+} __attribute__((packed)) ahci_cmd_table_t;
+
+typedef struct ahci_port {
+    volatile uint32_t *regs;
+    uint8_t num;             // номер порта HBA
+    uint8_t ncq;
+    uint32_t depth;          // слотов в работе одновременно
+    uint32_t all_slots;      // маска depth младших слотов
+
+    ahci_cmd_header_t *cmd_list;
+    ahci_cmd_table_t *tables;
+
+    // Свободные и поставленные слоты и их запросы — под lock; его
+    // берёт и обработчик прерывания
+    spinlock_t lock;
+    volatile uint32_t free_slots;
+    uint32_t issued;
+    volatile uint32_t exclusive_waiters;   // ждут не-NCQ команды: новые NCQ не встают
+    ahci_req_t *reqs[AHCI_MAX_SLOTS];
+    wait_queue_t slot_wait;
+
+    // Запросы команд очереди bio: по одному на слот
+    ahci_req_t cmd_reqs[AHCI_MAX_SLOTS];
+
+    char model[41];
+    block_device_t blk;
+} ahci_port_t;
+
+static ahci_cmd_header_t ahci_cmd_lists[AHCI_MAX_PORTS][AHCI_MAX_SLOTS] __attribute__((aligned(1024)));
+static uint8_t ahci_fis[AHCI_MAX_PORTS][256] __attribute__((aligned(256)));
+static ahci_cmd_table_t ahci_tables[AHCI_MAX_PORTS][AHCI_MAX_SLOTS] __attribute__((aligned(128)));
+
+static volatile uint32_t *ahci_hba;
+static uint32_t ahci_cap;
+static ahci_port_t ahci_ports[AHCI_MAX_PORTS];
+static int ahci_nports;
+static ahci_port_t *ahci_port_map[32];
+static volatile uint32_t ahci_irq_ready;
+
+static inline uint32_t hba_read(uint32_t reg) {
+    return ahci_hba[reg / 4];
+}
+
+static inline void hba_write(uint32_t reg, uint32_t val) {
+    ahci_hba[reg / 4] = val;
+}
+
+static inline uint32_t port_read(ahci_port_t *p, uint32_t reg) {
+    return p->regs[reg / 4];
+}
+
+static inline void port_write(ahci_port_t *p, uint32_t reg, uint32_t val) {
+    p->regs[reg / 4] = val;
+}
+
+// Дождаться, пока биты mask в регистре станут value; -1 — не дождались
+static int port_poll(ahci_port_t *p, uint32_t reg, uint32_t mask, uint32_t value) {
+    for (uint32_t i = 0; i < AHCI_POLL_SPINS; i++) {
+        if ((port_read(p, reg) & mask) == value) return 0;
+        cpu_relax();
+    }
+    return -1;
+}
+
+// Остановить разбор списка команд и приём FIS
+static int ahci_port_stop(ahci_port_t *p) {
+    port_write(p, PX_CMD, port_read(p, PX_CMD) & ~PX_CMD_ST);
+    if (port_poll(p, PX_CMD, PX_CMD_CR, 0) < 0) return -1;
+    port_write(p, PX_CMD, port_read(p, PX_CMD) & ~PX_CMD_FRE);
+    return port_poll(p, PX_CMD, PX_CMD_FR, 0);
+}
+
+static int ahci_port_start(ahci_port_t *p) {
+    // ST можно ставить, только когда диск не занят
+    if (port_poll(p, PX_TFD, PX_TFD_BSY | PX_TFD_DRQ, 0) < 0) return -1;
+    port_write(p, PX_CMD, port_read(p, PX_CMD) | PX_CMD_FRE | PX_CMD_ST);
+    return 0;
+}
+
+static int ahci_use_irq(void) {
+    return atomic_load32_acquire(&ahci_irq_ready) && arch_irqs_enabled();
+}
+
+// После ошибки порт останавливается и сбрасывает PxCI/PxSACT: все
+// поставленные команды потеряны. Разбирать, какая из NCQ-команд
+// виновата (READ LOG EXT 10h), не стоит — их просто отвергаем.
+// Вызывается под p->lock.
+static void ahci_port_recover(ahci_port_t *p) {
+    ahci_port_stop(p);
+    port_write(p, PX_SERR, 0xFFFFFFFFu);
+    port_write(p, PX_IS, 0xFFFFFFFFu);
+    if (ahci_port_start(p) < 0) {
+        printf("AHCI %s: port %u stuck after error\n", p->blk.name, p->num);
+    }
+}
+
+// Снять завершённые команды порта и разбудить их владельцев. Из
+// обработчика прерывания и из опроса.
+static void ahci_port_reap(ahci_port_t *p) {
+    ahci_req_t *done[AHCI_MAX_SLOTS];
+    int ndone = 0;
+    // Команды очереди bio: их слот может занять следующая команда ещё
+    // до конца разбора, поэтому команда и статус копируются под lock
+    block_cmd_t *cmds[AHCI_MAX_SLOTS];
+    int cmd_status[AHCI_MAX_SLOTS];
+    int ncmds = 0;
+    int failed = 0;
+
+    arch_irqflags_t flags = spin_lock_irqsave(&p->lock);
+    uint32_t is = port_read(p, PX_IS);
+    port_write(p, PX_IS, is);
+    if (is & PX_IS_ERRORS) {
+        ahci_port_recover(p);
+        failed = 1;
+    }
+
+    // Бит слота в PxSACT (NCQ) и PxCI снимает HBA по завершении
+    uint32_t active = failed ? 0 : port_read(p, PX_SACT) | port_read(p, PX_CI);
+    uint32_t finished = p->issued & ~active;
+    p->issued &= ~finished;
+    uint32_t freed = 0;
+    while (finished) {
+        uint32_t slot = (uint32_t)__builtin_ctz(finished);
+        finished &= finished - 1;
+        ahci_req_t *req = p->reqs[slot];
+        p->reqs[slot] = NULL;
+        if (!req) continue;
+        req->status = failed ? -1 : 0;
+        freed |= req->slots;
+        if (req->cmd) {
+            cmd_status[ncmds] = req->status;
+            cmds[ncmds++] = req->cmd;
+        } else {
+            done[ndone++] = req;
+        }
+    }
+    atomic_or32(&p->free_slots, freed);
+    spin_unlock_irqrestore(&p->lock, flags);
+
+    for (int i = 0; i < ndone; i++) {
+        complete(&done[i]->done);
+    }
+    if (freed) wake_up(&p->slot_wait);
+    for (int i = 0; i < ncmds; i++) {
+        cmds[i]->done(cmds[i], cmd_status[i]);
+    }
+    // Слоты, занятые в обход очереди bio, свободны: её команды,
+    // получившие BLOCK_BUSY, могут встать
+    if (ndone) blk_queue_kick(&p->blk);
+}
+
+static void ahci_irq() {
+    uint32_t is = hba_read(HBA_IS);
+    for (uint32_t pending = is; pending; pending &= pending - 1) {
+        ahci_port_t *p = ahci_port_map[__builtin_ctz(pending)];
+        if (p) ahci_port_reap(p);
+    }
+    // Общий бит снимается после битов портов
+    hba_write(HBA_IS, is);
+}
+
+static int ahci_slots_available(ahci_port_t *p, int queued) {
+    uint32_t free = atomic_load32(&p->free_slots);
+    if (!queued) return free == p->all_slots;
+    return free != 0 && !atomic_load32(&p->exclusive_waiters);
+}
+
+// Под p->lock: занять слоты без ожидания, 0 — нельзя. Команда NCQ
+// берёт один свободный; остальные команды нельзя смешивать с NCQ, и
+// они ждут, пока освободится весь порт, и занимают его целиком.
+static uint32_t ahci_try_take(ahci_port_t *p, int queued) {
+    uint32_t free = p->free_slots;
+    uint32_t take = 0;
+    if (queued && free && !p->exclusive_waiters) {
+        take = free & -free;
+    } else if (!queued && free == p->all_slots) {
+        take = free;
+    }
+    p->free_slots = free & ~take;
+    return take;
+}
+
+// Занять слоты, дождавшись их. Возвращает номер слота для команды.
+static uint32_t ahci_take_slots(ahci_port_t *p, ahci_req_t *req, int queued) {
+    int waiting = 0;
+    for (;;) {
+        arch_irqflags_t flags = spin_lock_irqsave(&p->lock);
+        uint32_t take = ahci_try_take(p, queued);
+        if (take) {
+            if (waiting) p->exclusive_waiters--;
+            spin_unlock_irqrestore(&p->lock, flags);
+            req->slots = take;
+            return (uint32_t)__builtin_ctz(take);
+        }
+        if (!queued && !waiting) {
+            p->exclusive_waiters++;
+            waiting = 1;
+        }
+        spin_unlock_irqrestore(&p->lock, flags);
+
+        if (ahci_use_irq()) {
+            wait_event(&p->slot_wait, ahci_slots_available(p, queued));
+        } else {
+            ahci_port_reap(p);
+            cpu_relax();
+        }
+    }
+}
+
+// Список ложится в PRDT: сегментов не больше AHCI_PRDT_MAX, адреса
+// чётные и доступны HBA
+static int ahci_segs_fit(const block_seg_t *segs, uint32_t nsegs) {
+    if (nsegs > AHCI_PRDT_MAX) return 0;
+    for (uint32_t i = 0; i < nsegs; i++) {
+        uint64_t phys = virt_to_phys(segs[i].buf);
+        uint64_t bytes = (uint64_t)segs[i].sectors * BLOCK_SECTOR_SIZE;
+        if ((phys & 1) || bytes == 0 || bytes > AHCI_PRD_MAX_BYTES) return 0;
+        if (!(ahci_cap & HBA_CAP_S64A) && phys + bytes > 0x100000000ull) return 0;
+    }
+    return 1;
+}
+
+static int ahci_queued(const ahci_req_t *req) {
+    return req->command == ATA_CMD_READ_FPDMA || req->command == ATA_CMD_WRITE_FPDMA;
+}
+
+static uint8_t ahci_rw_command(const ahci_port_t *p, int write) {
+    return p->ncq ? (write ? ATA_CMD_WRITE_FPDMA : ATA_CMD_READ_FPDMA)
+                  : (write ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_READ_DMA_EXT);
+}
+
+// Заполнить таблицу команды в занятом слоте и поставить её
+static void ahci_start(ahci_port_t *p, ahci_req_t *req, uint32_t slot,
+                       const block_seg_t *segs, uint32_t nsegs) {
+    int queued = ahci_queued(req);
+    ahci_cmd_header_t *hdr = &p->cmd_list[slot];
+    ahci_cmd_table_t *t = &p->tables[slot];
+
+    for (uint32_t i = 0; i < nsegs; i++) {
+        uint64_t phys = virt_to_phys(segs[i].buf);
+        t->prdt[i].dba = (uint32_t)phys;
+        t->prdt[i].dbau = (uint32_t)(phys >> 32);
+        t->prdt[i].reserved = 0;
+        t->prdt[i].dbc = segs[i].sectors * BLOCK_SECTOR_SIZE - 1;
+    }
+
+    uint8_t *fis = t->cfis;
+    uint64_t lba = req->lba;
+    uint32_t count = req->count;
+    for (int i = 0; i < 20; i++) fis[i] = 0;
+    fis[0] = FIS_TYPE_REG_H2D;
+    fis[1] = FIS_H2D_COMMAND;
+    fis[2] = req->command;
+    fis[4] = (uint8_t)lba;
+    fis[5] = (uint8_t)(lba >> 8);
+    fis[6] = (uint8_t)(lba >> 16);
+    fis[7] = req->command == ATA_CMD_IDENTIFY ? 0 : 0x40;   // LBA
+    fis[8] = (uint8_t)(lba >> 24);
+    fis[9] = (uint8_t)(lba >> 32);
+    fis[10] = (uint8_t)(lba >> 40);
+    if (queued) {
+        // FPDMA QUEUED: число секторов — в features, тег — в count
+        fis[3] = (uint8_t)count;
+        fis[11] = (uint8_t)(count >> 8);
+        fis[12] = (uint8_t)(slot << 3);
+    } else {
+        fis[12] = (uint8_t)count;
+        fis[13] = (uint8_t)(count >> 8);
+    }
+
+    hdr->flags = CMD_HDR_CFL | (req->write ? CMD_HDR_WRITE : 0);
+    hdr->prdtl = (uint16_t)nsegs;
+    hdr->prdbc = 0;
+
+    req->status = AHCI_REQ_PENDING;
+    reinit_completion(&req->done);
+
+    uint32_t bit = 1u << slot;
+    arch_irqflags_t flags = spin_lock_irqsave(&p->lock);
+    p->reqs[slot] = req;
+    p->issued |= bit;
+    // Для NCQ PxSACT ставится раньше PxCI; запись нуля битов не меняет
+    if (queued) port_write(p, PX_SACT, bit);
+    port_write(p, PX_CI, bit);
+    spin_unlock_irqrestore(&p->lock, flags);
+}
+
+// Занять слот (ждёт его) и поставить команду. 0 — поставлена.
+static int ahci_issue(ahci_port_t *p, ahci_req_t *req, const block_seg_t *segs, uint32_t nsegs) {
+    if (!ahci_segs_fit(segs, nsegs)) return -1;
+    uint32_t slot = ahci_take_slots(p, req, ahci_queued(req));
+    ahci_start(p, req, slot, segs, nsegs);
+    return 0;
+}
+
+static int ahci_port_wait(ahci_port_t *p, ahci_req_t *req) {
+    if (!ahci_use_irq()) {
+        while (!completion_done(&req->done)) {
+            ahci_port_reap(p);
+            cpu_relax();
+        }
+    }
+    wait_for_completion(&req->done);
+    return req->status;
+}
+
+static int ahci_port_rw(ahci_port_t *p, uint64_t lba, const block_seg_t *segs,
+                        uint32_t nsegs, int write) {
+    ahci_req_t req = { .lba = lba, .write = write, .done = COMPLETION_INIT };
+    for (uint32_t i = 0; i < nsegs; i++) {
+        req.count += segs[i].sectors;
+    }
+    if (req.count == 0 || req.count > AHCI_MAX_SECTORS) return -1;
+    req.command = ahci_rw_command(p, write);
+    if (ahci_issue(p, &req, segs, nsegs) < 0) return -1;
+    return ahci_port_wait(p, &req);
+}
+
+int ahci_submit(block_device_t *dev, ahci_req_t *req) {
+    ahci_port_t *p = (ahci_port_t *)dev->priv;
+    if (!p || req->count == 0 || req->count > AHCI_MAX_SECTORS ||
+        req->lba + req->count > dev->sectors) {
+        return -1;
+    }
+    req->command = ahci_rw_command(p, req->write);
+    req->cmd = NULL;
+    block_seg_t seg = { .buf = req->buf, .sectors = req->count };
+    return ahci_issue(p, req, &seg, 1);
+}
+
+int ahci_wait(block_device_t *dev, ahci_req_t *req) {
+    return ahci_port_wait((ahci_port_t *)dev->priv, req);
+}
+
+static int ahci_blk_read(block_device_t *dev, uint64_t lba, uint32_t count, void *buf) {
+    block_seg_t seg = { .buf = buf, .sectors = count };
+    return ahci_port_rw((ahci_port_t *)dev->priv, lba, &seg, 1, 0);
+}
+
+static int ahci_blk_write(block_device_t *dev, uint64_t lba, uint32_t count, const void *buf) {
+    block_seg_t seg = { .buf = (void *)buf, .sectors = count };
+    return ahci_port_rw((ahci_port_t *)dev->priv, lba, &seg, 1, 1);
+}
+
+static int ahci_blk_rw_sg(block_device_t *dev, uint64_t lba, const block_seg_t *segs,
+                          uint32_t nsegs, int write) {
+    if (!ahci_segs_fit(segs, nsegs)) return BLOCK_SG_UNSUPPORTED;
+    return ahci_port_rw((ahci_port_t *)dev->priv, lba, segs, nsegs, write);
+}
+
+// Команда очереди bio: слот — только свободный сейчас, запрос — свой
+// у слота
+static int ahci_blk_submit(block_device_t *dev, block_cmd_t *cmd) {
+    ahci_port_t *p = (ahci_port_t *)dev->priv;
+    if (!ahci_segs_fit(cmd->segs, cmd->nsegs)) return BLOCK_SG_UNSUPPORTED;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < cmd->nsegs; i++) {
+        count += cmd->segs[i].sectors;
+    }
+    if (count == 0 || count > AHCI_MAX_SECTORS) return -1;
+
+    arch_irqflags_t flags = spin_lock_irqsave(&p->lock);
+    uint32_t take = ahci_try_take(p, p->ncq);
+    spin_unlock_irqrestore(&p->lock, flags);
+    if (!take) return BLOCK_BUSY;
+
+    uint32_t slot = (uint32_t)__builtin_ctz(take);
+    ahci_req_t *req = &p->cmd_reqs[slot];
+    req->lba = cmd->lba;
+    req->count = count;
+    req->write = cmd->write;
+    req->command = ahci_rw_command(p, cmd->write);
+    req->slots = take;
+    req->cmd = cmd;
+    ahci_start(p, req, slot, cmd->segs, cmd->nsegs);
+    return 0;
+}
+
+static int ahci_blk_flush(block_device_t *dev) {
+    ahci_port_t *p = (ahci_port_t *)dev->priv;
+    ahci_req_t req = { .command = ATA_CMD_FLUSH_CACHE_EXT, .done = COMPLETION_INIT };
+    if (ahci_issue(p, &req, NULL, 0) < 0) return -1;
+    return ahci_port_wait(p, &req);
+}
+
+// Строки IDENTIFY хранятся словами с переставленными байтами
+static void ahci_copy_string(char *dst, const uint16_t *words, int nwords) {
+    int len = 0;
+    for (int i = 0; i < nwords; i++) {
+        dst[len++] = (char)(words[i] >> 8);
+        dst[len++] = (char)(words[i] & 0xFF);
+    }
+    while (len > 0 && dst[len - 1] == ' ') len--;
+    dst[len] = '\0';
+}
+
+// Выделить порту список команд, область FIS и таблицы и запустить его
+static int ahci_port_setup(ahci_port_t *p, int index) {
+    p->cmd_list = ahci_cmd_lists[index];
+    p->tables = ahci_tables[index];
+    p->depth = 1;
+    p->all_slots = 1;
+    p->free_slots = 1;
+    spin_lock_init(&p->lock, "ahci_port");
+    wait_queue_init(&p->slot_wait);
+
+    if (ahci_port_stop(p) < 0) return -1;
+
+    for (uint32_t s = 0; s < AHCI_MAX_SLOTS; s++) {
+        uint64_t ctba = virt_to_phys(&p->tables[s]);
+        p->cmd_list[s] = (ahci_cmd_header_t){ .ctba = (uint32_t)ctba,
+                                              .ctbau = (uint32_t)(ctba >> 32) };
+    }
+    uint64_t clb = virt_to_phys(p->cmd_list);
+    uint64_t fb = virt_to_phys(ahci_fis[index]);
+    port_write(p, PX_CLB, (uint32_t)clb);
+    port_write(p, PX_CLBU, (uint32_t)(clb >> 32));
+    port_write(p, PX_FB, (uint32_t)fb);
+    port_write(p, PX_FBU, (uint32_t)(fb >> 32));
+
+    port_write(p, PX_SERR, 0xFFFFFFFFu);
+    port_write(p, PX_IS, 0xFFFFFFFFu);
+    port_write(p, PX_IE, PX_IE_DEFAULT);
+    if (ahci_cap & HBA_CAP_SSS) {
+        port_write(p, PX_CMD, port_read(p, PX_CMD) | PX_CMD_SUD);
+    }
+    return ahci_port_start(p);
+}
+
+// IDENTIFY через слот 0 опросом; заполняет глубину очереди и устройство
+static int ahci_port_identify(ahci_port_t *p, const char *name) {
+    static uint16_t id[256] __attribute__((aligned(512)));
+    ahci_req_t req = { .command = ATA_CMD_IDENTIFY, .count = 1, .done = COMPLETION_INIT };
+    block_seg_t seg = { .buf = id, .sectors = 1 };
+    if (ahci_issue(p, &req, &seg, 1) < 0 || ahci_port_wait(p, &req) != 0) return -1;
+
+    if (!(id[83] & (1u << 10))) return -1;     // без LBA48 SATA-дисков не бывает
+    uint64_t sectors = (uint64_t)id[100] | ((uint64_t)id[101] << 16) |
+                       ((uint64_t)id[102] << 32) | ((uint64_t)id[103] << 48);
+    if (sectors == 0) return -1;
+    ahci_copy_string(p->model, &id[27], 20);
+
+    // Глубина NCQ — меньшая из заявленных диском и контроллером
+    if ((ahci_cap & HBA_CAP_SNCQ) && (id[76] & (1u << 8))) {
+        uint32_t depth = (id[75] & 0x1F) + 1u;
+        uint32_t hba_slots = ((ahci_cap >> HBA_CAP_NCS_SHIFT) & 0x1F) + 1u;
+        if (depth > hba_slots) depth = hba_slots;
+        p->ncq = 1;
+        p->depth = depth;
+        p->all_slots = depth == 32 ? 0xFFFFFFFFu : (1u << depth) - 1;
+        atomic_store32(&p->free_slots, p->all_slots);
+    }
+
+    block_device_t *blk = &p->blk;
+    for (int i = 0; name[i]; i++) {
+        blk->name[i] = name[i];
+    }
+    blk->sectors = sectors;
+    blk->sector_size = BLOCK_SECTOR_SIZE;
+    blk->max_transfer = AHCI_MAX_SECTORS;
+    blk->read = ahci_blk_read;
+    blk->write = ahci_blk_write;
+    blk->flush = ahci_blk_flush;
+    blk->rw_sg = ahci_blk_rw_sg;
+    blk->priv = p;
+    return 0;
+}
+
+// MSI на этот CPU через APIC; без него — линия INTx через PIC
+static int ahci_setup_irq(pci_device_t *pci) {
+    if (lapic_enabled() && pci_find_capability(pci, PCI_CAP_MSI, 0)) {
+        int vector = idt_alloc_vector();
+        if (vector >= 0 && register_interrupt_handler(vector, ahci_irq) == 0) {
+            pci_enable_msi(pci, lapic_msi_address(), lapic_msi_data((uint8_t)vector));
+            return 1;
+        }
+    }
+    if (pci->irq_line < 16 && register_interrupt_handler(32 + pci->irq_line, ahci_irq) == 0) {
+        pic_unmask_irq(pci->irq_line);
+        return 0;
+    }
+    return -1;
+}
+
+void ahci_init(void) {
+    static const char *const names[AHCI_MAX_PORTS] = {"sda", "sdb", "sdc", "sdd"};
+
+    pci_device_t *pci = pci_find_class(0x01, 0x06, 0x01, 0);
+    if (!pci || pci_bar_is_io(pci, 5)) return;
+    uint64_t abar = pci_bar(pci, 5);
+    if (!abar) return;
+    ahci_hba = (volatile uint32_t *)ioremap(abar, HBA_ABAR_SIZE);
+    if (!ahci_hba) return;
+    pci_enable(pci, PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER);
+
+    hba_write(HBA_GHC, hba_read(HBA_GHC) | HBA_GHC_AE);
+    ahci_cap = hba_read(HBA_CAP);
+    uint32_t implemented = hba_read(HBA_PI);
+
+    for (uint32_t n = 0; n < 32 && ahci_nports < AHCI_MAX_PORTS; n++) {
+        if (!(implemented & (1u << n))) continue;
+        ahci_port_t *p = &ahci_ports[ahci_nports];
+        p->regs = ahci_hba + (HBA_PORT_BASE + n * HBA_PORT_SIZE) / 4;
+        p->num = (uint8_t)n;
+
+        // Устройство есть и связь установлена; ATAPI (0xEB140101) — не наше
+        uint32_t ssts = port_read(p, PX_SSTS);
+        if ((ssts & 0xF) != SSTS_DET_PRESENT || ((ssts >> 8) & 0xF) != SSTS_IPM_ACTIVE) continue;
+        if (port_read(p, PX_SIG) != SATA_SIG_ATA) continue;
+
+        if (ahci_port_setup(p, ahci_nports) < 0 ||
+            ahci_port_identify(p, names[ahci_nports]) < 0) {
+            ahci_port_stop(p);
+            continue;
+        }
+        ahci_port_map[n] = p;
+        block_register(&p->blk);
+        ahci_nports++;
+    }
+    if (ahci_nports == 0) return;
+
+    int irq = ahci_setup_irq(pci);
+    if (irq >= 0) {
+        hba_write(HBA_IS, 0xFFFFFFFFu);
+        hba_write(HBA_GHC, hba_read(HBA_GHC) | HBA_GHC_IE);
+        atomic_store32_release(&ahci_irq_ready, 1);
+        // Завершения придут прерыванием: очередь bio ставит до depth команд
+        for (int i = 0; i < ahci_nports; i++) {
+            ahci_ports[i].blk.queue_depth = ahci_ports[i].depth;
+            ahci_ports[i].blk.submit = ahci_blk_submit;
+        }
+    }
+
+    for (int i = 0; i < ahci_nports; i++) {
+        ahci_port_t *p = &ahci_ports[i];
+        printf("AHCI %s: %s, %lu MiB, port %u, %s depth %u, %s\n", p->blk.name, p->model,
+               p->blk.sectors / 2048, p->num, p->ncq ? "NCQ" : "no NCQ", p->depth,
+               irq > 0 ? "MSI" : irq == 0 ? "INTx" : "polling");
+    }
+}
+
+// ---------------------------------------------------------------
+// Замер: случайные чтения при растущей глубине очереди
+// ---------------------------------------------------------------
+
+#define AHCI_BENCH_IOS     4096
+#define AHCI_BENCH_SECTORS 8     // 4 КиБ
+
+static uint8_t ahci_bench_buf[AHCI_MAX_SLOTS][AHCI_BENCH_SECTORS * BLOCK_SECTOR_SIZE]
+    __attribute__((aligned(4096)));
+static ahci_req_t ahci_bench_reqs[AHCI_MAX_SLOTS];
+
+static uint64_t ahci_bench_lba(uint64_t *seed, uint64_t span) {
+    uint64_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *seed = x;
+    return (x % span) * AHCI_BENCH_SECTORS;
+}
+
+void ahci_benchmark(void) {
+    if (ahci_nports == 0) {
+        printf("AHCI bench: no disk\n");
+        return;
+    }
+    ahci_port_t *p = &ahci_ports[0];
+    block_device_t *dev = &p->blk;
+    uint64_t span = dev->sectors / AHCI_BENCH_SECTORS;
+    if (span == 0) return;
+
+    printf("AHCI bench %s: random 4 KiB reads, %u per depth\n", dev->name, AHCI_BENCH_IOS);
+    for (uint32_t depth = 1; depth <= p->depth; depth *= 2) {
+        uint64_t seed = 0x9E3779B97F4A7C15ull;
+        uint32_t submitted = 0, completed = 0;
+        int failed = 0;
+        uint64_t t0 = arch_cycles();
+
+        for (uint32_t i = 0; i < depth; i++) {
+            ahci_req_t *req = &ahci_bench_reqs[i];
+            init_completion(&req->done);
+            req->lba = ahci_bench_lba(&seed, span);
+            req->count = AHCI_BENCH_SECTORS;
+            req->buf = ahci_bench_buf[i];
+            req->write = 0;
+            if (ahci_submit(dev, req) == 0) submitted++;
+        }
+        // По кругу: дождаться запроса и сразу поставить его снова, чтобы
+        // в очереди диска оставалось depth команд
+        for (uint32_t i = 0; completed < submitted; i = (i + 1) % depth) {
+            ahci_req_t *req = &ahci_bench_reqs[i];
+            if (ahci_wait(dev, req) != 0) failed = 1;
+            completed++;
+            if (!failed && submitted < AHCI_BENCH_IOS) {
+                req->lba = ahci_bench_lba(&seed, span);
+                if (ahci_submit(dev, req) == 0) submitted++;
+            }
+        }
+
+        uint64_t us = (arch_cycles() - t0) / arch_cycles_per_us();
+        if (failed) {
+            printf("  QD %u: I/O error\n", depth);
+            return;
+        }
+        uint64_t iops = us ? (uint64_t)completed * 1000000 / us : 0;
+        printf("  QD %u: %lu IOPS, %lu MB/s\n", depth, iops,
+               us ? (uint64_t)completed * AHCI_BENCH_SECTORS * BLOCK_SECTOR_SIZE / us : 0);
+    }
+}
+
+#else
+// Stub implementation for non-x86 platforms: AHCI ищется только на PCI PC
+
+void ahci_init(void) {
+}
+
+int ahci_submit(block_device_t *dev, ahci_req_t *req) {
+    (void)dev;
+    (void)req;
+    return -1;
+}
+
+int ahci_wait(block_device_t *dev, ahci_req_t *req) {
+    (void)dev;
+    (void)req;
+    return -1;
+}
+
+void ahci_benchmark(void) {
+}
+
+#endif
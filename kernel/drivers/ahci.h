@@ -0,0 +1,63 @@
+// ahci.h — SATA через AHCI: NCQ до 32 команд на порт, MSI
+//
+// Контроллер AHCI (PCI класс 01:06:01) описывает каждый порт списком
+// из 32 команд в памяти. Драйвер держит на порт свой список, область
+// приёма FIS и 32 таблицы команд; команда ставится записью бита слота
+// в PxCI, и ничего не ждёт: диск с NCQ получает до 32 чтений и записей
+// сразу и сам выбирает порядок. Завершение видно по снятым битам
+// PxSACT/PxCI; обработчик прерывания (MSI, если есть APIC, иначе INTx)
+// снимает их и будит ожидающих.
+//
+// Для каждого диска регистрируется блочное устройство sda..sdd.
+// Синхронные block_read/block_write — это один запрос на вызов.
+// Очередь bio ставит команды через submit устройства, а ahci_submit()
+// — без очереди bio: оба не ждут диска, чтобы держать его очередь
+// заполненной.
+#ifndef AHCI_H
+#define AHCI_H
+
+#include <stdint.h>
+#include "block.h"
+#include "../lib/sync/wait.h"
+
+#define AHCI_MAX_PORTS  4
+#define AHCI_MAX_SLOTS  32
+
+// Записей PRD в таблице команды: сегментов в одном запросе
+#define AHCI_PRDT_MAX   8
+
+// Асинхронный запрос чтения или записи. Память запроса и буфера
+// принадлежат драйверу до done.
+typedef struct ahci_req {
+    uint64_t lba;
+    uint32_t count;              // секторов, не больше max_transfer
+    void *buf;
+    int write;
+
+    volatile int status;         // AHCI_REQ_PENDING, затем 0 или -1
+    completion_t done;
+
+    // Заполняет драйвер
+    uint8_t command;
+    uint32_t slots;              // занятые запросом слоты
+    block_cmd_t *cmd;            // команда очереди bio: завершается cmd->done
+} ahci_req_t;
+
+#define AHCI_REQ_PENDING 1
+
+// Найти контроллер и диски (после pci_init и idt_init)
+void ahci_init(void);
+
+// Поставить запрос в очередь диска dev (устройство sdX). Ждёт только
+// свободного слота. 0 — поставлен, по завершении будет complete(&done);
+// -1 — неверный запрос.
+int ahci_submit(block_device_t *dev, ahci_req_t *req);
+
+// Дождаться запроса (до включения прерываний — опросом). Возвращает status.
+int ahci_wait(block_device_t *dev, ahci_req_t *req);
+
+// Случайные чтения по 4 КиБ при глубине очереди 1, 2, 4 ... 32:
+// IOPS в консоль. После включения прерываний (сборка с AHCI_BENCH=1).
+void ahci_benchmark(void);
+
+#endif // AHCI_H
@@ -0,0 +1,650 @@
+// ata.c — ATA: IDENTIFY, LBA28/LBA48, READ/WRITE MULTIPLE, DMA по PRD, IRQ14/15
+#include "ata.h"
+
+#if defined(__x86_64__) || defined(__amd64__)
+
+#include "../include/arch.h"
+#include "../include/atomic.h"
+#include "../include/memory.h"
+#include "../arch/x86_64/idt.h"
+#include "pci.h"
+#include "../lib/printf.h"
+#include "../lib/sync/wait.h"
+
+#include <stddef.h>
+
+// Регистры командного блока (смещения от io)
+#define ATA_REG_DATA      0
+#define ATA_REG_ERROR     1
+#define ATA_REG_FEATURES  1
+#define ATA_REG_COUNT     2
+#define ATA_REG_LBA0      3
+#define ATA_REG_LBA1      4
+#define ATA_REG_LBA2      5
+#define ATA_REG_DRIVE     6
+#define ATA_REG_STATUS    7
+#define ATA_REG_COMMAND   7
+
+// Регистр управления (ctrl): при чтении — альтернативный статус
+#define ATA_CTRL_NIEN     0x02   // запретить INTRQ
+
+#define ATA_SR_ERR        0x01
+#define ATA_SR_DRQ        0x08
+#define ATA_SR_DF         0x20
+#define ATA_SR_BSY        0x80
+
+#define ATA_CMD_READ_SECTORS      0x20
+#define ATA_CMD_READ_SECTORS_EXT  0x24
+#define ATA_CMD_READ_MULTIPLE     0xC4
+#define ATA_CMD_READ_MULTIPLE_EXT 0x29
+#define ATA_CMD_WRITE_SECTORS     0x30
+#define ATA_CMD_WRITE_SECTORS_EXT 0x34
+#define ATA_CMD_WRITE_MULTIPLE    0xC5
+#define ATA_CMD_WRITE_MULTIPLE_EXT 0x39
+#define ATA_CMD_SET_MULTIPLE      0xC6
+#define ATA_CMD_FLUSH_CACHE       0xE7
+#define ATA_CMD_FLUSH_CACHE_EXT   0xEA
+#define ATA_CMD_IDENTIFY          0xEC
+#define ATA_CMD_READ_DMA          0xC8
+#define ATA_CMD_READ_DMA_EXT      0x25
+#define ATA_CMD_WRITE_DMA         0xCA
+#define ATA_CMD_WRITE_DMA_EXT     0x35
+#define ATA_CMD_SET_FEATURES      0xEF
+#define ATA_FEATURE_XFER_MODE     0x03
+#define ATA_XFER_UDMA             0x40
+
+// Bus-master IDE (BAR4 контроллера, канал — 8 портов)
+#define BM_REG_COMMAND    0
+#define BM_REG_STATUS     2
+#define BM_REG_PRDT       4
+#define BM_CMD_START      0x01
+#define BM_CMD_TO_MEMORY  0x08   // чтение с диска
+#define BM_SR_ACTIVE      0x01
+#define BM_SR_ERROR       0x02
+#define BM_SR_IRQ         0x04
+#define BM_SR_DRIVE0_DMA  0x20
+
+// Записей PRD на канал: таблица 512 байт, выровнена и не пересекает
+// границу 64 КиБ. Одна запись — до 64 КиБ без пересечения этой границы.
+#define ATA_PRD_MAX       64
+#define ATA_PRD_EOT       0x8000
+#define ATA_DMA_BOUNDARY  0x10000u
+
+// Предел одной DMA-команды: непрерывный буфер займёт не больше 17 записей
+#define ATA_DMA_MAX_SECTORS 2048
+
+// Опрос BSY: предел итераций, чтобы отсутствующий диск не повесил загрузку
+#define ATA_POLL_SPINS    10000000
+
+#define ATA_WORDS_PER_SECTOR (BLOCK_SECTOR_SIZE / 2)
+
+typedef struct ata_prd {
+    uint32_t addr;       // физический адрес, чётный
+    uint16_t bytes;      // 0 — 64 КиБ
+    uint16_t flags;      // ATA_PRD_EOT у последней
+} __attribute__((packed)) ata_prd_t;
+
+typedef struct ata_channel {
+    uint16_t io;
+    uint16_t ctrl;
+    uint8_t irq;
+    uint16_t bmide;      // порты bus-master; 0 — DMA нет
+    ata_prd_t *prdt;
+
+    // Канал занят одной командой: остальные спят на idle
+    volatile uint32_t busy;
+    wait_queue_t idle;
+
+    // Обработчик IRQ снимает статус (это же гасит INTRQ) и будит
+    completion_t irq_done;
+    volatile uint32_t irq_status;
+    volatile uint32_t irq_ready;
+} ata_channel_t;
+
+typedef struct ata_drive {
+    ata_channel_t *ch;
+    uint8_t slave;
+    uint8_t lba48;
+    uint16_t multiple;     // секторов на DRQ-блок; 1 — без MULTIPLE
+    uint8_t dma;           // диск и канал умеют bus-master DMA
+    char model[41];
+    block_device_t blk;
+} ata_drive_t;
+
+static ata_channel_t ata_channels[2] = {
+    { .io = 0x1F0, .ctrl = 0x3F6, .irq = 14,
+      .idle = WAIT_QUEUE_INIT, .irq_done = COMPLETION_INIT },
+    { .io = 0x170, .ctrl = 0x376, .irq = 15,
+      .idle = WAIT_QUEUE_INIT, .irq_done = COMPLETION_INIT },
+};
+
+static ata_drive_t ata_drives[4];
+
+static ata_prd_t ata_prdt[2][ATA_PRD_MAX] __attribute__((aligned(ATA_PRD_MAX * sizeof(ata_prd_t))));
+
+static inline uint8_t ata_status(ata_channel_t *ch) {
+    return x86_64_inb(ch->io + ATA_REG_STATUS);
+}
+
+// 400 нс после выбора диска или команды: четыре чтения альтернативного
+// статуса, который не снимает прерывание
+static inline void ata_delay400(ata_channel_t *ch) {
+    for (int i = 0; i < 4; i++) {
+        (void)x86_64_inb(ch->ctrl);
+    }
+}
+
+// Дождаться BSY = 0 опросом; 0xFF — таймаут
+static uint8_t ata_poll(ata_channel_t *ch) {
+    ata_delay400(ch);
+    for (uint32_t i = 0; i < ATA_POLL_SPINS; i++) {
+        uint8_t st = ata_status(ch);
+        if (!(st & ATA_SR_BSY)) return st;
+        cpu_relax();
+    }
+    return 0xFF;
+}
+
+// Дождаться готовности следующего блока: прерывание или опрос
+static uint8_t ata_wait(ata_channel_t *ch, int use_irq) {
+    if (!use_irq) return ata_poll(ch);
+    wait_for_completion(&ch->irq_done);
+    return (uint8_t)atomic_load32_acquire(&ch->irq_status);
+}
+
+static void ata_irq(ata_channel_t *ch) {
+    // Бит прерывания bus-master снимается записью единицы. Бит ошибки
+    // снимается так же — его не трогаем: ata_dma_transfer() прочитает
+    // его после пробуждения
+    if (ch->bmide) {
+        uint8_t bst = x86_64_inb(ch->bmide + BM_REG_STATUS);
+        x86_64_outb(ch->bmide + BM_REG_STATUS, (bst & ~BM_SR_ERROR) | BM_SR_IRQ);
+    }
+    atomic_store32_release(&ch->irq_status, ata_status(ch));
+    complete(&ch->irq_done);
+}
+
+static void ata_irq_primary() {
+    ata_irq(&ata_channels[0]);
+}
+
+static void ata_irq_secondary() {
+    ata_irq(&ata_channels[1]);
+}
+
+static void ata_channel_acquire(ata_channel_t *ch) {
+    while (atomic_xchg32(&ch->busy, 1)) {
+        wait_event(&ch->idle, !atomic_load32(&ch->busy));
+    }
+}
+
+static void ata_channel_release(ata_channel_t *ch) {
+    atomic_store32_release(&ch->busy, 0);
+    wake_up(&ch->idle);
+}
+
+// Прерывания — только если обработчик стоит и CPU может их получить
+static int ata_use_irq(ata_channel_t *ch) {
+    return atomic_load32_acquire(&ch->irq_ready) && arch_irqs_enabled();
+}
+
+// Выбрать диск и задать адрес и число секторов; команду не подаёт
+static void ata_setup(ata_drive_t *d, uint64_t lba, uint32_t count, int use_irq) {
+    ata_channel_t *ch = d->ch;
+
+    x86_64_outb(ch->ctrl, use_irq ? 0 : ATA_CTRL_NIEN);
+    if (d->lba48) {
+        x86_64_outb(ch->io + ATA_REG_DRIVE, 0x40 | (d->slave << 4));
+        ata_delay400(ch);
+        // Сначала старшие байты: регистры двухуровневые (FIFO из двух)
+        x86_64_outb(ch->io + ATA_REG_COUNT, (uint8_t)(count >> 8));
+        x86_64_outb(ch->io + ATA_REG_LBA0, (uint8_t)(lba >> 24));
+        x86_64_outb(ch->io + ATA_REG_LBA1, (uint8_t)(lba >> 32));
+        x86_64_outb(ch->io + ATA_REG_LBA2, (uint8_t)(lba >> 40));
+    } else {
+        x86_64_outb(ch->io + ATA_REG_DRIVE, 0xE0 | (d->slave << 4) | ((lba >> 24) & 0x0F));
+        ata_delay400(ch);
+    }
+    x86_64_outb(ch->io + ATA_REG_COUNT, (uint8_t)count);   // 0 — 256 / 65536
+    x86_64_outb(ch->io + ATA_REG_LBA0, (uint8_t)lba);
+    x86_64_outb(ch->io + ATA_REG_LBA1, (uint8_t)(lba >> 8));
+    x86_64_outb(ch->io + ATA_REG_LBA2, (uint8_t)(lba >> 16));
+}
+
+static uint8_t ata_rw_command(ata_drive_t *d, int write) {
+    int multi = d->multiple > 1;
+    if (write) {
+        if (multi) return d->lba48 ? ATA_CMD_WRITE_MULTIPLE_EXT : ATA_CMD_WRITE_MULTIPLE;
+        return d->lba48 ? ATA_CMD_WRITE_SECTORS_EXT : ATA_CMD_WRITE_SECTORS;
+    }
+    if (multi) return d->lba48 ? ATA_CMD_READ_MULTIPLE_EXT : ATA_CMD_READ_MULTIPLE;
+    return d->lba48 ? ATA_CMD_READ_SECTORS_EXT : ATA_CMD_READ_SECTORS;
+}
+
+static int ata_status_bad(uint8_t st) {
+    return st == 0xFF || (st & (ATA_SR_ERR | ATA_SR_DF));
+}
+
+// Одна команда на count секторов (не больше blk.max_transfer)
+static int ata_transfer(ata_drive_t *d, uint64_t lba, uint32_t count, void *buf,
+                        int write, int allow_irq) {
+    ata_channel_t *ch = d->ch;
+    uint16_t *p = (uint16_t *)buf;
+    int ret = 0;
+
+    ata_channel_acquire(ch);
+    int use_irq = allow_irq && ata_use_irq(ch);
+
+    if (ata_status_bad(ata_poll(ch))) {
+        ata_channel_release(ch);
+        return -1;
+    }
+    ata_setup(d, lba, count, use_irq);
+    reinit_completion(&ch->irq_done);
+    x86_64_outb(ch->io + ATA_REG_COMMAND, ata_rw_command(d, write));
+
+    for (uint32_t done = 0; done < count; ) {
+        uint32_t n = count - done < d->multiple ? count - done : d->multiple;
+        // Первый блок записи диск просит без прерывания
+        uint8_t st = (write && done == 0) ? ata_poll(ch) : ata_wait(ch, use_irq);
+        if (ata_status_bad(st) || !(st & ATA_SR_DRQ)) {
+            ret = -1;
+            break;
+        }
+        if (write) {
+            x86_64_outsw(ch->io + ATA_REG_DATA, p, n * ATA_WORDS_PER_SECTOR);
+        } else {
+            x86_64_insw(ch->io + ATA_REG_DATA, p, n * ATA_WORDS_PER_SECTOR);
+        }
+        p += n * ATA_WORDS_PER_SECTOR;
+        done += n;
+    }
+
+    // После последнего блока записи диск сообщает о завершении
+    if (ret == 0 && write && ata_status_bad(ata_wait(ch, use_irq))) {
+        ret = -1;
+    }
+    ata_channel_release(ch);
+    return ret;
+}
+
+// ---------------------------------------------------------------
+// Bus-master DMA
+// ---------------------------------------------------------------
+
+// Заполнить PRD-таблицу канала. Число записей или -1, если буферы не
+// подходят для DMA (выше 4 ГиБ, нечётный адрес, не хватает записей).
+static int ata_build_prdt(ata_channel_t *ch, const block_seg_t *segs, uint32_t nsegs) {
+    int n = 0;
+    for (uint32_t i = 0; i < nsegs; i++) {
+        uint64_t addr = virt_to_phys(segs[i].buf);
+        uint64_t left = (uint64_t)segs[i].sectors * BLOCK_SECTOR_SIZE;
+        if ((addr & 1) || addr + left > 0x100000000ull) return -1;
+
+        while (left) {
+            if (n >= ATA_PRD_MAX) return -1;
+            uint64_t chunk = ATA_DMA_BOUNDARY - (addr & (ATA_DMA_BOUNDARY - 1));
+            if (chunk > left) chunk = left;
+            ch->prdt[n].addr = (uint32_t)addr;
+            ch->prdt[n].bytes = (uint16_t)chunk;   // 64 КиБ → 0
+            ch->prdt[n].flags = 0;
+            n++;
+            addr += chunk;
+            left -= chunk;
+        }
+    }
+    if (n == 0) return -1;
+    ch->prdt[n - 1].flags = ATA_PRD_EOT;
+    return n;
+}
+
+// Без прерываний: ждём, пока контроллер поднимет бит IRQ или остановится
+static int ata_dma_poll(ata_channel_t *ch) {
+    for (uint32_t i = 0; i < ATA_POLL_SPINS; i++) {
+        uint8_t bst = x86_64_inb(ch->bmide + BM_REG_STATUS);
+        if ((bst & BM_SR_IRQ) || !(bst & BM_SR_ACTIVE)) return 0;
+        cpu_relax();
+    }
+    return -1;
+}
+
+// Одна DMA-команда по списку буферов. 1 — список не подходит для DMA
+// (вызывающий переходит на PIO), -1 — ошибка диска.
+static int ata_dma_transfer(ata_drive_t *d, uint64_t lba, const block_seg_t *segs,
+                            uint32_t nsegs, int write, int allow_irq) {
+    ata_channel_t *ch = d->ch;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < nsegs; i++) {
+        count += segs[i].sectors;
+    }
+    if (!d->dma || count == 0 || count > ATA_DMA_MAX_SECTORS) return 1;
+
+    ata_channel_acquire(ch);
+    if (ata_build_prdt(ch, segs, nsegs) < 0) {
+        ata_channel_release(ch);
+        return 1;
+    }
+    int use_irq = allow_irq && ata_use_irq(ch);
+    uint8_t dir = write ? 0 : BM_CMD_TO_MEMORY;
+
+    x86_64_outb(ch->bmide + BM_REG_COMMAND, 0);
+    x86_64_outl(ch->bmide + BM_REG_PRDT, (uint32_t)virt_to_phys(ch->prdt));
+    x86_64_outb(ch->bmide + BM_REG_STATUS,
+                x86_64_inb(ch->bmide + BM_REG_STATUS) | BM_SR_ERROR | BM_SR_IRQ);
+    x86_64_outb(ch->bmide + BM_REG_COMMAND, dir);
+
+    if (ata_status_bad(ata_poll(ch))) {
+        ata_channel_release(ch);
+        return -1;
+    }
+    ata_setup(d, lba, count, use_irq);
+    reinit_completion(&ch->irq_done);
+    uint8_t cmd = write ? (d->lba48 ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_WRITE_DMA)
+                        : (d->lba48 ? ATA_CMD_READ_DMA_EXT : ATA_CMD_READ_DMA);
+    x86_64_outb(ch->io + ATA_REG_COMMAND, cmd);
+    x86_64_outb(ch->bmide + BM_REG_COMMAND, dir | BM_CMD_START);
+
+    // Данные идут без CPU: он спит до прерывания о конце команды
+    int ret = 0;
+    uint8_t st;
+    if (use_irq) {
+        st = ata_wait(ch, 1);
+    } else {
+        ret = ata_dma_poll(ch);
+        st = ata_poll(ch);
+    }
+
+    x86_64_outb(ch->bmide + BM_REG_COMMAND, dir);
+    uint8_t bst = x86_64_inb(ch->bmide + BM_REG_STATUS);
+    x86_64_outb(ch->bmide + BM_REG_STATUS, bst | BM_SR_ERROR | BM_SR_IRQ);
+    if (ret != 0 || (bst & BM_SR_ERROR) || ata_status_bad(st)) ret = -1;
+
+    ata_channel_release(ch);
+    return ret;
+}
+
+static int ata_rw(ata_drive_t *d, uint64_t lba, uint32_t count, void *buf, int write) {
+    block_seg_t seg = { .buf = buf, .sectors = count };
+    int ret = ata_dma_transfer(d, lba, &seg, 1, write, 1);
+    if (ret <= 0) return ret;
+    return ata_transfer(d, lba, count, buf, write, 1);
+}
+
+static int ata_blk_read(block_device_t *dev, uint64_t lba, uint32_t count, void *buf) {
+    return ata_rw((ata_drive_t *)dev->priv, lba, count, buf, 0);
+}
+
+static int ata_blk_write(block_device_t *dev, uint64_t lba, uint32_t count, const void *buf) {
+    return ata_rw((ata_drive_t *)dev->priv, lba, count, (void *)buf, 1);
+}
+
+// Список, не подходящий для DMA, — BLOCK_SG_UNSUPPORTED: block_rw_sg
+// повторит по сегментам; ошибка диска — -1
+static int ata_blk_rw_sg(block_device_t *dev, uint64_t lba, const block_seg_t *segs,
+                         uint32_t nsegs, int write) {
+    int ret = ata_dma_transfer((ata_drive_t *)dev->priv, lba, segs, nsegs, write, 1);
+    return ret > 0 ? BLOCK_SG_UNSUPPORTED : ret;
+}
+
+static int ata_blk_flush(block_device_t *dev) {
+    ata_drive_t *d = (ata_drive_t *)dev->priv;
+    ata_channel_t *ch = d->ch;
+
+    ata_channel_acquire(ch);
+    int use_irq = ata_use_irq(ch);
+    ata_setup(d, 0, 0, use_irq);
+    reinit_completion(&ch->irq_done);
+    x86_64_outb(ch->io + ATA_REG_COMMAND,
+                d->lba48 ? ATA_CMD_FLUSH_CACHE_EXT : ATA_CMD_FLUSH_CACHE);
+    int ret = ata_status_bad(ata_wait(ch, use_irq)) ? -1 : 0;
+    ata_channel_release(ch);
+    return ret;
+}
+
+// Строки IDENTIFY хранятся словами с переставленными байтами
+static void ata_copy_string(char *dst, const uint16_t *words, int nwords) {
+    int len = 0;
+    for (int i = 0; i < nwords; i++) {
+        dst[len++] = (char)(words[i] >> 8);
+        dst[len++] = (char)(words[i] & 0xFF);
+    }
+    while (len > 0 && dst[len - 1] == ' ') len--;
+    dst[len] = '\0';
+}
+
+// IDENTIFY опросом (прерывания канала ещё выключены). 0 — ATA-диск найден.
+static int ata_identify(ata_channel_t *ch, uint8_t slave, uint16_t id[256]) {
+    x86_64_outb(ch->ctrl, ATA_CTRL_NIEN);
+    x86_64_outb(ch->io + ATA_REG_DRIVE, 0xA0 | (slave << 4));
+    ata_delay400(ch);
+    x86_64_outb(ch->io + ATA_REG_COUNT, 0);
+    x86_64_outb(ch->io + ATA_REG_LBA0, 0);
+    x86_64_outb(ch->io + ATA_REG_LBA1, 0);
+    x86_64_outb(ch->io + ATA_REG_LBA2, 0);
+    x86_64_outb(ch->io + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
+
+    if (ata_status(ch) == 0) return -1;           // диска нет
+    uint8_t st = ata_poll(ch);
+    if (st == 0xFF) return -1;
+    // ATAPI и SATA-PI отвечают сигнатурой в LBA1/LBA2 — не наши
+    if (x86_64_inb(ch->io + ATA_REG_LBA1) || x86_64_inb(ch->io + ATA_REG_LBA2)) return -1;
+    for (uint32_t i = 0; !(st & (ATA_SR_DRQ | ATA_SR_ERR)); i++) {
+        if (i >= ATA_POLL_SPINS) return -1;
+        st = ata_status(ch);
+    }
+    if (st & ATA_SR_ERR) return -1;
+
+    x86_64_insw(ch->io + ATA_REG_DATA, id, 256);
+    return 0;
+}
+
+// Включить самый быстрый режим Ultra DMA, если его не выбрала прошивка.
+// 1 — диск готов к DMA.
+static int ata_set_udma(ata_drive_t *d, const uint16_t *id) {
+    if (!(id[49] & (1u << 8))) return 0;                 // DMA нет
+    if (!(id[53] & (1u << 2)) || !(id[88] & 0x7F)) return 1;   // только multiword
+    if (id[88] & 0x7F00) return 1;                       // режим уже выбран
+
+    uint8_t mode = (uint8_t)(31 - __builtin_clz(id[88] & 0x7F));
+    ata_channel_t *ch = d->ch;
+    x86_64_outb(ch->io + ATA_REG_DRIVE, 0xA0 | (d->slave << 4));
+    ata_delay400(ch);
+    x86_64_outb(ch->io + ATA_REG_FEATURES, ATA_FEATURE_XFER_MODE);
+    x86_64_outb(ch->io + ATA_REG_COUNT, ATA_XFER_UDMA | mode);
+    x86_64_outb(ch->io + ATA_REG_COMMAND, ATA_CMD_SET_FEATURES);
+    return !ata_status_bad(ata_poll(ch));
+}
+
+// Порты bus-master IDE из BAR4 контроллера (класс 01:01, prog-if бит 7)
+static uint16_t ata_find_bmide(void) {
+    pci_device_t *pci = pci_find_class(0x01, 0x01, 0xFF, 0);
+    if (!pci || !(pci->prog_if & 0x80) || !pci_bar_is_io(pci, 4)) return 0;
+    pci_enable(pci, PCI_COMMAND_IO | PCI_COMMAND_MASTER);
+    return (uint16_t)pci_bar(pci, 4);
+}
+
+// Включить READ/WRITE MULTIPLE; 1 — диск их не поддерживает
+static uint16_t ata_set_multiple(ata_drive_t *d, const uint16_t *id) {
+    uint16_t max = id[47] & 0xFF;
+    if (max == 0) return 1;
+    uint16_t n = max < ATA_MAX_MULTIPLE ? max : ATA_MAX_MULTIPLE;
+
+    ata_channel_t *ch = d->ch;
+    x86_64_outb(ch->io + ATA_REG_DRIVE, 0xA0 | (d->slave << 4));
+    ata_delay400(ch);
+    x86_64_outb(ch->io + ATA_REG_COUNT, (uint8_t)n);
+    x86_64_outb(ch->io + ATA_REG_COMMAND, ATA_CMD_SET_MULTIPLE);
+    return ata_status_bad(ata_poll(ch)) ? 1 : n;
+}
+
+void ata_init(void) {
+    static uint16_t id[256];
+    static const char *const names[4] = {"hda", "hdb", "hdc", "hdd"};
+    uint16_t bmide = ata_find_bmide();
+
+    for (int c = 0; c < 2; c++) {
+        ata_channel_t *ch = &ata_channels[c];
+        int found = 0;
+
+        // Плавающая шина (0xFF): контроллера на канале нет
+        if (ata_status(ch) == 0xFF) continue;
+        if (bmide) {
+            ch->bmide = (uint16_t)(bmide + c * 8);
+            ch->prdt = ata_prdt[c];
+        }
+
+        for (uint8_t slave = 0; slave < 2; slave++) {
+            if (ata_identify(ch, slave, id) != 0) continue;
+
+            ata_drive_t *d = &ata_drives[c * 2 + slave];
+            d->ch = ch;
+            d->slave = slave;
+            d->lba48 = (id[83] & (1u << 10)) != 0;
+            ata_copy_string(d->model, &id[27], 20);
+
+            uint64_t sectors = d->lba48
+                ? (uint64_t)id[100] | ((uint64_t)id[101] << 16) |
+                  ((uint64_t)id[102] << 32) | ((uint64_t)id[103] << 48)
+                : (uint64_t)id[60] | ((uint64_t)id[61] << 16);
+            if (sectors == 0) continue;
+
+            d->multiple = ata_set_multiple(d, id);
+            if (ch->bmide && ata_set_udma(d, id)) {
+                d->dma = 1;
+                // Контроллер разрешает DMA диску битом в своём статусе
+                x86_64_outb(ch->bmide + BM_REG_STATUS,
+                            x86_64_inb(ch->bmide + BM_REG_STATUS) | (BM_SR_DRIVE0_DMA << slave));
+            }
+
+            block_device_t *blk = &d->blk;
+            for (int i = 0; names[c * 2 + slave][i]; i++) {
+                blk->name[i] = names[c * 2 + slave][i];
+            }
+            blk->sectors = sectors;
+            blk->sector_size = BLOCK_SECTOR_SIZE;
+            blk->max_transfer = !d->lba48 ? 256 : d->dma ? ATA_DMA_MAX_SECTORS : 65536;
+            blk->read = ata_blk_read;
+            blk->write = ata_blk_write;
+            blk->flush = ata_blk_flush;
+            blk->rw_sg = d->dma ? ata_blk_rw_sg : NULL;
+            blk->priv = d;
+            block_register(blk);
+            found = 1;
+
+            printf("ATA %s: %s, %lu MiB, %s, %u sectors/DRQ, %s\n", blk->name, d->model,
+                   sectors / 2048, d->lba48 ? "LBA48" : "LBA28", d->multiple,
+                   d->dma ? "DMA" : "PIO");
+        }
+
+        if (found && register_interrupt_handler(32 + ch->irq,
+                                                c == 0 ? ata_irq_primary : ata_irq_secondary) == 0) {
+            pic_unmask_irq(ch->irq);
+            atomic_store32_release(&ch->irq_ready, 1);
+        }
+    }
+}
+
+// ---------------------------------------------------------------
+// Замер скорости
+// ---------------------------------------------------------------
+
+#define ATA_BENCH_BYTES  (4u * 1024 * 1024)
+#define ATA_BENCH_CHUNK  128   // секторов за вызов (64 КиБ)
+
+static uint16_t ata_bench_buf[ATA_BENCH_CHUNK * ATA_WORDS_PER_SECTOR];
+
+// Старый драйвер (src/kernel/ata.c): один сектор LBA28 на команду,
+// опрос BSY/DRQ и inw по слову
+static int ata_legacy_read_sector(ata_drive_t *d, uint32_t lba, uint16_t *buf) {
+    ata_channel_t *ch = d->ch;
+    x86_64_outb(ch->ctrl, ATA_CTRL_NIEN);
+    while (ata_status(ch) & ATA_SR_BSY) {
+    }
+    x86_64_outb(ch->io + ATA_REG_DRIVE, 0xE0 | (d->slave << 4) | ((lba >> 24) & 0x0F));
+    x86_64_outb(ch->io + ATA_REG_COUNT, 1);
+    x86_64_outb(ch->io + ATA_REG_LBA0, (uint8_t)lba);
+    x86_64_outb(ch->io + ATA_REG_LBA1, (uint8_t)(lba >> 8));
+    x86_64_outb(ch->io + ATA_REG_LBA2, (uint8_t)(lba >> 16));
+    x86_64_outb(ch->io + ATA_REG_COMMAND, ATA_CMD_READ_SECTORS);
+    x86_64_outb(0x80, 0);
+    while (ata_status(ch) & ATA_SR_BSY) {
+    }
+    uint8_t st;
+    while (!((st = ata_status(ch)) & ATA_SR_DRQ)) {
+        if (st & ATA_SR_ERR) return -1;
+    }
+    for (int i = 0; i < ATA_WORDS_PER_SECTOR; i++) {
+        buf[i] = x86_64_inw(ch->io + ATA_REG_DATA);
+    }
+    return 0;
+}
+
+// МБ/с = байт в микросекунду
+static uint64_t ata_mbps(uint64_t bytes, uint64_t cycles) {
+    uint64_t us = cycles / arch_cycles_per_us();
+    return us ? bytes / us : 0;
+}
+
+void ata_benchmark(void) {
+    ata_drive_t *d = NULL;
+    for (int i = 0; i < 4 && !d; i++) {
+        if (ata_drives[i].ch) d = &ata_drives[i];
+    }
+    if (!d) {
+        printf("ATA bench: no disk\n");
+        return;
+    }
+
+    uint32_t sectors = ATA_BENCH_BYTES / BLOCK_SECTOR_SIZE;
+    if (sectors > d->blk.sectors) sectors = (uint32_t)d->blk.sectors;
+    uint64_t bytes = (uint64_t)sectors * BLOCK_SECTOR_SIZE;
+
+    ata_channel_acquire(d->ch);
+    uint64_t t0 = arch_cycles();
+    for (uint32_t s = 0; s < sectors; s++) {
+        if (ata_legacy_read_sector(d, s, ata_bench_buf) != 0) break;
+    }
+    uint64_t legacy = arch_cycles() - t0;
+    ata_channel_release(d->ch);
+
+    uint64_t cycles[2];
+    for (int irq = 0; irq < 2; irq++) {
+        t0 = arch_cycles();
+        for (uint32_t s = 0; s < sectors; s += ATA_BENCH_CHUNK) {
+            uint32_t n = sectors - s < ATA_BENCH_CHUNK ? sectors - s : ATA_BENCH_CHUNK;
+            if (ata_transfer(d, s, n, ata_bench_buf, 0, irq) != 0) break;
+        }
+        cycles[irq] = arch_cycles() - t0;
+    }
+
+    printf("ATA bench %s, %lu KiB: per-sector %lu MB/s, multiple %lu MB/s (poll), %lu MB/s (irq)\n",
+           d->blk.name, bytes / 1024, ata_mbps(bytes, legacy),
+           ata_mbps(bytes, cycles[0]), ata_mbps(bytes, cycles[1]));
+
+    if (!d->dma) return;
+
+    // DMA: два несмежных полубуфера на команду — PRD-список из двух
+    // частей; CPU только ставит команду и спит до IRQ
+    uint32_t half = ATA_BENCH_CHUNK / 2;
+    block_seg_t segs[2] = {
+        { .buf = ata_bench_buf + half * ATA_WORDS_PER_SECTOR, .sectors = half },
+        { .buf = ata_bench_buf, .sectors = half },
+    };
+    t0 = arch_cycles();
+    for (uint32_t s = 0; s + ATA_BENCH_CHUNK <= sectors; s += ATA_BENCH_CHUNK) {
+        if (ata_dma_transfer(d, s, segs, 2, 0, 1) != 0) break;
+    }
+    uint64_t dma = arch_cycles() - t0;
+    printf("ATA bench %s: DMA scatter-gather %lu MB/s\n", d->blk.name, ata_mbps(bytes, dma));
+}
+
+#else
+// Stub implementation for non-x86 platforms: IDE — только на PC
+
+void ata_init(void) {
+}
+
+void ata_benchmark(void) {
+}
+
+#endif
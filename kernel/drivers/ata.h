@@ -0,0 +1,31 @@
+// ata.h — ATA (IDE) диски: PIO с READ/WRITE MULTIPLE и bus-master DMA, LBA48
+//
+// Драйвер опрашивает оба канала контроллера (0x1F0/IRQ14 и 0x170/IRQ15),
+// для каждого найденного ATA-диска регистрирует блочное устройство
+// hda..hdd. Команды передают до multiple секторов на один запрос
+// данных (DRQ) через rep insw/outsw; готовность блока ждётся прерыванием
+// канала, а до включения прерываний — опросом.
+//
+// Если контроллер PCI IDE умеет bus-master (BAR4), чтение и запись идут
+// по DMA: список буферов описывается PRD-таблицей канала, контроллер сам
+// переносит данные, а CPU ждёт одного прерывания в конце команды.
+// Буферы выше 4 ГиБ и длинные списки уходят в PIO.
+#ifndef ATA_H
+#define ATA_H
+
+#include <stdint.h>
+#include "block.h"
+
+// Секторов на один DRQ-блок READ/WRITE MULTIPLE (не больше заявленного диском)
+#define ATA_MAX_MULTIPLE 16
+
+// Найти диски и зарегистрировать их (после idt_init: ставит обработчики IRQ)
+void ata_init(void);
+
+// Замер скорости чтения первого диска в МБ/с: старый цикл по одному
+// сектору с опросом против READ MULTIPLE с опросом и по прерываниям
+// и DMA по списку из двух буферов.
+// Вызывается после включения прерываний (сборка с ATA_BENCH=1).
+void ata_benchmark(void);
+
+#endif // ATA_H
@@ -0,0 +1,539 @@
+// bio.c — очередь запросов блочного устройства: слияние, plug, выдача
+#include "bio.h"
+#include "../include/arch.h"
+#include "../include/atomic.h"
+#include "../lib/printf.h"
+
+#include <stddef.h>
+
+static request_queue_t queues[BLOCK_MAX_DEVICES];
+static uint32_t queues_used;
+static spinlock_t queues_lock = SPINLOCK_INIT("blk_queues");
+
+static const blk_elevator_t *const elevators[] = {
+    &blk_elv_deadline,
+    &blk_elv_noop,
+};
+
+static int name_eq(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+int blk_queue_init(block_device_t *dev) {
+    spin_lock(&queues_lock);
+    if (queues_used == BLOCK_MAX_DEVICES) {
+        spin_unlock(&queues_lock);
+        return -1;
+    }
+    request_queue_t *q = &queues[queues_used++];
+    spin_unlock(&queues_lock);
+
+    q->dev = dev;
+    spin_lock_init(&q->lock, "blk_queue");
+    wait_queue_init(&q->req_wait);
+    q->free = NULL;
+    for (int i = BLK_QUEUE_REQUESTS - 1; i >= 0; i--) {
+        q->reqs[i].queue = q;
+        q->reqs[i].qnext = q->free;
+        q->free = &q->reqs[i];
+    }
+    q->pending = NULL;
+    q->queued = 0;
+    q->dispatching = 0;
+    q->active = 0;
+    q->resume = NULL;
+    q->busy = 0;
+    q->kicks = 0;
+    q->elv = &blk_elv_deadline;
+    q->elv->init(q);
+    q->iostat.since = arch_cycles();
+    dev->queue = q;
+    return 0;
+}
+
+int blk_queue_set_elevator(block_device_t *dev, const char *name) {
+    request_queue_t *q = dev ? dev->queue : NULL;
+    if (!q) return -1;
+
+    for (uint32_t i = 0; i < sizeof(elevators) / sizeof(elevators[0]); i++) {
+        if (!name_eq(elevators[i]->name, name)) continue;
+
+        arch_irqflags_t flags = spin_lock_irqsave(&q->lock);
+        int ret = -1;
+        if (!q->queued) {
+            q->elv = elevators[i];
+            q->elv->init(q);
+            ret = 0;
+        }
+        spin_unlock_irqrestore(&q->lock, flags);
+        return ret;
+    }
+    return -1;
+}
+
+void blk_queue_get_stats(block_device_t *dev, blk_queue_stats_t *stats) {
+    request_queue_t *q = dev->queue;
+    arch_irqflags_t flags = spin_lock_irqsave(&q->lock);
+    *stats = q->stats;
+    spin_unlock_irqrestore(&q->lock, flags);
+}
+
+void blk_queue_get_iostat(block_device_t *dev, blk_iostat_t *st) {
+    request_queue_t *q = dev->queue;
+    arch_irqflags_t flags = spin_lock_irqsave(&q->lock);
+    *st = q->iostat;
+    spin_unlock_irqrestore(&q->lock, flags);
+}
+
+void blk_queue_reset_iostat(block_device_t *dev) {
+    request_queue_t *q = dev->queue;
+    arch_irqflags_t flags = spin_lock_irqsave(&q->lock);
+    uint32_t inflight = q->iostat.inflight;
+    q->iostat = (blk_iostat_t){ 0 };
+    q->iostat.inflight = q->iostat.max_inflight = inflight;
+    q->iostat.since = arch_cycles();
+    spin_unlock_irqrestore(&q->lock, flags);
+}
+
+// Под q->lock: bio вошёл в очередь
+static void blk_account_queue(request_queue_t *q) {
+    blk_iostat_t *st = &q->iostat;
+    q->stats.bios++;
+    st->inflight++;
+    if (st->inflight > st->max_inflight) st->max_inflight = st->inflight;
+    st->queued++;
+    st->depth_sum += st->inflight;
+}
+
+// Под q->lock: bio завершён со статусом ret в момент now
+static void blk_account_done(request_queue_t *q, bio_t *bio, int ret, uint64_t now,
+                             uint64_t per_us) {
+    blk_iostat_t *st = &q->iostat;
+    int dir = bio->write != 0;
+    st->inflight--;
+    if (ret) {
+        st->errors[dir]++;
+        return;
+    }
+
+    uint64_t us = (now - bio->start) / per_us;
+    uint32_t k = us ? 64 - (uint32_t)__builtin_clzll(us) : 0;
+    if (k >= BLK_LAT_BUCKETS) k = BLK_LAT_BUCKETS - 1;
+    st->ios[dir]++;
+    st->bytes[dir] += (uint64_t)bio->sectors * q->dev->sector_size;
+    st->lat_sum_us[dir] += us;
+    if (us > st->lat_max_us[dir]) st->lat_max_us[dir] = us;
+    st->lat_hist[dir][k]++;
+}
+
+static void bio_endio(bio_t *bio, int status) {
+    bio->status = status;
+    if (bio->end_io) bio->end_io(bio);
+}
+
+static uint8_t *bio_end_buf(request_queue_t *q, bio_t *bio) {
+    return (uint8_t *)bio->buf + (uint64_t)bio->sectors * q->dev->sector_size;
+}
+
+// ---------------------------------------------------------------
+// Постановка: слияние с ожидающим запросом или новый запрос
+// ---------------------------------------------------------------
+
+// Под q->lock. 1 — bio присоединён к запросу.
+static int blk_try_merge(request_queue_t *q, bio_t *bio) {
+    uint32_t max = q->dev->max_transfer;
+
+    for (blk_request_t *rq = q->pending; rq; rq = rq->qnext) {
+        if (rq->write != bio->write || rq->sectors + bio->sectors > max) continue;
+
+        if (rq->lba + rq->sectors == bio->lba) {
+            // Сзади: буфер продолжает последний — тот же сегмент
+            uint32_t segs = rq->nsegs + (bio_end_buf(q, rq->tail) != bio->buf);
+            if (segs > BLK_MAX_SEGS) continue;
+            rq->tail->next = bio;
+            rq->tail = bio;
+            rq->sectors += bio->sectors;
+            rq->nsegs = segs;
+            q->stats.back_merges++;
+            return 1;
+        }
+
+        if (bio->lba + bio->sectors == rq->lba) {
+            uint32_t segs = rq->nsegs + (bio_end_buf(q, bio) != rq->head->buf);
+            if (segs > BLK_MAX_SEGS) continue;
+            bio->next = rq->head;
+            rq->head = bio;
+            rq->lba = bio->lba;
+            rq->sectors += bio->sectors;
+            rq->nsegs = segs;
+            q->stats.front_merges++;
+            q->elv->merged(q, rq);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void blk_run_queue(request_queue_t *q, int async);
+
+// Выдавать ли запросы через submit: завершение придёт прерыванием,
+// только когда прерывания уже включены (монтирование при загрузке
+// идёт раньше — синхронно)
+static int blk_queue_async(request_queue_t *q) {
+    return q->dev->submit && arch_irqs_enabled();
+}
+
+static void blk_queue_bio(request_queue_t *q, bio_t *bio) {
+    bio->next = NULL;
+
+    for (;;) {
+        arch_irqflags_t flags = spin_lock_irqsave(&q->lock);
+        if (blk_try_merge(q, bio)) {
+            blk_account_queue(q);
+            spin_unlock_irqrestore(&q->lock, flags);
+            return;
+        }
+
+        blk_request_t *rq = q->free;
+        if (rq) {
+            q->free = rq->qnext;
+            rq->lba = bio->lba;
+            rq->sectors = bio->sectors;
+            rq->write = bio->write;
+            rq->nsegs = 1;
+            rq->head = rq->tail = bio;
+            rq->split = 0;
+            rq->qprev = NULL;
+            rq->qnext = q->pending;
+            if (q->pending) q->pending->qprev = rq;
+            q->pending = rq;
+            q->queued++;
+            q->elv->add(q, rq);
+            blk_account_queue(q);
+            spin_unlock_irqrestore(&q->lock, flags);
+            return;
+        }
+        spin_unlock_irqrestore(&q->lock, flags);
+
+        // Все запросы заняты: выдать, что можно, и дождаться завершения
+        blk_run_queue(q, blk_queue_async(q));
+        wait_event(&q->req_wait, atomic_load32(&q->queued) < BLK_QUEUE_REQUESTS);
+    }
+}
+
+// ---------------------------------------------------------------
+// Выдача
+// ---------------------------------------------------------------
+
+// Буферы запроса списком сегментов: смежные буферы склеиваются
+static uint32_t blk_build_segs(request_queue_t *q, blk_request_t *rq, block_seg_t *segs) {
+    uint32_t n = 0;
+
+    for (bio_t *bio = rq->head; bio; bio = bio->next) {
+        if (n && (uint8_t *)segs[n - 1].buf +
+                 (uint64_t)segs[n - 1].sectors * q->dev->sector_size == bio->buf) {
+            segs[n - 1].sectors += bio->sectors;
+        } else {
+            segs[n].buf = bio->buf;
+            segs[n].sectors = bio->sectors;
+            n++;
+        }
+    }
+    return n;
+}
+
+static int blk_dispatch(request_queue_t *q, blk_request_t *rq) {
+    block_seg_t segs[BLK_MAX_SEGS];
+    uint32_t n = blk_build_segs(q, rq, segs);
+    return block_rw_sg(q->dev, rq->lba, segs, n, rq->write);
+}
+
+// Запрос завершён со статусом ret: счётчики, вернуть запрос, end_io.
+// Запрос возвращается до end_io: обработчик освобождает bio, а
+// ждущий свободного запроса может продолжить сразу.
+static void blk_complete(request_queue_t *q, blk_request_t *rq, int ret) {
+    uint64_t now = arch_cycles();
+    uint64_t per_us = arch_cycles_per_us();
+
+    bio_t *bio = rq->head;
+    arch_irqflags_t flags = spin_lock_irqsave(&q->lock);
+    for (bio_t *b = bio; b; b = b->next) {
+        blk_account_done(q, b, ret, now, per_us);
+    }
+    rq->qnext = q->free;
+    q->free = rq;
+    q->queued--;
+    q->active--;
+    q->busy = 0;
+    q->kicks++;
+    spin_unlock_irqrestore(&q->lock, flags);
+    wake_up(&q->req_wait);
+
+    while (bio) {
+        bio_t *next = bio->next;   // end_io может освободить bio
+        bio_endio(bio, ret);
+        bio = next;
+    }
+}
+
+// Под q->lock: запрос снова ждёт выдачи, раньше планировщика
+static void blk_requeue(request_queue_t *q, blk_request_t *rq) {
+    q->active--;
+    rq->snext = q->resume;
+    q->resume = rq;
+}
+
+// Завершение команды submit (обработчик прерывания диска)
+static void blk_cmd_done(block_cmd_t *cmd, int status) {
+    blk_request_t *rq = (blk_request_t *)cmd->private;
+    request_queue_t *q = rq->queue;
+
+    if (status == 0 && rq->split) {
+        block_seg_t segs[BLK_MAX_SEGS];
+        uint32_t n = blk_build_segs(q, rq, segs);
+        rq->seg_lba += segs[rq->seg].sectors;
+        if (++rq->seg < n) {
+            // Следующий сегмент — той же очередью выдачи
+            arch_irqflags_t flags = spin_lock_irqsave(&q->lock);
+            blk_requeue(q, rq);
+            q->busy = 0;
+            q->kicks++;
+            spin_unlock_irqrestore(&q->lock, flags);
+            blk_run_queue(q, 1);
+            return;
+        }
+    }
+
+    blk_complete(q, rq, status);
+    blk_run_queue(q, 1);
+}
+
+// Поставить запрос командой submit. 0 — поставлен или уже завершён
+// с ошибкой, BLOCK_BUSY — у драйвера нет слота.
+static int blk_issue(request_queue_t *q, blk_request_t *rq) {
+    block_seg_t segs[BLK_MAX_SEGS];
+    uint32_t n = blk_build_segs(q, rq, segs);
+    block_cmd_t *cmd = &rq->cmd;
+
+    cmd->write = rq->write;
+    cmd->done = blk_cmd_done;
+    cmd->private = rq;
+    for (;;) {
+        if (rq->split) {
+            cmd->lba = rq->seg_lba;
+            cmd->segs = &segs[rq->seg];
+            cmd->nsegs = 1;
+        } else {
+            cmd->lba = rq->lba;
+            cmd->segs = segs;
+            cmd->nsegs = n;
+        }
+
+        int ret = q->dev->submit(q->dev, cmd);
+        if (ret == 0 || ret == BLOCK_BUSY) return ret;
+        // Как block_rw_sg: неподходящий список — по сегментам, ошибку
+        // диска не повторяем
+        if (ret == BLOCK_SG_UNSUPPORTED && !rq->split && n > 1) {
+            rq->split = 1;
+            rq->seg = 0;
+            rq->seg_lba = rq->lba;
+            continue;
+        }
+        blk_complete(q, rq, -1);
+        return 0;
+    }
+}
+
+// Под q->lock: есть ли что выдавать
+static int blk_queue_ready(request_queue_t *q, int async) {
+    if (q->busy || (async && q->active >= q->dev->queue_depth)) return 0;
+    return q->queued > q->active;
+}
+
+// Выдавать запросы, пока они есть (и, с submit, пока у диска есть
+// слоты). Диспетчер один: если им уже кто-то работает, он заберёт и
+// наши запросы. async — выдавать через submit; из завершения — всегда.
+static void blk_run_queue(request_queue_t *q, int async) {
+    for (;;) {
+        if (atomic_xchg32(&q->dispatching, 1)) return;
+
+        for (;;) {
+            arch_irqflags_t flags = spin_lock_irqsave(&q->lock);
+            if (!blk_queue_ready(q, async)) {
+                spin_unlock_irqrestore(&q->lock, flags);
+                break;
+            }
+            blk_request_t *rq = q->resume;
+            if (rq) {
+                q->resume = rq->snext;
+            } else {
+                rq = q->elv->next(q);
+                if (rq->qprev) rq->qprev->qnext = rq->qnext;
+                else q->pending = rq->qnext;
+                if (rq->qnext) rq->qnext->qprev = rq->qprev;
+                q->stats.requests++;
+                q->stats.sectors += rq->sectors;
+            }
+            q->active++;
+            uint32_t kicks = q->kicks;
+            spin_unlock_irqrestore(&q->lock, flags);
+
+            if (!async) {
+                blk_complete(q, rq, blk_dispatch(q, rq));
+                continue;
+            }
+            if (blk_issue(q, rq) == BLOCK_BUSY) {
+                // Слот мог освободиться, пока шёл submit: тогда сразу ещё раз
+                flags = spin_lock_irqsave(&q->lock);
+                blk_requeue(q, rq);
+                if (q->kicks == kicks) q->busy = 1;
+                spin_unlock_irqrestore(&q->lock, flags);
+            }
+        }
+
+        atomic_store32_release(&q->dispatching, 0);
+        smp_mb();
+        // Запрос, поставленный или завершённый между последней
+        // проверкой и сбросом флага, никто не выдаст — его отправитель
+        // видел нас
+        arch_irqflags_t flags = spin_lock_irqsave(&q->lock);
+        int again = blk_queue_ready(q, async);
+        spin_unlock_irqrestore(&q->lock, flags);
+        if (!again) return;
+    }
+}
+
+void blk_queue_kick(block_device_t *dev) {
+    request_queue_t *q = dev->queue;
+    if (!q) return;
+
+    arch_irqflags_t flags = spin_lock_irqsave(&q->lock);
+    int busy = q->busy;
+    q->busy = 0;
+    q->kicks++;
+    spin_unlock_irqrestore(&q->lock, flags);
+    if (busy) blk_run_queue(q, 1);
+}
+
+// ---------------------------------------------------------------
+// Отправка и plug
+// ---------------------------------------------------------------
+
+static int bio_valid(bio_t *bio) {
+    block_device_t *dev = bio->dev;
+    return dev && dev->queue && bio->sectors && bio->lba <= dev->sectors &&
+           bio->sectors <= dev->sectors - bio->lba &&
+           bio->sectors <= dev->max_transfer && (!bio->write || dev->write);
+}
+
+void blk_start_plug(blk_plug_t *plug) {
+    plug->head = plug->tail = NULL;
+    plug->count = 0;
+}
+
+void blk_finish_plug(blk_plug_t *plug) {
+    // Сначала поставить всё (чтобы слилось), потом выдать: каждую
+    // затронутую очередь — один раз
+    request_queue_t *touched[BLOCK_MAX_DEVICES];
+    uint32_t ntouched = 0;
+
+    bio_t *bio = plug->head;
+    plug->head = plug->tail = NULL;
+    plug->count = 0;
+
+    while (bio) {
+        bio_t *next = bio->next;
+        request_queue_t *q = bio->dev->queue;
+        blk_queue_bio(q, bio);
+
+        uint32_t i = 0;
+        while (i < ntouched && touched[i] != q) i++;
+        if (i == ntouched) touched[ntouched++] = q;
+        bio = next;
+    }
+
+    for (uint32_t i = 0; i < ntouched; i++) {
+        blk_run_queue(touched[i], blk_queue_async(touched[i]));
+    }
+}
+
+void submit_bio(blk_plug_t *plug, bio_t *bio) {
+    bio->next = NULL;
+    bio->status = 0;
+    bio->start = arch_cycles();
+    if (!bio_valid(bio)) {
+        bio_endio(bio, -1);
+        return;
+    }
+
+    if (!plug) {
+        request_queue_t *q = bio->dev->queue;
+        blk_queue_bio(q, bio);
+        blk_run_queue(q, blk_queue_async(q));
+        return;
+    }
+
+    if (plug->tail) plug->tail->next = bio;
+    else plug->head = bio;
+    plug->tail = bio;
+    if (++plug->count >= BLK_PLUG_MAX) {
+        blk_finish_plug(plug);
+    }
+}
+
+static void bio_end_wait(bio_t *bio) {
+    complete((completion_t *)bio->private);
+}
+
+int submit_bio_wait(bio_t *bio) {
+    completion_t done = COMPLETION_INIT;
+    bio->end_io = bio_end_wait;
+    bio->private = &done;
+    submit_bio(NULL, bio);
+    wait_for_completion(&done);
+    return bio->status;
+}
+
+// ---------------------------------------------------------------
+// Экспорт счётчиков
+// ---------------------------------------------------------------
+
+static void blk_iostat_dump_dir(const char *name, const blk_iostat_t *st, int dir,
+                                uint64_t us) {
+    static const char *const dir_names[2] = { "read", "write" };
+    uint64_t ios = st->ios[dir];
+    if (!ios && !st->errors[dir]) return;
+
+    serial_printf("%s %s: %lu ios, %lu KiB, %lu iops, %lu MB/s, lat avg %lu us max %lu us, "
+                  "%lu errors\n", name, dir_names[dir], ios, st->bytes[dir] / 1024,
+                  us ? ios * 1000000 / us : 0, us ? st->bytes[dir] / us : 0,
+                  ios ? st->lat_sum_us[dir] / ios : 0, st->lat_max_us[dir], st->errors[dir]);
+    for (uint32_t k = 0; k < BLK_LAT_BUCKETS; k++) {
+        uint64_t n = st->lat_hist[dir][k];
+        if (!n) continue;
+        uint64_t lo = k ? 1ull << (k - 1) : 0;
+        if (k == BLK_LAT_BUCKETS - 1) serial_printf("  >= %lu us: %lu\n", lo, n);
+        else serial_printf("  %lu-%lu us: %lu\n", lo, (1ull << k) - 1, n);
+    }
+}
+
+void blk_iostat_dump(void) {
+    uint64_t per_us = arch_cycles_per_us();
+
+    serial_printf("=== block I/O stats ===\n");
+    for (block_device_t *dev = block_first(); dev; dev = dev->next) {
+        if (!dev->queue) continue;
+        blk_iostat_t st;
+        blk_queue_get_iostat(dev, &st);
+        uint64_t us = (arch_cycles() - st.since) / per_us;
+
+        serial_printf("%s: inflight %u, max depth %u, avg depth %lu\n", dev->name,
+                      st.inflight, st.max_inflight, st.queued ? st.depth_sum / st.queued : 0);
+        blk_iostat_dump_dir(dev->name, &st, 0, us);
+        blk_iostat_dump_dir(dev->name, &st, 1, us);
+    }
+}
@@ -0,0 +1,216 @@
+// bio.h — блочный слой: bio, очередь запросов со слиянием, plug, планировщики
+//
+// Файловые системы и кэш описывают ввод-вывод как bio: диапазон
+// секторов и буфер. Очередь устройства собирает bio в запросы:
+// bio, продолжающий запрос (слияние сзади) или стоящий вплотную перед
+// ним (слияние спереди), присоединяется к нему, и диск получает одну
+// команду вместо нескольких. Буферы соседних bio идут одним списком
+// сегментов (block_rw_sg).
+//
+// Чтобы было что сливать, отправитель «затыкает» поток (plug): bio
+// копятся в blk_plug_t у вызывающего и попадают в очередь разом в
+// blk_finish_plug(). Без plug bio уходит на диск сразу.
+//
+// Порядок выдачи запросов задаёт планировщик очереди:
+//   noop     — FIFO, только слияние (NVMe, virtio: у них своя очередь);
+//   deadline — проход по возрастанию LBA пачками, чтения важнее
+//              записей, но запрос не ждёт дольше своего срока.
+//
+// Запросы выдаёт один из отправителей («диспетчер»), остальные только
+// ставят их. Если драйвер умеет submit, диспетчер ставит на диск до
+// queue_depth команд и возвращается, не дожидаясь их: завершение
+// приходит из обработчика прерывания, возвращает запрос, вызывает
+// end_io и тут же выдаёт следующий. Так NCQ, очереди NVMe и кольцо
+// virtio заняты, пока в очереди есть запросы. Без submit (ATA) и до
+// включения прерываний диспетчер выдаёт запросы по одному через rw_sg
+// и сам ждёт каждый.
+//
+// end_io поэтому может выполняться в обработчике прерывания: спать и
+// отправлять из него bio нельзя. Отправлять bio из обработчиков
+// прерываний тоже нельзя (постановка ждёт свободного запроса).
+//
+// Очередь ведёт счётчики ввода-вывода устройства (blk_iostat_t):
+// операции, байты, глубину очереди и гистограмму задержек от
+// submit_bio() до завершения по TSC. Так сравниваются ATA, AHCI, NVMe
+// и virtio на одной нагрузке. Вызовы block_read/block_write в обход
+// очереди не учитываются.
+#ifndef BIO_H
+#define BIO_H
+
+#include <stdint.h>
+#include "block.h"
+#include "../lib/sync/spinlock.h"
+#include "../lib/sync/wait.h"
+
+// Запросов на очередь (ожидающих выдачи)
+#define BLK_QUEUE_REQUESTS 64
+
+// Сегментов в одном запросе
+#define BLK_MAX_SEGS 32
+
+// bio в одном plug до принудительного сброса
+#define BLK_PLUG_MAX 64
+
+// Корзин гистограммы задержек: k-я — [2^(k-1), 2^k) мкс, 0-я — меньше
+// 1 мкс, последняя — всё, что дольше
+#define BLK_LAT_BUCKETS 24
+
+// deadline: сроки чтения и записи (мс), длина пачки и сколько пачек
+// чтений может обогнать ждущие записи
+#define DEADLINE_READ_EXPIRE_MS  500
+#define DEADLINE_WRITE_EXPIRE_MS 5000
+#define DEADLINE_FIFO_BATCH      16
+#define DEADLINE_WRITES_STARVED  2
+
+typedef struct bio bio_t;
+
+struct bio {
+    block_device_t *dev;
+    uint64_t lba;
+    uint32_t sectors;
+    void *buf;
+    int write;
+
+    // Вызывается по завершении со status 0/-1: в контексте диспетчера
+    // или из обработчика прерывания диска
+    void (*end_io)(bio_t *bio);
+    void *private;
+    int status;
+    uint64_t start;            // arch_cycles() отправки (счётчики)
+
+    bio_t *next;               // в запросе или в plug
+};
+
+typedef struct blk_request {
+    uint64_t lba;
+    uint32_t sectors;
+    int write;
+    uint32_t nsegs;            // сегментов после склейки смежных буферов
+    bio_t *head, *tail;
+    uint64_t deadline;         // arch_cycles() истечения срока
+
+    // Выдача через submit. Список, который драйвер не принял
+    // (BLOCK_SG_UNSUPPORTED), выдаётся по сегменту: seg — текущий.
+    block_cmd_t cmd;
+    struct request_queue *queue;
+    int split;
+    uint32_t seg;
+    uint64_t seg_lba;
+
+    struct blk_request *qnext, *qprev;   // все ожидающие: поиск слияний
+    struct blk_request *snext, *sprev;   // список планировщика
+    struct blk_request *fnext, *fprev;   // FIFO сроков (deadline)
+} blk_request_t;
+
+typedef struct request_queue request_queue_t;
+
+typedef struct blk_elevator {
+    const char *name;
+    void (*init)(request_queue_t *q);
+    void (*add)(request_queue_t *q, blk_request_t *rq);
+    // Начало запроса сдвинулось (слияние спереди)
+    void (*merged)(request_queue_t *q, blk_request_t *rq);
+    // Вынуть следующий запрос для выдачи или NULL
+    blk_request_t *(*next)(request_queue_t *q);
+} blk_elevator_t;
+
+typedef struct blk_queue_stats {
+    uint64_t bios;
+    uint64_t back_merges;
+    uint64_t front_merges;
+    uint64_t requests;         // выдано команд
+    uint64_t sectors;
+} blk_queue_stats_t;
+
+// Счётчики устройства; массивы — по направлению (0 — чтение, 1 — запись)
+typedef struct blk_iostat {
+    uint64_t ios[2];           // завершено успешно
+    uint64_t bytes[2];
+    uint64_t errors[2];
+    uint64_t lat_sum_us[2];
+    uint64_t lat_max_us[2];
+    uint64_t lat_hist[2][BLK_LAT_BUCKETS];
+    uint32_t inflight;         // bio в очереди и на диске
+    uint32_t max_inflight;
+    uint64_t queued;           // bio, прошедших очередь
+    uint64_t depth_sum;        // сумма inflight при постановке
+    uint64_t since;            // arch_cycles() начала отсчёта
+} blk_iostat_t;
+
+struct request_queue {
+    block_device_t *dev;
+    const blk_elevator_t *elv;
+
+    // Всё ниже, кроме dispatching, — под lock; его берёт и завершение
+    // из обработчика прерывания
+    spinlock_t lock;
+    blk_request_t reqs[BLK_QUEUE_REQUESTS];
+    blk_request_t *free;
+    blk_request_t *pending;    // список qnext/qprev
+    volatile uint32_t queued;  // занятых запросов
+    wait_queue_t req_wait;     // ждут свободного запроса
+    volatile uint32_t dispatching;
+
+    // Выданные и ещё не завершённые запросы. Запросы resume (список
+    // snext) выдаются раньше планировщика: их не принял submit или у
+    // них остались сегменты. busy — submit ответил BLOCK_BUSY: ждать
+    // завершения или blk_queue_kick; kicks считает их, чтобы не
+    // пропустить пришедшее во время submit.
+    volatile uint32_t active;
+    blk_request_t *resume;
+    volatile uint32_t busy;
+    uint32_t kicks;
+
+    // Данные планировщика (iosched.c): noop — только fifo[0];
+    // deadline — по направлению (0 — чтение, 1 — запись)
+    blk_request_t *sort[2];
+    blk_request_t *fifo[2], *fifo_tail[2];
+    uint64_t pos;              // следующий сектор прохода
+    uint32_t batch;
+    uint32_t starved;
+    int dir;
+
+    blk_queue_stats_t stats;
+    blk_iostat_t iostat;
+};
+
+// Сборка bio у отправителя
+typedef struct blk_plug {
+    bio_t *head, *tail;
+    uint32_t count;
+} blk_plug_t;
+
+extern const blk_elevator_t blk_elv_noop;
+extern const blk_elevator_t blk_elv_deadline;
+
+// Создать очередь устройства (из block_register), планировщик — deadline
+int blk_queue_init(block_device_t *dev);
+
+// Сменить планировщик ("noop", "deadline"). Только на пустой очереди.
+int blk_queue_set_elevator(block_device_t *dev, const char *name);
+
+void blk_queue_get_stats(block_device_t *dev, blk_queue_stats_t *stats);
+
+// Снимок счётчиков ввода-вывода / обнулить их (inflight сохраняется)
+void blk_queue_get_iostat(block_device_t *dev, blk_iostat_t *st);
+void blk_queue_reset_iostat(block_device_t *dev);
+
+// Экспорт в COM-порт: по каждому устройству IOPS, МБ/с, глубина
+// очереди и гистограммы задержек чтения и записи
+void blk_iostat_dump(void);
+
+// Драйвер освободил слоты, занятые в обход очереди: выдать запросы,
+// которым submit ответил BLOCK_BUSY. Можно из обработчика прерывания.
+void blk_queue_kick(block_device_t *dev);
+
+void blk_start_plug(blk_plug_t *plug);
+void blk_finish_plug(blk_plug_t *plug);
+
+// Отправить bio (не длиннее max_transfer); plug == NULL — сразу на
+// диск. end_io вызывается всегда, в том числе при ошибке диапазона.
+void submit_bio(blk_plug_t *plug, bio_t *bio);
+
+// Отправить без plug и дождаться. Возвращает status.
+int submit_bio_wait(bio_t *bio);
+
+#endif // BIO_H
@@ -0,0 +1,102 @@
+// block.c — реестр блочных устройств и разбиение запросов на команды
+#include "block.h"
+#include "bio.h"
+#include "../lib/sync/spinlock.h"
+
+#include <stddef.h>
+
+static block_device_t *block_devices;
+static spinlock_t block_list_lock = SPINLOCK_INIT("block_list");
+
+static int name_eq(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+int block_register(block_device_t *dev) {
+    if (!dev || !dev->read || !dev->sector_size || !dev->max_transfer) return -1;
+    if (blk_queue_init(dev) != 0) return -1;
+
+    spin_lock(&block_list_lock);
+    // В конец списка: устройства перечисляются в порядке обнаружения
+    block_device_t **link = &block_devices;
+    while (*link) link = &(*link)->next;
+    dev->next = NULL;
+    *link = dev;
+    spin_unlock(&block_list_lock);
+    return 0;
+}
+
+block_device_t *block_first(void) {
+    return block_devices;
+}
+
+block_device_t *block_get(const char *name) {
+    for (block_device_t *dev = block_devices; dev; dev = dev->next) {
+        if (name_eq(dev->name, name)) return dev;
+    }
+    return NULL;
+}
+
+static int block_in_range(block_device_t *dev, uint64_t lba, uint32_t count) {
+    return dev && lba <= dev->sectors && count <= dev->sectors - lba;
+}
+
+int block_read(block_device_t *dev, uint64_t lba, uint32_t count, void *buf) {
+    if (!block_in_range(dev, lba, count)) return -1;
+
+    uint8_t *p = (uint8_t *)buf;
+    while (count) {
+        uint32_t n = count < dev->max_transfer ? count : dev->max_transfer;
+        if (dev->read(dev, lba, n, p) != 0) return -1;
+        lba += n;
+        count -= n;
+        p += (uint64_t)n * dev->sector_size;
+    }
+    return 0;
+}
+
+int block_write(block_device_t *dev, uint64_t lba, uint32_t count, const void *buf) {
+    if (!block_in_range(dev, lba, count) || !dev->write) return -1;
+
+    const uint8_t *p = (const uint8_t *)buf;
+    while (count) {
+        uint32_t n = count < dev->max_transfer ? count : dev->max_transfer;
+        if (dev->write(dev, lba, n, p) != 0) return -1;
+        lba += n;
+        count -= n;
+        p += (uint64_t)n * dev->sector_size;
+    }
+    return 0;
+}
+
+int block_flush(block_device_t *dev) {
+    if (!dev) return -1;
+    return dev->flush ? dev->flush(dev) : 0;
+}
+
+int block_rw_sg(block_device_t *dev, uint64_t lba, const block_seg_t *segs,
+                uint32_t nsegs, int write) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < nsegs; i++) {
+        total += segs[i].sectors;
+    }
+    if (!dev || total > dev->sectors || lba > dev->sectors - total) return -1;
+
+    // Ошибку диска не повторяем: по сегментам — только неподходящий список
+    if (dev->rw_sg && total <= dev->max_transfer) {
+        int ret = dev->rw_sg(dev, lba, segs, nsegs, write);
+        if (ret != BLOCK_SG_UNSUPPORTED) return ret == 0 ? 0 : -1;
+    }
+
+    for (uint32_t i = 0; i < nsegs; i++) {
+        int ret = write ? block_write(dev, lba, segs[i].sectors, segs[i].buf)
+                        : block_read(dev, lba, segs[i].sectors, segs[i].buf);
+        if (ret != 0) return -1;
+        lba += segs[i].sectors;
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+// block.h — блочные устройства: общий интерфейс дисковых драйверов
+//
+// Драйвер заполняет block_device_t и регистрирует его; остальное ядро
+// обращается к диску только через block_read/block_write, не зная,
+// ATA это или что-то другое. Размер сектора и предел одной команды
+// задаёт драйвер; block_read/block_write проверяют диапазон и режут
+// большой запрос на команды не длиннее max_transfer.
+//
+// Вызовы могут спать (ждать прерывания диска), поэтому из обработчиков
+// прерываний и под спин-блокировкой их делать нельзя. Исключение —
+// submit: он ставит команду и возвращается, не дожидаясь диска; так
+// очередь bio (bio.h) держит на диске столько команд, сколько тот
+// принимает.
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include <stdint.h>
+
+#define BLOCK_SECTOR_SIZE 512
+#define BLOCK_NAME_MAX    8
+#define BLOCK_MAX_DEVICES 16
+
+// Сегмент разнесённого (scatter-gather) запроса: целые сектора
+typedef struct block_seg {
+    void *buf;
+    uint32_t sectors;
+} block_seg_t;
+
+// rw_sg, submit: список не подходит устройству (не ошибка ввода-вывода)
+#define BLOCK_SG_UNSUPPORTED 1
+
+// submit: свободных слотов нет, повторить после завершения
+#define BLOCK_BUSY           2
+
+// Команда асинхронной выдачи. Сегменты действительны только на время
+// submit: драйвер переносит их в свою таблицу (PRDT, PRP, дескрипторы).
+typedef struct block_cmd {
+    uint64_t lba;
+    const block_seg_t *segs;
+    uint32_t nsegs;
+    int write;
+
+    // Завершение со status 0/-1 — из обработчика прерывания диска
+    // (или опроса), не из submit
+    void (*done)(struct block_cmd *cmd, int status);
+    void *private;
+} block_cmd_t;
+
+typedef struct block_device {
+    char name[BLOCK_NAME_MAX];
+    uint64_t sectors;            // размер в секторах
+    uint32_t sector_size;
+    uint32_t max_transfer;       // секторов в одной команде
+
+    // 0 — успех, -1 — ошибка. count не больше max_transfer.
+    int (*read)(struct block_device *dev, uint64_t lba, uint32_t count, void *buf);
+    int (*write)(struct block_device *dev, uint64_t lba, uint32_t count, const void *buf);
+    int (*flush)(struct block_device *dev);   // сброс кэша записи; может быть NULL
+
+    // Один запрос на несколько буферов (DMA по списку). Может быть NULL,
+    // тогда block_rw_sg передаёт сегменты по одному. Сумма секторов
+    // не больше max_transfer; -1 — ошибка диска, BLOCK_SG_UNSUPPORTED —
+    // такой список драйвер не принимает: вызывающий повторит по сегментам.
+    int (*rw_sg)(struct block_device *dev, uint64_t lba,
+                 const block_seg_t *segs, uint32_t nsegs, int write);
+
+    // Поставить команду и вернуться, не засыпая; вызывается и из done.
+    // NULL, если завершения не приходят прерыванием, — тогда очередь
+    // выдаёт запросы по одному через rw_sg. 0 — поставлена, -1 —
+    // ошибка, BLOCK_SG_UNSUPPORTED — как у rw_sg, BLOCK_BUSY — слоты
+    // заняты (освобождая слоты команд в обход очереди — flush, read —
+    // драйвер зовёт blk_queue_kick). Сумма секторов не больше max_transfer.
+    int (*submit)(struct block_device *dev, block_cmd_t *cmd);
+    uint32_t queue_depth;        // команд submit в полёте одновременно
+
+    void *priv;                  // данные драйвера
+    struct request_queue *queue; // очередь bio (bio.h), создаёт block_register
+    struct block_device *next;
+} block_device_t;
+
+// Зарегистрировать устройство (при инициализации драйвера)
+int block_register(block_device_t *dev);
+
+// Устройство по имени или NULL; block_first() — начало списка (->next)
+block_device_t *block_get(const char *name);
+block_device_t *block_first(void);
+
+int block_read(block_device_t *dev, uint64_t lba, uint32_t count, void *buf);
+int block_write(block_device_t *dev, uint64_t lba, uint32_t count, const void *buf);
+int block_flush(block_device_t *dev);
+
+// Прочитать (write = 0) или записать подряд идущие сектора с lba в
+// несмежные буферы
+int block_rw_sg(block_device_t *dev, uint64_t lba, const block_seg_t *segs,
+                uint32_t nsegs, int write);
+
+#endif // BLOCK_H
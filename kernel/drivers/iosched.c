@@ -0,0 +1,157 @@
+// iosched.c — планировщики очереди запросов: noop и deadline
+//
+// Вызываются под q->lock.
+#include "bio.h"
+#include "../include/arch.h"
+
+#include <stddef.h>
+
+static void fifo_append(request_queue_t *q, int dir, blk_request_t *rq) {
+    rq->fnext = NULL;
+    rq->fprev = q->fifo_tail[dir];
+    if (q->fifo_tail[dir]) q->fifo_tail[dir]->fnext = rq;
+    else q->fifo[dir] = rq;
+    q->fifo_tail[dir] = rq;
+}
+
+static void fifo_remove(request_queue_t *q, int dir, blk_request_t *rq) {
+    if (rq->fprev) rq->fprev->fnext = rq->fnext;
+    else q->fifo[dir] = rq->fnext;
+    if (rq->fnext) rq->fnext->fprev = rq->fprev;
+    else q->fifo_tail[dir] = rq->fprev;
+}
+
+static void elv_reset(request_queue_t *q) {
+    for (int dir = 0; dir < 2; dir++) {
+        q->sort[dir] = NULL;
+        q->fifo[dir] = q->fifo_tail[dir] = NULL;
+    }
+    q->pos = 0;
+    q->batch = 0;
+    q->starved = 0;
+    q->dir = 0;
+}
+
+// ---------------------------------------------------------------
+// noop: порядок поступления (fifo[0]), только слияние
+// ---------------------------------------------------------------
+
+static void noop_add(request_queue_t *q, blk_request_t *rq) {
+    fifo_append(q, 0, rq);
+}
+
+static void noop_merged(request_queue_t *q, blk_request_t *rq) {
+    (void)q;
+    (void)rq;
+}
+
+static blk_request_t *noop_next(request_queue_t *q) {
+    blk_request_t *rq = q->fifo[0];
+    if (rq) fifo_remove(q, 0, rq);
+    return rq;
+}
+
+const blk_elevator_t blk_elv_noop = {
+    .name = "noop",
+    .init = elv_reset,
+    .add = noop_add,
+    .merged = noop_merged,
+    .next = noop_next,
+};
+
+// ---------------------------------------------------------------
+// deadline: по направлению — список по LBA и FIFO сроков
+//
+// Запросы выдаются пачками до DEADLINE_FIFO_BATCH штук в одном
+// направлении, по возрастанию LBA от текущей позиции головки. Новая
+// пачка — чтения, если записи ещё не пропустили
+// DEADLINE_WRITES_STARVED пачек подряд. Пачка начинается с самого
+// старого запроса, если его срок вышел, иначе продолжает проход.
+// ---------------------------------------------------------------
+
+static void sort_insert(request_queue_t *q, blk_request_t *rq) {
+    int dir = rq->write != 0;
+    blk_request_t *prev = NULL, *cur = q->sort[dir];
+    while (cur && cur->lba <= rq->lba) {
+        prev = cur;
+        cur = cur->snext;
+    }
+    rq->sprev = prev;
+    rq->snext = cur;
+    if (cur) cur->sprev = rq;
+    if (prev) prev->snext = rq;
+    else q->sort[dir] = rq;
+}
+
+static void sort_remove(request_queue_t *q, blk_request_t *rq) {
+    int dir = rq->write != 0;
+    if (rq->sprev) rq->sprev->snext = rq->snext;
+    else q->sort[dir] = rq->snext;
+    if (rq->snext) rq->snext->sprev = rq->sprev;
+}
+
+static void deadline_add(request_queue_t *q, blk_request_t *rq) {
+    int dir = rq->write != 0;
+    uint64_t ms = dir ? DEADLINE_WRITE_EXPIRE_MS : DEADLINE_READ_EXPIRE_MS;
+    rq->deadline = arch_cycles() + ms * 1000 * arch_cycles_per_us();
+    sort_insert(q, rq);
+    fifo_append(q, dir, rq);
+}
+
+static void deadline_merged(request_queue_t *q, blk_request_t *rq) {
+    // Начало сдвинулось влево: место в списке по LBA могло измениться
+    sort_remove(q, rq);
+    sort_insert(q, rq);
+}
+
+// Первый запрос направления с LBA не меньше pos
+static blk_request_t *deadline_after(request_queue_t *q, int dir, uint64_t pos) {
+    blk_request_t *rq = q->sort[dir];
+    while (rq && rq->lba < pos) rq = rq->snext;
+    return rq;
+}
+
+static blk_request_t *deadline_next(request_queue_t *q) {
+    int reads = q->sort[0] != NULL;
+    int writes = q->sort[1] != NULL;
+    if (!reads && !writes) return NULL;
+
+    blk_request_t *rq = NULL;
+    if (q->batch) {
+        rq = deadline_after(q, q->dir, q->pos);
+    }
+
+    if (!rq) {
+        int dir;
+        if (reads && (!writes || q->starved < DEADLINE_WRITES_STARVED)) {
+            dir = 0;
+            if (writes) q->starved++;
+        } else {
+            dir = 1;
+            q->starved = 0;
+        }
+
+        if (arch_cycles() >= q->fifo[dir]->deadline) {
+            rq = q->fifo[dir];
+        } else {
+            rq = deadline_after(q, dir, q->pos);
+            if (!rq) rq = q->sort[dir];   // конец диска: проход с начала
+        }
+        q->dir = dir;
+        q->batch = DEADLINE_FIFO_BATCH;
+    }
+
+    q->batch--;
+    q->pos = rq->lba + rq->sectors;
+    sort_remove(q, rq);
+    fifo_remove(q, rq->write != 0, rq);
+    return rq;
+}
+
+const blk_elevator_t blk_elv_deadline = {
+    .name = "deadline",
+    .init = elv_reset,
+    .add = deadline_add,
+    .merged = deadline_merged,
+    .next = deadline_next,
+};
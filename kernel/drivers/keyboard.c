@@ -7,10 +7,21 @@
 #include "../arch/x86_64/idt.h"
 #include "../drivers/vga.h"
 #include "../lib/printf.h"
+#include "../lib/sync/spinlock.h"
+#include "../lib/sync/wait.h"
 
 #define PORT_KEYDATA 0x60
 #define PORT_KEYSTATUS 0x64
 
+// Буфер введённых символов между IRQ1 и читателями (степень двойки)
+#define KBD_BUFFER_SIZE 128
+
+static char kbd_buffer[KBD_BUFFER_SIZE];
+static uint32_t kbd_head;   // пишет обработчик IRQ1
+static uint32_t kbd_tail;   // читают keyboard_getchar()
+static spinlock_t kbd_lock = SPINLOCK_INIT("keyboard");
+static wait_queue_t kbd_wait = WAIT_QUEUE_INIT;
+
 char keymap[128] = {
     0,  27, '1','2','3','4','5','6', '7','8','9','0','-','=', '\b','\t',
     'q','w','e','r','t','y','u','i','o','p','[',']','\n', 0, 'a','s',
@@ -32,11 +43,6 @@ static void inline_keyboard_read(uint8_t *scancode) {
     *scancode = val;
 }
 
-static void inline_keyboard_eoi(void) {
-    // Send EOI (End of Interrupt) to PIC
-    asm volatile("outb %0, $0x20" : : "a" ((unsigned char)0x20));
-}
-
 void keyboard_callback() {
     uint8_t scancode = 0;
     inline_keyboard_read(&scancode);
@@ -46,11 +52,35 @@ void keyboard_callback() {
         if (c) {
             // Печатаем символ на VGA
             vga_putc_color(c, vga_entry_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK));
+
+            // Буфер полон — самые новые нажатия теряются
+            spin_lock(&kbd_lock);  // прерывания уже запрещены
+            if (kbd_head - kbd_tail < KBD_BUFFER_SIZE) {
+                kbd_buffer[kbd_head++ & (KBD_BUFFER_SIZE - 1)] = c;
+            }
+            spin_unlock(&kbd_lock);
+            wake_up(&kbd_wait);
         }
     }
 
-    // EOI для PIC
-    inline_keyboard_eoi();
+    // EOI отправляет общий irq_handler после всей цепочки обработчиков
+}
+
+int keyboard_try_getchar(void) {
+    int c = -1;
+    arch_irqflags_t flags = spin_lock_irqsave(&kbd_lock);
+    if (kbd_tail != kbd_head) {
+        c = (unsigned char)kbd_buffer[kbd_tail++ & (KBD_BUFFER_SIZE - 1)];
+    }
+    spin_unlock_irqrestore(&kbd_lock, flags);
+    return c;
+}
+
+// Вместо опроса порта 0x64 читатель спит до IRQ1
+char keyboard_getchar(void) {
+    int c;
+    wait_event(&kbd_wait, (c = keyboard_try_getchar()) >= 0);
+    return (char)c;
 }
 
 #else
@@ -64,4 +94,13 @@ void keyboard_callback() {
     // No-op on non-x86 platforms
 }
 
+int keyboard_try_getchar(void) {
+    return -1;
+}
+
+char keyboard_getchar(void) {
+    // Клавиатуры нет: ждать нечего
+    return 0;
+}
+
 #endif
@@ -13,4 +13,11 @@ void keyboard_init();
 // Функция-обработчик (вызывается из irq_handler)
 void keyboard_callback();
 
+// Следующий введённый символ или -1, если буфер пуст
+int keyboard_try_getchar(void);
+
+// Дождаться введённого символа (спит до IRQ1; нельзя вызывать из
+// обработчика прерывания)
+char keyboard_getchar(void);
+
 #endif // KEYBOARD_H
@@ -0,0 +1,721 @@
+// nvme.c — NVMe: admin-очередь, пары SQ/CQ по CPU, PRP/SGL, MSI-X
+#include "nvme.h"
+
+#if defined(__x86_64__) || defined(__amd64__)
+
+#include "../include/arch.h"
+#include "../include/atomic.h"
+#include "../include/memory.h"
+#include "../include/smp.h"
+#include "../arch/x86_64/idt.h"
+#include "../arch/x86_64/lapic.h"
+#include "../arch/x86_64/paging.h"
+#include "bio.h"
+#include "pci.h"
+#include "../lib/printf.h"
+#include "../lib/sync/spinlock.h"
+
+#include <stddef.h>
+
+// Регистры контроллера (BAR0)
+#define NVME_REG_CAP      0x00
+#define NVME_REG_CC       0x14
+#define NVME_REG_CSTS     0x1C
+#define NVME_REG_AQA      0x24
+#define NVME_REG_ASQ      0x28
+#define NVME_REG_ACQ      0x30
+#define NVME_DOORBELL     0x1000
+
+#define NVME_CC_EN        (1u << 0)
+#define NVME_CC_IOSQES    (6u << 16)   // элемент SQ — 64 байта
+#define NVME_CC_IOCQES    (4u << 20)   // элемент CQ — 16 байт
+#define NVME_CSTS_RDY     (1u << 0)
+#define NVME_CSTS_CFS     (1u << 1)
+
+#define NVME_ADMIN_CREATE_SQ    0x01
+#define NVME_ADMIN_CREATE_CQ    0x05
+#define NVME_ADMIN_IDENTIFY     0x06
+#define NVME_ADMIN_SET_FEATURES 0x09
+#define NVME_FEAT_NUM_QUEUES    0x07
+#define NVME_FEAT_IRQ_COALESCE  0x08
+
+#define NVME_CMD_FLUSH    0x00
+#define NVME_CMD_WRITE    0x01
+#define NVME_CMD_READ     0x02
+
+#define NVME_QUEUE_PC     (1u << 0)    // очередь непрерывна в памяти
+#define NVME_QUEUE_IEN    (1u << 1)    // CQ: прерывания включены
+
+// CDW0: данные описаны SGL (PSDT = 01)
+#define NVME_PSDT_SGL     (1u << 14)
+#define NVME_SGL_DATA     0x00
+#define NVME_SGL_LAST_SEG 0x30
+
+#define NVME_PAGE         4096u
+
+// На команду — 256 байт под список PRP (32 страницы) или 16
+// дескрипторов SGL
+#define NVME_SCRATCH_WORDS 32
+#define NVME_SGL_MAX       (NVME_SCRATCH_WORDS / 2)
+#define NVME_MAX_SECTORS   (NVME_SCRATCH_WORDS * NVME_PAGE / BLOCK_SECTOR_SIZE)
+
+// Ожидание CSTS.RDY: CAP.TO бывает и в десятки секунд, но предел нужен
+#define NVME_POLL_SPINS   200000000
+
+typedef struct nvme_sqe {
+    uint32_t cdw0;           // opcode, PSDT, CID
+    uint32_t nsid;
+    uint64_t reserved;
+    uint64_t mptr;
+    uint64_t prp1;           // или первые 8 байт дескриптора SGL
+    uint64_t prp2;
+    uint32_t cdw10, cdw11, cdw12, cdw13, cdw14, cdw15;
+} __attribute__((packed)) nvme_sqe_t;
+
+typedef struct nvme_cqe {
+    uint32_t dw0;
+    uint32_t dw1;
+    uint16_t sq_head;
+    uint16_t sq_id;
+    uint16_t cid;
+    uint16_t status;         // бит 0 — фаза, выше — код
+} __attribute__((packed)) nvme_cqe_t;
+
+typedef struct nvme_sgl {
+    uint64_t addr;
+    uint32_t length;
+    uint8_t reserved[3];
+    uint8_t type;
+} __attribute__((packed)) nvme_sgl_t;
+
+typedef struct nvme_queue {
+    uint16_t qid;
+    uint16_t entries;
+    nvme_sqe_t *sq;
+    volatile nvme_cqe_t *cq;
+    uint64_t (*scratch)[NVME_SCRATCH_WORDS];
+    volatile uint32_t *sq_doorbell;
+    volatile uint32_t *cq_doorbell;
+
+    // Всё ниже — под lock; его берёт и обработчик прерывания
+    spinlock_t lock;
+    uint16_t sq_tail;
+    uint16_t cq_head;
+    uint8_t cq_phase;
+    volatile uint64_t free_cids;   // свободные идентификаторы команд
+    nvme_req_t *reqs[NVME_QUEUE_ENTRIES];
+    wait_queue_t cid_wait;
+
+    // Запросы команд очереди bio: по одному на идентификатор
+    nvme_req_t cmd_reqs[NVME_QUEUE_ENTRIES];
+} nvme_queue_t;
+
+typedef struct { nvme_sqe_t e[NVME_QUEUE_ENTRIES]; } __attribute__((aligned(NVME_PAGE))) nvme_sq_mem_t;
+typedef struct { nvme_cqe_t e[NVME_QUEUE_ENTRIES]; } __attribute__((aligned(NVME_PAGE))) nvme_cq_mem_t;
+
+// Очередь 0 — admin, 1..NVME_MAX_QUEUES — ввод-вывод
+static nvme_sq_mem_t nvme_sq_mem[NVME_MAX_QUEUES + 1];
+static nvme_cq_mem_t nvme_cq_mem[NVME_MAX_QUEUES + 1];
+static uint64_t nvme_scratch[NVME_MAX_QUEUES + 1][NVME_QUEUE_ENTRIES][NVME_SCRATCH_WORDS]
+    __attribute__((aligned(NVME_PAGE)));
+static uint8_t nvme_identify_buf[NVME_PAGE] __attribute__((aligned(NVME_PAGE)));
+
+typedef struct nvme_ctrl {
+    volatile uint32_t *regs;
+    uint32_t doorbell_stride;      // байт
+    uint16_t entries;
+    uint8_t sgl;                   // контроллер понимает SGL
+    uint32_t nqueues;
+    nvme_queue_t admin;
+    nvme_queue_t io[NVME_MAX_QUEUES];
+    volatile uint32_t irq_ready;
+    block_device_t blk;
+} nvme_ctrl_t;
+
+static nvme_ctrl_t nvme;
+
+static inline uint32_t nvme_read(uint32_t reg) {
+    return nvme.regs[reg / 4];
+}
+
+static inline void nvme_write(uint32_t reg, uint32_t val) {
+    nvme.regs[reg / 4] = val;
+}
+
+static inline void nvme_write64(uint32_t reg, uint64_t val) {
+    nvme_write(reg, (uint32_t)val);
+    nvme_write(reg + 4, (uint32_t)(val >> 32));
+}
+
+static int nvme_wait_ready(uint32_t ready) {
+    for (uint32_t i = 0; i < NVME_POLL_SPINS; i++) {
+        uint32_t csts = nvme_read(NVME_REG_CSTS);
+        if (csts & NVME_CSTS_CFS) return -1;
+        if ((csts & NVME_CSTS_RDY) == ready) return 0;
+        cpu_relax();
+    }
+    return -1;
+}
+
+static int nvme_use_irq(void) {
+    return atomic_load32_acquire(&nvme.irq_ready) && arch_irqs_enabled();
+}
+
+static void nvme_queue_init(nvme_queue_t *q, uint16_t qid) {
+    q->qid = qid;
+    q->entries = nvme.entries;
+    q->sq = nvme_sq_mem[qid].e;
+    q->cq = nvme_cq_mem[qid].e;
+    q->scratch = nvme_scratch[qid];
+    q->sq_doorbell = nvme.regs + (NVME_DOORBELL + (2u * qid) * nvme.doorbell_stride) / 4;
+    q->cq_doorbell = nvme.regs + (NVME_DOORBELL + (2u * qid + 1) * nvme.doorbell_stride) / 4;
+    q->sq_tail = 0;
+    q->cq_head = 0;
+    q->cq_phase = 1;
+    // Одна команда меньше размера кольца: полная SQ неотличима от пустой
+    q->free_cids = (1ull << (q->entries - 1)) - 1;
+    spin_lock_init(&q->lock, "nvme_queue");
+    wait_queue_init(&q->cid_wait);
+}
+
+// Снять все новые завершения и подтвердить их одной записью головы CQ.
+// Из обработчика прерывания и из опроса.
+static void nvme_queue_reap(nvme_queue_t *q) {
+    nvme_req_t *done[NVME_QUEUE_ENTRIES];
+    int ndone = 0;
+    // Команды очереди bio: их идентификатор может занять следующая
+    // команда ещё до конца разбора, поэтому команда и статус — копией
+    block_cmd_t *cmds[NVME_QUEUE_ENTRIES];
+    int cmd_status[NVME_QUEUE_ENTRIES];
+    int ncmds = 0;
+    uint64_t freed = 0;
+    int reaped = 0;
+
+    arch_irqflags_t flags = spin_lock_irqsave(&q->lock);
+    for (;;) {
+        volatile nvme_cqe_t *cqe = &q->cq[q->cq_head];
+        uint16_t status = cqe->status;
+        if ((status & 1) != q->cq_phase) break;
+        smp_rmb();
+
+        uint16_t cid = cqe->cid;
+        uint32_t result = cqe->dw0;
+        if (++q->cq_head == q->entries) {
+            q->cq_head = 0;
+            q->cq_phase ^= 1;
+        }
+        reaped++;
+        if (cid >= NVME_QUEUE_ENTRIES || !q->reqs[cid]) continue;
+
+        nvme_req_t *req = q->reqs[cid];
+        q->reqs[cid] = NULL;
+        req->result = result;
+        req->status = (status >> 1) ? -1 : 0;
+        freed |= 1ull << cid;
+        if (req->cmd) {
+            cmd_status[ncmds] = req->status;
+            cmds[ncmds++] = req->cmd;
+        } else {
+            done[ndone++] = req;
+        }
+    }
+    if (reaped) *q->cq_doorbell = q->cq_head;
+    q->free_cids |= freed;
+    spin_unlock_irqrestore(&q->lock, flags);
+
+    for (int i = 0; i < ndone; i++) {
+        complete(&done[i]->done);
+    }
+    if (freed) wake_up(&q->cid_wait);
+    for (int i = 0; i < ncmds; i++) {
+        cmds[i]->done(cmds[i], cmd_status[i]);
+    }
+    // Идентификаторы команд в обход очереди bio свободны: её команды,
+    // получившие BLOCK_BUSY, могут встать
+    if (ndone && q->qid != 0) blk_queue_kick(&nvme.blk);
+}
+
+static void nvme_irq_admin() {
+    nvme_queue_reap(&nvme.admin);
+}
+
+// Один вектор на всё: проверяются все очереди
+static void nvme_irq_all() {
+    nvme_queue_reap(&nvme.admin);
+    for (uint32_t i = 0; i < nvme.nqueues; i++) {
+        nvme_queue_reap(&nvme.io[i]);
+    }
+}
+
+#define NVME_QUEUE_IRQ(n) \
+static void nvme_irq_q##n() { nvme_queue_reap(&nvme.io[n]); }
+
+NVME_QUEUE_IRQ(0)
+NVME_QUEUE_IRQ(1)
+NVME_QUEUE_IRQ(2)
+NVME_QUEUE_IRQ(3)
+NVME_QUEUE_IRQ(4)
+NVME_QUEUE_IRQ(5)
+NVME_QUEUE_IRQ(6)
+NVME_QUEUE_IRQ(7)
+
+static void (*const nvme_queue_irqs[NVME_MAX_QUEUES])() = {
+    nvme_irq_q0, nvme_irq_q1, nvme_irq_q2, nvme_irq_q3,
+    nvme_irq_q4, nvme_irq_q5, nvme_irq_q6, nvme_irq_q7,
+};
+
+// Буфер запроса как список сегментов
+static const block_seg_t *nvme_req_segs(nvme_req_t *req, block_seg_t *one, uint32_t *nsegs) {
+    if (req->nsegs) {
+        *nsegs = req->nsegs;
+        return req->segs;
+    }
+    one->buf = req->buf;
+    one->sectors = req->count;
+    *nsegs = req->buf && req->count ? 1 : 0;
+    return one;
+}
+
+// Укладываются ли сегменты в PRP: внутри списка страницы сплошные,
+// поэтому сегмент, кроме первого, начинается с границы страницы, а
+// кроме последнего — на ней кончается
+static int nvme_prp_fits(const block_seg_t *segs, uint32_t nsegs) {
+    uint32_t pages = 0;
+    for (uint32_t i = 0; i < nsegs; i++) {
+        uint64_t addr = virt_to_phys(segs[i].buf);
+        uint64_t len = (uint64_t)segs[i].sectors * BLOCK_SECTOR_SIZE;
+        if (addr & 3) return 0;
+        if (i > 0 && (addr & (NVME_PAGE - 1))) return 0;
+        if (i + 1 < nsegs && ((addr + len) & (NVME_PAGE - 1))) return 0;
+        pages += (uint32_t)(((addr & (NVME_PAGE - 1)) + len + NVME_PAGE - 1) / NVME_PAGE);
+    }
+    return pages <= NVME_SCRATCH_WORDS + 1;
+}
+
+static int nvme_sgl_fits(uint32_t nsegs) {
+    return nvme.sgl && nsegs <= NVME_SGL_MAX;
+}
+
+static void nvme_build_prp(nvme_sqe_t *sqe, uint64_t *list, const block_seg_t *segs, uint32_t nsegs) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < nsegs; i++) {
+        uint64_t addr = virt_to_phys(segs[i].buf);
+        uint64_t len = (uint64_t)segs[i].sectors * BLOCK_SECTOR_SIZE;
+        while (len) {
+            uint64_t chunk = NVME_PAGE - (addr & (NVME_PAGE - 1));
+            if (chunk > len) chunk = len;
+            if (n == 0) {
+                sqe->prp1 = addr;
+            } else {
+                list[n - 1] = addr;
+            }
+            n++;
+            addr += chunk;
+            len -= chunk;
+        }
+    }
+    // Две страницы — PRP2 и есть вторая; больше — PRP2 указывает на список
+    if (n == 2) {
+        sqe->prp2 = list[0];
+    } else if (n > 2) {
+        sqe->prp2 = virt_to_phys(list);
+    }
+}
+
+static void nvme_build_sgl(nvme_sqe_t *sqe, uint64_t *scratch, const block_seg_t *segs, uint32_t nsegs) {
+    sqe->cdw0 |= NVME_PSDT_SGL;
+    if (nsegs == 1) {
+        sqe->prp1 = virt_to_phys(segs[0].buf);
+        sqe->prp2 = (uint64_t)segs[0].sectors * BLOCK_SECTOR_SIZE |
+                    ((uint64_t)NVME_SGL_DATA << 56);
+        return;
+    }
+    nvme_sgl_t *list = (nvme_sgl_t *)scratch;
+    for (uint32_t i = 0; i < nsegs; i++) {
+        list[i] = (nvme_sgl_t){ .addr = virt_to_phys(segs[i].buf),
+                                .length = segs[i].sectors * BLOCK_SECTOR_SIZE,
+                                .type = NVME_SGL_DATA };
+    }
+    sqe->prp1 = virt_to_phys(list);
+    sqe->prp2 = (uint64_t)(nsegs * sizeof(nvme_sgl_t)) | ((uint64_t)NVME_SGL_LAST_SEG << 56);
+}
+
+static void nvme_build(nvme_queue_t *q, uint16_t cid, nvme_req_t *req, nvme_sqe_t *sqe) {
+    *sqe = (nvme_sqe_t){ .cdw0 = req->opcode | ((uint32_t)cid << 16), .nsid = req->nsid };
+
+    if (q->qid != 0 && (req->opcode == NVME_CMD_READ || req->opcode == NVME_CMD_WRITE)) {
+        sqe->cdw10 = (uint32_t)req->lba;
+        sqe->cdw11 = (uint32_t)(req->lba >> 32);
+        sqe->cdw12 = req->count - 1;      // число блоков с нуля
+    } else {
+        sqe->cdw10 = req->cdw10;
+        sqe->cdw11 = req->cdw11;
+        sqe->prp1 = req->prp1;
+    }
+
+    block_seg_t one;
+    uint32_t nsegs;
+    const block_seg_t *segs = nvme_req_segs(req, &one, &nsegs);
+    if (nsegs == 0) return;
+    if (nvme_prp_fits(segs, nsegs)) {
+        nvme_build_prp(sqe, q->scratch[cid], segs, nsegs);
+    } else {
+        nvme_build_sgl(sqe, q->scratch[cid], segs, nsegs);
+    }
+}
+
+// Под q->lock: положить запрос в SQ под свободным cid (doorbell — за
+// вызывающим)
+static void nvme_queue_put(nvme_queue_t *q, uint16_t cid, nvme_req_t *req) {
+    q->free_cids &= ~(1ull << cid);
+    req->cid = cid;
+    req->queue = q;
+    req->status = NVME_REQ_PENDING;
+    reinit_completion(&req->done);
+    q->reqs[cid] = req;
+    nvme_build(q, cid, req, &q->sq[q->sq_tail]);
+    if (++q->sq_tail == q->entries) q->sq_tail = 0;
+}
+
+// Положить запросы в SQ и сдвинуть хвост одной записью doorbell на
+// всё, что поместилось. Если идентификаторы кончились — ждать их.
+static void nvme_queue_submit(nvme_queue_t *q, nvme_req_t **reqs, uint32_t n) {
+    uint32_t i = 0;
+    while (i < n) {
+        arch_irqflags_t flags = spin_lock_irqsave(&q->lock);
+        uint16_t start = q->sq_tail;
+        while (i < n && q->free_cids) {
+            nvme_queue_put(q, (uint16_t)__builtin_ctzll(q->free_cids), reqs[i++]);
+        }
+        if (q->sq_tail != start) {
+            smp_wmb();   // элементы SQ видны контроллеру до doorbell
+            *q->sq_doorbell = q->sq_tail;
+        }
+        spin_unlock_irqrestore(&q->lock, flags);
+
+        if (i < n) {
+            if (nvme_use_irq()) {
+                wait_event(&q->cid_wait, atomic_load64(&q->free_cids) != 0);
+            } else {
+                nvme_queue_reap(q);
+                cpu_relax();
+            }
+        }
+    }
+}
+
+int nvme_wait(nvme_req_t *req) {
+    nvme_queue_t *q = (nvme_queue_t *)req->queue;
+    if (!nvme_use_irq()) {
+        while (!completion_done(&req->done)) {
+            nvme_queue_reap(q);
+            cpu_relax();
+        }
+    }
+    wait_for_completion(&req->done);
+    return req->status;
+}
+
+// Команда администрирования с ожиданием; buf — одна страница или NULL
+static int nvme_admin(uint8_t opcode, uint32_t nsid, uint32_t cdw10, uint32_t cdw11,
+                      uint64_t prp1, void *buf, uint32_t *result) {
+    nvme_req_t req = {
+        .buf = buf, .count = buf ? NVME_PAGE / BLOCK_SECTOR_SIZE : 0,
+        .opcode = opcode, .nsid = nsid, .cdw10 = cdw10, .cdw11 = cdw11,
+        .prp1 = prp1, .done = COMPLETION_INIT,
+    };
+    nvme_req_t *r = &req;
+    nvme_queue_submit(&nvme.admin, &r, 1);
+    int ret = nvme_wait(&req);
+    if (result) *result = req.result;
+    return ret;
+}
+
+// Пара своего CPU; если пар меньше, чем CPU, соседние CPU делят пару
+static nvme_queue_t *nvme_cpu_queue(void) {
+    return &nvme.io[smp_cpu_id() % nvme.nqueues];
+}
+
+static int nvme_prepare(nvme_req_t *req) {
+    if (req->count == 0 || req->count > nvme.blk.max_transfer ||
+        req->lba + req->count > nvme.blk.sectors) {
+        return -1;
+    }
+    block_seg_t one;
+    uint32_t nsegs;
+    const block_seg_t *segs = nvme_req_segs(req, &one, &nsegs);
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < nsegs; i++) {
+        total += segs[i].sectors;
+    }
+    if (nsegs == 0 || total != req->count) return -1;
+    if (!nvme_prp_fits(segs, nsegs) && !nvme_sgl_fits(nsegs)) return -1;
+
+    req->opcode = req->write ? NVME_CMD_WRITE : NVME_CMD_READ;
+    req->nsid = 1;
+    return 0;
+}
+
+int nvme_submit(block_device_t *dev, nvme_req_t **reqs, uint32_t n) {
+    if (dev != &nvme.blk || nvme.nqueues == 0) return -1;
+    for (uint32_t i = 0; i < n; i++) {
+        if (nvme_prepare(reqs[i]) < 0) return -1;
+        reqs[i]->cmd = NULL;
+    }
+    nvme_queue_submit(nvme_cpu_queue(), reqs, n);
+    return 0;
+}
+
+static int nvme_rw(const block_seg_t *segs, uint32_t nsegs, uint64_t lba, int write) {
+    nvme_req_t req = { .lba = lba, .segs = segs, .nsegs = nsegs, .write = write,
+                       .done = COMPLETION_INIT };
+    for (uint32_t i = 0; i < nsegs; i++) {
+        req.count += segs[i].sectors;
+    }
+    if (nvme_prepare(&req) < 0) return -1;
+    nvme_req_t *r = &req;
+    nvme_queue_submit(nvme_cpu_queue(), &r, 1);
+    return nvme_wait(&req);
+}
+
+static int nvme_blk_read(block_device_t *dev, uint64_t lba, uint32_t count, void *buf) {
+    (void)dev;
+    block_seg_t seg = { .buf = buf, .sectors = count };
+    return nvme_rw(&seg, 1, lba, 0);
+}
+
+static int nvme_blk_write(block_device_t *dev, uint64_t lba, uint32_t count, const void *buf) {
+    (void)dev;
+    block_seg_t seg = { .buf = (void *)buf, .sectors = count };
+    return nvme_rw(&seg, 1, lba, 1);
+}
+
+static int nvme_blk_rw_sg(block_device_t *dev, uint64_t lba, const block_seg_t *segs,
+                          uint32_t nsegs, int write) {
+    (void)dev;
+    if (!nvme_prp_fits(segs, nsegs) && !nvme_sgl_fits(nsegs)) return BLOCK_SG_UNSUPPORTED;
+    return nvme_rw(segs, nsegs, lba, write);
+}
+
+// Команда очереди bio: в пару своего CPU, только если есть свободный cid
+static int nvme_blk_submit(block_device_t *dev, block_cmd_t *cmd) {
+    (void)dev;
+    if (!nvme_prp_fits(cmd->segs, cmd->nsegs) && !nvme_sgl_fits(cmd->nsegs)) {
+        return BLOCK_SG_UNSUPPORTED;
+    }
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < cmd->nsegs; i++) {
+        count += cmd->segs[i].sectors;
+    }
+
+    nvme_queue_t *q = nvme_cpu_queue();
+    arch_irqflags_t flags = spin_lock_irqsave(&q->lock);
+    if (!q->free_cids) {
+        spin_unlock_irqrestore(&q->lock, flags);
+        return BLOCK_BUSY;
+    }
+    uint16_t cid = (uint16_t)__builtin_ctzll(q->free_cids);
+    nvme_req_t *req = &q->cmd_reqs[cid];
+    *req = (nvme_req_t){ .lba = cmd->lba, .count = count, .segs = cmd->segs,
+                         .nsegs = cmd->nsegs, .write = cmd->write, .cmd = cmd,
+                         .opcode = cmd->write ? NVME_CMD_WRITE : NVME_CMD_READ, .nsid = 1 };
+    nvme_queue_put(q, cid, req);
+    smp_wmb();
+    *q->sq_doorbell = q->sq_tail;
+    spin_unlock_irqrestore(&q->lock, flags);
+    return 0;
+}
+
+static int nvme_blk_flush(block_device_t *dev) {
+    (void)dev;
+    nvme_req_t req = { .opcode = NVME_CMD_FLUSH, .nsid = 1, .done = COMPLETION_INIT };
+    nvme_req_t *r = &req;
+    nvme_queue_submit(nvme_cpu_queue(), &r, 1);
+    return nvme_wait(&req);
+}
+
+// Векторы: по MSI-X на очередь, если их хватает, иначе один на всё
+// (MSI-X или INTx). Все векторы идут на загрузочный CPU: APIC других
+// CPU ядро пока не включает. Возвращает число векторов, 0 — опрос.
+static uint32_t nvme_setup_irq(pci_device_t *pci, uint32_t nqueues) {
+    if (lapic_enabled() && pci_msix_count(pci) >= nqueues + 1) {
+        int vectors[NVME_MAX_QUEUES + 1];
+        uint32_t done = 0;     // элементов с вектором, обработчиком и записью
+        int vector = -1, handler = 0;
+        for (; done <= nqueues; done++) {
+            void (*irq)() = done ? nvme_queue_irqs[done - 1] : nvme_irq_admin;
+            vector = idt_alloc_vector();
+            if (vector < 0) break;
+            handler = register_interrupt_handler(vector, irq) == 0;
+            if (!handler || pci_enable_msix(pci, (uint16_t)done, lapic_msi_address(),
+                                            lapic_msi_data((uint8_t)vector)) != 0) {
+                break;
+            }
+            vectors[done] = vector;
+        }
+        if (done > nqueues) return nqueues + 1;
+
+        // Откат: элемент, на котором сорвалось, затем включённые до него
+        if (vector >= 0) {
+            if (handler) {
+                unregister_interrupt_handler(vector, done ? nvme_queue_irqs[done - 1] : nvme_irq_admin);
+            }
+            idt_free_vector(vector);
+        }
+        while (done--) {
+            pci_mask_msix(pci, (uint16_t)done);
+            unregister_interrupt_handler(vectors[done], done ? nvme_queue_irqs[done - 1] : nvme_irq_admin);
+            idt_free_vector(vectors[done]);
+        }
+        pci_disable_msix(pci);
+    }
+    if (lapic_enabled() && pci_msix_count(pci) >= 1) {
+        int vector = idt_alloc_vector();
+        if (vector >= 0) {
+            int handler = register_interrupt_handler(vector, nvme_irq_all) == 0;
+            if (handler &&
+                pci_enable_msix(pci, 0, lapic_msi_address(), lapic_msi_data((uint8_t)vector)) == 0) {
+                return 1;
+            }
+            if (handler) unregister_interrupt_handler(vector, nvme_irq_all);
+            idt_free_vector(vector);
+        }
+    }
+    if (pci->irq_line < 16 && register_interrupt_handler(32 + pci->irq_line, nvme_irq_all) == 0) {
+        pic_unmask_irq(pci->irq_line);
+        return 1;
+    }
+    return 0;
+}
+
+void nvme_init(void) {
+    pci_device_t *pci = pci_find_class(0x01, 0x08, 0x02, 0);
+    if (!pci || pci_bar_is_io(pci, 0)) return;
+    uint64_t bar = pci_bar(pci, 0);
+    if (!bar) return;
+    pci_enable(pci, PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER);
+
+    nvme.regs = (volatile uint32_t *)ioremap(bar, NVME_DOORBELL);
+    if (!nvme.regs) return;
+    uint64_t cap = nvme_read(NVME_REG_CAP) | ((uint64_t)nvme_read(NVME_REG_CAP + 4) << 32);
+    if (!((cap >> 37) & 1) || ((cap >> 48) & 0xF) != 0) {
+        printf("NVMe: no NVM command set or 4 KiB pages\n");
+        return;
+    }
+    nvme.doorbell_stride = 4u << ((cap >> 32) & 0xF);
+    uint32_t mqes = (uint32_t)(cap & 0xFFFF) + 1;
+    nvme.entries = (uint16_t)(mqes < NVME_QUEUE_ENTRIES ? mqes : NVME_QUEUE_ENTRIES);
+    if (!ioremap(bar, NVME_DOORBELL + 2 * (NVME_MAX_QUEUES + 1) * nvme.doorbell_stride)) return;
+
+    // Сброс и запуск с admin-очередью
+    nvme_write(NVME_REG_CC, 0);
+    if (nvme_wait_ready(0) < 0) return;
+    nvme_queue_init(&nvme.admin, 0);
+    nvme_write(NVME_REG_AQA, (uint32_t)(nvme.entries - 1) | ((uint32_t)(nvme.entries - 1) << 16));
+    nvme_write64(NVME_REG_ASQ, virt_to_phys(nvme.admin.sq));
+    nvme_write64(NVME_REG_ACQ, virt_to_phys((const void *)nvme.admin.cq));
+    nvme_write(NVME_REG_CC, NVME_CC_EN | NVME_CC_IOSQES | NVME_CC_IOCQES);
+    if (nvme_wait_ready(NVME_CSTS_RDY) < 0) {
+        printf("NVMe: controller not ready\n");
+        return;
+    }
+
+    // Контроллер: MDTS (байт 77) и поддержка SGL (SGLS, байты 536..539)
+    if (nvme_admin(NVME_ADMIN_IDENTIFY, 0, 1, 0, 0, nvme_identify_buf, NULL) != 0) return;
+    uint8_t mdts = nvme_identify_buf[77];
+    nvme.sgl = (nvme_identify_buf[536] & 3) != 0;
+
+    // Пространство имён 1: размер и формат блока
+    if (nvme_admin(NVME_ADMIN_IDENTIFY, 1, 0, 0, 0, nvme_identify_buf, NULL) != 0) return;
+    uint64_t nsze = *(uint64_t *)nvme_identify_buf;
+    uint32_t lbaf = *(uint32_t *)(nvme_identify_buf + 128 + 4 * (nvme_identify_buf[26] & 0xF));
+    if (nsze == 0 || ((lbaf >> 16) & 0xFF) != 9) {
+        printf("NVMe: namespace 1 missing or not 512-byte blocks\n");
+        return;
+    }
+
+    // Пары по числу CPU, сколько разрешит контроллер
+    uint32_t want = smp_num_cpus();
+    if (want > NVME_MAX_QUEUES) want = NVME_MAX_QUEUES;
+    uint32_t granted;
+    if (nvme_admin(NVME_ADMIN_SET_FEATURES, 0, NVME_FEAT_NUM_QUEUES,
+                   (want - 1) | ((want - 1) << 16), 0, NULL, &granted) != 0) {
+        return;
+    }
+    uint32_t nq = want;
+    if ((granted & 0xFFFF) + 1 < nq) nq = (granted & 0xFFFF) + 1;
+    if ((granted >> 16) + 1 < nq) nq = (granted >> 16) + 1;
+
+    uint32_t vectors = nvme_setup_irq(pci, nq);
+    for (uint32_t i = 0; i < nq; i++) {
+        nvme_queue_t *q = &nvme.io[i];
+        uint16_t qid = (uint16_t)(i + 1);
+        nvme_queue_init(q, qid);
+        uint32_t size = (uint32_t)qid | ((uint32_t)(q->entries - 1) << 16);
+        uint32_t iv = vectors > 1 ? qid : 0;
+        uint32_t cq_flags = NVME_QUEUE_PC | (vectors ? NVME_QUEUE_IEN : 0) | (iv << 16);
+        if (nvme_admin(NVME_ADMIN_CREATE_CQ, 0, size, cq_flags,
+                       virt_to_phys((const void *)q->cq), NULL, NULL) != 0 ||
+            nvme_admin(NVME_ADMIN_CREATE_SQ, 0, size, NVME_QUEUE_PC | ((uint32_t)qid << 16),
+                       virt_to_phys(q->sq), NULL, NULL) != 0) {
+            break;
+        }
+        nvme.nqueues = i + 1;
+    }
+    if (nvme.nqueues == 0) {
+        printf("NVMe: cannot create I/O queues\n");
+        return;
+    }
+
+    // Объединение прерываний: без него каждое завершение — прерывание
+    nvme_admin(NVME_ADMIN_SET_FEATURES, 0, NVME_FEAT_IRQ_COALESCE,
+               (NVME_COALESCE_ENTRIES - 1) | (NVME_COALESCE_100US << 8), 0, NULL, NULL);
+
+    block_device_t *blk = &nvme.blk;
+    const char *name = "nvme0n1";
+    for (int i = 0; name[i]; i++) {
+        blk->name[i] = name[i];
+    }
+    blk->sectors = nsze;
+    blk->sector_size = BLOCK_SECTOR_SIZE;
+    blk->max_transfer = NVME_MAX_SECTORS;
+    if (mdts && (NVME_PAGE / BLOCK_SECTOR_SIZE) << mdts < blk->max_transfer) {
+        blk->max_transfer = (NVME_PAGE / BLOCK_SECTOR_SIZE) << mdts;
+    }
+    blk->read = nvme_blk_read;
+    blk->write = nvme_blk_write;
+    blk->flush = nvme_blk_flush;
+    blk->rw_sg = nvme_blk_rw_sg;
+    blk->priv = &nvme;
+    // Своя очередь и нет головки: переупорядочивать незачем
+    if (block_register(blk) == 0) blk_queue_set_elevator(blk, "noop");
+    if (vectors) {
+        atomic_store32_release(&nvme.irq_ready, 1);
+        // Завершения придут прерыванием: очередь bio держит пару полной
+        blk->queue_depth = nvme.entries - 1u;
+        blk->submit = nvme_blk_submit;
+    }
+
+    printf("NVMe %s: %lu MiB, %u queue pair(s) x %u, %s, %u vector(s)\n", blk->name,
+           nsze / 2048, nvme.nqueues, nvme.entries, nvme.sgl ? "PRP+SGL" : "PRP", vectors);
+}
+
+#else
+// Stub implementation for non-x86 platforms: NVMe ищется только на PCI PC
+
+void nvme_init(void) {
+}
+
+int nvme_submit(block_device_t *dev, nvme_req_t **reqs, uint32_t n) {
+    (void)dev;
+    (void)reqs;
+    (void)n;
+    return -1;
+}
+
+int nvme_wait(nvme_req_t *req) {
+    (void)req;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,77 @@
+// nvme.h — NVMe: пара очередей SQ/CQ на каждый CPU
+//
+// Контроллер NVMe (PCI класс 01:08:02) принимает команды через кольца
+// в памяти: очередь отправки (SQ) и очередь завершений (CQ). Драйвер
+// создаёт по паре на CPU (сколько даст контроллер), и CPU ставит
+// команды только в свою пару: очереди не делят между ядрами, и
+// блокировка пары берётся без соперничества.
+//
+// Запись в doorbell — это обращение к устройству через PCIe, поэтому
+// драйвер пишет его один раз на пачку: nvme_submit() кладёт в SQ все
+// запросы пачки и только потом сдвигает хвост, а разбор CQ подтверждает
+// все снятые завершения одной записью головы. Контроллеру включено
+// объединение прерываний (не больше одного на NVME_COALESCE_ENTRIES
+// завершений или NVME_COALESCE_100US * 100 мкс); у каждой пары свой
+// вектор MSI-X, если их хватает.
+//
+// Очередь bio ставит команды через submit устройства в пару текущего
+// CPU, не дожидаясь ни их, ни свободных элементов: завершение
+// приходит из прерывания пары.
+//
+// Данные описываются списком PRP (страницы по 4 КиБ), а если
+// контроллер умеет SGL — списком сегментов произвольной длины для
+// разнесённых запросов. Пространство имён 1 регистрируется как
+// блочное устройство nvme0n1.
+#ifndef NVME_H
+#define NVME_H
+
+#include <stdint.h>
+#include "block.h"
+#include "../lib/sync/wait.h"
+
+#define NVME_MAX_QUEUES       8      // пар ввода-вывода
+#define NVME_QUEUE_ENTRIES    64     // элементов в SQ и CQ
+
+// Объединение прерываний: порог (завершений) и задержка (по 100 мкс)
+#define NVME_COALESCE_ENTRIES 8
+#define NVME_COALESCE_100US   1
+
+// Запрос чтения или записи. Буфер — buf/count или, если nsegs != 0,
+// список segs. Память запроса принадлежит драйверу до done.
+typedef struct nvme_req {
+    uint64_t lba;
+    uint32_t count;              // секторов, не больше max_transfer
+    void *buf;
+    const block_seg_t *segs;
+    uint32_t nsegs;
+    int write;
+
+    volatile int status;         // NVME_REQ_PENDING, затем 0 или -1
+    completion_t done;
+
+    // Заполняет драйвер
+    uint8_t opcode;
+    uint16_t cid;
+    uint32_t nsid;
+    uint32_t cdw10, cdw11;       // команды администрирования
+    uint64_t prp1;               // адрес очереди для CREATE SQ/CQ
+    uint32_t result;             // DW0 завершения
+    void *queue;
+    block_cmd_t *cmd;            // команда очереди bio: завершается cmd->done
+} nvme_req_t;
+
+#define NVME_REQ_PENDING 1
+
+// Найти контроллер, создать очереди и зарегистрировать пространство
+// имён (после pci_init, idt_init и smp_init)
+void nvme_init(void);
+
+// Поставить n запросов в очередь текущего CPU одной записью doorbell
+// (больше — если очередь заполнится). Ждёт только свободных элементов.
+// 0 — все поставлены; -1 — неверный запрос, ничего не поставлено.
+int nvme_submit(block_device_t *dev, nvme_req_t **reqs, uint32_t n);
+
+// Дождаться запроса (до включения прерываний — опросом). Возвращает status.
+int nvme_wait(nvme_req_t *req);
+
+#endif // NVME_H
@@ -0,0 +1,260 @@
+// pci.c — перебор шины PCI и доступ к конфигурационному пространству
+#include "pci.h"
+
+#include <stddef.h>
+
+static pci_device_t pci_devices[PCI_MAX_DEVICES];
+static int pci_count;
+
+#if defined(__x86_64__) || defined(__amd64__)
+
+#include "../include/arch.h"
+#include "../lib/printf.h"
+#include "../lib/sync/spinlock.h"
+#include "../arch/x86_64/paging.h"
+
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA    0xCFC
+
+// Пара «адрес → данные» не атомарна: одна блокировка на все CPU
+static spinlock_t pci_config_lock = SPINLOCK_INIT("pci_config");
+
+static uint32_t pci_address(uint8_t bus, uint8_t slot, uint8_t func, uint8_t off) {
+    return 0x80000000u | ((uint32_t)bus << 16) | ((uint32_t)slot << 11) |
+           ((uint32_t)func << 8) | (off & 0xFC);
+}
+
+static uint32_t pci_raw_read32(uint8_t bus, uint8_t slot, uint8_t func, uint8_t off) {
+    arch_irqflags_t flags = spin_lock_irqsave(&pci_config_lock);
+    x86_64_outl(PCI_CONFIG_ADDRESS, pci_address(bus, slot, func, off));
+    uint32_t val = x86_64_inl(PCI_CONFIG_DATA);
+    spin_unlock_irqrestore(&pci_config_lock, flags);
+    return val;
+}
+
+static void pci_raw_write32(uint8_t bus, uint8_t slot, uint8_t func, uint8_t off, uint32_t val) {
+    arch_irqflags_t flags = spin_lock_irqsave(&pci_config_lock);
+    x86_64_outl(PCI_CONFIG_ADDRESS, pci_address(bus, slot, func, off));
+    x86_64_outl(PCI_CONFIG_DATA, val);
+    spin_unlock_irqrestore(&pci_config_lock, flags);
+}
+
+static void pci_add(uint8_t bus, uint8_t slot, uint8_t func) {
+    if (pci_count >= PCI_MAX_DEVICES) return;
+    pci_device_t *d = &pci_devices[pci_count++];
+    d->bus = bus;
+    d->slot = slot;
+    d->func = func;
+
+    uint32_t id = pci_raw_read32(bus, slot, func, PCI_VENDOR_ID);
+    uint32_t cls = pci_raw_read32(bus, slot, func, 0x08);
+    d->vendor = (uint16_t)id;
+    d->device = (uint16_t)(id >> 16);
+    d->prog_if = (uint8_t)(cls >> 8);
+    d->subclass = (uint8_t)(cls >> 16);
+    d->class_code = (uint8_t)(cls >> 24);
+    d->irq_line = (uint8_t)pci_raw_read32(bus, slot, func, PCI_INTERRUPT_LINE);
+}
+
+void pci_init(void) {
+    // Полный перебор: шин немного, а мосты настроены прошивкой
+    for (uint32_t bus = 0; bus < 256; bus++) {
+        for (uint8_t slot = 0; slot < 32; slot++) {
+            uint32_t id = pci_raw_read32((uint8_t)bus, slot, 0, PCI_VENDOR_ID);
+            if ((uint16_t)id == 0xFFFF) continue;
+
+            uint8_t header = (uint8_t)(pci_raw_read32((uint8_t)bus, slot, 0, 0x0C) >> 16);
+            uint8_t nfunc = (header & 0x80) ? 8 : 1;
+            for (uint8_t func = 0; func < nfunc; func++) {
+                if (func && (uint16_t)pci_raw_read32((uint8_t)bus, slot, func, PCI_VENDOR_ID) == 0xFFFF) {
+                    continue;
+                }
+                pci_add((uint8_t)bus, slot, func);
+            }
+        }
+    }
+    printf("PCI: %d function(s)\n", pci_count);
+}
+
+uint32_t pci_read32(const pci_device_t *dev, uint8_t off) {
+    return pci_raw_read32(dev->bus, dev->slot, dev->func, off);
+}
+
+void pci_write32(const pci_device_t *dev, uint8_t off, uint32_t val) {
+    pci_raw_write32(dev->bus, dev->slot, dev->func, off, val);
+}
+
+// Элемент entry таблицы MSI-X или NULL
+static volatile uint32_t *pci_msix_entry(const pci_device_t *dev, uint8_t cap, uint16_t entry) {
+    uint16_t ctrl = pci_read16(dev, (uint8_t)(cap + 2));
+    if (entry > (ctrl & 0x07FF)) return NULL;
+
+    // Таблица лежит в BAR функции: BIR — младшие 3 бита смещения
+    uint32_t table = pci_read32(dev, (uint8_t)(cap + 4));
+    uint64_t bar = pci_bar(dev, (int)(table & 7));
+    if (!bar) return NULL;
+    return (volatile uint32_t *)ioremap(bar + (table & ~7u) + entry * 16u, 16);
+}
+
+int pci_enable_msix(const pci_device_t *dev, uint16_t entry, uint64_t address, uint32_t data) {
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_MSIX, 0);
+    if (!cap) return -1;
+    volatile uint32_t *e = pci_msix_entry(dev, cap, entry);
+    if (!e) return -1;
+    uint16_t ctrl = pci_read16(dev, (uint8_t)(cap + 2));
+
+    e[0] = (uint32_t)address;
+    e[1] = (uint32_t)(address >> 32);
+    e[2] = data;
+    e[3] = 0;                                         // снять маску элемента
+
+    // Включить MSI-X и снять общую маску функции
+    pci_write16(dev, (uint8_t)(cap + 2), (uint16_t)((ctrl & ~0x4000) | 0x8000));
+    pci_enable(dev, PCI_COMMAND_MEMORY | PCI_COMMAND_INTX_DISABLE);
+    return 0;
+}
+
+int pci_mask_msix(const pci_device_t *dev, uint16_t entry) {
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_MSIX, 0);
+    if (!cap) return -1;
+    volatile uint32_t *e = pci_msix_entry(dev, cap, entry);
+    if (!e) return -1;
+    e[3] = 1;
+    return 0;
+}
+
+#else
+// Stub implementation for non-x86 platforms: без ECAM функций нет
+
+void pci_init(void) {
+}
+
+uint32_t pci_read32(const pci_device_t *dev, uint8_t off) {
+    (void)dev;
+    (void)off;
+    return 0xFFFFFFFFu;
+}
+
+void pci_write32(const pci_device_t *dev, uint8_t off, uint32_t val) {
+    (void)dev;
+    (void)off;
+    (void)val;
+}
+
+int pci_enable_msix(const pci_device_t *dev, uint16_t entry, uint64_t address, uint32_t data) {
+    (void)dev;
+    (void)entry;
+    (void)address;
+    (void)data;
+    return -1;
+}
+
+int pci_mask_msix(const pci_device_t *dev, uint16_t entry) {
+    (void)dev;
+    (void)entry;
+    return -1;
+}
+
+#endif
+
+uint16_t pci_read16(const pci_device_t *dev, uint8_t off) {
+    return (uint16_t)(pci_read32(dev, off) >> ((off & 2) * 8));
+}
+
+uint8_t pci_read8(const pci_device_t *dev, uint8_t off) {
+    return (uint8_t)(pci_read32(dev, off) >> ((off & 3) * 8));
+}
+
+void pci_write16(const pci_device_t *dev, uint8_t off, uint16_t val) {
+    uint32_t shift = (off & 2) * 8;
+    uint32_t v = pci_read32(dev, off);
+    v = (v & ~(0xFFFFu << shift)) | ((uint32_t)val << shift);
+    pci_write32(dev, off, v);
+}
+
+pci_device_t *pci_find_class(uint8_t class_code, uint8_t subclass, uint8_t prog_if, int index) {
+    for (int i = 0; i < pci_count; i++) {
+        pci_device_t *d = &pci_devices[i];
+        if (d->class_code == class_code && d->subclass == subclass &&
+            (prog_if == 0xFF || d->prog_if == prog_if) && index-- == 0) {
+            return d;
+        }
+    }
+    return NULL;
+}
+
+pci_device_t *pci_find_device(uint16_t vendor, uint16_t device, int index) {
+    for (int i = 0; i < pci_count; i++) {
+        pci_device_t *d = &pci_devices[i];
+        if (d->vendor == vendor && d->device == device && index-- == 0) {
+            return d;
+        }
+    }
+    return NULL;
+}
+
+int pci_bar_is_io(const pci_device_t *dev, int bar) {
+    return pci_read32(dev, (uint8_t)(PCI_BAR0 + bar * 4)) & 1;
+}
+
+uint64_t pci_bar(const pci_device_t *dev, int bar) {
+    if (bar < 0 || bar > 5) return 0;
+    uint32_t lo = pci_read32(dev, (uint8_t)(PCI_BAR0 + bar * 4));
+    if (lo & 1) return lo & ~3u;                      // порты ввода-вывода
+
+    uint64_t addr = lo & ~0xFu;
+    if (((lo >> 1) & 3) == 2 && bar < 5) {            // 64-битный BAR
+        addr |= (uint64_t)pci_read32(dev, (uint8_t)(PCI_BAR0 + (bar + 1) * 4)) << 32;
+    }
+    return addr;
+}
+
+void pci_enable(const pci_device_t *dev, uint16_t command) {
+    pci_write16(dev, PCI_COMMAND, pci_read16(dev, PCI_COMMAND) | command);
+}
+
+uint8_t pci_find_capability(const pci_device_t *dev, uint8_t cap_id, uint8_t start) {
+    if (!(pci_read16(dev, PCI_STATUS) & PCI_STATUS_CAP_LIST)) return 0;
+
+    uint8_t off = start ? pci_read8(dev, (uint8_t)(start + 1)) : pci_read8(dev, PCI_CAP_PTR);
+    // Предел против зацикленного списка
+    for (int guard = 0; off >= 0x40 && guard < 48; guard++) {
+        off &= 0xFC;
+        if (pci_read8(dev, off) == cap_id) return off;
+        off = pci_read8(dev, (uint8_t)(off + 1));
+    }
+    return 0;
+}
+
+int pci_enable_msi(const pci_device_t *dev, uint64_t address, uint32_t data) {
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_MSI, 0);
+    if (!cap) return -1;
+
+    uint16_t ctrl = pci_read16(dev, (uint8_t)(cap + 2));
+    pci_write32(dev, (uint8_t)(cap + 4), (uint32_t)address);
+    if (ctrl & 0x0080) {                              // 64-битный адрес
+        pci_write32(dev, (uint8_t)(cap + 8), (uint32_t)(address >> 32));
+        pci_write16(dev, (uint8_t)(cap + 12), (uint16_t)data);
+    } else {
+        pci_write16(dev, (uint8_t)(cap + 8), (uint16_t)data);
+    }
+    // Один вектор (Multiple Message Enable = 0), затем включение
+    ctrl = (uint16_t)((ctrl & ~0x0070) | 0x0001);
+    pci_write16(dev, (uint8_t)(cap + 2), ctrl);
+    pci_enable(dev, PCI_COMMAND_INTX_DISABLE);
+    return 0;
+}
+
+uint16_t pci_msix_count(const pci_device_t *dev) {
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_MSIX, 0);
+    if (!cap) return 0;
+    return (uint16_t)((pci_read16(dev, (uint8_t)(cap + 2)) & 0x07FF) + 1);
+}
+
+void pci_disable_msix(const pci_device_t *dev) {
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_MSIX, 0);
+    if (!cap) return;
+    uint16_t ctrl = pci_read16(dev, (uint8_t)(cap + 2));
+    pci_write16(dev, (uint8_t)(cap + 2), (uint16_t)(ctrl & ~0x8000));
+    pci_write16(dev, PCI_COMMAND, (uint16_t)(pci_read16(dev, PCI_COMMAND) & ~PCI_COMMAND_INTX_DISABLE));
+}
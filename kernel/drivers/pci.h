@@ -0,0 +1,85 @@
+// pci.h — конфигурационное пространство PCI и список найденных функций
+//
+// Доступ через порты 0xCF8/0xCFC (механизм №1), поэтому только на x86;
+// на остальных архитектурах pci_init() ничего не находит.
+#ifndef PCI_H
+#define PCI_H
+
+#include <stdint.h>
+
+#define PCI_MAX_DEVICES 64
+
+// Регистры заголовка
+#define PCI_VENDOR_ID      0x00
+#define PCI_DEVICE_ID      0x02
+#define PCI_COMMAND        0x04
+#define PCI_STATUS         0x06
+#define PCI_PROG_IF        0x09
+#define PCI_SUBCLASS       0x0A
+#define PCI_CLASS          0x0B
+#define PCI_HEADER_TYPE    0x0E
+#define PCI_BAR0           0x10
+#define PCI_CAP_PTR        0x34
+#define PCI_INTERRUPT_LINE 0x3C
+
+#define PCI_COMMAND_IO          0x0001
+#define PCI_COMMAND_MEMORY      0x0002
+#define PCI_COMMAND_MASTER      0x0004
+#define PCI_COMMAND_INTX_DISABLE 0x0400
+
+#define PCI_STATUS_CAP_LIST 0x0010
+
+// Идентификаторы capability
+#define PCI_CAP_MSI    0x05
+#define PCI_CAP_VENDOR 0x09
+#define PCI_CAP_MSIX   0x11
+
+typedef struct pci_device {
+    uint8_t bus, slot, func;
+    uint16_t vendor, device;
+    uint8_t class_code, subclass, prog_if;
+    uint8_t irq_line;
+} pci_device_t;
+
+void pci_init(void);
+
+uint32_t pci_read32(const pci_device_t *dev, uint8_t off);
+uint16_t pci_read16(const pci_device_t *dev, uint8_t off);
+uint8_t pci_read8(const pci_device_t *dev, uint8_t off);
+void pci_write32(const pci_device_t *dev, uint8_t off, uint32_t val);
+void pci_write16(const pci_device_t *dev, uint8_t off, uint16_t val);
+
+// index-я функция с данным классом / идентификатором, NULL — нет.
+// prog_if 0xFF — любой.
+pci_device_t *pci_find_class(uint8_t class_code, uint8_t subclass, uint8_t prog_if, int index);
+pci_device_t *pci_find_device(uint16_t vendor, uint16_t device, int index);
+
+// Адрес BAR (порт или память, 64-битные BAR склеиваются); 0 — нет
+uint64_t pci_bar(const pci_device_t *dev, int bar);
+int pci_bar_is_io(const pci_device_t *dev, int bar);
+
+// Включить биты PCI_COMMAND_*
+void pci_enable(const pci_device_t *dev, uint16_t command);
+
+// Смещение capability id в конфигурационном пространстве, 0 — нет.
+// start — продолжить поиск после найденной (0 — с начала).
+uint8_t pci_find_capability(const pci_device_t *dev, uint8_t cap_id, uint8_t start);
+
+// Включить MSI с одним вектором и отключить INTx. 0 — успех,
+// -1 — у функции нет capability MSI.
+int pci_enable_msi(const pci_device_t *dev, uint64_t address, uint32_t data);
+
+// Размер таблицы MSI-X (0 — MSI-X нет)
+uint16_t pci_msix_count(const pci_device_t *dev);
+
+// Записать и размаскировать элемент entry таблицы MSI-X, включить
+// MSI-X и отключить INTx. 0 — успех.
+int pci_enable_msix(const pci_device_t *dev, uint16_t entry, uint64_t address, uint32_t data);
+
+// Замаскировать элемент entry таблицы MSI-X. 0 — успех.
+int pci_mask_msix(const pci_device_t *dev, uint16_t entry);
+
+// Выключить MSI-X функции и снова разрешить INTx
+void pci_disable_msix(const pci_device_t *dev);
+
+#endif // PCI_H
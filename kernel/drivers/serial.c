@@ -16,6 +16,10 @@
 
 #if HAVE_PORT_IO
 
+#include "../arch/x86_64/idt.h"
+#include "../lib/sync/spinlock.h"
+#include "../lib/sync/wait.h"
+
 // Порты COM1
 #define COM1_PORT 0x3F8
 #define COM1_DATA COM1_PORT
@@ -24,6 +28,17 @@
 #define COM1_LINE_CONTROL COM1_PORT + 3
 #define COM1_MODEM_CONTROL COM1_PORT + 4
 #define COM1_LINE_STATUS COM1_PORT + 5
+#define COM1_INT_ID COM1_PORT + 2      // при чтении — IIR
+
+#define COM1_IRQ 4
+#define LSR_THR_EMPTY 0x20
+#define IER_THR_EMPTY 0x02             // прерывание «буфер передачи пуст»
+#define IIR_NO_INT 0x01
+#define IIR_ID_MASK 0x0E
+#define IIR_THR_EMPTY 0x02
+
+// Глубина FIFO передатчика 16550A: после «пуст» можно записать столько
+#define SERIAL_FIFO_DEPTH 16
 
 // Отладочный порт Bochs/QEMU (debugcon). Полезно для CI, где нет доступа к VGA.
 #define DEBUGCON_PORT 0xE9
@@ -62,14 +77,70 @@ void serial_init() {
     outb(COM1_MODEM_CONTROL, 0x0B);
 }
 
-// Отправка одного символа
-void serial_write_char(char c) {
-    // Ждем, пока буфер передачи не освободится, но не бесконечно (важно для CI)
+// Писатели ждут прерывания «буфер передачи пуст», а не крутятся
+static wait_queue_t serial_tx_wait = WAIT_QUEUE_INIT;
+static volatile uint32_t serial_irq_ready;
+
+// FIFO заполняет один CPU за раз. Строку целиком держит serial_tx_busy —
+// у тех, кто может спать; обработчики прерываний и код с запрещёнными
+// прерываниями берут только serial_tx_lock и могут вклиниться между
+// порциями по SERIAL_FIFO_DEPTH символов.
+static spinlock_t serial_tx_lock = SPINLOCK_INIT("serial_tx");
+static volatile uint32_t serial_tx_busy;
+
+static inline int serial_tx_empty(void) {
+    return (inb(COM1_LINE_STATUS) & LSR_THR_EMPTY) != 0;
+}
+
+static void serial_irq_handler() {
+    uint8_t iir = inb(COM1_INT_ID);  // чтение IIR снимает прерывание THRE
+    if (iir & IIR_NO_INT) return;    // линия разделяемая — не наше
+
+    if ((iir & IIR_ID_MASK) == IIR_THR_EMPTY) {
+        // Прерывание одноразовое: следующий ждущий включит его снова
+        outb(COM1_INT_ENABLE, 0x00);
+        wake_up_all(&serial_tx_wait);
+    }
+}
+
+void serial_irq_init() {
+    if (register_interrupt_handler(32 + COM1_IRQ, serial_irq_handler) != 0) {
+        return;  // остаёмся на опросе
+    }
+    pic_unmask_irq(COM1_IRQ);
+    atomic_store32_release(&serial_irq_ready, 1);
+}
+
+static inline int serial_can_sleep(void) {
+    return atomic_load32_acquire(&serial_irq_ready) && arch_irqs_enabled();
+}
+
+// Дождаться освобождения передатчика. 0 — пуст, -1 — не дождались
+// опросом (порта нет или он завис)
+static int serial_wait_tx(void) {
+    if (serial_tx_empty()) return 0;
+
+    if (serial_can_sleep()) {
+        // Спим до IRQ4. Если передатчик освободится раньше, чем мы
+        // включим прерывание, 16550 поднимет его сразу после включения.
+        while (!serial_tx_empty()) {
+            outb(COM1_INT_ENABLE, IER_THR_EMPTY);
+            wait_event(&serial_tx_wait,
+                       serial_tx_empty() || !(inb(COM1_INT_ENABLE) & IER_THR_EMPTY));
+        }
+        return 0;
+    }
+
+    // Ранняя загрузка, обработчик прерывания или запрещённые прерывания:
+    // опрос, но не бесконечный (важно для CI)
     int timeout = 100000;
-    while ((inb(COM1_LINE_STATUS) & 0x20) == 0 && --timeout > 0) {
-        /* spin */
+    while (!serial_tx_empty() && --timeout > 0) {
+        cpu_relax();
     }
+    return timeout > 0 ? 0 : -1;
+}
 
+static inline void serial_put_raw(char c) {
     // Отправляем символ в COM1
     outb(COM1_DATA, c);
 
@@ -77,11 +148,56 @@ void serial_write_char(char c) {
     outb(DEBUGCON_PORT, c);
 }
 
-// Отправка строки
+// Записать до SERIAL_FIFO_DEPTH символов из str[0..len), если
+// передатчик пуст: после ожидания его мог занять другой CPU. force —
+// ожидание не удалось, пишем как есть. Возвращает число записанных.
+static size_t serial_fill(const char *str, size_t len, int force) {
+    size_t n = 0;
+    arch_irqflags_t flags = spin_lock_irqsave(&serial_tx_lock);
+    if (force || serial_tx_empty()) {
+        for (; n < SERIAL_FIFO_DEPTH && n < len; n++) {
+            serial_put_raw(str[n]);
+        }
+    }
+    spin_unlock_irqrestore(&serial_tx_lock, flags);
+    return n;
+}
+
+static int serial_tx_acquire(void) {
+    if (!serial_can_sleep()) return 0;
+    while (atomic_xchg32(&serial_tx_busy, 1)) {
+        wait_on_address(&serial_tx_busy, 1);
+    }
+    return 1;
+}
+
+static void serial_tx_release(int held) {
+    if (!held) return;
+    atomic_store32_release(&serial_tx_busy, 0);
+    wake_address(&serial_tx_busy, 1);
+}
+
+// Отправка одного символа
+void serial_write_char(char c) {
+    int held = serial_tx_acquire();
+    while (!serial_fill(&c, 1, serial_wait_tx() != 0)) {
+        cpu_relax();
+    }
+    serial_tx_release(held);
+}
+
+// Отправка строки: после каждого ожидания заполняем FIFO целиком,
+// так что на 16 символов приходится одно прерывание
 void serial_write_string(const char* str) {
-    for (size_t i = 0; str[i] != '\0'; i++) {
-        serial_write_char(str[i]);
+    size_t len = 0;
+    while (str[len] != '\0') len++;
+
+    int held = serial_tx_acquire();
+    size_t i = 0;
+    while (i < len) {
+        i += serial_fill(str + i, len - i, serial_wait_tx() != 0);
     }
+    serial_tx_release(held);
 }
 
 #else
@@ -101,4 +217,8 @@ void serial_write_string(const char* str) {
     // No-op on non-x86 platforms
 }
 
+void serial_irq_init() {
+    // No-op on non-x86 platforms
+}
+
 #endif
\ No newline at end of file
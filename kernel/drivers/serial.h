@@ -7,6 +7,9 @@
 // Инициализация COM1 порта
 void serial_init();
 
+// Перевести передачу с опроса на ожидание IRQ4 (после idt_init)
+void serial_irq_init();
+
 // Отправка одного символа
 void serial_write_char(char c);
 
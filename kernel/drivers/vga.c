@@ -2,6 +2,7 @@
 #include "vga.h"
 #include <stddef.h>
 #include <stdint.h>
+#include "../lib/sync/spinlock.h"
 
 // По физическому адресу 0xB8000 расположен текстовый буфер VGA
 static uint16_t* const VGA_BUFFER = (uint16_t*)0xB8000;
@@ -9,6 +10,10 @@ static uint8_t terminal_row = 0;
 static uint8_t terminal_col = 0;
 static uint8_t terminal_color;
 
+// Защищает курсор (terminal_row/col): печатать могут разные CPU
+// и обработчики прерываний
+static spinlock_t vga_lock = SPINLOCK_INIT("vga");
+
 // Установить цвет (фоновый + символа)
 uint8_t vga_entry_color(uint8_t fg, uint8_t bg) {
     return fg | bg << 4;
@@ -32,8 +37,8 @@ void vga_init() {
     }
 }
 
-// Вывод символа
-void vga_putc_color(char c, uint8_t color) {
+// Вывод символа (вызывается под vga_lock)
+static void vga_putc_locked(char c, uint8_t color) {
     if (c == '\n') {
         terminal_col = 0;
         terminal_row++;
@@ -52,9 +57,18 @@ void vga_putc_color(char c, uint8_t color) {
     }
 }
 
-// Вывод строки
+// Вывод символа
+void vga_putc_color(char c, uint8_t color) {
+    arch_irqflags_t flags = spin_lock_irqsave(&vga_lock);
+    vga_putc_locked(c, color);
+    spin_unlock_irqrestore(&vga_lock, flags);
+}
+
+// Вывод строки (целиком, не перемешиваясь с выводом других CPU)
 void vga_write_string(const char* str, uint8_t color) {
+    arch_irqflags_t flags = spin_lock_irqsave(&vga_lock);
     for (size_t i = 0; str[i] != '\0'; i++) {
-        vga_putc_color(str[i], color);
+        vga_putc_locked(str[i], color);
     }
+    spin_unlock_irqrestore(&vga_lock, flags);
 }
\ No newline at end of file
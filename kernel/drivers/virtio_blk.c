@@ -0,0 +1,675 @@
+// virtio_blk.c — virtio-blk: virtio-pci 1.0, split virtqueue, INDIRECT_DESC, EVENT_IDX
+#include "virtio_blk.h"
+
+#if defined(__x86_64__) || defined(__amd64__)
+
+#include "../include/arch.h"
+#include "../include/atomic.h"
+#include "../include/memory.h"
+#include "../arch/x86_64/idt.h"
+#include "../arch/x86_64/lapic.h"
+#include "../arch/x86_64/paging.h"
+#include "bio.h"
+#include "pci.h"
+#include "../lib/printf.h"
+#include "../lib/sync/spinlock.h"
+#include "../lib/sync/wait.h"
+
+#include <stddef.h>
+
+#define VIRTIO_VENDOR           0x1AF4
+#define VIRTIO_DEV_BLK_MODERN   0x1042
+#define VIRTIO_DEV_BLK_TRANS    0x1001
+
+// Типы структур в vendor-capability virtio-pci
+#define VIRTIO_PCI_CAP_COMMON   1
+#define VIRTIO_PCI_CAP_NOTIFY   2
+#define VIRTIO_PCI_CAP_ISR      3
+#define VIRTIO_PCI_CAP_DEVICE   4
+
+// virtio_pci_common_cfg
+#define VCOMMON_DFSELECT        0x00
+#define VCOMMON_DF              0x04
+#define VCOMMON_GFSELECT        0x08
+#define VCOMMON_GF              0x0C
+#define VCOMMON_MSIX_CONFIG     0x10
+#define VCOMMON_STATUS          0x14
+#define VCOMMON_Q_SELECT        0x16
+#define VCOMMON_Q_SIZE          0x18
+#define VCOMMON_Q_MSIX          0x1A
+#define VCOMMON_Q_ENABLE        0x1C
+#define VCOMMON_Q_NOFF          0x1E
+#define VCOMMON_Q_DESC          0x20
+#define VCOMMON_Q_AVAIL         0x28
+#define VCOMMON_Q_USED          0x30
+
+#define VIRTIO_STATUS_ACK       0x01
+#define VIRTIO_STATUS_DRIVER    0x02
+#define VIRTIO_STATUS_DRIVER_OK 0x04
+#define VIRTIO_STATUS_FEATURES_OK 0x08
+#define VIRTIO_STATUS_FAILED    0x80
+
+#define VIRTIO_MSI_NO_VECTOR    0xFFFF
+
+// Биты возможностей (номер бита в 64-битном наборе)
+#define VIRTIO_BLK_F_SIZE_MAX   1
+#define VIRTIO_BLK_F_SEG_MAX    2
+#define VIRTIO_BLK_F_RO         5
+#define VIRTIO_BLK_F_FLUSH      9
+#define VIRTIO_RING_F_INDIRECT_DESC 28
+#define VIRTIO_RING_F_EVENT_IDX 29
+#define VIRTIO_F_VERSION_1      32
+
+// Конфигурация virtio-blk
+#define VBLK_CFG_CAPACITY       0x00
+#define VBLK_CFG_SIZE_MAX       0x08
+#define VBLK_CFG_SEG_MAX        0x0C
+
+#define VIRTIO_BLK_T_IN         0
+#define VIRTIO_BLK_T_OUT        1
+#define VIRTIO_BLK_T_FLUSH      4
+#define VIRTIO_BLK_S_OK         0
+
+#define VRING_DESC_F_NEXT       1
+#define VRING_DESC_F_WRITE      2
+#define VRING_DESC_F_INDIRECT   4
+#define VRING_USED_F_NO_NOTIFY  1
+
+// Без косвенных таблиц запрос — цепочка в самом кольце: заголовок,
+// до двух сегментов, статус
+#define VIRTIO_BLK_DIRECT_SEGS  2
+
+// Предел одного запроса (1 МиБ)
+#define VIRTIO_BLK_MAX_SECTORS  2048
+
+#define VIRTIO_POLL_SPINS       10000000
+
+typedef struct vring_desc {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed)) vring_desc_t;
+
+typedef struct vring_used_elem {
+    uint32_t id;
+    uint32_t len;
+} __attribute__((packed)) vring_used_elem_t;
+
+typedef struct virtio_blk_hdr {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+} __attribute__((packed)) virtio_blk_hdr_t;
+
+// Память одной очереди: кольца и по косвенной таблице, заголовку и
+// байту статуса на каждый слот запроса
+typedef struct virtio_blk_mem {
+    vring_desc_t desc[VIRTIO_BLK_QUEUE_SIZE];
+    struct {
+        uint16_t flags;
+        volatile uint16_t idx;
+        uint16_t ring[VIRTIO_BLK_QUEUE_SIZE + 1];   // за кольцом — used_event
+    } __attribute__((packed, aligned(4))) avail;
+    struct {
+        volatile uint16_t flags;
+        volatile uint16_t idx;
+        vring_used_elem_t ring[VIRTIO_BLK_QUEUE_SIZE];
+        uint16_t avail_event;                // за кольцом, если оно полное
+    } __attribute__((packed, aligned(4))) used;
+    vring_desc_t indirect[VIRTIO_BLK_QUEUE_SIZE][VIRTIO_BLK_SEG_MAX + 2] __attribute__((aligned(16)));
+    virtio_blk_hdr_t hdr[VIRTIO_BLK_QUEUE_SIZE];
+    volatile uint8_t status[VIRTIO_BLK_QUEUE_SIZE];
+} __attribute__((aligned(4096))) virtio_blk_mem_t;
+
+// Запрос в полёте: владелец ждёт done, команда очереди bio —
+// cmd->done
+typedef struct virtio_blk_req {
+    completion_t done;
+    int status;
+    block_cmd_t *cmd;
+} virtio_blk_req_t;
+
+typedef struct virtio_blk_dev {
+    pci_device_t *pci;
+    volatile uint8_t *common;
+    volatile uint8_t *isr;
+    volatile uint8_t *device;
+    volatile uint16_t *notify;
+    uint64_t features;
+    uint8_t indirect;
+    uint8_t event_idx;
+    uint16_t qsize;
+    uint16_t slot_descs;          // дескрипторов кольца на слот
+    uint16_t nslots;
+    uint32_t seg_max;
+    uint32_t size_max;            // байт в одном сегменте
+    virtio_blk_mem_t *mem;
+    // EVENT_IDX: поля сразу за кольцами фактического размера qsize
+    volatile uint16_t *used_event;     // будить драйвер после этого used
+    volatile uint16_t *avail_event;    // звонить устройству после этого avail
+
+    // Слоты, индексы колец и запросы — под lock; его берёт и
+    // обработчик прерывания
+    spinlock_t lock;
+    volatile uint64_t free_slots;
+    uint16_t avail_idx;
+    uint16_t last_used;
+    virtio_blk_req_t *reqs[VIRTIO_BLK_QUEUE_SIZE];
+    wait_queue_t slot_wait;
+    volatile uint32_t irq_ready;
+
+    // Запросы команд очереди bio: по одному на слот
+    virtio_blk_req_t cmd_reqs[VIRTIO_BLK_QUEUE_SIZE];
+
+    block_device_t blk;
+} virtio_blk_dev_t;
+
+static virtio_blk_mem_t virtio_blk_mem[VIRTIO_BLK_MAX_DEVS];
+static virtio_blk_dev_t virtio_blk_devs[VIRTIO_BLK_MAX_DEVS];
+static int virtio_blk_ndevs;
+
+static inline uint8_t vread8(volatile uint8_t *base, uint32_t off) {
+    return *(volatile uint8_t *)(base + off);
+}
+
+static inline uint16_t vread16(volatile uint8_t *base, uint32_t off) {
+    return *(volatile uint16_t *)(base + off);
+}
+
+static inline uint32_t vread32(volatile uint8_t *base, uint32_t off) {
+    return *(volatile uint32_t *)(base + off);
+}
+
+static inline void vwrite8(volatile uint8_t *base, uint32_t off, uint8_t val) {
+    *(volatile uint8_t *)(base + off) = val;
+}
+
+static inline void vwrite16(volatile uint8_t *base, uint32_t off, uint16_t val) {
+    *(volatile uint16_t *)(base + off) = val;
+}
+
+static inline void vwrite32(volatile uint8_t *base, uint32_t off, uint32_t val) {
+    *(volatile uint32_t *)(base + off) = val;
+}
+
+static inline void vwrite64(volatile uint8_t *base, uint32_t off, uint64_t val) {
+    vwrite32(base, off, (uint32_t)val);
+    vwrite32(base, off + 4, (uint32_t)(val >> 32));
+}
+
+// EVENT_IDX: событие event пройдено при переходе индекса old → new
+static inline int vring_need_event(uint16_t event, uint16_t new_idx, uint16_t old_idx) {
+    return (uint16_t)(new_idx - event - 1) < (uint16_t)(new_idx - old_idx);
+}
+
+static int virtio_blk_use_irq(virtio_blk_dev_t *d) {
+    return atomic_load32_acquire(&d->irq_ready) && arch_irqs_enabled();
+}
+
+// Снять выполненные запросы из used. Из прерывания и из опроса.
+static void virtio_blk_reap(virtio_blk_dev_t *d) {
+    virtio_blk_req_t *done[VIRTIO_BLK_QUEUE_SIZE];
+    int ndone = 0;
+    // Команды очереди bio: их слот может занять следующая команда ещё
+    // до конца разбора, поэтому команда и статус — копией
+    block_cmd_t *cmds[VIRTIO_BLK_QUEUE_SIZE];
+    int cmd_status[VIRTIO_BLK_QUEUE_SIZE];
+    int ncmds = 0;
+    uint64_t freed = 0;
+    virtio_blk_mem_t *m = d->mem;
+
+    arch_irqflags_t flags = spin_lock_irqsave(&d->lock);
+    for (;;) {
+        while (d->last_used != m->used.idx) {
+            smp_rmb();
+            uint32_t head = m->used.ring[d->last_used % d->qsize].id;
+            d->last_used++;
+            uint32_t slot = head / d->slot_descs;
+            if (slot >= d->nslots || !d->reqs[slot]) continue;
+            virtio_blk_req_t *req = d->reqs[slot];
+            d->reqs[slot] = NULL;
+            req->status = m->status[slot] == VIRTIO_BLK_S_OK ? 0 : -1;
+            freed |= 1ull << slot;
+            if (req->cmd) {
+                cmd_status[ncmds] = req->status;
+                cmds[ncmds++] = req->cmd;
+            } else {
+                done[ndone++] = req;
+            }
+        }
+        if (!d->event_idx) break;
+        // Следующее прерывание — на следующее завершение. Перепроверка
+        // после барьера: запись могла разминуться с устройством.
+        *d->used_event = d->last_used;
+        smp_mb();
+        if (d->last_used == m->used.idx) break;
+    }
+    d->free_slots |= freed;
+    spin_unlock_irqrestore(&d->lock, flags);
+
+    for (int i = 0; i < ndone; i++) {
+        complete(&done[i]->done);
+    }
+    if (freed) wake_up(&d->slot_wait);
+    for (int i = 0; i < ncmds; i++) {
+        cmds[i]->done(cmds[i], cmd_status[i]);
+    }
+    // Слоты запросов в обход очереди bio свободны: её команды,
+    // получившие BLOCK_BUSY, могут встать
+    if (ndone) blk_queue_kick(&d->blk);
+}
+
+static void virtio_blk_irq(virtio_blk_dev_t *d) {
+    // Без MSI-X линия INTx общая: ISR показывает, наше ли прерывание,
+    // и при чтении сбрасывается
+    if (d->isr && !(vread8(d->isr, 0) & 1)) return;
+    virtio_blk_reap(d);
+}
+
+static void virtio_blk_irq_msix(virtio_blk_dev_t *d) {
+    virtio_blk_reap(d);
+}
+
+#define VIRTIO_BLK_IRQ(n)                                                   \
+static void virtio_blk_irq##n() { virtio_blk_irq(&virtio_blk_devs[n]); }   \
+static void virtio_blk_irq_msix##n() { virtio_blk_irq_msix(&virtio_blk_devs[n]); }
+
+VIRTIO_BLK_IRQ(0)
+VIRTIO_BLK_IRQ(1)
+VIRTIO_BLK_IRQ(2)
+VIRTIO_BLK_IRQ(3)
+
+static void (*const virtio_blk_intx[VIRTIO_BLK_MAX_DEVS])() = {
+    virtio_blk_irq0, virtio_blk_irq1, virtio_blk_irq2, virtio_blk_irq3,
+};
+
+static void (*const virtio_blk_msix[VIRTIO_BLK_MAX_DEVS])() = {
+    virtio_blk_irq_msix0, virtio_blk_irq_msix1, virtio_blk_irq_msix2, virtio_blk_irq_msix3,
+};
+
+static uint32_t virtio_blk_take_slot(virtio_blk_dev_t *d) {
+    for (;;) {
+        arch_irqflags_t flags = spin_lock_irqsave(&d->lock);
+        uint64_t free = d->free_slots;
+        if (free) {
+            uint32_t slot = (uint32_t)__builtin_ctzll(free);
+            d->free_slots = free & ~(1ull << slot);
+            spin_unlock_irqrestore(&d->lock, flags);
+            return slot;
+        }
+        spin_unlock_irqrestore(&d->lock, flags);
+
+        if (virtio_blk_use_irq(d)) {
+            wait_event(&d->slot_wait, atomic_load64(&d->free_slots) != 0);
+        } else {
+            virtio_blk_reap(d);
+            cpu_relax();
+        }
+    }
+}
+
+// Сколько дескрипторов данных займёт список
+static uint32_t virtio_blk_descs(const virtio_blk_dev_t *d, const block_seg_t *segs,
+                                 uint32_t nsegs) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < nsegs; i++) {
+        uint64_t len = (uint64_t)segs[i].sectors * BLOCK_SECTOR_SIZE;
+        n += (uint32_t)((len + d->size_max - 1) / d->size_max);
+    }
+    return n;
+}
+
+// Дескрипторы данных: сегмент длиннее size_max режется. Возвращает
+// число записанных или -1, если не влезло в max.
+static int virtio_blk_fill(virtio_blk_dev_t *d, vring_desc_t *out, uint32_t max,
+                           const block_seg_t *segs, uint32_t nsegs, int write) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < nsegs; i++) {
+        uint64_t addr = virt_to_phys(segs[i].buf);
+        uint64_t len = (uint64_t)segs[i].sectors * BLOCK_SECTOR_SIZE;
+        while (len) {
+            uint32_t chunk = len > d->size_max ? d->size_max : (uint32_t)len;
+            if (n == max) return -1;
+            out[n++] = (vring_desc_t){ .addr = addr, .len = chunk,
+                                       .flags = write ? 0 : VRING_DESC_F_WRITE };
+            addr += chunk;
+            len -= chunk;
+        }
+    }
+    return (int)n;
+}
+
+static void virtio_blk_free_slot(virtio_blk_dev_t *d, uint32_t slot) {
+    arch_irqflags_t flags = spin_lock_irqsave(&d->lock);
+    d->free_slots |= 1ull << slot;
+    spin_unlock_irqrestore(&d->lock, flags);
+    wake_up(&d->slot_wait);
+}
+
+// Собрать запрос в занятом слоте и выставить его в avail. Дескрипторы
+// таблицы (косвенной или куска кольца) связываются по порядку. -1 —
+// список не влез, слот остаётся у вызывающего.
+static int virtio_blk_post(virtio_blk_dev_t *d, uint32_t slot, uint32_t type, uint64_t sector,
+                           const block_seg_t *segs, uint32_t nsegs, virtio_blk_req_t *req) {
+    virtio_blk_mem_t *m = d->mem;
+    uint16_t head = (uint16_t)(slot * d->slot_descs);
+    vring_desc_t *table = d->indirect ? m->indirect[slot] : &m->desc[head];
+    uint32_t max = d->indirect ? d->seg_max : VIRTIO_BLK_DIRECT_SEGS;
+
+    int ndata = virtio_blk_fill(d, table + 1, max, segs, nsegs, type == VIRTIO_BLK_T_OUT);
+    if (ndata < 0) return -1;
+
+    m->hdr[slot] = (virtio_blk_hdr_t){ .type = type, .sector = sector };
+    m->status[slot] = 0xFF;
+    table[0] = (vring_desc_t){ .addr = virt_to_phys(&m->hdr[slot]), .len = sizeof(virtio_blk_hdr_t) };
+    table[ndata + 1] = (vring_desc_t){ .addr = virt_to_phys(&m->status[slot]), .len = 1,
+                                       .flags = VRING_DESC_F_WRITE };
+    // next — индекс внутри той же таблицы; у прямой цепочки — в кольце
+    uint16_t base = d->indirect ? 0 : head;
+    for (int i = 0; i <= ndata; i++) {
+        table[i].flags |= VRING_DESC_F_NEXT;
+        table[i].next = (uint16_t)(base + i + 1);
+    }
+    if (d->indirect) {
+        m->desc[head] = (vring_desc_t){ .addr = virt_to_phys(table),
+                                        .len = (uint32_t)((ndata + 2) * sizeof(vring_desc_t)),
+                                        .flags = VRING_DESC_F_INDIRECT };
+    }
+
+    req->status = 1;
+    reinit_completion(&req->done);
+
+    arch_irqflags_t flags = spin_lock_irqsave(&d->lock);
+    d->reqs[slot] = req;
+    m->avail.ring[d->avail_idx % d->qsize] = head;
+    uint16_t old = d->avail_idx;
+    d->avail_idx++;
+    smp_wmb();          // элемент кольца виден раньше нового idx
+    m->avail.idx = d->avail_idx;
+    smp_mb();           // idx опубликован до чтения подавления
+    int kick = d->event_idx ? vring_need_event(*d->avail_event, d->avail_idx, old)
+                            : !(m->used.flags & VRING_USED_F_NO_NOTIFY);
+    spin_unlock_irqrestore(&d->lock, flags);
+
+    if (kick) *d->notify = 0;   // номер очереди
+    return 0;
+}
+
+// Занять слот (ждёт его) и выставить запрос
+static int virtio_blk_submit(virtio_blk_dev_t *d, uint32_t type, uint64_t sector,
+                             const block_seg_t *segs, uint32_t nsegs, virtio_blk_req_t *req) {
+    uint32_t slot = virtio_blk_take_slot(d);
+    if (virtio_blk_post(d, slot, type, sector, segs, nsegs, req) < 0) {
+        virtio_blk_free_slot(d, slot);
+        return -1;
+    }
+    return 0;
+}
+
+static int virtio_blk_wait(virtio_blk_dev_t *d, virtio_blk_req_t *req) {
+    if (!virtio_blk_use_irq(d)) {
+        while (!completion_done(&req->done)) {
+            virtio_blk_reap(d);
+            cpu_relax();
+        }
+    }
+    wait_for_completion(&req->done);
+    return req->status;
+}
+
+static int virtio_blk_rw(virtio_blk_dev_t *d, uint32_t type, uint64_t sector,
+                         const block_seg_t *segs, uint32_t nsegs) {
+    virtio_blk_req_t req = { .done = COMPLETION_INIT };
+    if (virtio_blk_submit(d, type, sector, segs, nsegs, &req) < 0) return -1;
+    return virtio_blk_wait(d, &req);
+}
+
+static int virtio_blk_read(block_device_t *dev, uint64_t lba, uint32_t count, void *buf) {
+    block_seg_t seg = { .buf = buf, .sectors = count };
+    return virtio_blk_rw((virtio_blk_dev_t *)dev->priv, VIRTIO_BLK_T_IN, lba, &seg, 1);
+}
+
+static int virtio_blk_write(block_device_t *dev, uint64_t lba, uint32_t count, const void *buf) {
+    virtio_blk_dev_t *d = (virtio_blk_dev_t *)dev->priv;
+    if (d->features & (1ull << VIRTIO_BLK_F_RO)) return -1;
+    block_seg_t seg = { .buf = (void *)buf, .sectors = count };
+    return virtio_blk_rw(d, VIRTIO_BLK_T_OUT, lba, &seg, 1);
+}
+
+static int virtio_blk_rw_sg(block_device_t *dev, uint64_t lba, const block_seg_t *segs,
+                            uint32_t nsegs, int write) {
+    virtio_blk_dev_t *d = (virtio_blk_dev_t *)dev->priv;
+    if (write && (d->features & (1ull << VIRTIO_BLK_F_RO))) return -1;
+    if (virtio_blk_descs(d, segs, nsegs) > (d->indirect ? d->seg_max : VIRTIO_BLK_DIRECT_SEGS)) {
+        return BLOCK_SG_UNSUPPORTED;
+    }
+    return virtio_blk_rw(d, write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN, lba, segs, nsegs);
+}
+
+// Команда очереди bio: только свободный сейчас слот, запрос — свой
+// у слота
+static int virtio_blk_cmd_submit(block_device_t *dev, block_cmd_t *cmd) {
+    virtio_blk_dev_t *d = (virtio_blk_dev_t *)dev->priv;
+    if (cmd->write && (d->features & (1ull << VIRTIO_BLK_F_RO))) return -1;
+    if (virtio_blk_descs(d, cmd->segs, cmd->nsegs) >
+        (d->indirect ? d->seg_max : VIRTIO_BLK_DIRECT_SEGS)) {
+        return BLOCK_SG_UNSUPPORTED;
+    }
+
+    arch_irqflags_t flags = spin_lock_irqsave(&d->lock);
+    uint64_t free = d->free_slots;
+    if (!free) {
+        spin_unlock_irqrestore(&d->lock, flags);
+        return BLOCK_BUSY;
+    }
+    uint32_t slot = (uint32_t)__builtin_ctzll(free);
+    d->free_slots = free & ~(1ull << slot);
+    spin_unlock_irqrestore(&d->lock, flags);
+
+    virtio_blk_req_t *req = &d->cmd_reqs[slot];
+    req->cmd = cmd;
+    if (virtio_blk_post(d, slot, cmd->write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN, cmd->lba,
+                        cmd->segs, cmd->nsegs, req) < 0) {
+        virtio_blk_free_slot(d, slot);
+        return -1;
+    }
+    return 0;
+}
+
+static int virtio_blk_flush(block_device_t *dev) {
+    virtio_blk_dev_t *d = (virtio_blk_dev_t *)dev->priv;
+    if (!(d->features & (1ull << VIRTIO_BLK_F_FLUSH))) return 0;   // кэша записи нет
+    return virtio_blk_rw(d, VIRTIO_BLK_T_FLUSH, 0, NULL, 0);
+}
+
+// Отобразить структуру из vendor-capability: адрес или NULL
+static volatile uint8_t *virtio_map_cap(pci_device_t *pci, uint8_t cap, uint32_t *extra) {
+    uint8_t bar = pci_read8(pci, (uint8_t)(cap + 4));
+    uint32_t off = pci_read32(pci, (uint8_t)(cap + 8));
+    uint32_t len = pci_read32(pci, (uint8_t)(cap + 12));
+    if (extra) *extra = pci_read32(pci, (uint8_t)(cap + 16));
+    if (bar > 5 || pci_bar_is_io(pci, bar)) return NULL;
+    uint64_t base = pci_bar(pci, bar);
+    if (!base) return NULL;
+    return (volatile uint8_t *)ioremap(base + off, len ? len : 1);
+}
+
+static int virtio_blk_probe(virtio_blk_dev_t *d, pci_device_t *pci, int index) {
+    volatile uint8_t *notify_base = NULL;
+    uint32_t notify_mult = 0;
+
+    d->pci = pci;
+    for (uint8_t cap = pci_find_capability(pci, PCI_CAP_VENDOR, 0); cap;
+         cap = pci_find_capability(pci, PCI_CAP_VENDOR, cap)) {
+        switch (pci_read8(pci, (uint8_t)(cap + 3))) {
+        case VIRTIO_PCI_CAP_COMMON:
+            if (!d->common) d->common = virtio_map_cap(pci, cap, NULL);
+            break;
+        case VIRTIO_PCI_CAP_NOTIFY:
+            if (!notify_base) notify_base = virtio_map_cap(pci, cap, &notify_mult);
+            break;
+        case VIRTIO_PCI_CAP_ISR:
+            if (!d->isr) d->isr = virtio_map_cap(pci, cap, NULL);
+            break;
+        case VIRTIO_PCI_CAP_DEVICE:
+            if (!d->device) d->device = virtio_map_cap(pci, cap, NULL);
+            break;
+        }
+    }
+    // Без этих структур это устройство только старого транспорта
+    if (!d->common || !notify_base || !d->device) return -1;
+    pci_enable(pci, PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER);
+
+    // Сброс и знакомство
+    volatile uint8_t *c = d->common;
+    vwrite8(c, VCOMMON_STATUS, 0);
+    for (uint32_t i = 0; vread8(c, VCOMMON_STATUS) != 0; i++) {
+        if (i >= VIRTIO_POLL_SPINS) return -1;
+        cpu_relax();
+    }
+    vwrite8(c, VCOMMON_STATUS, VIRTIO_STATUS_ACK);
+    vwrite8(c, VCOMMON_STATUS, VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER);
+
+    uint64_t offered = 0;
+    for (uint32_t sel = 0; sel < 2; sel++) {
+        vwrite32(c, VCOMMON_DFSELECT, sel);
+        offered |= (uint64_t)vread32(c, VCOMMON_DF) << (32 * sel);
+    }
+    uint64_t wanted = (1ull << VIRTIO_F_VERSION_1) | (1ull << VIRTIO_RING_F_INDIRECT_DESC) |
+                      (1ull << VIRTIO_RING_F_EVENT_IDX) | (1ull << VIRTIO_BLK_F_FLUSH) |
+                      (1ull << VIRTIO_BLK_F_SEG_MAX) | (1ull << VIRTIO_BLK_F_SIZE_MAX) |
+                      (1ull << VIRTIO_BLK_F_RO);
+    d->features = offered & wanted;
+    if (!(d->features & (1ull << VIRTIO_F_VERSION_1))) goto fail;
+    for (uint32_t sel = 0; sel < 2; sel++) {
+        vwrite32(c, VCOMMON_GFSELECT, sel);
+        vwrite32(c, VCOMMON_GF, (uint32_t)(d->features >> (32 * sel)));
+    }
+    vwrite8(c, VCOMMON_STATUS, VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_FEATURES_OK);
+    if (!(vread8(c, VCOMMON_STATUS) & VIRTIO_STATUS_FEATURES_OK)) goto fail;
+
+    d->indirect = (d->features & (1ull << VIRTIO_RING_F_INDIRECT_DESC)) != 0;
+    d->event_idx = (d->features & (1ull << VIRTIO_RING_F_EVENT_IDX)) != 0;
+    d->seg_max = VIRTIO_BLK_SEG_MAX;
+    if (d->features & (1ull << VIRTIO_BLK_F_SEG_MAX)) {
+        uint32_t seg_max = vread32(d->device, VBLK_CFG_SEG_MAX);
+        if (seg_max && seg_max < d->seg_max) d->seg_max = seg_max;
+    }
+    d->size_max = 0xFFFFF000u;
+    if (d->features & (1ull << VIRTIO_BLK_F_SIZE_MAX)) {
+        uint32_t size_max = vread32(d->device, VBLK_CFG_SIZE_MAX) & ~(BLOCK_SECTOR_SIZE - 1);
+        if (size_max) d->size_max = size_max;
+    }
+
+    // Очередь 0
+    vwrite16(c, VCOMMON_Q_SELECT, 0);
+    uint16_t max = vread16(c, VCOMMON_Q_SIZE);
+    if (max == 0) goto fail;
+    d->qsize = max < VIRTIO_BLK_QUEUE_SIZE ? max : VIRTIO_BLK_QUEUE_SIZE;
+    d->slot_descs = d->indirect ? 1 : VIRTIO_BLK_DIRECT_SEGS + 2;
+    d->nslots = d->qsize / d->slot_descs;
+    d->free_slots = d->nslots == 64 ? ~0ull : (1ull << d->nslots) - 1;
+    d->mem = &virtio_blk_mem[index];
+    d->used_event = &d->mem->avail.ring[d->qsize];
+    d->avail_event = (volatile uint16_t *)&d->mem->used.ring[d->qsize];
+    spin_lock_init(&d->lock, "virtio_blk");
+    wait_queue_init(&d->slot_wait);
+
+    vwrite16(c, VCOMMON_Q_SIZE, d->qsize);
+    vwrite64(c, VCOMMON_Q_DESC, virt_to_phys(d->mem->desc));
+    vwrite64(c, VCOMMON_Q_AVAIL, virt_to_phys(&d->mem->avail));
+    vwrite64(c, VCOMMON_Q_USED, virt_to_phys(&d->mem->used));
+    d->notify = (volatile uint16_t *)(notify_base + vread16(c, VCOMMON_Q_NOFF) * notify_mult);
+
+    // Прерывание очереди: MSI-X через APIC или общая линия INTx с ISR
+    int irq = -1;
+    vwrite16(c, VCOMMON_MSIX_CONFIG, VIRTIO_MSI_NO_VECTOR);
+    if (lapic_enabled() && pci_msix_count(pci) >= 1) {
+        int vector = idt_alloc_vector();
+        if (vector >= 0) {
+            int handler = register_interrupt_handler(vector, virtio_blk_msix[index]) == 0;
+            if (handler &&
+                pci_enable_msix(pci, 0, lapic_msi_address(), lapic_msi_data((uint8_t)vector)) == 0) {
+                vwrite16(c, VCOMMON_Q_MSIX, 0);
+                if (vread16(c, VCOMMON_Q_MSIX) == 0) {
+                    irq = 1;
+                    d->isr = NULL;
+                } else {
+                    // Устройство не приняло вектор: без MSI-X снова работает INTx
+                    pci_disable_msix(pci);
+                }
+            }
+            if (irq < 0) {
+                if (handler) unregister_interrupt_handler(vector, virtio_blk_msix[index]);
+                idt_free_vector(vector);
+            }
+        }
+    }
+    if (irq < 0 && d->isr && pci->irq_line < 16 &&
+        register_interrupt_handler(32 + pci->irq_line, virtio_blk_intx[index]) == 0) {
+        pic_unmask_irq(pci->irq_line);
+        irq = 0;
+    }
+
+    vwrite16(c, VCOMMON_Q_ENABLE, 1);
+    vwrite8(c, VCOMMON_STATUS, VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER |
+                               VIRTIO_STATUS_FEATURES_OK | VIRTIO_STATUS_DRIVER_OK);
+
+    static const char *const names[VIRTIO_BLK_MAX_DEVS] = {"vda", "vdb", "vdc", "vdd"};
+    block_device_t *blk = &d->blk;
+    for (int i = 0; names[index][i]; i++) {
+        blk->name[i] = names[index][i];
+    }
+    blk->sectors = (uint64_t)vread32(d->device, VBLK_CFG_CAPACITY) |
+                   ((uint64_t)vread32(d->device, VBLK_CFG_CAPACITY + 4) << 32);
+    blk->sector_size = BLOCK_SECTOR_SIZE;
+    blk->max_transfer = VIRTIO_BLK_MAX_SECTORS;
+    blk->read = virtio_blk_read;
+    blk->write = virtio_blk_write;
+    blk->flush = virtio_blk_flush;
+    blk->rw_sg = virtio_blk_rw_sg;
+    blk->priv = d;
+    if (irq >= 0) {
+        atomic_store32_release(&d->irq_ready, 1);
+        // Завершения придут прерыванием: очередь bio держит кольцо полным
+        blk->queue_depth = d->nslots;
+        blk->submit = virtio_blk_cmd_submit;
+    }
+
+    printf("virtio-blk %s: %lu MiB, queue %u, %s%s, %s\n", blk->name, blk->sectors / 2048,
+           d->qsize, d->indirect ? "indirect" : "direct", d->event_idx ? " event-idx" : "",
+           irq > 0 ? "MSI-X" : irq == 0 ? "INTx" : "polling");
+    return 0;
+
+fail:
+    vwrite8(c, VCOMMON_STATUS, VIRTIO_STATUS_FAILED);
+    return -1;
+}
+
+void virtio_blk_init(void) {
+    static const uint16_t ids[2] = { VIRTIO_DEV_BLK_MODERN, VIRTIO_DEV_BLK_TRANS };
+    for (int t = 0; t < 2; t++) {
+        for (int i = 0; virtio_blk_ndevs < VIRTIO_BLK_MAX_DEVS; i++) {
+            pci_device_t *pci = pci_find_device(VIRTIO_VENDOR, ids[t], i);
+            if (!pci) break;
+            virtio_blk_dev_t *d = &virtio_blk_devs[virtio_blk_ndevs];
+            if (virtio_blk_probe(d, pci, virtio_blk_ndevs) == 0) {
+                if (block_register(&d->blk) == 0) {
+                    blk_queue_set_elevator(&d->blk, "noop");
+                }
+                virtio_blk_ndevs++;
+            } else {
+                *d = (virtio_blk_dev_t){ 0 };
+            }
+        }
+    }
+}
+
+#else
+// Stub implementation for non-x86 platforms: virtio-mmio пока не поддержан
+
+void virtio_blk_init(void) {
+}
+
+#endif
@@ -0,0 +1,38 @@
+// virtio_blk.h — диск virtio-blk (современный транспорт virtio-pci)
+//
+// Под QEMU это самый быстрый путь к диску: гость не эмулирует
+// регистры контроллера, а кладёт описания запросов в общее кольцо
+// (split virtqueue) и один раз «звонит» устройству.
+//
+// Каждый запрос занимает в кольце ровно один дескриптор: он указывает
+// на косвенную таблицу (VIRTIO_RING_F_INDIRECT_DESC), где лежат
+// заголовок, сегменты данных и байт статуса. Поэтому длинный
+// разнесённый запрос не съедает кольцо, и в полёте может быть столько
+// запросов, сколько в кольце элементов.
+//
+// С VIRTIO_RING_F_EVENT_IDX стороны сообщают друг другу, до какого
+// индекса их не нужно будить: драйвер пишет в устройство, только если
+// устройство дошло до avail_event, а устройство прерывает, только
+// когда used обгоняет used_event.
+//
+// Очередь bio ставит команды через submit устройства, не дожидаясь
+// их: до VIRTIO_BLK_QUEUE_SIZE команд в кольце, завершение приходит
+// из прерывания.
+//
+// Диски регистрируются как vda..vdd.
+#ifndef VIRTIO_BLK_H
+#define VIRTIO_BLK_H
+
+#include <stdint.h>
+#include "block.h"
+
+#define VIRTIO_BLK_MAX_DEVS   4
+#define VIRTIO_BLK_QUEUE_SIZE 64
+
+// Сегментов данных в косвенной таблице одного запроса
+#define VIRTIO_BLK_SEG_MAX    32
+
+// Найти устройства virtio-blk и зарегистрировать их (после pci_init)
+void virtio_blk_init(void);
+
+#endif // VIRTIO_BLK_H
@@ -0,0 +1,547 @@
+// bcache.c — кэш блоков: хэш по (устройство, блок), вытеснение 2Q, отложенная запись
+#include "bcache.h"
+#include "../include/atomic.h"
+#include "../lib/sched/task.h"
+#include "../lib/sync/spinlock.h"
+#include "../lib/sync/wait.h"
+
+#include <stddef.h>
+
+#define BCACHE_HASH_SIZE (1u << BCACHE_HASH_BITS)
+
+enum {
+    BUF_LIST_NONE,
+    BUF_LIST_A1IN,
+    BUF_LIST_AM,
+};
+
+// Очередь 2Q: head — самый новый (MRU), tail — кандидат на вытеснение
+typedef struct buf_list {
+    buf_t *head, *tail;
+    uint32_t count;
+} buf_list_t;
+
+// Ключ блока, вытесненного из A1in
+typedef struct ghost {
+    block_device_t *dev;
+    uint64_t block;
+    struct ghost *hnext;
+    struct ghost *lnext, *lprev;
+} ghost_t;
+
+// Пачка записи: последний завершившийся bio будит bcache_sync или,
+// для фоновой пачки, снимает flush_pending
+typedef struct bcache_wb {
+    volatile uint32_t pending;
+    volatile int error;
+    completion_t done;
+} bcache_wb_t;
+
+static uint8_t bcache_data[BCACHE_BUFFERS][BCACHE_BLOCK_SIZE] __attribute__((aligned(4096)));
+static buf_t bufs[BCACHE_BUFFERS];
+static buf_t *buf_hash[BCACHE_HASH_SIZE];
+static buf_t *buf_free;                 // ещё не использованные (связь hnext)
+static buf_list_t a1in, am;
+
+static ghost_t ghosts[BCACHE_GHOSTS];
+static ghost_t *ghost_hash[BCACHE_HASH_SIZE];
+static ghost_t *ghost_free;
+static ghost_t *a1out_head, *a1out_tail;
+
+// Берут и завершения bio из обработчика прерывания диска
+static spinlock_t bcache_lock = SPINLOCK_INIT("bcache");
+static bcache_stats_t stats;
+static volatile uint32_t flush_pending;
+static bcache_wb_t flush_wb;            // пачка фоновой записи
+
+static uint32_t bcache_hash(block_device_t *dev, uint64_t block) {
+    uint64_t h = (block + ((uintptr_t)dev >> 4)) * 0x9E3779B97F4A7C15ull;
+    return (uint32_t)(h >> (64 - BCACHE_HASH_BITS));
+}
+
+void bcache_init(void) {
+    buf_free = NULL;
+    for (int i = BCACHE_BUFFERS - 1; i >= 0; i--) {
+        bufs[i].data = bcache_data[i];
+        bufs[i].hnext = buf_free;
+        buf_free = &bufs[i];
+    }
+    ghost_free = NULL;
+    for (int i = BCACHE_GHOSTS - 1; i >= 0; i--) {
+        ghosts[i].hnext = ghost_free;
+        ghost_free = &ghosts[i];
+    }
+}
+
+// ---------------------------------------------------------------
+// Очереди и хэш (под bcache_lock)
+// ---------------------------------------------------------------
+
+static void list_push(buf_t *b, uint32_t which) {
+    buf_list_t *l = which == BUF_LIST_AM ? &am : &a1in;
+    b->list = which;
+    b->lprev = NULL;
+    b->lnext = l->head;
+    if (l->head) l->head->lprev = b;
+    else l->tail = b;
+    l->head = b;
+    l->count++;
+}
+
+static void list_del(buf_t *b) {
+    buf_list_t *l = b->list == BUF_LIST_AM ? &am : &a1in;
+    if (b->lprev) b->lprev->lnext = b->lnext;
+    else l->head = b->lnext;
+    if (b->lnext) b->lnext->lprev = b->lprev;
+    else l->tail = b->lprev;
+    l->count--;
+    b->list = BUF_LIST_NONE;
+}
+
+static void hash_del(buf_t *b) {
+    buf_t **link = &buf_hash[bcache_hash(b->dev, b->block)];
+    while (*link != b) link = &(*link)->hnext;
+    *link = b->hnext;
+}
+
+static ghost_t *ghost_find(block_device_t *dev, uint64_t block) {
+    for (ghost_t *g = ghost_hash[bcache_hash(dev, block)]; g; g = g->hnext) {
+        if (g->dev == dev && g->block == block) return g;
+    }
+    return NULL;
+}
+
+static void ghost_del(ghost_t *g) {
+    ghost_t **link = &ghost_hash[bcache_hash(g->dev, g->block)];
+    while (*link != g) link = &(*link)->hnext;
+    *link = g->hnext;
+
+    if (g->lprev) g->lprev->lnext = g->lnext;
+    else a1out_head = g->lnext;
+    if (g->lnext) g->lnext->lprev = g->lprev;
+    else a1out_tail = g->lprev;
+
+    g->hnext = ghost_free;
+    ghost_free = g;
+}
+
+static void ghost_add(block_device_t *dev, uint64_t block) {
+    // A1out полна: забыть самый старый ключ
+    if (!ghost_free) ghost_del(a1out_tail);
+
+    ghost_t *g = ghost_free;
+    ghost_free = g->hnext;
+    g->dev = dev;
+    g->block = block;
+
+    uint32_t h = bcache_hash(dev, block);
+    g->hnext = ghost_hash[h];
+    ghost_hash[h] = g;
+
+    g->lprev = NULL;
+    g->lnext = a1out_head;
+    if (a1out_head) a1out_head->lprev = g;
+    else a1out_tail = g;
+    a1out_head = g;
+}
+
+// Освободить буфер под новый блок. Сначала A1in, если она больше
+// своей доли, иначе LRU-конец Am. Занятые и грязные не трогаем.
+static buf_t *bcache_reclaim(void) {
+    if (buf_free) {
+        buf_t *b = buf_free;
+        buf_free = b->hnext;
+        return b;
+    }
+
+    buf_list_t *order[2] = { &a1in, &am };
+    if (a1in.count <= BCACHE_A1IN_MAX) {
+        order[0] = &am;
+        order[1] = &a1in;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        for (buf_t *b = order[i]->tail; b; b = b->lprev) {
+            if (b->refcnt || b->io || (b->flags & BUF_DIRTY)) continue;
+
+            hash_del(b);
+            if (b->list == BUF_LIST_A1IN && (b->flags & BUF_VALID)) {
+                ghost_add(b->dev, b->block);
+            }
+            list_del(b);
+            stats.evictions++;
+            return b;
+        }
+    }
+    return NULL;
+}
+
+// Буфер под отсутствующий блок (ссылка у вызывающего) или NULL
+static buf_t *bcache_insert(block_device_t *dev, uint64_t block) {
+    buf_t *b = bcache_reclaim();
+    if (!b) return NULL;
+
+    ghost_t *g = ghost_find(dev, block);
+    if (g) {
+        ghost_del(g);
+        stats.ghost_hits++;
+        list_push(b, BUF_LIST_AM);
+    } else {
+        list_push(b, BUF_LIST_A1IN);
+    }
+    b->dev = dev;
+    b->block = block;
+    b->flags = 0;
+    b->refcnt = 1;
+
+    uint32_t h = bcache_hash(dev, block);
+    b->hnext = buf_hash[h];
+    buf_hash[h] = b;
+    return b;
+}
+
+static buf_t *bcache_find(block_device_t *dev, uint64_t block) {
+    for (buf_t *b = buf_hash[bcache_hash(dev, block)]; b; b = b->hnext) {
+        if (b->dev == dev && b->block == block) return b;
+    }
+    return NULL;
+}
+
+static uint32_t bcache_spb(block_device_t *dev, uint64_t block) {
+    if (!dev || !dev->queue || dev->sector_size > BCACHE_BLOCK_SIZE) return 0;
+    uint32_t spb = BCACHE_BLOCK_SIZE / dev->sector_size;
+    return block < dev->sectors / spb ? spb : 0;
+}
+
+// ---------------------------------------------------------------
+// Чтение
+// ---------------------------------------------------------------
+
+static buf_t *bcache_lookup(block_device_t *dev, uint64_t block, int read) {
+    uint32_t spb = bcache_spb(dev, block);
+    if (!spb) return NULL;
+
+    buf_t *b;
+    for (int attempt = 0;; attempt++) {
+        arch_irqflags_t flags = spin_lock_irqsave(&bcache_lock);
+        b = bcache_find(dev, block);
+        if (b) {
+            // Повтор в A1in — ещё не признак горячего блока (2Q)
+            stats.hits++;
+            b->refcnt++;
+            if (b->list == BUF_LIST_AM) {
+                list_del(b);
+                list_push(b, BUF_LIST_AM);
+            }
+            spin_unlock_irqrestore(&bcache_lock, flags);
+            break;
+        }
+
+        b = bcache_insert(dev, block);
+        if (b) {
+            stats.misses++;
+            spin_unlock_irqrestore(&bcache_lock, flags);
+            break;
+        }
+        spin_unlock_irqrestore(&bcache_lock, flags);
+
+        // Свободных нет, кроме грязных: записать их и повторить
+        if (attempt) return NULL;
+        bcache_sync(NULL);
+    }
+
+    // Данных ещё нет: дождаться чужого чтения или прочитать самим
+    for (;;) {
+        while (atomic_load32_acquire(&b->io)) {
+            wait_on_address(&b->io, 1);
+        }
+
+        arch_irqflags_t flags = spin_lock_irqsave(&bcache_lock);
+        if (b->flags & BUF_VALID) {
+            spin_unlock_irqrestore(&bcache_lock, flags);
+            return b;
+        }
+        if (b->io) {
+            spin_unlock_irqrestore(&bcache_lock, flags);
+            continue;
+        }
+        if (!read) {
+            b->flags |= BUF_VALID;
+            spin_unlock_irqrestore(&bcache_lock, flags);
+            return b;
+        }
+        b->io = 1;
+        spin_unlock_irqrestore(&bcache_lock, flags);
+
+        bio_t *bio = &b->bio;
+        bio->dev = dev;
+        bio->lba = block * spb;
+        bio->sectors = spb;
+        bio->buf = b->data;
+        bio->write = 0;
+        int ret = submit_bio_wait(bio);
+
+        flags = spin_lock_irqsave(&bcache_lock);
+        if (ret == 0) b->flags |= BUF_VALID;
+        else stats.errors++;
+        spin_unlock_irqrestore(&bcache_lock, flags);
+        atomic_store32_release(&b->io, 0);
+        wake_address(&b->io, WAKE_ALL);
+
+        if (ret != 0) {
+            bcache_release(b);
+            return NULL;
+        }
+        return b;
+    }
+}
+
+buf_t *bcache_read(block_device_t *dev, uint64_t block) {
+    return bcache_lookup(dev, block, 1);
+}
+
+buf_t *bcache_get(block_device_t *dev, uint64_t block) {
+    return bcache_lookup(dev, block, 0);
+}
+
+static void bcache_end_read(bio_t *bio) {
+    buf_t *b = (buf_t *)bio->private;
+
+    arch_irqflags_t flags = spin_lock_irqsave(&bcache_lock);
+    if (bio->status == 0) b->flags |= BUF_VALID;
+    else stats.errors++;
+    b->refcnt--;
+    spin_unlock_irqrestore(&bcache_lock, flags);
+
+    atomic_store32_release(&b->io, 0);
+    wake_address(&b->io, WAKE_ALL);
+}
+
+uint32_t bcache_prefetch(block_device_t *dev, const uint64_t *blocks, uint32_t n) {
+    uint32_t issued = 0;
+    blk_plug_t plug;
+    blk_start_plug(&plug);
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t spb = bcache_spb(dev, blocks[i]);
+        if (!spb) break;
+
+        arch_irqflags_t flags = spin_lock_irqsave(&bcache_lock);
+        if (bcache_find(dev, blocks[i])) {
+            spin_unlock_irqrestore(&bcache_lock, flags);
+            continue;
+        }
+        // Ради чтения вперёд грязные не пишем: нет буфера — хватит
+        buf_t *b = bcache_insert(dev, blocks[i]);
+        if (!b) {
+            spin_unlock_irqrestore(&bcache_lock, flags);
+            break;
+        }
+        b->io = 1;
+        stats.prefetched++;
+        spin_unlock_irqrestore(&bcache_lock, flags);
+
+        bio_t *bio = &b->bio;
+        bio->dev = dev;
+        bio->lba = blocks[i] * spb;
+        bio->sectors = spb;
+        bio->buf = b->data;
+        bio->write = 0;
+        bio->end_io = bcache_end_read;
+        bio->private = b;
+        submit_bio(&plug, bio);
+        issued++;
+    }
+
+    blk_finish_plug(&plug);
+    return issued;
+}
+
+void bcache_release(buf_t *b) {
+    arch_irqflags_t flags = spin_lock_irqsave(&bcache_lock);
+    b->refcnt--;
+    spin_unlock_irqrestore(&bcache_lock, flags);
+}
+
+// ---------------------------------------------------------------
+// Запись
+// ---------------------------------------------------------------
+
+static void bcache_end_write(bio_t *bio) {
+    buf_t *b = (buf_t *)bio->private;
+    bcache_wb_t *wb = b->wb;
+
+    arch_irqflags_t flags = spin_lock_irqsave(&bcache_lock);
+    if (bio->status) {
+        // Блок снова грязный: запишем в следующий раз
+        if (!(b->flags & BUF_DIRTY)) {
+            b->flags |= BUF_DIRTY;
+            stats.dirty++;
+        }
+        stats.errors++;
+        wb->error = 1;
+    } else {
+        stats.writebacks++;
+    }
+    b->refcnt--;
+    spin_unlock_irqrestore(&bcache_lock, flags);
+
+    atomic_store32_release(&b->io, 0);
+    wake_address(&b->io, WAKE_ALL);
+    if (atomic_fetch_sub32(&wb->pending, 1) == 1) {
+        if (wb == &flush_wb) atomic_store32_release(&flush_pending, 0);
+        else complete(&wb->done);
+    }
+}
+
+static int buf_before(const buf_t *a, const buf_t *b) {
+    if (a->dev != b->dev) return (uintptr_t)a->dev < (uintptr_t)b->dev;
+    return a->block < b->block;
+}
+
+// Отправить пачку до BCACHE_WB_BATCH грязных блоков dev (NULL — всех
+// устройств), не дожидаясь диска; завершение каждого блока — в
+// bcache_end_write. Блоки, запись которых уже в полёте, пропускаются.
+// Возвращает число отправленных блоков.
+static uint32_t bcache_wb_start(block_device_t *dev, bcache_wb_t *wb) {
+    buf_t *batch[BCACHE_WB_BATCH];
+    uint32_t n = 0;
+
+    arch_irqflags_t flags = spin_lock_irqsave(&bcache_lock);
+    for (uint32_t i = 0; i < BCACHE_BUFFERS && n < BCACHE_WB_BATCH; i++) {
+        buf_t *b = &bufs[i];
+        if (!(b->flags & BUF_DIRTY) || b->io || (dev && b->dev != dev)) continue;
+        b->flags &= ~BUF_DIRTY;
+        stats.dirty--;
+        b->refcnt++;
+        b->io = 1;
+        b->wb = wb;
+        batch[n++] = b;
+    }
+    spin_unlock_irqrestore(&bcache_lock, flags);
+    if (!n) return 0;
+
+    // По возрастанию блока: соседние сольются в одну команду
+    for (uint32_t i = 1; i < n; i++) {
+        buf_t *b = batch[i];
+        uint32_t j = i;
+        while (j && buf_before(b, batch[j - 1])) {
+            batch[j] = batch[j - 1];
+            j--;
+        }
+        batch[j] = b;
+    }
+
+    // До первой отправки: завершение может прийти, пока ставим остальные
+    wb->pending = n;
+    blk_plug_t plug;
+    blk_start_plug(&plug);
+    for (uint32_t i = 0; i < n; i++) {
+        buf_t *b = batch[i];
+        uint32_t spb = BCACHE_BLOCK_SIZE / b->dev->sector_size;
+        bio_t *bio = &b->bio;
+        bio->dev = b->dev;
+        bio->lba = b->block * spb;
+        bio->sectors = spb;
+        bio->buf = b->data;
+        bio->write = 1;
+        bio->end_io = bcache_end_write;
+        bio->private = b;
+        submit_bio(&plug, bio);
+    }
+    blk_finish_plug(&plug);
+    return n;
+}
+
+// Записать грязные блоки dev (NULL — всех устройств) и дождаться диска.
+// Блоки, запись которых уже в полёте, пропускаются — их ждёт
+// bcache_wait_io().
+static int bcache_write_dirty(block_device_t *dev) {
+    for (;;) {
+        bcache_wb_t wb;
+        wb.error = 0;
+        init_completion(&wb.done);
+
+        uint32_t n = bcache_wb_start(dev, &wb);
+        if (!n) break;
+        wait_for_completion(&wb.done);
+
+        if (wb.error) return -1;
+        if (n < BCACHE_WB_BATCH) break;
+    }
+    return 0;
+}
+
+// Фоновая запись: отправить одну пачку и вернуться, не дожидаясь диска.
+// Пачку закрывает bcache_end_write последнего блока; если грязных всё
+// ещё не меньше порога, следующую поставит очередной bcache_mark_dirty.
+// Ошибки не теряются: блоки снова грязные, их запишет следующая пачка.
+static void bcache_flush_task(void *arg) {
+    (void)arg;
+    flush_wb.error = 0;
+    if (!bcache_wb_start(NULL, &flush_wb)) atomic_store32_release(&flush_pending, 0);
+}
+
+void bcache_mark_dirty(buf_t *b) {
+    arch_irqflags_t flags = spin_lock_irqsave(&bcache_lock);
+    if (!(b->flags & BUF_DIRTY)) {
+        b->flags |= BUF_DIRTY;
+        stats.dirty++;
+    }
+    int kick = stats.dirty >= BCACHE_DIRTY_HIGH;
+    spin_unlock_irqrestore(&bcache_lock, flags);
+
+    if (kick && !atomic_xchg32(&flush_pending, 1)) {
+        if (task_create(bcache_flush_task, NULL) != 0) {
+            atomic_store32(&flush_pending, 0);
+        }
+    }
+}
+
+// Дождаться чтений и записей в полёте, начатых другими (фоновая
+// запись, параллельный sync). Возвращает 1, если после них есть
+// грязные блоки: неудачная запись снова помечает блок грязным.
+static int bcache_wait_io(block_device_t *dev) {
+    int dirty = 0;
+    for (uint32_t i = 0; i < BCACHE_BUFFERS; i++) {
+        buf_t *b = &bufs[i];
+        arch_irqflags_t flags = spin_lock_irqsave(&bcache_lock);
+        if (!b->io || (dev && b->dev != dev)) {
+            spin_unlock_irqrestore(&bcache_lock, flags);
+            continue;
+        }
+        b->refcnt++;            // не дать отдать буфер другому блоку
+        spin_unlock_irqrestore(&bcache_lock, flags);
+
+        while (atomic_load32_acquire(&b->io)) {
+            wait_on_address(&b->io, 1);
+        }
+
+        flags = spin_lock_irqsave(&bcache_lock);
+        if (b->flags & BUF_DIRTY) dirty = 1;
+        b->refcnt--;
+        spin_unlock_irqrestore(&bcache_lock, flags);
+    }
+    return dirty;
+}
+
+int bcache_sync(block_device_t *dev) {
+    // Чужую запись, закончившуюся ошибкой, повторяем сами: её ошибка
+    // становится нашей
+    do {
+        if (bcache_write_dirty(dev) != 0) return -1;
+    } while (bcache_wait_io(dev));
+
+    // Кэш записи самих дисков
+    int ret = 0;
+    for (block_device_t *d = block_first(); d; d = d->next) {
+        if ((!dev || d == dev) && block_flush(d) != 0) ret = -1;
+    }
+    return ret;
+}
+
+void bcache_get_stats(bcache_stats_t *out) {
+    arch_irqflags_t flags = spin_lock_irqsave(&bcache_lock);
+    *out = stats;
+    spin_unlock_irqrestore(&bcache_lock, flags);
+}
@@ -0,0 +1,104 @@
+// bcache.h — кэш блоков дисков (buffer cache)
+//
+// Метаданные файловых систем читаются много раз: один и тот же сектор
+// FAT, каталог или суперблок. Кэш держит блоки по BCACHE_BLOCK_SIZE
+// байт, найденные по паре (устройство, номер блока) через хэш-таблицу,
+// так что повторное обращение не доходит до диска.
+//
+// Вытеснение — 2Q: впервые прочитанный блок попадает в короткую FIFO
+// A1in и вытесняется из неё, не потеснив горячие блоки, — поэтому
+// однократный проход по большому файлу не вымывает кэш. Ключи
+// вытесненных из A1in блоков помнит «призрачная» очередь A1out; блок,
+// прочитанный снова, пока его ключ там, считается горячим и идёт в LRU
+// Am.
+//
+// Запись отложенная: bcache_mark_dirty() только помечает блок, на диск
+// его отправляют bcache_sync(), вытеснение или фоновая задача, которая
+// запускается, когда грязных блоков становится BCACHE_DIRTY_HIGH.
+// Фоновая задача только отправляет пачку и не ждёт диска: пачку
+// закрывает завершение последней записи, а следующую поставит очередной
+// bcache_mark_dirty(), если грязных всё ещё не меньше порога.
+// Запись идёт пачками через plug блочного слоя, отсортированная по
+// номеру блока, поэтому соседние блоки сливаются в одну команду.
+//
+// Вызовы могут спать (ждать диска), поэтому из обработчиков прерываний
+// их делать нельзя.
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include <stdint.h>
+#include "../drivers/bio.h"
+
+#define BCACHE_BLOCK_SIZE 4096
+#define BCACHE_BUFFERS    512
+#define BCACHE_HASH_BITS  10
+
+// 2Q: доля A1in (Kin) и число ключей в A1out (Kout)
+#define BCACHE_A1IN_MAX   (BCACHE_BUFFERS / 4)
+#define BCACHE_GHOSTS     (BCACHE_BUFFERS / 2)
+
+// Грязных блоков, при которых запускается фоновая запись
+#define BCACHE_DIRTY_HIGH (BCACHE_BUFFERS / 4)
+
+// Блоков в одной пачке записи
+#define BCACHE_WB_BATCH   BLK_PLUG_MAX
+
+#define BUF_VALID 0x1   // данные прочитаны
+#define BUF_DIRTY 0x2   // изменены, не записаны
+
+typedef struct buf {
+    block_device_t *dev;
+    uint64_t block;
+    uint8_t *data;             // BCACHE_BLOCK_SIZE байт
+
+    // Под блокировкой кэша
+    uint32_t flags;
+    uint32_t refcnt;
+    uint32_t list;             // в какой очереди 2Q
+    volatile uint32_t io;      // 1 — идёт чтение или запись
+
+    bio_t bio;
+    struct bcache_wb *wb;      // пачка записи, в которой блок
+    struct buf *hnext;
+    struct buf *lnext, *lprev;
+} buf_t;
+
+typedef struct bcache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t ghost_hits;       // промахи, вернувшие блок в Am
+    uint64_t prefetched;       // прочитано вперёд (bcache_prefetch)
+    uint64_t evictions;
+    uint64_t writebacks;       // записанных блоков
+    uint64_t errors;
+    uint32_t dirty;
+} bcache_stats_t;
+
+void bcache_init(void);
+
+// Блок с прочитанными данными (ссылка: вернуть bcache_release) или
+// NULL — ошибка чтения, блок вне устройства или все буферы заняты
+buf_t *bcache_read(block_device_t *dev, uint64_t block);
+
+// То же без чтения — для блока, который будет перезаписан целиком
+buf_t *bcache_get(block_device_t *dev, uint64_t block);
+
+void bcache_release(buf_t *b);
+
+// Начать чтение блоков, которых нет в кэше, не дожидаясь их: одним
+// plug, так что подряд идущие блоки уходят одной командой. Блоки
+// появляются в кэше по завершении; bcache_read дождётся идущего
+// чтения. Возвращает число начатых чтений.
+uint32_t bcache_prefetch(block_device_t *dev, const uint64_t *blocks, uint32_t n);
+
+// Данные блока изменены; запишутся позже
+void bcache_mark_dirty(buf_t *b);
+
+// Записать грязные блоки устройства (NULL — всех) и дождаться их и
+// записей, уже начатых фоновой задачей или другим sync.
+// 0 — успех, -1 — была ошибка записи (блоки остались грязными).
+int bcache_sync(block_device_t *dev);
+
+void bcache_get_stats(bcache_stats_t *stats);
+
+#endif // BCACHE_H
@@ -0,0 +1,679 @@
+// fat32.c — FAT32 только для чтения: FAT через кэш блоков, экстенты файлов, чтение вперёд
+#include "fat32.h"
+#include "bcache.h"
+#include "readahead.h"
+#include "../include/atomic.h"
+#include "../lib/string.h"
+#include "../lib/sync/spinlock.h"
+#include "../lib/sync/wait.h"
+
+#include <stddef.h>
+
+#define FAT32_POS_END     (~0ull)
+
+// Корень FAT32 — цепочка без записи каталога; остальные inode нумеруются
+// байтом своей записи на устройстве (кратен 32, корню не равен)
+#define FAT32_ROOT_INO    1
+
+#define DIRENT_SIZE       32
+#define ATTR_VOLUME       0x08
+#define ATTR_DIR          0x10
+#define ATTR_LFN          0x0F
+#define ATTR_LFN_MASK     0x3F
+#define LFN_LAST          0x40
+#define LFN_CHARS         13
+#define LFN_MAX           255
+#define NT_LOWER_BASE     0x08
+#define NT_LOWER_EXT      0x10
+
+// Выравнивание буфера для DMA прямо в него: PRP NVMe без SGL и PRD ATA
+// не принимают произвольный адрес
+#define DATA_DMA_ALIGN    4
+
+// Следующий кластер цепочки: конец или ошибка (свободный, битый,
+// вне тома, сбой чтения)
+#define CHAIN_END         0
+#define CHAIN_BAD         0xFFFFFFFFu
+
+typedef struct fat32_fs {
+    block_device_t *dev;
+    uint64_t fat_byte;         // FAT №0 на устройстве
+    uint64_t data_byte;        // кластер 2
+    uint32_t cluster_bytes;
+    uint32_t clusters;         // кластеров данных
+    uint32_t root_cluster;
+    int ra;                    // кластеры кратны блокам кэша и выровнены по ним
+    int used;
+} fat32_fs_t;
+
+typedef struct fat32_extent {
+    uint32_t fcluster;         // кластер файла
+    uint32_t dcluster;         // кластер диска
+    uint32_t len;
+} fat32_extent_t;
+
+// Экстенты только добавляются — под lock (спящей: достройка читает
+// FAT), а читатели ищут в первых nextents без неё. Окно чтения вперёд
+// общее для читателей inode и без блокировки: одновременные потоки
+// портят только догадку о потоке, но не данные.
+typedef struct fat32_file {
+    fat32_fs_t *fs;
+    uint32_t clusters;         // кластеров по размеру; у каталога — до конца цепочки
+    uint32_t tail;             // кластер за последним экстентом или CHAIN_END/CHAIN_BAD
+    volatile uint32_t nextents;
+    volatile uint32_t lock;
+    struct fat32_file *next_free;
+    readahead_t ra;
+    fat32_extent_t extents[FAT32_EXTENTS];
+} fat32_file_t;
+
+typedef struct fat32_dent {
+    char name[VFS_NAME_MAX + 1];
+    uint32_t len;
+    uint64_t ino;
+    uint8_t attr;
+    uint32_t cluster;
+    uint32_t size;
+} fat32_dent_t;
+
+// Пулы — под fat32_lock
+static spinlock_t fat32_lock = SPINLOCK_INIT("fat32");
+
+static fat32_fs_t volumes[FAT32_MOUNTS];
+static fat32_file_t files[FAT32_FILES];
+static fat32_file_t *file_free;
+
+static fat32_stats_t stats;
+
+#define STAT_ADD(field, n) atomic_fetch_add64(&stats.field, (n))
+
+static uint16_t le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t le32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// ---------------------------------------------------------------
+// Метаданные через кэш блоков
+// ---------------------------------------------------------------
+
+// Байт byte устройства в блоке кэша. Блок держится в *held, пока
+// следующие обращения попадают в него же; вызывающий отпускает его.
+static const uint8_t *meta_at(block_device_t *dev, buf_t **held, uint64_t byte) {
+    uint64_t block = byte / BCACHE_BLOCK_SIZE;
+    if (!*held || (*held)->block != block) {
+        if (*held) bcache_release(*held);
+        *held = bcache_read(dev, block);
+        if (!*held) return NULL;
+    }
+    return (*held)->data + byte % BCACHE_BLOCK_SIZE;
+}
+
+static void meta_release(buf_t **held) {
+    if (*held) bcache_release(*held);
+    *held = NULL;
+}
+
+static int cluster_valid(const fat32_fs_t *fs, uint32_t c) {
+    return c >= 2 && c - 2 < fs->clusters;
+}
+
+static uint64_t cluster_byte(const fat32_fs_t *fs, uint32_t c) {
+    return fs->data_byte + (uint64_t)(c - 2) * fs->cluster_bytes;
+}
+
+// Запись FAT кластера c: соседние записи цепочки лежат в том же блоке
+static uint32_t fat_next(fat32_fs_t *fs, uint32_t c, buf_t **held) {
+    STAT_ADD(fat_reads, 1);
+    const uint8_t *p = meta_at(fs->dev, held, fs->fat_byte + (uint64_t)c * 4);
+    if (!p) return CHAIN_BAD;
+    uint32_t v = le32(p) & 0x0FFFFFFF;
+    if (v >= 0x0FFFFFF8) return CHAIN_END;
+    return cluster_valid(fs, v) ? v : CHAIN_BAD;
+}
+
+// ---------------------------------------------------------------
+// Экстенты
+// ---------------------------------------------------------------
+
+static void file_lock(fat32_file_t *f) {
+    while (atomic_xchg32(&f->lock, 1)) {
+        wait_on_address(&f->lock, 1);
+    }
+}
+
+static void file_unlock(fat32_file_t *f) {
+    atomic_store32_release(&f->lock, 0);
+    wake_address(&f->lock, 1);
+}
+
+// Экстент с кластером файла fc среди первых n или -1
+static int find_extent(const fat32_file_t *f, uint32_t n, uint32_t fc) {
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (f->extents[mid].fcluster <= fc) lo = mid + 1;
+        else hi = mid;
+    }
+    if (!lo) return -1;
+    const fat32_extent_t *e = &f->extents[lo - 1];
+    return fc - e->fcluster < e->len ? (int)(lo - 1) : -1;
+}
+
+// Под f->lock: достроить экстенты, пока не покрыт кластер fc, не
+// кончилась цепочка или место
+static void extend_locked(fat32_file_t *f, uint32_t fc) {
+    fat32_fs_t *fs = f->fs;
+    buf_t *held = NULL;
+    uint32_t n = f->nextents;
+
+    while (n < FAT32_EXTENTS && cluster_valid(fs, f->tail)) {
+        uint32_t fcl = 0;
+        if (n) {
+            const fat32_extent_t *last = &f->extents[n - 1];
+            fcl = last->fcluster + last->len;
+            if (fc < fcl) break;
+        }
+        if (fcl >= f->clusters) {
+            f->tail = CHAIN_END;
+            break;
+        }
+
+        // Отрезок подряд идущих кластеров; за концом файла FAT не читается
+        uint32_t d = f->tail;
+        uint32_t len = 1;
+        uint32_t next;
+        for (;;) {
+            if (fcl + len >= f->clusters) {
+                next = CHAIN_END;
+                break;
+            }
+            next = fat_next(fs, d + len - 1, &held);
+            if (next != d + len) break;
+            len++;
+        }
+        f->extents[n] = (fat32_extent_t){ fcl, d, len };
+        f->tail = next;
+        atomic_store32_release(&f->nextents, ++n);
+    }
+    meta_release(&held);
+}
+
+// Под f->lock, экстенты кончились: пройти цепочку от последнего
+static int walk_locked(fat32_file_t *f, uint32_t fc, uint32_t *dc, uint32_t *run) {
+    fat32_fs_t *fs = f->fs;
+    const fat32_extent_t *last = &f->extents[FAT32_EXTENTS - 1];
+    uint32_t fcl = last->fcluster + last->len;
+    uint32_t c = f->tail;
+    buf_t *held = NULL;
+
+    STAT_ADD(chain_walks, 1);
+    while (cluster_valid(fs, c) && fcl < fc) {
+        c = fat_next(fs, c, &held);
+        fcl++;
+    }
+    if (!cluster_valid(fs, c) || fc >= f->clusters) {
+        meta_release(&held);
+        return -1;
+    }
+    uint32_t r = 1;
+    while (fc + r < f->clusters && fat_next(fs, c + r - 1, &held) == c + r) r++;
+    meta_release(&held);
+    *dc = c;
+    *run = r;
+    return 0;
+}
+
+// Кластер диска для кластера файла fc и сколько кластеров подряд за
+// ним на диске; -1 — за концом цепочки или она испорчена
+static int bmap(fat32_file_t *f, uint32_t fc, uint32_t *dc, uint32_t *run) {
+    int i = find_extent(f, atomic_load32_acquire(&f->nextents), fc);
+    if (i >= 0) {
+        STAT_ADD(extent_hits, 1);
+    } else {
+        file_lock(f);
+        extend_locked(f, fc);
+        uint32_t n = f->nextents;
+        i = find_extent(f, n, fc);
+        if (i < 0 && n == FAT32_EXTENTS) {
+            int ret = walk_locked(f, fc, dc, run);
+            file_unlock(f);
+            return ret;
+        }
+        file_unlock(f);
+        if (i < 0) return -1;
+        STAT_ADD(extent_misses, 1);
+    }
+    const fat32_extent_t *e = &f->extents[i];
+    *dc = e->dcluster + (fc - e->fcluster);
+    *run = e->len - (fc - e->fcluster);
+    return 0;
+}
+
+// ---------------------------------------------------------------
+// Данные
+// ---------------------------------------------------------------
+
+// Кусок одного сектора — через кэш блоков
+static int read_cached(fat32_fs_t *fs, uint64_t byte, uint8_t *dst, uint32_t len) {
+    buf_t *held = NULL;
+    const uint8_t *p = meta_at(fs->dev, &held, byte);
+    if (p) memcpy(dst, p, len);
+    meta_release(&held);
+    STAT_ADD(cached_reads, 1);
+    return p ? 0 : -1;
+}
+
+// [byte, byte + len) подряд на устройстве: неполные сектора по краям
+// через кэш, целые — командами по max_transfer секторов прямо в dst.
+// Невыровненный для DMA dst читается через кэш целиком.
+static int read_span(fat32_fs_t *fs, uint64_t byte, uint8_t *dst, uint64_t len) {
+    block_device_t *dev = fs->dev;
+    uint32_t head = byte % BLOCK_SECTOR_SIZE;
+    if (head) {
+        uint32_t n = BLOCK_SECTOR_SIZE - head;
+        if (n > len) n = (uint32_t)len;
+        if (read_cached(fs, byte, dst, n) != 0) return -1;
+        byte += n;
+        dst += n;
+        len -= n;
+    }
+
+    if ((uintptr_t)dst & (DATA_DMA_ALIGN - 1)) {
+        while (len) {
+            uint32_t n = BCACHE_BLOCK_SIZE - (uint32_t)(byte % BCACHE_BLOCK_SIZE);
+            if (n > len) n = (uint32_t)len;
+            if (read_cached(fs, byte, dst, n) != 0) return -1;
+            byte += n;
+            dst += n;
+            len -= n;
+        }
+        return 0;
+    }
+
+    uint64_t sectors = len / BLOCK_SECTOR_SIZE;
+    while (sectors) {
+        uint32_t k = sectors < dev->max_transfer ? (uint32_t)sectors : dev->max_transfer;
+        bio_t bio = {
+            .dev = dev,
+            .lba = byte / BLOCK_SECTOR_SIZE,
+            .sectors = k,
+            .buf = dst,
+            .write = 0,
+        };
+        if (submit_bio_wait(&bio) != 0) return -1;
+        STAT_ADD(data_cmds, 1);
+        STAT_ADD(data_sectors, k);
+        byte += (uint64_t)k * BLOCK_SECTOR_SIZE;
+        dst += (uint64_t)k * BLOCK_SECTOR_SIZE;
+        len -= (uint64_t)k * BLOCK_SECTOR_SIZE;
+        sectors -= k;
+    }
+
+    if (len) return read_cached(fs, byte, dst, (uint32_t)len);
+    return 0;
+}
+
+// Блок кэша устройства для блока index файла (по BCACHE_BLOCK_SIZE)
+static uint64_t ra_bmap(void *ctx, uint64_t index) {
+    fat32_file_t *f = (fat32_file_t *)ctx;
+    fat32_fs_t *fs = f->fs;
+    uint64_t byte = index * BCACHE_BLOCK_SIZE;
+    uint32_t dc, run;
+    if (byte / fs->cluster_bytes >= f->clusters ||
+        bmap(f, (uint32_t)(byte / fs->cluster_bytes), &dc, &run) != 0) {
+        return RA_NO_BLOCK;
+    }
+    return (cluster_byte(fs, dc) + byte % fs->cluster_bytes) / BCACHE_BLOCK_SIZE;
+}
+
+// Через кэш блоков с окном чтения вперёд: последовательный поток
+// находит блоки уже прочитанными большими командами
+static uint64_t read_ahead(fat32_file_t *f, uint64_t off, uint8_t *dst, uint64_t len) {
+    uint64_t done = 0;
+    while (done < len) {
+        uint64_t pos = off + done;
+        uint32_t in = (uint32_t)(pos % BCACHE_BLOCK_SIZE);
+        buf_t *b = readahead_read(&f->ra, f->fs->dev, ra_bmap, f, pos / BCACHE_BLOCK_SIZE);
+        if (!b) break;
+        uint64_t n = BCACHE_BLOCK_SIZE - in;
+        if (n > len - done) n = len - done;
+        memcpy(dst + done, b->data + in, n);
+        bcache_release(b);
+        STAT_ADD(ra_blocks, 1);
+        done += n;
+    }
+    return done;
+}
+
+static int64_t fat32_read(vfs_inode_t *inode, uint64_t off, void *buf, uint64_t len) {
+    fat32_file_t *f = (fat32_file_t *)inode->priv;
+    fat32_fs_t *fs = f->fs;
+    uint8_t *dst = (uint8_t *)buf;
+    if (off >= inode->size) return 0;
+    if (len > inode->size - off) len = inode->size - off;
+
+    if (fs->ra) {
+        uint64_t done = read_ahead(f, off, dst, len);
+        return done || !len ? (int64_t)done : -1;
+    }
+
+    // Кусок на экстент: подряд идущие кластеры — одним чтением
+    uint64_t done = 0;
+    while (done < len) {
+        uint64_t pos = off + done;
+        uint32_t in = (uint32_t)(pos % fs->cluster_bytes);
+        uint32_t dc, run;
+        if (bmap(f, (uint32_t)(pos / fs->cluster_bytes), &dc, &run) != 0) break;
+
+        uint64_t n = (uint64_t)run * fs->cluster_bytes - in;
+        if (n > len - done) n = len - done;
+        if (read_span(fs, cluster_byte(fs, dc) + in, dst + done, n) != 0) break;
+        done += n;
+    }
+    return done || !len ? (int64_t)done : -1;
+}
+
+// ---------------------------------------------------------------
+// Каталоги
+// ---------------------------------------------------------------
+
+static uint8_t short_checksum(const uint8_t *name) {
+    uint8_t sum = 0;
+    for (int i = 0; i < 11; i++) {
+        sum = (uint8_t)(((sum & 1) << 7) + (sum >> 1) + name[i]);
+    }
+    return sum;
+}
+
+// Имя 8.3: без пробелов-заполнителей, регистр — по флагам NT
+static uint32_t short_name(const uint8_t *e, char *out) {
+    uint32_t n = 0;
+    for (int i = 0; i < 8 && e[i] != ' '; i++) {
+        char c = (char)(i == 0 && e[0] == 0x05 ? 0xE5 : e[i]);
+        if ((e[12] & NT_LOWER_BASE) && c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        out[n++] = c;
+    }
+    if (e[8] != ' ') {
+        out[n++] = '.';
+        for (int i = 8; i < 11 && e[i] != ' '; i++) {
+            char c = (char)e[i];
+            if ((e[12] & NT_LOWER_EXT) && c >= 'A' && c <= 'Z') c += 'a' - 'A';
+            out[n++] = c;
+        }
+    }
+    out[n] = '\0';
+    return n;
+}
+
+// Следующая запись каталога f с байта *pos: длинное имя собирается из
+// записей VFAT перед короткой и берётся, если сходятся номера и сумма.
+// "." и "..", метка тома и удалённые пропускаются; имена длиннее
+// VFS_NAME_MAX — тоже. -1 — каталог кончился.
+static int dir_next(fat32_file_t *f, uint64_t *pos, fat32_dent_t *d, buf_t **held) {
+    static const uint8_t lfn_offs[LFN_CHARS] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+    fat32_fs_t *fs = f->fs;
+    char lfn[LFN_MAX + LFN_CHARS];
+    uint32_t lfn_len = 0;
+    uint32_t lfn_seq = 0;      // ожидаемый номер следующей записи VFAT, 0 — имени нет
+    uint8_t lfn_sum = 0;
+
+    for (;;) {
+        uint32_t dc, run;
+        if (bmap(f, (uint32_t)(*pos / fs->cluster_bytes), &dc, &run) != 0) return -1;
+        uint64_t byte = cluster_byte(fs, dc) + *pos % fs->cluster_bytes;
+        const uint8_t *e = meta_at(fs->dev, held, byte);
+        if (!e || !e[0]) return -1;
+        *pos += DIRENT_SIZE;
+
+        uint8_t attr = e[11];
+        if (e[0] == 0xE5) {
+            lfn_seq = 0;
+            continue;
+        }
+        if ((attr & ATTR_LFN_MASK) == ATTR_LFN) {
+            uint32_t seq = e[0] & 0x1F;
+            if (e[0] & LFN_LAST) {
+                lfn_seq = seq;
+                lfn_sum = e[13];
+                lfn_len = seq * LFN_CHARS;
+                if (lfn_len > LFN_MAX + LFN_CHARS - 1) lfn_seq = 0;
+            }
+            if (!seq || seq != lfn_seq || e[13] != lfn_sum) {
+                lfn_seq = 0;
+                continue;
+            }
+            // Символы UCS-2; имя кончается на 0x0000 (дальше 0xFFFF)
+            for (uint32_t i = 0; i < LFN_CHARS; i++) {
+                uint16_t ch = le16(e + lfn_offs[i]);
+                uint32_t at = (seq - 1) * LFN_CHARS + i;
+                if (!ch && at < lfn_len) lfn_len = at;
+                lfn[at] = ch < 0x80 ? (char)ch : '?';
+            }
+            lfn_seq--;
+            if (!lfn_seq) lfn_seq = ~0u;   // собрано, ждём короткую запись
+            continue;
+        }
+        int have_lfn = lfn_seq == ~0u && short_checksum(e) == lfn_sum;
+        lfn_seq = 0;
+        if ((attr & ATTR_VOLUME) || e[0] == '.') continue;
+
+        if (have_lfn) {
+            if (lfn_len > VFS_NAME_MAX) continue;
+            memcpy(d->name, lfn, lfn_len);
+            d->name[lfn_len] = '\0';
+            d->len = lfn_len;
+        } else {
+            d->len = short_name(e, d->name);
+        }
+        d->ino = byte;
+        d->attr = attr;
+        d->cluster = (uint32_t)le16(e + 20) << 16 | le16(e + 26);
+        d->size = le32(e + 28);
+        return 0;
+    }
+}
+
+static int name_eq_nocase(const char *a, const char *b, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        char x = a[i], y = b[i];
+        if (x >= 'a' && x <= 'z') x -= 'a' - 'A';
+        if (y >= 'a' && y <= 'z') y -= 'a' - 'A';
+        if (x != y) return 0;
+    }
+    return 1;
+}
+
+static int fat32_lookup(vfs_inode_t *dir, const char *name, uint32_t len, uint64_t *ino) {
+    fat32_file_t *f = (fat32_file_t *)dir->priv;
+    fat32_dent_t d;
+    buf_t *held = NULL;
+    uint64_t pos = 0;
+    int ret = -1;
+    while (dir_next(f, &pos, &d, &held) == 0) {
+        if (d.len == len && name_eq_nocase(d.name, name, len)) {
+            *ino = d.ino;
+            ret = 0;
+            break;
+        }
+    }
+    meta_release(&held);
+    return ret;
+}
+
+static int fat32_readdir(vfs_inode_t *dir, uint64_t *pos, vfs_dirent_t *ent) {
+    fat32_file_t *f = (fat32_file_t *)dir->priv;
+    fat32_dent_t d;
+    buf_t *held = NULL;
+    if (*pos == FAT32_POS_END) return -1;
+    int ret = dir_next(f, pos, &d, &held);
+    meta_release(&held);
+    if (ret != 0) {
+        *pos = FAT32_POS_END;
+        return -1;
+    }
+    memcpy(ent->name, d.name, d.len + 1);
+    ent->ino = d.ino;
+    ent->type = (d.attr & ATTR_DIR) ? VFS_DIR : VFS_FILE;
+    return 0;
+}
+
+// ---------------------------------------------------------------
+// inode
+// ---------------------------------------------------------------
+
+static int fat32_read_inode(vfs_inode_t *inode) {
+    fat32_fs_t *fs = (fat32_fs_t *)inode->sb->priv;
+    uint32_t first, size = 0;
+    uint32_t type = VFS_DIR;
+
+    if (inode->ino == FAT32_ROOT_INO) {
+        first = fs->root_cluster;
+    } else {
+        if (inode->ino % DIRENT_SIZE) return -1;
+        buf_t *held = NULL;
+        const uint8_t *e = meta_at(fs->dev, &held, inode->ino);
+        if (!e) return -1;
+        first = (uint32_t)le16(e + 20) << 16 | le16(e + 26);
+        if (!(e[11] & ATTR_DIR)) {
+            type = VFS_FILE;
+            size = le32(e + 28);
+        }
+        meta_release(&held);
+    }
+
+    spin_lock(&fat32_lock);
+    fat32_file_t *f = file_free;
+    if (f) file_free = f->next_free;
+    spin_unlock(&fat32_lock);
+    if (!f) return -1;
+
+    f->fs = fs;
+    f->clusters = type == VFS_DIR ? UINT32_MAX
+                                  : (uint32_t)(((uint64_t)size + fs->cluster_bytes - 1) / fs->cluster_bytes);
+    f->tail = first ? first : CHAIN_END;
+    f->nextents = 0;
+    f->lock = 0;
+    readahead_init(&f->ra);
+    inode->type = type;
+    inode->size = size;
+    inode->priv = f;
+    return 0;
+}
+
+static void fat32_evict_inode(vfs_inode_t *inode) {
+    fat32_file_t *f = (fat32_file_t *)inode->priv;
+    if (!f) return;
+    spin_lock(&fat32_lock);
+    f->next_free = file_free;
+    file_free = f;
+    spin_unlock(&fat32_lock);
+}
+
+static const vfs_ops_t fat32_ops = {
+    .read_inode = fat32_read_inode,
+    .evict_inode = fat32_evict_inode,
+    .lookup = fat32_lookup,
+    .read = fat32_read,
+    .readdir = fat32_readdir,
+};
+
+// ---------------------------------------------------------------
+// Монтирование
+// ---------------------------------------------------------------
+
+// Загрузочный сектор FAT32: секторы по 512 байт, корня FAT12/16 и
+// 16-битного размера FAT нет
+static int bpb_ok(const uint8_t *p) {
+    uint8_t spc = p[13];
+    return p[510] == 0x55 && p[511] == 0xAA && le16(p + 11) == BLOCK_SECTOR_SIZE &&
+           spc && !(spc & (spc - 1)) && le16(p + 14) && p[16] &&
+           !le16(p + 17) && !le16(p + 22) && le32(p + 36);
+}
+
+static int fat32_mount(vfs_sb_t *sb, block_device_t *dev, const void *data) {
+    if (!dev || dev->sector_size != BLOCK_SECTOR_SIZE) return -1;
+    uint64_t part = data ? *(const uint64_t *)data : 0;
+    buf_t *held = NULL;
+
+    const uint8_t *p = meta_at(dev, &held, part * BLOCK_SECTOR_SIZE);
+    if (p && !data && !bpb_ok(p) && p[510] == 0x55 && p[511] == 0xAA) {
+        // MBR: первый раздел FAT32 (LBA)
+        for (int i = 0; i < 4; i++) {
+            const uint8_t *pe = p + 446 + 16 * i;
+            if (pe[4] == 0x0B || pe[4] == 0x0C) {
+                part = le32(pe + 8);
+                p = meta_at(dev, &held, part * BLOCK_SECTOR_SIZE);
+                break;
+            }
+        }
+    }
+    if (!p || !bpb_ok(p)) {
+        meta_release(&held);
+        return -1;
+    }
+
+    uint32_t spc = p[13];
+    uint32_t reserved = le16(p + 14);
+    uint32_t fat_size = le32(p + 36);
+    uint32_t total = le16(p + 19) ? le16(p + 19) : le32(p + 32);
+    uint64_t data_sec = reserved + (uint64_t)p[16] * fat_size;
+    uint32_t root = le32(p + 44);
+    meta_release(&held);
+    if (total <= data_sec || part + total > dev->sectors) return -1;
+
+    // Кластеров не больше, чем записей в FAT
+    uint64_t clusters = (total - data_sec) / spc;
+    uint64_t fat_entries = (uint64_t)fat_size * (BLOCK_SECTOR_SIZE / 4) - 2;
+    if (clusters > fat_entries) clusters = fat_entries;
+
+    fat32_fs_t *fs = NULL;
+    spin_lock(&fat32_lock);
+    for (int i = 0; i < FAT32_MOUNTS && !fs; i++) {
+        if (!volumes[i].used) fs = &volumes[i];
+    }
+    if (fs) fs->used = 1;
+    spin_unlock(&fat32_lock);
+    if (!fs) return -1;
+
+    fs->dev = dev;
+    fs->fat_byte = (part + reserved) * BLOCK_SECTOR_SIZE;
+    fs->data_byte = (part + data_sec) * BLOCK_SECTOR_SIZE;
+    fs->cluster_bytes = spc * BLOCK_SECTOR_SIZE;
+    fs->clusters = (uint32_t)clusters;
+    fs->root_cluster = root;
+    fs->ra = fs->cluster_bytes % BCACHE_BLOCK_SIZE == 0 && fs->data_byte % BCACHE_BLOCK_SIZE == 0;
+    if (!cluster_valid(fs, root)) {
+        fs->used = 0;
+        return -1;
+    }
+
+    sb->ops = &fat32_ops;
+    sb->root_ino = FAT32_ROOT_INO;
+    sb->priv = fs;
+    return 0;
+}
+
+static vfs_fs_type_t fat32_type = {
+    .name = "fat32",
+    .mount = fat32_mount,
+};
+
+int fat32_init(void) {
+    file_free = NULL;
+    for (int i = FAT32_FILES - 1; i >= 0; i--) {
+        files[i].next_free = file_free;
+        file_free = &files[i];
+    }
+    for (int i = 0; i < FAT32_MOUNTS; i++) {
+        volumes[i].used = 0;
+    }
+    stats = (fat32_stats_t){ 0 };
+    return vfs_register_fs(&fat32_type);
+}
+
+void fat32_get_stats(fat32_stats_t *out) {
+    *out = stats;
+}
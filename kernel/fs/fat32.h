@@ -0,0 +1,60 @@
+// fat32.h — FAT32 (только чтение)
+//
+// Таблица FAT читается через общий кэш блоков: цепочку кластеров
+// проходят по записям, лежащим в уже прочитанных секторах FAT, и
+// диск видит их один раз.
+//
+// Цепочка файла переводится в экстенты — отрезки подряд идущих
+// кластеров (кластер файла, кластер диска, длина), — которые хранятся
+// при inode, пока он в кэше VFS. Экстенты строятся лениво, по мере
+// чтения, и отсортированы по кластеру файла, так что позиция в файле
+// находится двоичным поиском, а не проходом по цепочке от начала. На
+// файл помещается FAT32_EXTENTS экстентов; за ними цепочка проходится
+// от последнего экстента при каждом обращении.
+//
+// Данные файлов читаются через кэш блоков с чтением вперёд: у каждого
+// файла свой readahead_t, и последовательный поток находит блоки уже
+// прочитанными большими командами (readahead.h). Так нужно, чтобы
+// кластеры укладывались в блоки кэша — были кратны BCACHE_BLOCK_SIZE и
+// начинались на его границе. На томе с меньшими или невыровненными
+// кластерами данные идут в обход кэша: подряд идущие кластеры экстента
+// читаются одной многосекторной командой (bio не длиннее max_transfer
+// устройства) прямо в буфер читающего, а через кэш — только неполные
+// сектора по краям запроса и чтения в буфер, не выровненный для DMA
+// (по 4 байта).
+//
+// Имена — 8.3 и длинные (VFAT), без учёта регистра; символы длинных
+// имён вне ASCII заменяются на '?'.
+#ifndef FAT32_H
+#define FAT32_H
+
+#include <stdint.h>
+#include "vfs.h"
+
+// Смонтированных томов и открытых (в кэше inode) файлов и каталогов
+#define FAT32_MOUNTS   4
+#define FAT32_FILES    VFS_INODES
+
+// Экстентов на файл
+#define FAT32_EXTENTS  64
+
+typedef struct fat32_stats {
+    uint64_t extent_hits;      // позиция найдена в экстентах
+    uint64_t extent_misses;    // пришлось достроить экстенты
+    uint64_t chain_walks;      // за последним экстентом — проход по цепочке
+    uint64_t fat_reads;        // прочитано записей FAT
+    uint64_t data_cmds;        // многосекторных чтений данных
+    uint64_t data_sectors;
+    uint64_t cached_reads;     // кусков сектора через кэш блоков
+    uint64_t ra_blocks;        // блоков данных через чтение вперёд
+} fat32_stats_t;
+
+// Зарегистрировать тип "fat32" в VFS (после vfs_init). Монтирование:
+// vfs_mount("fat32", dev, NULL, path) — FAT32 с сектора 0 или в первом
+// разделе FAT32 таблицы MBR; data может указывать на uint64_t — LBA
+// начала тома.
+int fat32_init(void);
+
+void fat32_get_stats(fat32_stats_t *stats);
+
+#endif // FAT32_H
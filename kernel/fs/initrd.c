@@ -0,0 +1,384 @@
+// initrd.c — ФС только для чтения поверх архива cpio/tar в памяти, без копирования данных
+#include "initrd.h"
+#include "../include/atomic.h"
+#include "../lib/string.h"
+#include "../lib/sync/spinlock.h"
+
+#include <stddef.h>
+
+#define INITRD_POS_END    (~0ull)
+
+#define TAR_BLOCK         512
+#define CPIO_HEADER       110
+#define CPIO_TRAILER      "TRAILER!!!"
+
+#define CPIO_TYPE_MASK    0170000
+#define CPIO_TYPE_DIR     0040000
+#define CPIO_TYPE_FILE    0100000
+
+// Номера узлов; 0 — «нет». Имя и данные — указатели в образ.
+typedef struct initrd_node {
+    const char *name;
+    uint32_t len;
+    uint32_t type;
+    uint32_t hash;
+    uint32_t parent;
+    uint32_t hnext;            // цепочка хэша
+    uint32_t child, last;      // дети каталога в порядке архива
+    uint32_t next;
+    const uint8_t *data;
+    uint64_t size;
+} initrd_node_t;
+
+// Индекс строится при монтировании под initrd_lock и дальше не
+// меняется: поиск идёт без блокировки. Новые узлы попадают в голову
+// цепочки хэша с release — читатель видит их уже заполненными.
+static spinlock_t initrd_lock = SPINLOCK_INIT("initrd");
+
+static initrd_node_t nodes[INITRD_NODES];
+static uint32_t nodes_used;
+static uint32_t name_hash_tab[1u << INITRD_HASH_BITS];
+
+static initrd_stats_t stats;
+
+// ---------------------------------------------------------------
+// Индекс
+// ---------------------------------------------------------------
+
+// FNV-1a
+static uint32_t name_hash(const char *name, uint32_t len) {
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return h;
+}
+
+static uint32_t name_bucket(uint32_t dir, uint32_t hash) {
+    return ((hash ^ dir) * 0x9E3779B1u) >> (32 - INITRD_HASH_BITS);
+}
+
+static uint32_t find(uint32_t dir, const char *name, uint32_t len, uint32_t hash) {
+    uint32_t n = atomic_load32_acquire(&name_hash_tab[name_bucket(dir, hash)]);
+    for (; n; n = nodes[n].hnext) {
+        const initrd_node_t *node = &nodes[n];
+        if (node->parent != dir || node->hash != hash || node->len != len) continue;
+        uint32_t i = 0;
+        while (i < len && node->name[i] == name[i]) i++;
+        if (i == len) return n;
+    }
+    return 0;
+}
+
+// Под initrd_lock
+static uint32_t node_add_locked(uint32_t dir, const char *name, uint32_t len, uint32_t type) {
+    if (nodes_used >= INITRD_NODES) return 0;
+    uint32_t n = nodes_used++;
+    initrd_node_t *node = &nodes[n];
+    node->name = name;
+    node->len = len;
+    node->type = type;
+    node->hash = name_hash(name, len);
+    node->parent = dir;
+    node->child = node->last = node->next = 0;
+    node->data = NULL;
+    node->size = 0;
+
+    if (dir) {
+        initrd_node_t *parent = &nodes[dir];
+        if (parent->last) nodes[parent->last].next = n;
+        else parent->child = n;
+        parent->last = n;
+
+        uint32_t b = name_bucket(dir, node->hash);
+        node->hnext = name_hash_tab[b];
+        atomic_store32_release(&name_hash_tab[b], n);
+    }
+    if (type == VFS_DIR) stats.dirs++;
+    else stats.files++;
+    stats.nodes++;
+    return n;
+}
+
+// Под initrd_lock: узел пути path (len байт) от каталога dir; недостающие
+// промежуточные каталоги создаются, последний компонент получает type.
+// Пустой путь и "." — сам dir. 0 — путь не годится (.., длинное имя,
+// файл на месте каталога) или узлы кончились.
+static uint32_t add_path_locked(uint32_t dir, const char *path, uint32_t len, uint32_t type) {
+    uint32_t i = 0;
+    while (i < len) {
+        while (i < len && path[i] == '/') i++;
+        uint32_t start = i;
+        while (i < len && path[i] != '/') i++;
+        uint32_t clen = i - start;
+        const char *comp = path + start;
+        if (!clen || (clen == 1 && comp[0] == '.')) continue;
+        if ((clen == 2 && comp[0] == '.' && comp[1] == '.') || clen > VFS_NAME_MAX) return 0;
+
+        uint32_t j = i;
+        while (j < len && path[j] == '/') j++;
+        uint32_t t = j == len ? type : VFS_DIR;
+
+        uint32_t n = find(dir, comp, clen, name_hash(comp, clen));
+        if (!n) n = node_add_locked(dir, comp, clen, t);
+        if (!n || nodes[n].type != t) return 0;
+        dir = n;
+    }
+    return nodes[dir].type == type ? dir : 0;
+}
+
+// Под initrd_lock: файл или каталог из записи архива. Повтор пути
+// заменяет данные файла — как при распаковке.
+static void add_entry_locked(uint32_t dir, const char *path, uint32_t len, uint32_t type,
+                             const uint8_t *data, uint64_t size) {
+    uint32_t n = add_path_locked(dir, path, len, type);
+    if (!n) {
+        stats.skipped++;
+        return;
+    }
+    if (type == VFS_FILE) {
+        stats.bytes += size - nodes[n].size;
+        nodes[n].data = data;
+        nodes[n].size = size;
+    }
+}
+
+// ---------------------------------------------------------------
+// Форматы архивов
+// ---------------------------------------------------------------
+
+static uint64_t parse_octal(const uint8_t *p, uint32_t n) {
+    uint64_t v = 0;
+    uint32_t i = 0;
+    while (i < n && p[i] == ' ') i++;
+    for (; i < n && p[i] >= '0' && p[i] <= '7'; i++) {
+        v = v * 8 + (p[i] - '0');
+    }
+    return v;
+}
+
+// -1 — не шестнадцатеричное число
+static int64_t parse_hex8(const uint8_t *p) {
+    uint64_t v = 0;
+    for (uint32_t i = 0; i < 8; i++) {
+        uint8_t c = p[i];
+        uint32_t d;
+        if (c >= '0' && c <= '9') d = c - '0';
+        else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+        else return -1;
+        v = v * 16 + d;
+    }
+    return (int64_t)v;
+}
+
+// Длина строки в поле фиксированной ширины (без NUL, если поле полное)
+static uint32_t field_len(const uint8_t *p, uint32_t n) {
+    uint32_t i = 0;
+    while (i < n && p[i]) i++;
+    return i;
+}
+
+static int is_prefix(const uint8_t *p, const char *s) {
+    for (; *s; s++, p++) {
+        if (*p != (uint8_t)*s) return 0;
+    }
+    return 1;
+}
+
+// ustar: заголовки по 512 байт, данные следом с выравниванием на блок,
+// конец — нулевой блок. Имя — prefix[155] + "/" + name[100].
+static int parse_tar_locked(uint32_t root, const uint8_t *base, uint64_t size) {
+    uint64_t off = 0;
+    while (off + TAR_BLOCK <= size) {
+        const uint8_t *h = base + off;
+        if (!h[0]) return 0;
+
+        // Сумма заголовка, поле суммы считается пробелами
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i < TAR_BLOCK; i++) {
+            sum += (i >= 148 && i < 156) ? ' ' : h[i];
+        }
+        if (sum != parse_octal(h + 148, 8)) return -1;
+
+        uint64_t fsize = parse_octal(h + 124, 12);
+        uint64_t data = off + TAR_BLOCK;
+        if (fsize > size - data) return -1;
+
+        uint8_t flag = h[156];
+        uint32_t type = 0;
+        if (flag == '0' || flag == '\0' || flag == '7') type = VFS_FILE;
+        else if (flag == '5') type = VFS_DIR;
+
+        if (type) {
+            uint32_t dir = root;
+            uint32_t plen = is_prefix(h + 257, "ustar") ? field_len(h + 345, 155) : 0;
+            if (plen) dir = add_path_locked(root, (const char *)h + 345, plen, VFS_DIR);
+            if (dir) {
+                add_entry_locked(dir, (const char *)h, field_len(h, 100), type,
+                                 base + data, type == VFS_FILE ? fsize : 0);
+            } else {
+                stats.skipped++;
+            }
+        } else {
+            stats.skipped++;   // ссылки, устройства, расширенные заголовки
+        }
+        off = data + (fsize + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+    }
+    return 0;
+}
+
+// cpio newc: заголовок из 110 символов (поля — 8 шестнадцатеричных
+// цифр), имя с NUL, данные; имя и данные выровнены на 4 байта от начала
+// архива. Конец — запись "TRAILER!!!".
+static int parse_cpio_locked(uint32_t root, const uint8_t *base, uint64_t size) {
+    uint64_t off = 0;
+    while (off + CPIO_HEADER <= size) {
+        const uint8_t *h = base + off;
+        if (!is_prefix(h, "07070") || (h[5] != '1' && h[5] != '2')) return -1;
+
+        int64_t mode = parse_hex8(h + 14);
+        int64_t fsize = parse_hex8(h + 54);
+        int64_t namesize = parse_hex8(h + 94);
+        if (mode < 0 || fsize < 0 || namesize < 1) return -1;
+        if ((uint64_t)namesize > size - off - CPIO_HEADER) return -1;
+
+        const char *name = (const char *)h + CPIO_HEADER;
+        uint32_t nlen = (uint32_t)namesize - 1;
+        if (nlen == sizeof(CPIO_TRAILER) - 1 && is_prefix((const uint8_t *)name, CPIO_TRAILER)) {
+            return 0;
+        }
+
+        uint64_t data = (off + CPIO_HEADER + namesize + 3) & ~3ull;
+        if (data > size || (uint64_t)fsize > size - data) return -1;
+
+        uint32_t kind = (uint32_t)mode & CPIO_TYPE_MASK;
+        if (kind == CPIO_TYPE_FILE) {
+            add_entry_locked(root, name, nlen, VFS_FILE, base + data, (uint64_t)fsize);
+        } else if (kind == CPIO_TYPE_DIR) {
+            add_entry_locked(root, name, nlen, VFS_DIR, NULL, 0);
+        } else {
+            stats.skipped++;
+        }
+        off = (data + fsize + 3) & ~3ull;
+    }
+    return -1;                 // нет "TRAILER!!!" — образ обрезан
+}
+
+// ---------------------------------------------------------------
+// Операции VFS
+// ---------------------------------------------------------------
+
+static int initrd_read_inode(vfs_inode_t *inode) {
+    if (!inode->ino || inode->ino >= INITRD_NODES) return -1;
+    initrd_node_t *node = &nodes[inode->ino];
+    inode->type = node->type;
+    inode->size = node->size;
+    inode->priv = node;
+    return 0;
+}
+
+static int initrd_lookup(vfs_inode_t *dir, const char *name, uint32_t len, uint64_t *ino) {
+    uint32_t n = find((uint32_t)dir->ino, name, len, name_hash(name, len));
+    if (!n) return -1;
+    *ino = n;
+    return 0;
+}
+
+static int initrd_readdir(vfs_inode_t *dir, uint64_t *pos, vfs_dirent_t *ent) {
+    uint64_t n = *pos ? *pos : nodes[dir->ino].child;
+    if (!n || n >= INITRD_NODES) {
+        *pos = INITRD_POS_END;
+        return -1;
+    }
+    initrd_node_t *node = &nodes[n];
+    memcpy(ent->name, node->name, node->len);
+    ent->name[node->len] = '\0';
+    ent->ino = n;
+    ent->type = node->type;
+    *pos = node->next ? node->next : INITRD_POS_END;
+    return 0;
+}
+
+// Данные — прямо в образе, одним куском до конца файла
+static const void *initrd_map(vfs_inode_t *inode, uint64_t off, uint64_t *len) {
+    initrd_node_t *node = (initrd_node_t *)inode->priv;
+    if (off >= node->size) return NULL;
+    if (*len > node->size - off) *len = node->size - off;
+    return node->data + off;
+}
+
+static int64_t initrd_read(vfs_inode_t *inode, uint64_t off, void *buf, uint64_t len) {
+    const void *src = initrd_map(inode, off, &len);
+    if (!src) return 0;
+    memcpy(buf, src, len);
+    return (int64_t)len;
+}
+
+static const vfs_ops_t initrd_ops = {
+    .read_inode = initrd_read_inode,
+    .lookup = initrd_lookup,
+    .read = initrd_read,
+    .readdir = initrd_readdir,
+    .map = initrd_map,
+};
+
+// ---------------------------------------------------------------
+// Монтирование
+// ---------------------------------------------------------------
+
+// Построить индекс образа; испорченный образ не монтируется, и его
+// узлы снимаются с хэша в обратном порядке — каждый там голова цепочки
+static int initrd_mount(vfs_sb_t *sb, block_device_t *dev, const void *data) {
+    (void)dev;
+    const initrd_image_t *img = (const initrd_image_t *)data;
+    if (!img || !img->base) return -1;
+    const uint8_t *base = (const uint8_t *)img->base;
+
+    spin_lock(&initrd_lock);
+    uint32_t first = nodes_used;
+    initrd_stats_t saved = stats;
+    uint32_t root = node_add_locked(0, "", 0, VFS_DIR);
+    int rc = -1;
+    if (root && img->size >= 262 && is_prefix(base + 257, "ustar")) {
+        rc = parse_tar_locked(root, base, img->size);
+    } else if (root && img->size >= 6 && is_prefix(base, "07070")) {
+        rc = parse_cpio_locked(root, base, img->size);
+    }
+    if (rc != 0) {
+        for (uint32_t n = nodes_used; n-- > first;) {
+            if (nodes[n].parent) {
+                name_hash_tab[name_bucket(nodes[n].parent, nodes[n].hash)] = nodes[n].hnext;
+            }
+        }
+        nodes_used = first;
+        stats = saved;
+    }
+    spin_unlock(&initrd_lock);
+    if (rc != 0) return -1;
+
+    sb->ops = &initrd_ops;
+    sb->root_ino = root;
+    sb->priv = NULL;
+    return 0;
+}
+
+static vfs_fs_type_t initrd_type = {
+    .name = "initrd",
+    .mount = initrd_mount,
+};
+
+int initrd_init(void) {
+    nodes_used = 1;            // узел 0 — «нет»
+    for (uint32_t b = 0; b < (1u << INITRD_HASH_BITS); b++) {
+        name_hash_tab[b] = 0;
+    }
+    stats = (initrd_stats_t){ 0 };
+    return vfs_register_fs(&initrd_type);
+}
+
+void initrd_get_stats(initrd_stats_t *out) {
+    spin_lock(&initrd_lock);
+    *out = stats;
+    spin_unlock(&initrd_lock);
+}
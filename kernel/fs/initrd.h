@@ -0,0 +1,41 @@
+// initrd.h — файловая система только для чтения из образа в памяти
+//
+// Образ — архив cpio (newc, "070701"/"070702") или tar (ustar), обычно
+// модуль, загруженный вместе с ядром. При монтировании архив один раз
+// проходится целиком и строится индекс: узлы с именами-указателями в
+// архив и хэш по ключу (каталог, имя), так что поиск имени — одно
+// попадание в хэш. Каталоги, которых нет в архиве явно, создаются по
+// путям файлов.
+//
+// Данные не копируются: read и vfs_read_map() берут их прямо из
+// памяти образа, она должна жить, пока смонтирована ФС.
+#ifndef INITRD_H
+#define INITRD_H
+
+#include <stdint.h>
+#include "vfs.h"
+
+// Узлов (файлов и каталогов) на все экземпляры
+#define INITRD_NODES      4096
+#define INITRD_HASH_BITS  12
+
+// Аргумент data у vfs_mount("initrd", ...)
+typedef struct initrd_image {
+    const void *base;
+    uint64_t size;
+} initrd_image_t;
+
+typedef struct initrd_stats {
+    uint32_t nodes;            // занято
+    uint32_t files;
+    uint32_t dirs;
+    uint32_t skipped;          // ссылки, устройства, слишком длинные имена
+    uint64_t bytes;            // данных в файлах
+} initrd_stats_t;
+
+// Зарегистрировать тип "initrd" в VFS (после vfs_init)
+int initrd_init(void);
+
+void initrd_get_stats(initrd_stats_t *stats);
+
+#endif // INITRD_H
@@ -0,0 +1,503 @@
+// ramfs.c — файловая система в памяти: хэш имён, страничные данные, чтение без копирования
+#include "ramfs.h"
+#include "../include/arch.h"
+#include "../lib/printf.h"
+#include "../lib/string.h"
+#include "../lib/sync/spinlock.h"
+
+#include <stddef.h>
+
+#define RAMFS_POS_END    (~0ull)
+
+#define RAMFS_UNLINKED   0x1
+
+// Номера узлов и страниц; 0 — «нет»
+typedef struct ramfs_node {
+    char name[VFS_NAME_MAX + 1];
+    uint32_t type;             // 0 — узел свободен
+    uint32_t flags;
+    uint32_t hash;             // хэш имени
+    uint32_t parent;
+    uint32_t hnext;            // цепочка хэша; у свободных — список свободных
+    uint32_t child;            // первый ребёнок каталога
+    uint32_t next, prev;       // соседи в каталоге
+    uint32_t pages[RAMFS_DIRECT];
+    uint32_t indirect;         // страница номеров следующих страниц
+    uint64_t size;
+} ramfs_node_t;
+
+// Узлы, хэш, списки каталогов и пул страниц — под ramfs_lock. Данные
+// файла читают и пишут без блокировки: файл пишет один владелец.
+static spinlock_t ramfs_lock = SPINLOCK_INIT("ramfs");
+
+static ramfs_node_t nodes[RAMFS_NODES];
+static uint32_t node_free;
+static uint32_t name_hash_tab[1u << RAMFS_HASH_BITS];
+
+static uint8_t pages[RAMFS_PAGES][RAMFS_PAGE_SIZE] __attribute__((aligned(4096)));
+static uint32_t page_next[RAMFS_PAGES];
+static uint32_t page_free;
+
+static const uint8_t zero_page[RAMFS_PAGE_SIZE];
+
+static ramfs_stats_t stats;
+
+// ---------------------------------------------------------------
+// Пулы
+// ---------------------------------------------------------------
+
+// Страница, заполненная нулями, или 0
+static uint32_t page_alloc(void) {
+    spin_lock(&ramfs_lock);
+    uint32_t p = page_free;
+    if (p) {
+        page_free = page_next[p];
+        stats.pages++;
+    }
+    spin_unlock(&ramfs_lock);
+    if (p) memset(pages[p], 0, RAMFS_PAGE_SIZE);
+    return p;
+}
+
+// Под ramfs_lock
+static void page_free_locked(uint32_t p) {
+    if (!p) return;
+    page_next[p] = page_free;
+    page_free = p;
+    stats.pages--;
+}
+
+// Под ramfs_lock
+static uint32_t node_alloc_locked(void) {
+    uint32_t n = node_free;
+    if (n) {
+        node_free = nodes[n].hnext;
+        stats.nodes++;
+    }
+    return n;
+}
+
+// Под ramfs_lock: вернуть узел и его страницы
+static void node_free_locked(uint32_t n) {
+    ramfs_node_t *node = &nodes[n];
+    for (uint32_t i = 0; i < RAMFS_DIRECT; i++) {
+        page_free_locked(node->pages[i]);
+    }
+    if (node->indirect) {
+        const uint32_t *ind = (const uint32_t *)pages[node->indirect];
+        for (uint32_t i = 0; i < RAMFS_INDIRECT; i++) {
+            page_free_locked(ind[i]);
+        }
+        page_free_locked(node->indirect);
+    }
+    node->type = 0;
+    node->hnext = node_free;
+    node_free = n;
+    stats.nodes--;
+}
+
+static void node_init(uint32_t n, uint32_t type) {
+    ramfs_node_t *node = &nodes[n];
+    node->type = type;
+    node->flags = 0;
+    node->parent = 0;
+    node->hnext = 0;
+    node->child = node->next = node->prev = 0;
+    for (uint32_t i = 0; i < RAMFS_DIRECT; i++) {
+        node->pages[i] = 0;
+    }
+    node->indirect = 0;
+    node->size = 0;
+}
+
+// ---------------------------------------------------------------
+// Имена
+// ---------------------------------------------------------------
+
+// FNV-1a
+static uint32_t name_hash(const char *name, uint32_t len) {
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return h;
+}
+
+static uint32_t name_bucket(uint32_t dir, uint32_t hash) {
+    return ((hash ^ dir) * 0x9E3779B1u) >> (32 - RAMFS_HASH_BITS);
+}
+
+static int name_eq(const char *stored, const char *name, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        if (stored[i] != name[i]) return 0;
+    }
+    return !stored[len];
+}
+
+// Под ramfs_lock
+static uint32_t find_locked(uint32_t dir, const char *name, uint32_t len, uint32_t hash) {
+    for (uint32_t n = name_hash_tab[name_bucket(dir, hash)]; n; n = nodes[n].hnext) {
+        ramfs_node_t *node = &nodes[n];
+        if (node->parent == dir && node->hash == hash && name_eq(node->name, name, len)) {
+            return n;
+        }
+    }
+    return 0;
+}
+
+static int ramfs_read_inode(vfs_inode_t *inode) {
+    if (!inode->ino || inode->ino >= RAMFS_NODES) return -1;
+    ramfs_node_t *node = &nodes[inode->ino];
+    if (!node->type) return -1;
+    inode->type = node->type;
+    inode->size = node->size;
+    inode->priv = node;
+    return 0;
+}
+
+// Удалённый узел освобождается, когда VFS отпускает последний inode
+static void ramfs_evict_inode(vfs_inode_t *inode) {
+    ramfs_node_t *node = (ramfs_node_t *)inode->priv;
+    spin_lock(&ramfs_lock);
+    if (node->flags & RAMFS_UNLINKED) node_free_locked((uint32_t)inode->ino);
+    spin_unlock(&ramfs_lock);
+}
+
+static int ramfs_lookup(vfs_inode_t *dir, const char *name, uint32_t len, uint64_t *ino) {
+    uint32_t hash = name_hash(name, len);
+    spin_lock(&ramfs_lock);
+    uint32_t n = find_locked((uint32_t)dir->ino, name, len, hash);
+    spin_unlock(&ramfs_lock);
+    if (!n) return -1;
+    *ino = n;
+    return 0;
+}
+
+static int ramfs_create(vfs_inode_t *dir, const char *name, uint32_t len, uint32_t type,
+                        uint64_t *ino) {
+    uint32_t d = (uint32_t)dir->ino;
+    uint32_t hash = name_hash(name, len);
+    if (len > VFS_NAME_MAX) return -1;
+
+    spin_lock(&ramfs_lock);
+    uint32_t n = find_locked(d, name, len, hash) ? 0 : node_alloc_locked();
+    if (!n) {
+        spin_unlock(&ramfs_lock);
+        return -1;
+    }
+    node_init(n, type);
+    ramfs_node_t *node = &nodes[n];
+    for (uint32_t i = 0; i < len; i++) {
+        node->name[i] = name[i];
+    }
+    node->name[len] = '\0';
+    node->hash = hash;
+    node->parent = d;
+
+    uint32_t b = name_bucket(d, hash);
+    node->hnext = name_hash_tab[b];
+    name_hash_tab[b] = n;
+
+    ramfs_node_t *parent = &nodes[d];
+    node->next = parent->child;
+    if (parent->child) nodes[parent->child].prev = n;
+    parent->child = n;
+    spin_unlock(&ramfs_lock);
+
+    *ino = n;
+    return 0;
+}
+
+static int ramfs_unlink(vfs_inode_t *dir, const char *name, uint32_t len, vfs_inode_t *inode) {
+    (void)name;
+    (void)len;
+    uint32_t n = (uint32_t)inode->ino;
+    ramfs_node_t *node = &nodes[n];
+
+    spin_lock(&ramfs_lock);
+    if (node->type == VFS_DIR && node->child) {
+        spin_unlock(&ramfs_lock);
+        return -1;
+    }
+
+    uint32_t *link = &name_hash_tab[name_bucket(node->parent, node->hash)];
+    while (*link != n) link = &nodes[*link].hnext;
+    *link = node->hnext;
+
+    ramfs_node_t *parent = &nodes[(uint32_t)dir->ino];
+    if (node->prev) nodes[node->prev].next = node->next;
+    else parent->child = node->next;
+    if (node->next) nodes[node->next].prev = node->prev;
+
+    // Страницы освободит evict_inode: файл может быть ещё открыт
+    node->flags |= RAMFS_UNLINKED;
+    node->parent = 0;
+    spin_unlock(&ramfs_lock);
+    return 0;
+}
+
+static int ramfs_readdir(vfs_inode_t *dir, uint64_t *pos, vfs_dirent_t *ent) {
+    uint32_t d = (uint32_t)dir->ino;
+    spin_lock(&ramfs_lock);
+    uint64_t n = *pos ? *pos : nodes[d].child;
+    // Позиция — следующий ребёнок; если его удалили, листинг кончается
+    if (!n || n >= RAMFS_NODES || !nodes[n].type || nodes[n].parent != d) {
+        *pos = RAMFS_POS_END;
+        spin_unlock(&ramfs_lock);
+        return -1;
+    }
+    ramfs_node_t *node = &nodes[n];
+    uint32_t i;
+    for (i = 0; node->name[i]; i++) {
+        ent->name[i] = node->name[i];
+    }
+    ent->name[i] = '\0';
+    ent->ino = n;
+    ent->type = node->type;
+    *pos = node->next ? node->next : RAMFS_POS_END;
+    spin_unlock(&ramfs_lock);
+    return 0;
+}
+
+// ---------------------------------------------------------------
+// Данные
+// ---------------------------------------------------------------
+
+// Номер страницы pn файла: слот в узле или в косвенной странице. NULL —
+// за пределом RAMFS_MAX_FILE или косвенной страницы нет (alloc == 0)
+static uint32_t *page_slot(ramfs_node_t *node, uint64_t pn, int alloc) {
+    if (pn < RAMFS_DIRECT) return &node->pages[pn];
+    pn -= RAMFS_DIRECT;
+    if (pn >= RAMFS_INDIRECT) return NULL;
+    if (!node->indirect) {
+        if (!alloc || !(node->indirect = page_alloc())) return NULL;
+    }
+    return &((uint32_t *)pages[node->indirect])[pn];
+}
+
+static const void *ramfs_map(vfs_inode_t *inode, uint64_t off, uint64_t *len) {
+    ramfs_node_t *node = (ramfs_node_t *)inode->priv;
+    if (off >= node->size) return NULL;
+
+    uint64_t in = off % RAMFS_PAGE_SIZE;
+    uint64_t n = RAMFS_PAGE_SIZE - in;
+    if (n > node->size - off) n = node->size - off;
+    if (n > *len) n = *len;
+    *len = n;
+
+    uint32_t *slot = page_slot(node, off / RAMFS_PAGE_SIZE, 0);
+    if (!slot || !*slot) return zero_page + in;    // дыра
+    return pages[*slot] + in;
+}
+
+static int64_t ramfs_read(vfs_inode_t *inode, uint64_t off, void *buf, uint64_t len) {
+    uint8_t *dst = (uint8_t *)buf;
+    uint64_t done = 0;
+    while (done < len) {
+        uint64_t n = len - done;
+        const void *src = ramfs_map(inode, off + done, &n);
+        if (!src) break;
+        memcpy(dst + done, src, n);
+        done += n;
+    }
+    return (int64_t)done;
+}
+
+static int64_t ramfs_write(vfs_inode_t *inode, uint64_t off, const void *buf, uint64_t len) {
+    ramfs_node_t *node = (ramfs_node_t *)inode->priv;
+    const uint8_t *src = (const uint8_t *)buf;
+    uint64_t done = 0;
+
+    // Недостающие страницы добавляются; записанные не двигаются
+    while (done < len) {
+        uint64_t pos = off + done;
+        uint32_t *slot = page_slot(node, pos / RAMFS_PAGE_SIZE, 1);
+        if (!slot || (!*slot && !(*slot = page_alloc()))) break;
+
+        uint64_t in = pos % RAMFS_PAGE_SIZE;
+        uint64_t n = RAMFS_PAGE_SIZE - in;
+        if (n > len - done) n = len - done;
+        memcpy(pages[*slot] + in, src + done, n);
+        done += n;
+    }
+
+    if (off + done > node->size) {
+        node->size = off + done;
+        inode->size = node->size;
+    }
+    return done || !len ? (int64_t)done : -1;
+}
+
+static const vfs_ops_t ramfs_ops = {
+    .read_inode = ramfs_read_inode,
+    .evict_inode = ramfs_evict_inode,
+    .lookup = ramfs_lookup,
+    .create = ramfs_create,
+    .unlink = ramfs_unlink,
+    .read = ramfs_read,
+    .write = ramfs_write,
+    .readdir = ramfs_readdir,
+    .map = ramfs_map,
+};
+
+// ---------------------------------------------------------------
+// Монтирование
+// ---------------------------------------------------------------
+
+// Каждый экземпляр — свой корневой каталог в общих пулах
+static int ramfs_mount(vfs_sb_t *sb, block_device_t *dev, const void *data) {
+    (void)dev;
+    (void)data;
+    spin_lock(&ramfs_lock);
+    uint32_t root = node_alloc_locked();
+    if (root) node_init(root, VFS_DIR);
+    spin_unlock(&ramfs_lock);
+    if (!root) return -1;
+
+    nodes[root].name[0] = '\0';
+    sb->ops = &ramfs_ops;
+    sb->root_ino = root;
+    sb->priv = NULL;
+    return 0;
+}
+
+static vfs_fs_type_t ramfs_type = {
+    .name = "ramfs",
+    .mount = ramfs_mount,
+};
+
+int ramfs_init(void) {
+    // Узел 0 и страница 0 — «нет»
+    node_free = 0;
+    for (uint32_t n = RAMFS_NODES - 1; n > 0; n--) {
+        nodes[n].type = 0;
+        nodes[n].hnext = node_free;
+        node_free = n;
+    }
+    for (uint32_t b = 0; b < (1u << RAMFS_HASH_BITS); b++) {
+        name_hash_tab[b] = 0;
+    }
+    page_free = 0;
+    for (uint32_t p = RAMFS_PAGES - 1; p > 0; p--) {
+        page_next[p] = page_free;
+        page_free = p;
+    }
+    stats = (ramfs_stats_t){ 0 };
+    return vfs_register_fs(&ramfs_type);
+}
+
+void ramfs_get_stats(ramfs_stats_t *out) {
+    spin_lock(&ramfs_lock);
+    *out = stats;
+    spin_unlock(&ramfs_lock);
+}
+
+// ---------------------------------------------------------------
+// Замер
+// ---------------------------------------------------------------
+
+#define RAMFS_BENCH_FILES  100000
+#define RAMFS_BENCH_BYTES  (4 * 1024 * 1024)
+
+// "/bench/f<i>"
+static void bench_path(char *out, uint32_t i) {
+    const char *prefix = "/bench/f";
+    char digits[10];
+    uint32_t n = 0;
+    while (*prefix) *out++ = *prefix++;
+    do {
+        digits[n++] = (char)('0' + i % 10);
+        i /= 10;
+    } while (i);
+    while (n) *out++ = digits[--n];
+    *out = '\0';
+}
+
+static uint64_t bench_ns(uint64_t t0, uint32_t ops) {
+    return (arch_cycles() - t0) * 1000 / arch_cycles_per_us() / ops;
+}
+
+void ramfs_benchmark(void) {
+    if (vfs_mkdir("/bench") != 0) {
+        printf("ramfs bench: no /bench\n");
+        return;
+    }
+    printf("ramfs bench: %u files in one directory\n", RAMFS_BENCH_FILES);
+
+    char path[32];
+    uint32_t i;
+    uint64_t t0 = arch_cycles();
+    for (i = 0; i < RAMFS_BENCH_FILES; i++) {
+        bench_path(path, i);
+        vfs_file_t *f = vfs_open(path, VFS_O_CREAT);
+        if (!f) break;
+        vfs_close(f);
+    }
+    if (i < RAMFS_BENCH_FILES) {
+        printf("  create failed at file %u\n", i);
+        return;
+    }
+    printf("  create: %lu ns per file\n", bench_ns(t0, RAMFS_BENCH_FILES));
+
+    // Имён больше, чем dentry в кэше: поиск доходит до хэша ramfs
+    vfs_stat_t st;
+    t0 = arch_cycles();
+    for (i = 0; i < RAMFS_BENCH_FILES; i++) {
+        bench_path(path, (i * 7919u) % RAMFS_BENCH_FILES);
+        if (vfs_stat(path, &st) != 0) break;
+    }
+    printf("  lookup: %lu ns per path%s\n", bench_ns(t0, RAMFS_BENCH_FILES),
+           i < RAMFS_BENCH_FILES ? " (failed)" : "");
+
+    vfs_file_t *dir = vfs_open("/bench", 0);
+    vfs_dirent_t ent;
+    uint32_t listed = 0;
+    t0 = arch_cycles();
+    while (dir && vfs_readdir(dir, &ent) == 0) listed++;
+    if (dir) vfs_close(dir);
+    printf("  readdir: %u entries, %lu ns per entry\n", listed, bench_ns(t0, listed ? listed : 1));
+
+    t0 = arch_cycles();
+    for (i = 0; i < RAMFS_BENCH_FILES; i++) {
+        bench_path(path, i);
+        if (vfs_unlink(path) != 0) break;
+    }
+    printf("  unlink: %lu ns per file\n", bench_ns(t0, RAMFS_BENCH_FILES));
+
+    // Поток через один файл: запись, чтение с копированием и без
+    static uint8_t chunk[RAMFS_PAGE_SIZE];
+    uint32_t chunks = RAMFS_BENCH_BYTES / RAMFS_PAGE_SIZE;
+    vfs_file_t *f = vfs_open("/bench/stream", VFS_O_CREAT);
+    if (!f) return;
+
+    t0 = arch_cycles();
+    for (i = 0; i < chunks && vfs_write(f, chunk, sizeof(chunk)) == sizeof(chunk); i++) {
+    }
+    uint64_t us = (arch_cycles() - t0) / arch_cycles_per_us();
+    printf("  write: %lu MB/s\n", us ? (uint64_t)i * RAMFS_PAGE_SIZE / us : 0);
+    uint64_t bytes = (uint64_t)i * RAMFS_PAGE_SIZE;
+
+    vfs_seek(f, 0);
+    t0 = arch_cycles();
+    while (vfs_read(f, chunk, sizeof(chunk)) > 0) {
+    }
+    us = (arch_cycles() - t0) / arch_cycles_per_us();
+    printf("  read (copy): %lu MB/s\n", us ? bytes / us : 0);
+
+    vfs_seek(f, 0);
+    uint64_t sum = 0;
+    t0 = arch_cycles();
+    for (;;) {
+        uint64_t n = RAMFS_PAGE_SIZE;
+        const uint8_t *p = (const uint8_t *)vfs_read_map(f, &n);
+        if (!p) break;
+        sum += p[0];
+    }
+    us = (arch_cycles() - t0) / arch_cycles_per_us();
+    printf("  read (map): %lu MB/s\n", us ? bytes / us : 0);
+    (void)sum;
+
+    vfs_close(f);
+    vfs_unlink("/bench/stream");
+    vfs_unlink("/bench");
+}
@@ -0,0 +1,50 @@
+// ramfs.h — файловая система в памяти
+//
+// Каталоги иерархические; имена всех каталогов лежат в одной
+// хэш-таблице по ключу (каталог, имя), так что поиск имени — одно
+// попадание в хэш при любом размере каталога. Дети каталога связаны
+// ещё и списком — для readdir и проверки пустоты при удалении.
+//
+// Данные файла — страницы RAMFS_PAGE_SIZE из общего пула: первые
+// RAMFS_DIRECT адресуются из узла, остальные — через косвенную
+// страницу номеров. Файл растёт, добавляя страницы; записанное раньше
+// не переносится. Чтение через vfs_read_map() отдаёт указатель прямо
+// в страницу, без копирования; дыры читаются нулями.
+//
+// Узел удалённого файла, открытого в VFS, живёт до вытеснения его
+// inode — открытый файл остаётся читаемым.
+#ifndef RAMFS_H
+#define RAMFS_H
+
+#include <stdint.h>
+#include "vfs.h"
+
+// Узлов (файлов и каталогов) и страниц данных на все экземпляры
+#define RAMFS_NODES      (1u << 17)
+#define RAMFS_PAGES      2048
+#define RAMFS_PAGE_SIZE  4096
+#define RAMFS_HASH_BITS  17
+
+// Страниц в узле и номеров в косвенной странице
+#define RAMFS_DIRECT     4
+#define RAMFS_INDIRECT   (RAMFS_PAGE_SIZE / sizeof(uint32_t))
+
+// Наибольший файл
+#define RAMFS_MAX_FILE   ((uint64_t)(RAMFS_DIRECT + RAMFS_INDIRECT) * RAMFS_PAGE_SIZE)
+
+typedef struct ramfs_stats {
+    uint32_t nodes;            // занято
+    uint32_t pages;
+} ramfs_stats_t;
+
+// Подготовить пулы и зарегистрировать тип "ramfs" в VFS (после vfs_init)
+int ramfs_init(void);
+
+void ramfs_get_stats(ramfs_stats_t *stats);
+
+// Замер: 100 000 файлов в одном каталоге (создание, поиск, readdir,
+// удаление) и поток через файл в несколько МиБ (запись, чтение с
+// копированием и без)
+void ramfs_benchmark(void);
+
+#endif // RAMFS_H
@@ -0,0 +1,124 @@
+// readahead.c — окно чтения вперёд: обнаружение потока, рост окна, асинхронная подкачка
+#include "readahead.h"
+#include "../include/arch.h"
+#include "../lib/printf.h"
+
+#include <stddef.h>
+
+void readahead_init(readahead_t *ra) {
+    ra->start = 0;
+    ra->size = 0;
+    ra->async_size = 0;
+    ra->prev = 0;
+}
+
+// Блоки устройства для блоков файла [start, start + n); до конца файла
+static uint32_t ra_map(ra_bmap_t bmap, void *ctx, uint64_t start, uint32_t n, uint64_t *out) {
+    uint32_t i;
+    for (i = 0; i < n; i++) {
+        uint64_t block = bmap(ctx, start + i);
+        if (block == RA_NO_BLOCK) break;
+        out[i] = block;
+    }
+    return i;
+}
+
+// Начать чтение текущего окна. Драйвер с submit получает команды и
+// bcache_prefetch возвращается, не дожидаясь диска; без submit (ATA,
+// до включения прерываний) окно читается сразу.
+static void ra_submit(readahead_t *ra, block_device_t *dev, ra_bmap_t bmap, void *ctx) {
+    uint64_t blocks[RA_MAX_BLOCKS];
+    uint32_t n = ra_map(bmap, ctx, ra->start, ra->size, blocks);
+    bcache_prefetch(dev, blocks, n);
+}
+
+buf_t *readahead_read(readahead_t *ra, block_device_t *dev, ra_bmap_t bmap, void *ctx,
+                      uint64_t index) {
+    if (index + 1 == ra->prev) {
+        // Тот же блок ещё раз: файл читают кусками меньше блока
+    } else if (index != ra->prev) {
+        // Не подряд: окно сбрасывается
+        ra->size = 0;
+    } else if (ra->size && index < ra->start + ra->size) {
+        // Поток внутри прочитанного: на метке — следующее окно, вдвое больше
+        if (index == ra->start + ra->size - ra->async_size) {
+            ra->start += ra->size;
+            ra->size = ra->size * 2 < RA_MAX_BLOCKS ? ra->size * 2 : RA_MAX_BLOCKS;
+            ra->async_size = ra->size;
+            ra_submit(ra, dev, bmap, ctx);
+        }
+    } else {
+        // Начало потока: окно от index, метка сразу за ним
+        ra->start = index;
+        ra->size = RA_INIT_BLOCKS;
+        ra->async_size = ra->size - 1;
+        ra_submit(ra, dev, bmap, ctx);
+    }
+    ra->prev = index + 1;
+
+    uint64_t block = bmap(ctx, index);
+    if (block == RA_NO_BLOCK) return NULL;
+    return bcache_read(dev, block);
+}
+
+// ---------------------------------------------------------------
+// Замер
+// ---------------------------------------------------------------
+
+#define RA_BENCH_BYTES (16 * 1024 * 1024)
+
+// «Файл» — непрерывный участок диска
+typedef struct ra_bench_file {
+    uint64_t base;
+    uint64_t blocks;
+} ra_bench_file_t;
+
+static uint64_t ra_bench_bmap(void *ctx, uint64_t index) {
+    ra_bench_file_t *f = (ra_bench_file_t *)ctx;
+    return index < f->blocks ? f->base + index : RA_NO_BLOCK;
+}
+
+void readahead_benchmark(void) {
+    block_device_t *dev = block_first();
+    if (!dev) {
+        printf("Readahead bench: no disk\n");
+        return;
+    }
+
+    // Два равных участка: второй проход не попадает в кэш после первого
+    uint64_t blocks = RA_BENCH_BYTES / BCACHE_BLOCK_SIZE;
+    uint64_t dev_blocks = dev->sectors * dev->sector_size / BCACHE_BLOCK_SIZE;
+    if (blocks > dev_blocks / 2) blocks = dev_blocks / 2;
+    if (!blocks) return;
+
+    printf("Readahead bench %s: streaming %lu KiB in 4 KiB reads\n", dev->name,
+           blocks * BCACHE_BLOCK_SIZE / 1024);
+    for (int on = 0; on < 2; on++) {
+        ra_bench_file_t file = { .base = on * blocks, .blocks = blocks };
+        readahead_t ra;
+        readahead_init(&ra);
+        blk_queue_stats_t before, after;
+        blk_queue_get_stats(dev, &before);
+
+        uint64_t t0 = arch_cycles();
+        uint64_t i;
+        for (i = 0; i < blocks; i++) {
+            buf_t *b = on ? readahead_read(&ra, dev, ra_bench_bmap, &file, i)
+                          : bcache_read(dev, file.base + i);
+            if (!b) break;
+            bcache_release(b);
+        }
+        uint64_t us = (arch_cycles() - t0) / arch_cycles_per_us();
+        blk_queue_get_stats(dev, &after);
+
+        const char *mode = on ? "readahead" : "no readahead";
+        if (i < blocks) {
+            printf("  %s: I/O error at block %lu\n", mode, i);
+            return;
+        }
+        uint64_t cmds = after.requests - before.requests;
+        printf("  %s: %lu MB/s, %lu commands, %lu KiB per command\n", mode,
+               us ? blocks * BCACHE_BLOCK_SIZE / us : 0, cmds,
+               cmds ? (after.sectors - before.sectors) * dev->sector_size / 1024 / cmds : 0);
+    }
+}
@@ -0,0 +1,48 @@
+// readahead.h — чтение вперёд для последовательных потоков
+//
+// Каждый открытый файл держит свой readahead_t. Пока файл читают
+// подряд, впереди читающего поддерживается окно блоков, которые уже
+// читаются в кэш (bcache_prefetch): читатель находит их готовыми или
+// ждёт уже идущего чтения, а диск получает большие команды вместо
+// команды на блок.
+//
+// Первое окно — RA_INIT_BLOCKS, каждое следующее вдвое больше, до
+// RA_MAX_BLOCKS. Следующее окно начинают читать, когда читатель
+// доходит до метки в текущем (async_size блоков до его конца), —
+// асинхронно: очередь устройства ставит команды и возвращается, так что
+// чтение диска идёт одновременно с обработкой уже прочитанного (на
+// диске без submit окно читается сразу). Обращение не подряд
+// сбрасывает окно: случайному доступу чтение вперёд только мешает.
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include <stdint.h>
+#include "bcache.h"
+
+#define RA_INIT_BLOCKS 4       // 16 КиБ
+#define RA_MAX_BLOCKS  64      // 256 КиБ
+
+// Блок файла за концом или без места на диске
+#define RA_NO_BLOCK ((uint64_t)-1)
+
+// Номер блока устройства по номеру блока файла
+typedef uint64_t (*ra_bmap_t)(void *ctx, uint64_t index);
+
+typedef struct readahead {
+    uint64_t start;            // первый блок (файла) текущего окна
+    uint32_t size;             // блоков в окне, 0 — окна нет
+    uint32_t async_size;       // от метки до конца окна
+    uint64_t prev;             // ожидаемый следующий блок
+} readahead_t;
+
+void readahead_init(readahead_t *ra);
+
+// Прочитать блок index файла через кэш, ведя окно чтения вперёд.
+// Ссылка на буфер — вернуть bcache_release; NULL — ошибка.
+buf_t *readahead_read(readahead_t *ra, block_device_t *dev, ra_bmap_t bmap, void *ctx,
+                      uint64_t index);
+
+// Замер: поток по первому диску без чтения вперёд и с ним
+void readahead_benchmark(void);
+
+#endif // READAHEAD_H
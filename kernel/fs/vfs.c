@@ -0,0 +1,672 @@
+// vfs.c — разбор путей, кэши dentry и inode, монтирование, открытые файлы
+#include "vfs.h"
+#include "../include/atomic.h"
+#include "../lib/sync/spinlock.h"
+#include "../lib/sync/wait.h"
+
+#include <stddef.h>
+
+// Кэши, пулы, список типов и таблица монтирований — под vfs_lock
+static spinlock_t vfs_lock = SPINLOCK_INIT("vfs");
+
+static vfs_fs_type_t *fs_types;
+static vfs_mount_t mounts[VFS_MOUNTS];
+static vfs_mount_t *root_mnt;
+
+static vfs_dentry_t dentries[VFS_DENTRIES];
+static vfs_dentry_t *d_free;
+static vfs_dentry_t *d_hash[1u << DCACHE_HASH_BITS];
+static vfs_dentry_t *lru_head, *lru_tail;    // голова — недавние
+
+static vfs_inode_t inodes[VFS_INODES];
+static vfs_inode_t *i_free;
+static vfs_inode_t *i_hash[1u << ICACHE_HASH_BITS];
+
+static vfs_file_t files[VFS_FILES];
+static vfs_file_t *f_free;
+
+static vfs_dcache_stats_t stats;
+
+void vfs_init(void) {
+    fs_types = NULL;
+    root_mnt = NULL;
+    for (int i = 0; i < VFS_MOUNTS; i++) {
+        mounts[i].sb.type = NULL;
+    }
+
+    d_free = NULL;
+    for (int i = VFS_DENTRIES - 1; i >= 0; i--) {
+        dentries[i].hnext = d_free;
+        d_free = &dentries[i];
+    }
+    for (uint32_t i = 0; i < (1u << DCACHE_HASH_BITS); i++) {
+        d_hash[i] = NULL;
+    }
+    lru_head = lru_tail = NULL;
+
+    i_free = NULL;
+    for (int i = VFS_INODES - 1; i >= 0; i--) {
+        inodes[i].hnext = i_free;
+        i_free = &inodes[i];
+    }
+    for (uint32_t i = 0; i < (1u << ICACHE_HASH_BITS); i++) {
+        i_hash[i] = NULL;
+    }
+
+    f_free = NULL;
+    for (int i = VFS_FILES - 1; i >= 0; i--) {
+        files[i].next = f_free;
+        f_free = &files[i];
+    }
+
+    stats = (vfs_dcache_stats_t){ 0 };
+}
+
+static int name_eq(const char *a, const char *b, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        if (a[i] != b[i]) return 0;
+    }
+    return 1;
+}
+
+static int str_eq(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+int vfs_register_fs(vfs_fs_type_t *type) {
+    if (!type || !type->name || !type->mount) return -1;
+    spin_lock(&vfs_lock);
+    for (vfs_fs_type_t *t = fs_types; t; t = t->next) {
+        if (str_eq(t->name, type->name)) {
+            spin_unlock(&vfs_lock);
+            return -1;
+        }
+    }
+    type->next = fs_types;
+    fs_types = type;
+    spin_unlock(&vfs_lock);
+    return 0;
+}
+
+// Спящая блокировка суперблока: операции ФС под ней могут ждать диска
+static void ns_lock(vfs_sb_t *sb) {
+    while (atomic_xchg32(&sb->ns_lock, 1)) {
+        wait_on_address(&sb->ns_lock, 1);
+    }
+}
+
+static void ns_unlock(vfs_sb_t *sb) {
+    atomic_store32_release(&sb->ns_lock, 0);
+    wake_address(&sb->ns_lock, 1);
+}
+
+// ---------------------------------------------------------------
+// Кэш inode
+// ---------------------------------------------------------------
+
+static uint32_t i_bucket(const vfs_sb_t *sb, uint64_t ino) {
+    uint64_t h = (ino ^ ((uintptr_t)sb >> 4)) * 0x9E3779B97F4A7C15ull;
+    return (uint32_t)(h >> (64 - ICACHE_HASH_BITS));
+}
+
+static void iput(vfs_inode_t *inode) {
+    if (!inode) return;
+
+    spin_lock(&vfs_lock);
+    if (--inode->refcnt) {
+        spin_unlock(&vfs_lock);
+        return;
+    }
+    vfs_inode_t **link = &i_hash[i_bucket(inode->sb, inode->ino)];
+    while (*link != inode) link = &(*link)->hnext;
+    *link = inode->hnext;
+    spin_unlock(&vfs_lock);
+
+    // Вне блокировки: ФС может освобождать свои данные с ожиданием
+    if (inode->sb->ops->evict_inode) inode->sb->ops->evict_inode(inode);
+
+    spin_lock(&vfs_lock);
+    inode->hnext = i_free;
+    i_free = inode;
+    stats.inodes--;
+    spin_unlock(&vfs_lock);
+}
+
+static int d_shrink_locked(vfs_inode_t **drop);
+
+// inode с номером ino (ссылка: вернуть iput) или NULL. Под sb->ns_lock:
+// другой iget того же суперблока не создаст второй inode с этим номером.
+static vfs_inode_t *iget(vfs_sb_t *sb, uint64_t ino) {
+    uint32_t b = i_bucket(sb, ino);
+
+    for (;;) {
+        spin_lock(&vfs_lock);
+        for (vfs_inode_t *inode = i_hash[b]; inode; inode = inode->hnext) {
+            if (inode->sb == sb && inode->ino == ino) {
+                inode->refcnt++;
+                spin_unlock(&vfs_lock);
+                return inode;
+            }
+        }
+
+        vfs_inode_t *inode = i_free;
+        if (inode) {
+            i_free = inode->hnext;
+            stats.inodes++;
+            spin_unlock(&vfs_lock);
+
+            inode->sb = sb;
+            inode->ino = ino;
+            inode->type = 0;
+            inode->size = 0;
+            inode->priv = NULL;
+            inode->refcnt = 1;
+            if (sb->ops->read_inode(inode) != 0) {
+                spin_lock(&vfs_lock);
+                inode->hnext = i_free;
+                i_free = inode;
+                stats.inodes--;
+                spin_unlock(&vfs_lock);
+                return NULL;
+            }
+
+            spin_lock(&vfs_lock);
+            inode->hnext = i_hash[b];
+            i_hash[b] = inode;
+            spin_unlock(&vfs_lock);
+            return inode;
+        }
+
+        // Пул пуст: inode освобождаются вместе с вытесненными именами
+        vfs_inode_t *drop = NULL;
+        int shrunk = d_shrink_locked(&drop);
+        spin_unlock(&vfs_lock);
+        iput(drop);
+        if (!shrunk) return NULL;
+    }
+}
+
+// ---------------------------------------------------------------
+// Кэш dentry
+// ---------------------------------------------------------------
+
+// FNV-1a
+static uint32_t name_hash(const char *name, uint32_t len) {
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return h;
+}
+
+static uint32_t d_bucket(const vfs_dentry_t *parent, uint32_t hash) {
+    uint32_t h = hash ^ (uint32_t)((uintptr_t)parent >> 4);
+    return (h * 0x9E3779B1u) >> (32 - DCACHE_HASH_BITS);
+}
+
+static void lru_del(vfs_dentry_t *d) {
+    if (d->lprev) d->lprev->lnext = d->lnext;
+    else lru_head = d->lnext;
+    if (d->lnext) d->lnext->lprev = d->lprev;
+    else lru_tail = d->lprev;
+}
+
+static void lru_add(vfs_dentry_t *d) {
+    d->lprev = NULL;
+    d->lnext = lru_head;
+    if (lru_head) lru_head->lprev = d;
+    else lru_tail = d;
+    lru_head = d;
+}
+
+// dentry без ссылок стоит в LRU (корни ФС держит монтирование)
+static void dget_locked(vfs_dentry_t *d) {
+    if (d->refcnt++ == 0) lru_del(d);
+}
+
+static void dput_locked(vfs_dentry_t *d) {
+    if (--d->refcnt == 0) lru_add(d);
+}
+
+static void dput(vfs_dentry_t *d) {
+    spin_lock(&vfs_lock);
+    dput_locked(d);
+    spin_unlock(&vfs_lock);
+}
+
+// Вытеснить самую старую неиспользуемую dentry. Её inode — в *drop:
+// iput после снятия блокировки. 0 — вытеснять нечего.
+static int d_shrink_locked(vfs_inode_t **drop) {
+    vfs_dentry_t *d = lru_tail;
+    if (!d) return 0;
+
+    lru_del(d);
+    vfs_dentry_t **link = &d_hash[d_bucket(d->parent, d->hash)];
+    while (*link != d) link = &(*link)->hnext;
+    *link = d->hnext;
+    dput_locked(d->parent);
+    *drop = d->inode;
+
+    d->hnext = d_free;
+    d_free = d;
+    stats.dentries--;
+    stats.evictions++;
+    return 1;
+}
+
+static vfs_dentry_t *d_find_locked(vfs_dentry_t *parent, const char *name, uint32_t len,
+                                   uint32_t hash) {
+    for (vfs_dentry_t *d = d_hash[d_bucket(parent, hash)]; d; d = d->hnext) {
+        if (d->parent == parent && d->hash == hash && d->len == len &&
+            name_eq(d->name, name, len)) {
+            return d;
+        }
+    }
+    return NULL;
+}
+
+// Новая dentry со ссылкой; parent == NULL — корень ФС, вне хэша.
+// Ссылку на inode забирает dentry.
+static vfs_dentry_t *d_alloc(vfs_sb_t *sb, vfs_dentry_t *parent, const char *name,
+                             uint32_t len, uint32_t hash, vfs_inode_t *inode) {
+    for (;;) {
+        vfs_inode_t *drop = NULL;
+        spin_lock(&vfs_lock);
+        vfs_dentry_t *d = d_free;
+        if (d) {
+            d_free = d->hnext;
+            for (uint32_t i = 0; i < len; i++) {
+                d->name[i] = name[i];
+            }
+            d->name[len] = '\0';
+            d->len = len;
+            d->hash = hash;
+            d->sb = sb;
+            d->parent = parent;
+            d->inode = inode;
+            d->mounted = NULL;
+            d->refcnt = 1;
+            d->hnext = NULL;
+            if (parent) {
+                dget_locked(parent);
+                uint32_t b = d_bucket(parent, hash);
+                d->hnext = d_hash[b];
+                d_hash[b] = d;
+            }
+            stats.dentries++;
+            spin_unlock(&vfs_lock);
+            return d;
+        }
+
+        // Родитель не вытеснится: на него есть ссылка вызывающего
+        int shrunk = d_shrink_locked(&drop);
+        spin_unlock(&vfs_lock);
+        iput(drop);
+        if (!shrunk) return NULL;
+    }
+}
+
+// Имя в каталоге parent (ссылка: вернуть dput), возможно отрицательная
+// dentry; NULL — ошибка ФС или пулы заняты
+static vfs_dentry_t *d_lookup(vfs_dentry_t *parent, const char *name, uint32_t len) {
+    uint32_t hash = name_hash(name, len);
+
+    spin_lock(&vfs_lock);
+    vfs_dentry_t *d = d_find_locked(parent, name, len, hash);
+    if (d) {
+        dget_locked(d);
+        if (d->inode) stats.hits++;
+        else stats.negative_hits++;
+        spin_unlock(&vfs_lock);
+        return d;
+    }
+    spin_unlock(&vfs_lock);
+
+    // Промах: спросить ФС. Под ns_lock, чтобы имя не появилось между
+    // ответом ФС и вставкой в кэш.
+    vfs_sb_t *sb = parent->sb;
+    ns_lock(sb);
+    spin_lock(&vfs_lock);
+    d = d_find_locked(parent, name, len, hash);
+    if (d) {
+        dget_locked(d);
+        spin_unlock(&vfs_lock);
+        ns_unlock(sb);
+        return d;
+    }
+    stats.misses++;
+    spin_unlock(&vfs_lock);
+
+    vfs_inode_t *inode = NULL;
+    uint64_t ino;
+    if (!parent->inode) {
+        // Каталог удалён, пока мы ждали
+    } else if (sb->ops->lookup(parent->inode, name, len, &ino) == 0) {
+        inode = iget(sb, ino);
+        if (!inode) {
+            ns_unlock(sb);
+            return NULL;
+        }
+    }
+    d = parent->inode ? d_alloc(sb, parent, name, len, hash, inode) : NULL;
+    ns_unlock(sb);
+    if (!d) iput(inode);
+    return d;
+}
+
+// Под vfs_lock: спуститься в корни ФС, смонтированных поверх d
+static void d_follow_mounts(vfs_dentry_t **d, vfs_mount_t **mnt) {
+    while ((*d)->mounted) {
+        vfs_mount_t *m = (*d)->mounted;
+        dget_locked(m->root);
+        dput_locked(*d);
+        *d = m->root;
+        *mnt = m;
+    }
+}
+
+// Разрешить абсолютный путь. Последний компонент может не существовать
+// (отрицательная dentry), промежуточные — существующие каталоги.
+static int vfs_walk(const char *path, vfs_dentry_t **out, vfs_mount_t **out_mnt) {
+    if (!path || path[0] != '/') return -1;
+
+    spin_lock(&vfs_lock);
+    if (!root_mnt) {
+        spin_unlock(&vfs_lock);
+        return -1;
+    }
+    vfs_mount_t *mnt = root_mnt;
+    vfs_dentry_t *d = mnt->root;
+    dget_locked(d);
+    d_follow_mounts(&d, &mnt);
+    spin_unlock(&vfs_lock);
+
+    const char *p = path;
+    for (;;) {
+        while (*p == '/') p++;
+        if (!*p) break;
+        const char *name = p;
+        while (*p && *p != '/') p++;
+        uint32_t len = (uint32_t)(p - name);
+
+        vfs_inode_t *dir = d->inode;
+        if (!dir || dir->type != VFS_DIR || len > VFS_NAME_MAX) {
+            dput(d);
+            return -1;
+        }
+        if (len == 1 && name[0] == '.') continue;
+
+        if (len == 2 && name[0] == '.' && name[1] == '.') {
+            spin_lock(&vfs_lock);
+            // Из корня смонтированной ФС — в её точку монтирования
+            while (!d->parent && mnt->mountpoint) {
+                vfs_dentry_t *mp = mnt->mountpoint;
+                dget_locked(mp);
+                dput_locked(d);
+                d = mp;
+                mnt = mnt->parent;
+            }
+            if (d->parent) {
+                vfs_dentry_t *up = d->parent;
+                dget_locked(up);
+                dput_locked(d);
+                d = up;
+            }
+            d_follow_mounts(&d, &mnt);
+            spin_unlock(&vfs_lock);
+            continue;
+        }
+
+        vfs_dentry_t *next = d_lookup(d, name, len);
+        dput(d);
+        if (!next) return -1;
+        d = next;
+
+        spin_lock(&vfs_lock);
+        d_follow_mounts(&d, &mnt);
+        spin_unlock(&vfs_lock);
+    }
+
+    *out = d;
+    if (out_mnt) *out_mnt = mnt;
+    return 0;
+}
+
+// Создать имя отрицательной dentry d
+static int vfs_create(vfs_dentry_t *d, uint32_t type) {
+    vfs_sb_t *sb = d->sb;
+    if (!d->parent || !sb->ops->create) return -1;
+
+    int ret = -1;
+    ns_lock(sb);
+    if (d->inode) {
+        // Создано, пока мы ждали: файл открываем, каталог — ошибка
+        ret = type == VFS_FILE && d->inode->type == VFS_FILE ? 0 : -1;
+    } else if (d->parent->inode) {
+        uint64_t ino;
+        if (sb->ops->create(d->parent->inode, d->name, d->len, type, &ino) == 0) {
+            vfs_inode_t *inode = iget(sb, ino);
+            if (inode) {
+                spin_lock(&vfs_lock);
+                d->inode = inode;
+                spin_unlock(&vfs_lock);
+                ret = 0;
+            }
+        }
+    }
+    ns_unlock(sb);
+    return ret;
+}
+
+// ---------------------------------------------------------------
+// Монтирование
+// ---------------------------------------------------------------
+
+static int path_is_root(const char *path) {
+    if (!path || *path != '/') return 0;
+    while (*path == '/') path++;
+    return !*path;
+}
+
+int vfs_mount(const char *type, block_device_t *dev, const void *data, const char *path) {
+    vfs_fs_type_t *t;
+    spin_lock(&vfs_lock);
+    for (t = fs_types; t && !str_eq(t->name, type); t = t->next) {
+    }
+    int first = !root_mnt;
+    spin_unlock(&vfs_lock);
+    if (!t || (first && !path_is_root(path))) return -1;
+
+    // Точка монтирования — существующий каталог
+    vfs_dentry_t *mp = NULL;
+    vfs_mount_t *parent = NULL;
+    if (!first) {
+        if (vfs_walk(path, &mp, &parent) != 0) return -1;
+        if (!mp->inode || mp->inode->type != VFS_DIR) {
+            dput(mp);
+            return -1;
+        }
+    }
+
+    vfs_mount_t *m = NULL;
+    spin_lock(&vfs_lock);
+    for (int i = 0; i < VFS_MOUNTS && !m; i++) {
+        if (!mounts[i].sb.type) m = &mounts[i];
+    }
+    if (m) m->sb.type = t;
+    spin_unlock(&vfs_lock);
+    if (!m) goto fail;
+
+    m->sb.ops = NULL;
+    m->sb.dev = dev;
+    m->sb.root_ino = 0;
+    m->sb.priv = NULL;
+    m->sb.ns_lock = 0;
+    if (t->mount(&m->sb, dev, data) != 0 || !m->sb.ops) goto fail;
+
+    ns_lock(&m->sb);
+    vfs_inode_t *inode = iget(&m->sb, m->sb.root_ino);
+    ns_unlock(&m->sb);
+    if (!inode || inode->type != VFS_DIR) {
+        iput(inode);
+        goto fail;
+    }
+    m->root = d_alloc(&m->sb, NULL, "/", 1, 0, inode);
+    if (!m->root) {
+        iput(inode);
+        goto fail;
+    }
+    m->mountpoint = mp;
+    m->parent = parent;
+
+    spin_lock(&vfs_lock);
+    if (mp) mp->mounted = m;
+    else root_mnt = m;
+    spin_unlock(&vfs_lock);
+    return 0;
+
+fail:
+    if (m) m->sb.type = NULL;
+    if (mp) dput(mp);
+    return -1;
+}
+
+// ---------------------------------------------------------------
+// Файлы
+// ---------------------------------------------------------------
+
+vfs_file_t *vfs_open(const char *path, uint32_t flags) {
+    vfs_dentry_t *d;
+    if (vfs_walk(path, &d, NULL) != 0) return NULL;
+    if (!d->inode && (flags & VFS_O_CREAT)) vfs_create(d, VFS_FILE);
+
+    // Файл держит и inode: после unlink имя станет отрицательным, а
+    // открытый файл останется читаемым
+    spin_lock(&vfs_lock);
+    vfs_inode_t *inode = d->inode;
+    vfs_file_t *f = inode ? f_free : NULL;
+    if (f) {
+        f_free = f->next;
+        inode->refcnt++;
+    }
+    spin_unlock(&vfs_lock);
+    if (!f) {
+        dput(d);
+        return NULL;
+    }
+
+    f->dentry = d;
+    f->inode = inode;
+    f->pos = 0;
+    f->flags = flags;
+    return f;
+}
+
+void vfs_close(vfs_file_t *f) {
+    iput(f->inode);
+    dput(f->dentry);
+    spin_lock(&vfs_lock);
+    f->next = f_free;
+    f_free = f;
+    spin_unlock(&vfs_lock);
+}
+
+int64_t vfs_read(vfs_file_t *f, void *buf, uint64_t len) {
+    const vfs_ops_t *ops = f->inode->sb->ops;
+    if (f->inode->type != VFS_FILE || !ops->read) return -1;
+    int64_t n = ops->read(f->inode, f->pos, buf, len);
+    if (n > 0) f->pos += (uint64_t)n;
+    return n;
+}
+
+int64_t vfs_write(vfs_file_t *f, const void *buf, uint64_t len) {
+    const vfs_ops_t *ops = f->inode->sb->ops;
+    if (f->inode->type != VFS_FILE || !ops->write) return -1;
+    int64_t n = ops->write(f->inode, f->pos, buf, len);
+    if (n > 0) f->pos += (uint64_t)n;
+    return n;
+}
+
+void vfs_seek(vfs_file_t *f, uint64_t pos) {
+    f->pos = pos;
+}
+
+const void *vfs_read_map(vfs_file_t *f, uint64_t *len) {
+    const vfs_ops_t *ops = f->inode->sb->ops;
+    if (f->inode->type != VFS_FILE || !ops->map || !*len) return NULL;
+    const void *p = ops->map(f->inode, f->pos, len);
+    if (p) f->pos += *len;
+    return p;
+}
+
+int vfs_readdir(vfs_file_t *f, vfs_dirent_t *ent) {
+    const vfs_ops_t *ops = f->inode->sb->ops;
+    if (f->inode->type != VFS_DIR || !ops->readdir) return -1;
+    return ops->readdir(f->inode, &f->pos, ent);
+}
+
+// ---------------------------------------------------------------
+// Имена
+// ---------------------------------------------------------------
+
+int vfs_mkdir(const char *path) {
+    vfs_dentry_t *d;
+    if (vfs_walk(path, &d, NULL) != 0) return -1;
+    int ret = d->inode ? -1 : vfs_create(d, VFS_DIR);
+    dput(d);
+    return ret;
+}
+
+int vfs_unlink(const char *path) {
+    vfs_dentry_t *d;
+    if (vfs_walk(path, &d, NULL) != 0) return -1;
+
+    // Корень ФС (в том числе точку монтирования — walk спустился в
+    // смонтированную ФС) удалить нельзя
+    vfs_sb_t *sb = d->sb;
+    vfs_inode_t *inode = NULL;
+    int ret = -1;
+    if (d->parent && sb->ops->unlink) {
+        ns_lock(sb);
+        if (d->inode && !d->mounted && d->parent->inode &&
+            sb->ops->unlink(d->parent->inode, d->name, d->len, d->inode) == 0) {
+            // Имя остаётся в кэше отрицательным
+            spin_lock(&vfs_lock);
+            inode = d->inode;
+            d->inode = NULL;
+            spin_unlock(&vfs_lock);
+            ret = 0;
+        }
+        ns_unlock(sb);
+    }
+    iput(inode);
+    dput(d);
+    return ret;
+}
+
+int vfs_stat(const char *path, vfs_stat_t *st) {
+    vfs_dentry_t *d;
+    if (vfs_walk(path, &d, NULL) != 0) return -1;
+
+    int ret = -1;
+    spin_lock(&vfs_lock);
+    if (d->inode) {
+        st->ino = d->inode->ino;
+        st->size = d->inode->size;
+        st->type = d->inode->type;
+        ret = 0;
+    }
+    spin_unlock(&vfs_lock);
+    dput(d);
+    return ret;
+}
+
+void vfs_get_dcache_stats(vfs_dcache_stats_t *out) {
+    spin_lock(&vfs_lock);
+    *out = stats;
+    spin_unlock(&vfs_lock);
+}
@@ -0,0 +1,192 @@
+// vfs.h — виртуальная файловая система: монтирование, inode, dentry, кэш имён
+//
+// Конкретная ФС (ramfs, FAT32, initrd) регистрирует vfs_fs_type_t и
+// при монтировании заполняет суперблок таблицей операций vfs_ops_t:
+// поиск имени в каталоге, создание, удаление, чтение, запись. Всё
+// остальное — разбор путей, точки монтирования, кэши — общее.
+//
+// Файл или каталог в памяти — inode, найденный по паре (суперблок,
+// номер) в хэш-таблице. Имя — dentry: (родитель, имя) → inode. Кэш
+// dentry хэширован по той же паре, поэтому путь разрешается за число
+// его компонентов, по попаданию в хэш на компонент, без обращения к ФС.
+// Отсутствие имени тоже кэшируется — отрицательной dentry (inode ==
+// NULL): повторный поиск несуществующего файла не доходит до ФС, а
+// создание файла превращает её в обычную.
+//
+// Неиспользуемые dentry стоят в LRU и вытесняются, когда пул кончается;
+// dentry держит ссылку на родителя и на свой inode, так что каталог не
+// вытесняется раньше детей, а inode живёт, пока на него есть имя или
+// открытый файл.
+//
+// Промах кэша и изменения имён идут под спящей блокировкой суперблока,
+// поэтому операции ФС могут ждать диска; попадание — только под
+// спин-блокировкой кэша. Пути — абсолютные, с «.» и «..»; «..» из
+// корня смонтированной ФС ведёт в каталог, на который она смонтирована.
+// Вызовы могут спать — из обработчиков прерываний их делать нельзя.
+#ifndef VFS_H
+#define VFS_H
+
+#include <stdint.h>
+#include "../drivers/block.h"
+
+#define VFS_NAME_MAX      63
+
+// Размеры пулов
+#define VFS_DENTRIES      1024
+#define VFS_INODES        512
+#define VFS_FILES         64
+#define VFS_MOUNTS        8
+
+#define DCACHE_HASH_BITS  10
+#define ICACHE_HASH_BITS  9
+
+// Тип inode
+#define VFS_FILE          1
+#define VFS_DIR           2
+
+// Флаги vfs_open
+#define VFS_O_CREAT       0x1
+
+typedef struct vfs_inode vfs_inode_t;
+typedef struct vfs_sb vfs_sb_t;
+
+typedef struct vfs_dirent {
+    char name[VFS_NAME_MAX + 1];
+    uint64_t ino;
+    uint32_t type;
+} vfs_dirent_t;
+
+typedef struct vfs_stat {
+    uint64_t ino;
+    uint64_t size;
+    uint32_t type;
+} vfs_stat_t;
+
+// Операции ФС. 0 — успех, -1 — ошибка. Операции изменения могут быть
+// NULL — ФС только для чтения.
+typedef struct vfs_ops {
+    // Заполнить type, size и priv inode с номером inode->ino
+    int (*read_inode)(vfs_inode_t *inode);
+    // inode уходит из кэша (может быть NULL)
+    void (*evict_inode)(vfs_inode_t *inode);
+
+    // Номер inode по имени в каталоге; -1 — имени нет
+    int (*lookup)(vfs_inode_t *dir, const char *name, uint32_t len, uint64_t *ino);
+    // Создать файл или каталог (type); номер нового inode в *ino
+    int (*create)(vfs_inode_t *dir, const char *name, uint32_t len, uint32_t type,
+                  uint64_t *ino);
+    // Удалить имя (каталог — только пустой)
+    int (*unlink)(vfs_inode_t *dir, const char *name, uint32_t len, vfs_inode_t *inode);
+
+    // Байт передано или -1. write обновляет inode->size.
+    int64_t (*read)(vfs_inode_t *inode, uint64_t off, void *buf, uint64_t len);
+    int64_t (*write)(vfs_inode_t *inode, uint64_t off, const void *buf, uint64_t len);
+
+    // Запись каталога с позиции *pos, позиция сдвигается; -1 — конец
+    int (*readdir)(vfs_inode_t *dir, uint64_t *pos, vfs_dirent_t *ent);
+
+    // Данные файла с off без копирования (может быть NULL): указатель и
+    // в *len — сколько байт подряд, не больше запрошенного; NULL — конец
+    // файла. Данные действительны, пока inode в кэше.
+    const void *(*map)(vfs_inode_t *inode, uint64_t off, uint64_t *len);
+} vfs_ops_t;
+
+struct vfs_sb {
+    const struct vfs_fs_type *type;
+    const vfs_ops_t *ops;
+    block_device_t *dev;
+    uint64_t root_ino;
+    void *priv;                        // данные ФС
+    volatile uint32_t ns_lock;         // промахи кэша и изменения имён
+};
+
+typedef struct vfs_fs_type {
+    const char *name;
+    // Заполнить ops, root_ino и priv суперблока; dev может быть NULL
+    int (*mount)(vfs_sb_t *sb, block_device_t *dev, const void *data);
+    struct vfs_fs_type *next;
+} vfs_fs_type_t;
+
+struct vfs_inode {
+    vfs_sb_t *sb;
+    uint64_t ino;
+    uint32_t type;
+    uint64_t size;
+    void *priv;                        // данные ФС
+
+    uint32_t refcnt;                   // под блокировкой кэша
+    vfs_inode_t *hnext;
+};
+
+typedef struct vfs_dentry {
+    char name[VFS_NAME_MAX + 1];
+    uint32_t len;
+    uint32_t hash;                     // хэш имени
+    vfs_sb_t *sb;
+    struct vfs_dentry *parent;         // NULL — корень ФС
+    vfs_inode_t *inode;                // NULL — отрицательная
+    struct vfs_mount *mounted;         // смонтированная поверх ФС
+
+    // Под блокировкой кэша
+    uint32_t refcnt;                   // ссылки и дети
+    struct vfs_dentry *hnext;
+    struct vfs_dentry *lnext, *lprev;  // LRU неиспользуемых
+} vfs_dentry_t;
+
+// Монтирование; занято, пока sb.type != NULL
+typedef struct vfs_mount {
+    vfs_sb_t sb;
+    vfs_dentry_t *root;
+    vfs_dentry_t *mountpoint;          // NULL — корень всего дерева
+    struct vfs_mount *parent;
+} vfs_mount_t;
+
+typedef struct vfs_file {
+    vfs_dentry_t *dentry;
+    vfs_inode_t *inode;
+    uint64_t pos;                      // смещение или позиция readdir
+    uint32_t flags;
+    struct vfs_file *next;             // список свободных
+} vfs_file_t;
+
+typedef struct vfs_dcache_stats {
+    uint64_t hits;
+    uint64_t negative_hits;            // попадания в отрицательные dentry
+    uint64_t misses;                   // обращения к lookup ФС
+    uint64_t evictions;
+    uint32_t dentries;                 // занято
+    uint32_t inodes;
+} vfs_dcache_stats_t;
+
+void vfs_init(void);
+
+int vfs_register_fs(vfs_fs_type_t *type);
+
+// Смонтировать ФС типа type на каталог path; первой — на "/"
+int vfs_mount(const char *type, block_device_t *dev, const void *data, const char *path);
+
+// Открыть файл или каталог; VFS_O_CREAT — создать файл, если его нет
+vfs_file_t *vfs_open(const char *path, uint32_t flags);
+void vfs_close(vfs_file_t *f);
+
+// С текущей позиции; байт передано или -1
+int64_t vfs_read(vfs_file_t *f, void *buf, uint64_t len);
+int64_t vfs_write(vfs_file_t *f, const void *buf, uint64_t len);
+void vfs_seek(vfs_file_t *f, uint64_t pos);
+
+// Чтение без копирования: указатель на данные с текущей позиции, в *len
+// (на входе — сколько нужно) — сколько их подряд; позиция сдвигается.
+// NULL — конец файла или ФС так не умеет. Данные действительны до
+// vfs_close.
+const void *vfs_read_map(vfs_file_t *f, uint64_t *len);
+
+// Следующая запись открытого каталога; -1 — конец
+int vfs_readdir(vfs_file_t *f, vfs_dirent_t *ent);
+
+int vfs_mkdir(const char *path);
+int vfs_unlink(const char *path);
+int vfs_stat(const char *path, vfs_stat_t *st);
+
+void vfs_get_dcache_stats(vfs_dcache_stats_t *stats);
+
+#endif // VFS_H
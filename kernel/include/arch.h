@@ -5,16 +5,22 @@
 #if defined(__x86_64__) || defined(__amd64__) || (defined(__i386__) && !defined(__INTEL_COMPILER__))
     #define ARCH_X86_64
     #include "../arch/x86_64/arch.h"
+    #include "../arch/x86_64/atomic.h"
+    #define ARCH_ATOMIC(op) x86_64_##op
     typedef x86_64_reg_t arch_reg_t;
     typedef x86_64_inst_t arch_inst_t;
 #elif defined(__aarch64__) || defined(__arm64__)
     #define ARCH_ARM64
     #include "../arch/arm64/arch.h"
+    #include "../arch/arm64/atomic.h"
+    #define ARCH_ATOMIC(op) arm64_##op
     typedef arm64_reg_t arch_reg_t;
     typedef arm64_inst_t arch_inst_t;
 #elif defined(__riscv) && __riscv_xlen == 64
     #define ARCH_RISCV64
     #include "../arch/riscv64/arch.h"
+    #include "../arch/riscv64/atomic.h"
+    #define ARCH_ATOMIC(op) riscv64_##op
     typedef riscv64_reg_t arch_reg_t;
     typedef riscv64_inst_t arch_inst_t;
 #else
@@ -50,6 +56,81 @@ static inline void arch_enable_interrupts(void) {
 #endif
 }
 
+// Сохранить состояние прерываний и запретить их. Пара arch_irq_restore()
+// восстанавливает исходное состояние, поэтому такие секции можно вкладывать.
+typedef unsigned long arch_irqflags_t;
+
+static inline arch_irqflags_t arch_irq_save(void) {
+    arch_irqflags_t flags;
+#ifdef ARCH_X86_64
+    asm volatile("pushfq; popq %0; cli" : "=r"(flags) : : "memory");
+#elif defined(ARCH_ARM64)
+    asm volatile("mrs %0, daif; msr daifset, #2" : "=r"(flags) : : "memory");
+#elif defined(ARCH_RISCV64)
+    asm volatile("csrrci %0, sstatus, 0x2" : "=r"(flags) : : "memory");
+#endif
+    return flags;
+}
+
+static inline void arch_irq_restore(arch_irqflags_t flags) {
+#ifdef ARCH_X86_64
+    if (flags & (1UL << 9)) {  // RFLAGS.IF
+        asm volatile("sti" : : : "memory");
+    }
+#elif defined(ARCH_ARM64)
+    asm volatile("msr daif, %0" : : "r"(flags) : "memory");
+#elif defined(ARCH_RISCV64)
+    asm volatile("csrs sstatus, %0" : : "r"(flags & 0x2) : "memory");
+#endif
+}
+
+// Разрешены ли прерывания на текущем CPU. В обработчике прерывания —
+// нет: засыпать там нельзя, только опрашивать.
+static inline int arch_irqs_enabled(void) {
+#ifdef ARCH_X86_64
+    unsigned long flags;
+    asm volatile("pushfq; popq %0" : "=r"(flags));
+    return (flags & (1UL << 9)) != 0;  // RFLAGS.IF
+#elif defined(ARCH_ARM64)
+    unsigned long daif;
+    asm volatile("mrs %0, daif" : "=r"(daif));
+    return (daif & (1UL << 7)) == 0;   // DAIF.I
+#elif defined(ARCH_RISCV64)
+    unsigned long sstatus;
+    asm volatile("csrr %0, sstatus" : "=r"(sstatus));
+    return (sstatus & 0x2) != 0;       // SIE
+#endif
+}
+
+// Счётчик тактов для замеров (TSC / CNTVCT_EL0 / time). Частота
+// зависит от платформы; монотонен в пределах одного CPU.
+static inline uint64_t arch_cycles(void) {
+#ifdef ARCH_X86_64
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#elif defined(ARCH_ARM64)
+    uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#elif defined(ARCH_RISCV64)
+    return riscv64_read_timer();
+#endif
+}
+
+// Тактов arch_cycles() в микросекунде (не меньше 1)
+static inline uint64_t arch_cycles_per_us(void) {
+    uint64_t per_us;
+#ifdef ARCH_X86_64
+    per_us = x86_64_tsc_per_us();
+#elif defined(ARCH_ARM64)
+    per_us = arm64_read_cntfrq() / 1000000;
+#elif defined(ARCH_RISCV64)
+    per_us = RISCV64_TIMEBASE_HZ / 1000000;
+#endif
+    return per_us ? per_us : 1;
+}
+
 static inline void arch_halt(void) {
 #ifdef ARCH_X86_64
     x86_64_hlt();
@@ -60,6 +141,33 @@ static inline void arch_halt(void) {
 #endif
 }
 
+// Атомарно разрешить прерывания и остановить CPU до прерывания.
+// Вызывается с запрещёнными прерываниями после проверки «работы нет»:
+// прерывание, пришедшее между проверкой и остановкой, не теряется.
+static inline void arch_safe_halt(void) {
+#ifdef ARCH_X86_64
+    asm volatile("sti; hlt" : : : "memory");  // sti действует после hlt
+#elif defined(ARCH_ARM64)
+    asm volatile("wfi; msr daifclr, #2" : : : "memory");  // wfi просыпается и при маскированном IRQ
+#elif defined(ARCH_RISCV64)
+    asm volatile("wfi; csrsi sstatus, 0x2" : : : "memory");
+#endif
+}
+
+// Однократное прерывание таймера текущего CPU не раньше момента cycles
+// (по arch_cycles), чтобы остановленный CPU проснулся к сроку. 0 —
+// взведён, -1 — таймера нет (ждать срока можно только опросом).
+static inline int arch_timer_wake_at(uint64_t cycles) {
+#ifdef ARCH_X86_64
+    return x86_64_timer_wake_at(cycles);
+#else
+    (void)cycles;
+    return -1;
+#endif
+}
+
+// Сброс TLB только текущего CPU. Другим CPU сброс рассылает
+// lib/mm/tlb.c (IPI или широковещательный TLBI на ARM64).
 static inline void arch_invalidate_tlb(void) {
 #ifdef ARCH_X86_64
     x86_64_invalidate_tlb();
@@ -70,6 +178,16 @@ static inline void arch_invalidate_tlb(void) {
 #endif
 }
 
+static inline void arch_invalidate_tlb_page(uintptr_t addr) {
+#ifdef ARCH_X86_64
+    x86_64_invlpg(addr);
+#elif defined(ARCH_ARM64)
+    arm64_invalidate_tlb_page(addr);
+#elif defined(ARCH_RISCV64)
+    riscv64_sfence_vma_addr(addr);
+#endif
+}
+
 static inline void arch_invalidate_icache(void) {
 #ifdef ARCH_X86_64
     x86_64_invalidate_icache();
@@ -85,14 +203,16 @@ static inline void arch_invalidate_icache(void) {
 #define ARCH_ALIGN_DOWN(addr, align) ((addr) & ~((align) - 1))
 #define ARCH_IS_ALIGNED(addr, align) (((addr) & ((align) - 1)) == 0)
 
-// Архитектурно-независимые функции для работы с памятью
+// Обязательные барьеры: упорядочивают обращения и к обычной памяти, и к
+// устройствам (MMIO, DMA-буферы). Для синхронизации CPU между собой
+// используйте более дешёвые smp_mb/smp_rmb/smp_wmb из atomic.h.
 static inline void arch_memory_barrier(void) {
 #ifdef ARCH_X86_64
     asm volatile("mfence" : : : "memory");
 #elif defined(ARCH_ARM64)
-    asm volatile("dmb ish" : : : "memory");
+    asm volatile("dsb sy" : : : "memory");
 #elif defined(ARCH_RISCV64)
-    asm volatile("fence rw,rw" : : : "memory");
+    asm volatile("fence iorw,iorw" : : : "memory");
 #endif
 }
 
@@ -100,9 +220,9 @@ static inline void arch_read_barrier(void) {
 #ifdef ARCH_X86_64
     asm volatile("lfence" : : : "memory");
 #elif defined(ARCH_ARM64)
-    asm volatile("dmb ish" : : : "memory");
+    asm volatile("dsb ld" : : : "memory");
 #elif defined(ARCH_RISCV64)
-    asm volatile("fence r,r" : : : "memory");
+    asm volatile("fence ir,ir" : : : "memory");
 #endif
 }
 
@@ -110,43 +230,20 @@ static inline void arch_write_barrier(void) {
 #ifdef ARCH_X86_64
     asm volatile("sfence" : : : "memory");
 #elif defined(ARCH_ARM64)
-    asm volatile("dmb ish" : : : "memory");
+    asm volatile("dsb st" : : : "memory");
 #elif defined(ARCH_RISCV64)
-    asm volatile("fence w,w" : : : "memory");
+    asm volatile("fence ow,ow" : : : "memory");
 #endif
 }
 
-// Архитектурно-независимые функции для работы с атомарными операциями
+// Совместимые обёртки над atomic.h (полностью упорядоченные операции).
+// Возвращают предыдущее значение *ptr.
 static inline uint32_t arch_atomic_add(volatile uint32_t* ptr, uint32_t value) {
-#ifdef ARCH_X86_64
-    uint32_t result;
-    asm volatile("lock xaddl %0, %1" : "=r"(result), "+m"(*ptr) : "0"(value) : "memory");
-    return result;
-#elif defined(ARCH_ARM64)
-    uint32_t result;
-    asm volatile("ldadd %0, %1, [%2]" : "=r"(result) : "r"(value), "r"(ptr) : "memory");
-    return result;
-#elif defined(ARCH_RISCV64)
-    uint32_t result;
-    asm volatile("amoadd.w %0, %1, (%2)" : "=r"(result) : "r"(value), "r"(ptr) : "memory");
-    return result;
-#endif
+    return ARCH_ATOMIC(fetch_add32)(ptr, value);
 }
 
 static inline uint32_t arch_atomic_compare_exchange(volatile uint32_t* ptr, uint32_t expected, uint32_t desired) {
-#ifdef ARCH_X86_64
-    uint32_t result;
-    asm volatile("lock cmpxchgl %2, %1" : "=a"(result), "+m"(*ptr) : "r"(desired), "0"(expected) : "memory");
-    return result;
-#elif defined(ARCH_ARM64)
-    uint32_t result;
-    asm volatile("cas %0, %1, [%2]" : "=r"(result) : "r"(expected), "r"(ptr) : "memory");
-    return result;
-#elif defined(ARCH_RISCV64)
-    uint32_t result;
-    asm volatile("amoswap.w %0, %1, (%2)" : "=r"(result) : "r"(desired), "r"(ptr) : "memory");
-    return result;
-#endif
+    return ARCH_ATOMIC(cmpxchg32)(ptr, expected, desired);
 }
 
 #endif // ARCH_H
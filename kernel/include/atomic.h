@@ -0,0 +1,108 @@
+// atomic.h — архитектурно-независимые атомарные операции и барьеры памяти
+//
+// Правила именования:
+//   atomic_loadN / atomic_storeN            — без упорядочивания (relaxed)
+//   atomic_loadN_acquire / _storeN_release  — acquire / release
+//   atomic_fetch_addN, atomic_xchgN, atomic_cmpxchgN, atomic_orN,
+//   atomic_andN                             — полный порядок (как smp_mb
+//                                             до и после операции)
+//   *_relaxed                               — атомарно, без упорядочивания
+//
+// smp_mb/smp_rmb/smp_wmb упорядочивают обычную память между CPU и
+// дешевле arch_memory_barrier() и др., которые нужны для устройств (MMIO, DMA).
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "arch.h"  // подключает arch/<arch>/atomic.h и ARCH_ATOMIC()
+
+// Барьер компилятора: запрещает переупорядочивание только компилятору
+#define barrier() asm volatile("" : : : "memory")
+
+#ifdef ARCH_X86_64
+#define smp_mb()  x86_64_smp_mb()
+#define smp_rmb() barrier()   // TSO: загрузки не переупорядочиваются
+#define smp_wmb() barrier()   // TSO: сохранения не переупорядочиваются
+#else
+#define smp_mb()  ARCH_ATOMIC(smp_mb)()
+#define smp_rmb() ARCH_ATOMIC(smp_rmb)()
+#define smp_wmb() ARCH_ATOMIC(smp_wmb)()
+#endif
+
+// Подсказка процессору внутри цикла ожидания
+static inline void cpu_relax(void) {
+    ARCH_ATOMIC(cpu_relax)();
+}
+
+#define ATOMIC_GENERIC_OPS(bits, type)                                              \
+static inline type atomic_load##bits(const volatile type *p) {                     \
+    return *p;                                                                      \
+}                                                                                   \
+static inline void atomic_store##bits(volatile type *p, type v) {                  \
+    *p = v;                                                                         \
+}                                                                                   \
+static inline type atomic_load##bits##_acquire(const volatile type *p) {           \
+    return ARCH_ATOMIC(load##bits##_acquire)(p);                                    \
+}                                                                                   \
+static inline void atomic_store##bits##_release(volatile type *p, type v) {        \
+    ARCH_ATOMIC(store##bits##_release)(p, v);                                       \
+}                                                                                   \
+static inline type atomic_fetch_add##bits(volatile type *p, type v) {              \
+    return ARCH_ATOMIC(fetch_add##bits)(p, v);                                      \
+}                                                                                   \
+static inline type atomic_fetch_sub##bits(volatile type *p, type v) {              \
+    return ARCH_ATOMIC(fetch_add##bits)(p, (type)-v);                               \
+}                                                                                   \
+static inline type atomic_xchg##bits(volatile type *p, type v) {                   \
+    return ARCH_ATOMIC(xchg##bits)(p, v);                                           \
+}                                                                                   \
+/* Возвращает предыдущее значение; обмен произошёл, если оно == old */            \
+static inline type atomic_cmpxchg##bits(volatile type *p, type old, type new_val) { \
+    return ARCH_ATOMIC(cmpxchg##bits)(p, old, new_val);                             \
+}                                                                                   \
+/* При неудаче записывает текущее значение в *old (удобно для циклов CAS) */      \
+static inline bool atomic_try_cmpxchg##bits(volatile type *p, type *old, type new_val) { \
+    type prev = ARCH_ATOMIC(cmpxchg##bits)(p, *old, new_val);                       \
+    if (prev == *old) return true;                                                  \
+    *old = prev;                                                                    \
+    return false;                                                                   \
+}                                                                                   \
+static inline void atomic_or##bits(volatile type *p, type v) {                     \
+    ARCH_ATOMIC(or##bits)(p, v);                                                    \
+}                                                                                   \
+static inline void atomic_and##bits(volatile type *p, type v) {                    \
+    ARCH_ATOMIC(and##bits)(p, v);                                                   \
+}
+
+ATOMIC_GENERIC_OPS(32, uint32_t)
+ATOMIC_GENERIC_OPS(64, uint64_t)
+
+#undef ATOMIC_GENERIC_OPS
+
+// Relaxed-сложение: на x86 любая lock-операция полностью упорядочена
+#ifdef ARCH_X86_64
+#define atomic_fetch_add32_relaxed(p, v) x86_64_fetch_add32((p), (v))
+#define atomic_fetch_add64_relaxed(p, v) x86_64_fetch_add64((p), (v))
+#else
+#define atomic_fetch_add32_relaxed(p, v) ARCH_ATOMIC(fetch_add32_relaxed)((p), (v))
+#define atomic_fetch_add64_relaxed(p, v) ARCH_ATOMIC(fetch_add64_relaxed)((p), (v))
+#endif
+
+// Операции над указателями (все поддерживаемые архитектуры 64-битные)
+#define atomic_load_ptr(p) \
+    ((__typeof__(*(p)))atomic_load64((const volatile uint64_t *)(p)))
+#define atomic_load_ptr_acquire(p) \
+    ((__typeof__(*(p)))atomic_load64_acquire((const volatile uint64_t *)(p)))
+#define atomic_store_ptr(p, v) \
+    atomic_store64((volatile uint64_t *)(p), (uint64_t)(uintptr_t)(v))
+#define atomic_store_ptr_release(p, v) \
+    atomic_store64_release((volatile uint64_t *)(p), (uint64_t)(uintptr_t)(v))
+#define atomic_xchg_ptr(p, v) \
+    ((__typeof__(*(p)))atomic_xchg64((volatile uint64_t *)(p), (uint64_t)(uintptr_t)(v)))
+#define atomic_cmpxchg_ptr(p, old, new_val)                                   \
+    ((__typeof__(*(p)))atomic_cmpxchg64((volatile uint64_t *)(p),           \
+                                        (uint64_t)(uintptr_t)(old),          \
+                                        (uint64_t)(uintptr_t)(new_val)))
+
+#endif // ATOMIC_H
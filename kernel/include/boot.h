@@ -0,0 +1,18 @@
+// boot.h — что передал загрузчик: модули, загруженные вместе с ядром
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+
+// Модуль в физической памяти [start, end); память тождественно
+// отображена, так что адрес годится и для доступа
+typedef struct boot_module {
+    uint64_t start;
+    uint64_t end;
+    const char *cmdline;       // строка модуля из конфигурации загрузчика
+} boot_module_t;
+
+// Модуль номер i; -1 — загрузчик его не передал
+int boot_module(uint32_t i, boot_module_t *mod);
+
+#endif // BOOT_H
@@ -0,0 +1,18 @@
+// memory.h — физические адреса для DMA
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stdint.h>
+
+// Ядро отображено тождественно (entry.S): физический адрес буфера
+// совпадает с виртуальным. Когда появится отображение в верхнюю
+// половину, меняется только здесь.
+static inline uint64_t virt_to_phys(const volatile void *p) {
+    return (uint64_t)(uintptr_t)p;
+}
+
+static inline void *phys_to_virt(uint64_t phys) {
+    return (void *)(uintptr_t)phys;
+}
+
+#endif // MEMORY_H
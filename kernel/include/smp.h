@@ -0,0 +1,73 @@
+// smp.h — архитектурно-независимый интерфейс многопроцессорности (SMP)
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+
+// Максимальное число логических CPU, которое поддерживает ядро
+#define SMP_MAX_CPUS 8
+
+// Размер строки кэша: per-CPU данные выравниваются по нему,
+// чтобы соседние CPU не делили одну строку (false sharing)
+#define SMP_CACHELINE 64
+#define __cacheline_aligned __attribute__((aligned(SMP_CACHELINE)))
+
+// Маска CPU: бит N соответствует логическому CPU N
+typedef uint64_t cpumask_t;
+#define CPUMASK_ALL ((cpumask_t)((1ULL << SMP_MAX_CPUS) - 1))
+#define CPUMASK_CPU(cpu) ((cpumask_t)1 << (cpu))
+
+// Причины межпроцессорных прерываний (IPI)
+#define IPI_RESCHEDULE 0   // есть работа в очереди — проснуться
+#define IPI_CALL_FUNC  1   // выполнить зарегистрированную функцию
+#define IPI_STOP       2   // остановить CPU
+#define IPI_TLB_FLUSH  3   // сбросить TLB по запросам других CPU (lib/mm/tlb.c)
+#define IPI_MAX        8
+
+// Per-CPU данные. На RISC-V указатель на структуру текущего CPU
+// хранится в регистре tp, на остальных архитектурах — индекс 0.
+typedef struct cpu_info {
+    uint32_t id;                  // логический номер CPU (0..SMP_MAX_CPUS-1)
+    uint32_t hwid;                // аппаратный ID (hartid / APIC ID / MPIDR)
+    volatile uint32_t online;     // CPU запущен и обрабатывает IPI
+    volatile uint32_t ipi_pending; // битовая маска ожидающих IPI
+    uintptr_t stack_top;          // вершина стека ядра этого CPU
+} __cacheline_aligned cpu_info_t;
+
+extern cpu_info_t smp_cpus[SMP_MAX_CPUS];
+
+typedef void (*ipi_handler_t)(void);
+
+// Запуск вторичных CPU (вызывается загрузочным CPU один раз)
+void smp_init(void);
+
+// Логический номер текущего CPU
+uint32_t smp_cpu_id(void);
+
+// Per-CPU данные текущего CPU
+cpu_info_t *smp_this_cpu(void);
+
+// Количество запущенных CPU
+uint32_t smp_num_cpus(void);
+
+// Маска запущенных CPU
+cpumask_t smp_online_mask(void);
+
+// Регистрация обработчика IPI для причины reason
+void smp_register_ipi_handler(uint32_t reason, ipi_handler_t handler);
+
+// Отправка IPI одному CPU и группе CPU
+void smp_send_ipi(uint32_t cpu, uint32_t reason);
+void smp_send_ipi_mask(cpumask_t mask, uint32_t reason);
+
+// Диспетчер IPI: вызывается из архитектурного обработчика прерывания
+void smp_handle_ipi(void);
+
+// Вход вторичного CPU в цикл планировщика (не возвращается)
+void smp_secondary_idle(void) __attribute__((noreturn));
+
+// Архитектурные хуки (по умолчанию — однопроцессорная реализация)
+void arch_smp_boot_secondaries(void);
+void arch_smp_send_ipi(uint32_t hwid);
+
+#endif // SMP_H
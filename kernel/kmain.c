@@ -2,12 +2,15 @@
 #include <stdint.h>
 #include "include/common.h"
 #include "include/arch.h"
+#include "include/smp.h"
+#include "include/boot.h"
 
 // Архитектурно-зависимые заголовки
 #ifdef ARCH_X86_64
 #include "arch/x86_64/gdt.h"
 #include "arch/x86_64/idt.h"
 #include "arch/x86_64/paging.h"
+#include "arch/x86_64/lapic.h"
 #elif defined(ARCH_ARM64)
 // ARM64 специфичные заголовки будут добавлены позже
 #elif defined(ARCH_RISCV64)
@@ -17,7 +20,27 @@
 #include "drivers/vga.h"
 #include "drivers/serial.h"
 #include "drivers/keyboard.h"
+#include "drivers/ata.h"
+#include "drivers/ahci.h"
+#include "drivers/nvme.h"
+#include "drivers/virtio_blk.h"
+#include "drivers/pci.h"
+#include "drivers/bio.h"
+#include "fs/bcache.h"
+#include "fs/readahead.h"
+#include "fs/vfs.h"
+#include "fs/ramfs.h"
+#include "fs/initrd.h"
+#include "fs/fat32.h"
 #include "lib/printf.h"
+#include "lib/sched/task.h"
+#include "lib/sched/cpuidle.h"
+#include "lib/sched/deadline.h"
+#include "lib/sync/lockstat.h"
+#include "lib/stats/stat.h"
+#include "lib/sync/rcu.h"
+#include "lib/sync/wait.h"
+#include "lib/mm/tlb.h"
 
 // Graphics система
 #include "lib/graphics/graphics.h"
@@ -92,11 +115,20 @@ void kernel_main() {
     paging_init();
     printf("Paging initialized.\n");
     serial_write_string("Paging initialized.\n");
+
+    // Локальный APIC: принимает MSI (линии устройств остаются на PIC)
+    if (lapic_init() < 0) {
+        printf("LAPIC not available, MSI disabled.\n");
+    }
 #elif defined(ARCH_ARM64)
     // ARM64 специфичная инициализация
     printf("ARM64 initialization...\n");
     serial_write_string("ARM64 initialization...\n");
 
+    // Выбор атомарных инструкций: LSE или LL/SC
+    arm64_cpu_features_init();
+    printf("Atomics: %s\n", arm64_has_lse ? "LSE" : "LL/SC");
+
     // GIC (Generic Interrupt Controller) инициализация
     // Сейчас используем базовую инициализацию
     // В реальной системе нужно:
@@ -139,16 +171,82 @@ void kernel_main() {
 
 #endif
 
+    // Планировщик инициализируется до запуска вторичных CPU:
+    // они сразу входят в sched_loop
+    rcu_init();
+    wait_init();
+    tasking_init();
+    cpuidle_init();
+    tlb_init();
+
+    // Запуск вторичных CPU (на RISC-V — hart'ы через SBI HSM)
+    smp_init();
+    printf("SMP: %u CPU(s) online\n", smp_num_cpus());
+    serial_write_string("SMP initialized.\n");
+
     // Инициализируем клавиатуру
     keyboard_init();
     printf("Keyboard driver initialized.\n");
     serial_write_string("Keyboard driver initialized.\n");
 
+    // Вывод в COM1 ждёт IRQ4 вместо опроса порта
+    serial_irq_init();
+
+    // Диски IDE: поиск опросом, дальше обмен по IRQ14/15 (DMA — через
+    // контроллер PCI), SATA — через AHCI с NCQ, NVMe — пара очередей
+    // на CPU (после smp_init: число пар по числу CPU); поверх них —
+    // общий кэш блоков и VFS с корнем в ramfs; initrd — первый модуль
+    // загрузчика, на /initrd без копирования; том FAT32 первого диска —
+    // на /mnt
+    pci_init();
+    ata_init();
+    ahci_init();
+    nvme_init();
+    virtio_blk_init();
+    bcache_init();
+    vfs_init();
+    ramfs_init();
+    if (vfs_mount("ramfs", NULL, NULL, "/") != 0) {
+        serial_write_string("ramfs root mount failed.\n");
+    }
+    initrd_init();
+#ifdef ARCH_X86_64
+    boot_module_t mod;
+    if (boot_module(0, &mod) == 0) {
+        initrd_image_t img = { (const void *)(uintptr_t)mod.start, mod.end - mod.start };
+        initrd_stats_t is;
+        if (vfs_mkdir("/initrd") == 0 && vfs_mount("initrd", NULL, &img, "/initrd") == 0) {
+            initrd_get_stats(&is);
+            printf("initrd: %u files, %u dirs, %u bytes\n", is.files, is.dirs, (uint32_t)is.bytes);
+        } else {
+            serial_write_string("initrd mount failed.\n");
+        }
+    }
+#endif
+    fat32_init();
+    block_device_t *disk = block_first();
+    if (disk && vfs_mkdir("/mnt") == 0 && vfs_mount("fat32", disk, NULL, "/mnt") == 0) {
+        printf("FAT32: %s mounted on /mnt\n", disk->name);
+    }
+
     // Включаем прерывания используя архитектурно-независимый интерфейс
     arch_enable_interrupts();
     printf("Interrupts enabled.\n");
     serial_write_string("Interrupts enabled.\n");
 
+#ifdef ENABLE_ATA_BENCH
+    ata_benchmark();
+#endif
+#ifdef ENABLE_AHCI_BENCH
+    ahci_benchmark();
+#endif
+#ifdef ENABLE_RA_BENCH
+    readahead_benchmark();
+#endif
+#ifdef ENABLE_RAMFS_BENCH
+    ramfs_benchmark();
+#endif
+
     // Приветствие с красивым splash screen
     printf("\n");
     printf("╔════════════════════════════════════════════════════════════════════════╗\n");
@@ -273,10 +371,25 @@ void kernel_main() {
         serial_write_string("Graphics not available, GUI disabled.\n");
     }
 
+    // Статистика блокировок за время загрузки (только при LOCK_STATS=1)
+    lockstat_dump();
+
+    // Счётчики событий по CPU за загрузку
+    stat_dump();
+
+    // Работы с крайним сроком и их промахи
+    sched_dl_dump();
+
+    // Состояния простоя CPU и задержки пробуждения
+    cpuidle_dump();
+
+    // Ввод-вывод дисков за загрузку: IOPS, глубина очереди, задержки
+    blk_iostat_dump();
+
     printf("\nEntering main event loop...\n");
     serial_write_string("Entering main event loop.\n");
 
-    while (1) {
-        arch_halt(); // при отсутствии задач простаиваем, пока прерывание не придёт
-    }
+    // Загрузочный CPU становится обычным участником планировщика:
+    // выполняет задачи, а при их отсутствии простаивает до прерывания
+    sched_loop();
 }
@@ -2,6 +2,7 @@
 
 #include "graphics.h"
 #include "../printf.h"
+#include "../stats/stat.h"
 
 // Global graphics device
 graphics_device_t *g_graphics_device = NULL;
@@ -69,15 +70,30 @@ void graphics_cleanup(void) {
     g_graphics_device = NULL;
 }
 
+// Framebuffer bytes written, for the per-CPU draw counter. Shapes are
+// counted before clipping except fillrect, where the area dominates.
+static inline void count_pixels(uint64_t pixels) {
+    stat_add(STAT_DRAW_BYTES, pixels * (g_graphics_device->bpp / 8));
+}
+
+static inline uint32_t clip_span(int32_t start, uint32_t len, uint32_t limit) {
+    int64_t lo = start < 0 ? 0 : start;
+    int64_t hi = (int64_t)start + len;
+    if (hi > limit) hi = limit;
+    return hi > lo ? (uint32_t)(hi - lo) : 0;
+}
+
 // Drawing functions
 void graphics_clear(uint32_t color) {
     if (g_graphics_device == NULL || g_graphics_device->clear == NULL) return;
     g_graphics_device->clear(g_graphics_device, color);
+    count_pixels((uint64_t)g_graphics_device->width * g_graphics_device->height);
 }
 
 void graphics_putpixel(int32_t x, int32_t y, uint32_t color) {
     if (g_graphics_device == NULL || g_graphics_device->putpixel == NULL) return;
     g_graphics_device->putpixel(g_graphics_device, x, y, color);
+    count_pixels(1);
 }
 
 uint32_t graphics_getpixel(int32_t x, int32_t y) {
@@ -88,16 +104,22 @@ uint32_t graphics_getpixel(int32_t x, int32_t y) {
 void graphics_fillrect(graphics_rect_t rect, uint32_t color) {
     if (g_graphics_device == NULL || g_graphics_device->fillrect == NULL) return;
     g_graphics_device->fillrect(g_graphics_device, rect, color);
+    count_pixels((uint64_t)clip_span(rect.x, rect.width, g_graphics_device->width) *
+                 clip_span(rect.y, rect.height, g_graphics_device->height));
 }
 
 void graphics_drawrect(graphics_rect_t rect, uint32_t color) {
     if (g_graphics_device == NULL || g_graphics_device->drawrect == NULL) return;
     g_graphics_device->drawrect(g_graphics_device, rect, color);
+    count_pixels(2 * ((uint64_t)rect.width + rect.height));
 }
 
 void graphics_drawline(graphics_point_t p1, graphics_point_t p2, uint32_t color) {
     if (g_graphics_device == NULL || g_graphics_device->drawline == NULL) return;
     g_graphics_device->drawline(g_graphics_device, p1, p2, color);
+    int32_t dx = p2.x > p1.x ? p2.x - p1.x : p1.x - p2.x;
+    int32_t dy = p2.y > p1.y ? p2.y - p1.y : p1.y - p2.y;
+    count_pixels((uint64_t)(dx > dy ? dx : dy) + 1);
 }
 
 // Simple circle drawing using Midpoint Circle Algorithm
@@ -118,6 +140,7 @@ void graphics_drawcircle(graphics_point_t center, uint32_t radius, uint32_t colo
         g_graphics_device->putpixel(g_graphics_device, center.x - y, center.y + x, color);
         g_graphics_device->putpixel(g_graphics_device, center.x + y, center.y - x, color);
         g_graphics_device->putpixel(g_graphics_device, center.x - y, center.y - x, color);
+        count_pixels(8);
 
         if (d < 0) {
             d = d + 4 * y + 6;
@@ -133,13 +156,16 @@ void graphics_drawcircle(graphics_point_t center, uint32_t radius, uint32_t colo
 void graphics_fillcircle(graphics_point_t center, uint32_t radius, uint32_t color) {
     if (g_graphics_device == NULL || g_graphics_device->putpixel == NULL) return;
 
+    uint64_t drawn = 0;
     for (int32_t y = -radius; y <= radius; y++) {
         for (int32_t x = -radius; x <= radius; x++) {
             if (x * x + y * y <= radius * radius) {
                 g_graphics_device->putpixel(g_graphics_device, center.x + x, center.y + y, color);
+                drawn++;
             }
         }
     }
+    count_pixels(drawn);
 }
 
 // Text rendering
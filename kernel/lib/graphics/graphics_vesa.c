@@ -2,6 +2,7 @@
 
 #include "graphics.h"
 #include "../printf.h"
+#include "../sched/workpool.h"
 #include <stddef.h>
 
 #ifdef __x86_64__
@@ -11,16 +12,37 @@
 
 static graphics_device_t vesa_device;
 
+// Pixels per parallel_for chunk when clearing: 64 KiB of framebuffer,
+// large enough that dispatch cost is lost in the memory traffic
+#define VESA_CLEAR_GRAIN (16 * 1024)
+
+typedef struct {
+    uint32_t *fb;
+    uint32_t color;
+} vesa_fill_ctx_t;
+
+static void vesa_fill_span(uint64_t begin, uint64_t end, void *arg) {
+    vesa_fill_ctx_t *ctx = (vesa_fill_ctx_t *)arg;
+    // Locals, so the stores to fb can't alias ctx and the loop vectorizes
+    uint32_t *fb = ctx->fb;
+    uint32_t color = ctx->color;
+    for (uint64_t i = begin; i < end; i++) {
+        fb[i] = color;
+    }
+}
+
 // Simple framebuffer-based drawing functions
 static void vesa_clear(graphics_device_t *dev, uint32_t color) {
     if (dev->framebuffer == NULL) return;
 
-    uint32_t *fb = (uint32_t *)dev->framebuffer;
-    uint32_t pixels = dev->width * dev->height;
+    vesa_fill_ctx_t ctx = {
+        .fb = (uint32_t *)dev->framebuffer,
+        .color = color,
+    };
+    uint64_t pixels = (uint64_t)dev->width * dev->height;
 
-    for (uint32_t i = 0; i < pixels; i++) {
-        fb[i] = color;
-    }
+    // Full-screen fill is memory bound: split it across all CPUs
+    parallel_for(0, pixels, VESA_CLEAR_GRAIN, vesa_fill_span, &ctx);
 }
 
 static void vesa_putpixel(graphics_device_t *dev, int32_t x, int32_t y, uint32_t color) {
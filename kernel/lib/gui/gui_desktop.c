@@ -7,6 +7,10 @@
 #include <stdbool.h>
 #include "../../lib/printf.h"
 #include "../../lib/graphics/graphics.h"
+#include "../../lib/sched/workpool.h"
+#include "../../lib/sched/deadline.h"
+#include "../../lib/sched/cpuidle.h"
+#include "gui_widgets.h"
 
 // Цвета для интерфейса
 #define DESKTOP_BG_COLOR      0x1a1a2e  // Темно-синий
@@ -18,6 +22,20 @@
 #define BUTTON_COLOR          0x16213e  // Кнопки
 #define BUTTON_HOVER_COLOR    0x0f3460  // При наведении
 
+// Параметры класса крайних сроков (мкс): кадр 60 Гц и опрос ввода
+// 250 Гц со сроком вдвое короче периода, чтобы отклик не зависел от
+// фоновой нагрузки
+#define FRAME_PERIOD_US       16667
+#define FRAME_RUNTIME_US      5000
+#define INPUT_PERIOD_US       4000
+#define INPUT_DEADLINE_US     2000
+#define INPUT_RUNTIME_US      200
+
+// Пока GUI работает, CPU не уходят в простой с выходом дольше этого:
+// клавиатура и мышь будят CPU прерыванием, и отклик не должен ждать
+// выхода из глубокого состояния
+#define INPUT_IDLE_LATENCY_US 10
+
 // Структуры
 typedef struct {
     int32_t x, y;
@@ -42,6 +60,10 @@ typedef struct {
     int32_t taskbar_button_count;
     uint32_t active_window;
     graphics_device_t *gfx;
+    volatile uint32_t dirty;   // нужен новый кадр
+    int frame_dl;              // работы класса крайних сроков (-1 — нет)
+    int input_dl;
+    cpuidle_qos_req_t idle_qos;
 } gui_desktop_t;
 
 static gui_desktop_t desktop = {0};
@@ -119,14 +141,14 @@ static void draw_taskbar(void) {
     graphics_putstring(10, screen_height - 40, "MyOS v1.0", TEXT_COLOR, TASKBAR_COLOR);
 }
 
-static void draw_desktop_wallpaper(void) {
-    if (!desktop.gfx) return;
+// Строк обоев на одну порцию parallel_for
+#define WALLPAPER_ROWS_PER_CHUNK 32
 
-    uint32_t screen_width = graphics_get_width();
-    uint32_t screen_height = graphics_get_height();
+// Строки [begin, end) обоев; arg — ширина экрана
+static void draw_wallpaper_rows(uint64_t begin, uint64_t end, void *arg) {
+    uint32_t screen_width = *(uint32_t *)arg;
 
-    // Фон рабочего стола - красивый градиентный эффект
-    for (uint32_t y = 0; y < screen_height - 50; y++) {
+    for (uint32_t y = (uint32_t)begin; y < (uint32_t)end; y++) {
         uint32_t color = DESKTOP_BG_COLOR;
         // Небольшой градиент сверху
         if (y < 100) {
@@ -138,6 +160,19 @@ static void draw_desktop_wallpaper(void) {
     }
 }
 
+static void draw_desktop_wallpaper(void) {
+    if (!desktop.gfx) return;
+
+    uint32_t screen_width = graphics_get_width();
+    uint32_t screen_height = graphics_get_height();
+    if (screen_height <= 50) return;
+
+    // Фон рабочего стола - красивый градиентный эффект.
+    // Строки независимы — рисуем их на всех CPU
+    parallel_for(0, screen_height - 50, WALLPAPER_ROWS_PER_CHUNK,
+                 draw_wallpaper_rows, &screen_width);
+}
+
 static void draw_icons(void) {
     if (!desktop.gfx) return;
 
@@ -166,6 +201,8 @@ void gui_desktop_init(graphics_device_t *gfx) {
     desktop.window_count = 0;
     desktop.taskbar_button_count = 0;
     desktop.active_window = 0;
+    desktop.frame_dl = -1;
+    desktop.input_dl = -1;
 
     if (!gfx || gfx->bpp < 16) {
         printf("GUI Desktop требует 16-bit или выше цветной графики\n");
@@ -214,10 +251,8 @@ void gui_desktop_init(graphics_device_t *gfx) {
            desktop.window_count, desktop.taskbar_button_count);
 }
 
-// Рендеринг всего интерфейса
-void gui_desktop_render(void) {
-    if (!desktop.gfx) return;
-
+// Отрисовка одного кадра
+static void compose_frame(void) {
     // Очищаем экран
     graphics_clear(DESKTOP_BG_COLOR);
 
@@ -239,10 +274,59 @@ void gui_desktop_render(void) {
 
     // Обновляем дисплей
     graphics_flush();
+}
+
+// Рендеринг всего интерфейса
+void gui_desktop_render(void) {
+    if (!desktop.gfx) return;
 
+    compose_frame();
     printf("GUI Desktop отрисован\n");
 }
 
+// Кадр: перерисовываем, только если что-то изменилось
+static void desktop_frame_job(void *arg) {
+    (void)arg;
+    if (atomic_xchg32(&desktop.dirty, 0)) {
+        compose_frame();
+    }
+}
+
+static void desktop_input_job(void *arg) {
+    (void)arg;
+    gui_process_events();
+}
+
+// Запросить перерисовку: в ближайшем кадре или сразу, если работа
+// кадра не была принята классом крайних сроков
+static void desktop_invalidate(void) {
+    if (desktop.frame_dl >= 0) {
+        atomic_store32(&desktop.dirty, 1);
+    } else {
+        compose_frame();
+    }
+}
+
+static void desktop_start_deadline_jobs(void) {
+    sched_dl_params_t frame = {
+        .runtime = sched_dl_us(FRAME_RUNTIME_US),
+        .deadline = sched_dl_us(FRAME_PERIOD_US),
+        .period = sched_dl_us(FRAME_PERIOD_US),
+    };
+    sched_dl_params_t input = {
+        .runtime = sched_dl_us(INPUT_RUNTIME_US),
+        .deadline = sched_dl_us(INPUT_DEADLINE_US),
+        .period = sched_dl_us(INPUT_PERIOD_US),
+    };
+
+    cpuidle_qos_add(&desktop.idle_qos, INPUT_IDLE_LATENCY_US);
+    desktop.input_dl = sched_dl_create(desktop_input_job, NULL, &input);
+    desktop.frame_dl = sched_dl_create(desktop_frame_job, NULL, &frame);
+    printf("Deadline class: input %s, frames %s\n",
+           desktop.input_dl >= 0 ? "admitted" : "rejected",
+           desktop.frame_dl >= 0 ? "admitted" : "rejected (redraw on demand)");
+}
+
 // Запуск GUI Desktop
 void gui_desktop_run(graphics_device_t *gfx) {
     if (!gfx) {
@@ -253,6 +337,7 @@ void gui_desktop_run(graphics_device_t *gfx) {
     printf("Запуск GUI Desktop...\n");
     gui_desktop_init(gfx);
     gui_desktop_render();
+    desktop_start_deadline_jobs();
 
     printf("\nGUI Desktop запущен успешно!\n");
     printf("═════════════════════════════════════════════════════════════\n");
@@ -266,7 +351,8 @@ void gui_desktop_run(graphics_device_t *gfx) {
 
 // Функция для обновления интерфейса
 void gui_desktop_update(void) {
-    gui_desktop_render();
+    if (!desktop.gfx) return;
+    desktop_invalidate();
 }
 
 // Функция обработки событий мыши
@@ -291,5 +377,5 @@ void gui_desktop_handle_mouse(int32_t x, int32_t y, bool clicked) {
         }
     }
 
-    gui_desktop_render();
+    desktop_invalidate();
 }
@@ -7,6 +7,10 @@
 #include "../graphics/graphics.h"
 #include "../graphics/graphics_font.h"
 #include "../string.h"
+#include "../sync/spinlock.h"
+#include "../sync/rcu.h"
+#include "../stats/stat.h"
+#include "../../include/atomic.h"
 
 /* str_ncpy implementation since we're in freestanding mode */
 static void str_ncpy(char *dst, const char *src, uint32_t n) {
@@ -21,15 +25,20 @@ static void str_ncpy(char *dst, const char *src, uint32_t n) {
 void *kmalloc(uint32_t size) {
     /* TODO: Implement proper kernel malloc */
     static uint8_t heap[65536];
-    static uint32_t heap_pos = 0;
+    static volatile uint32_t heap_pos = 0;
 
-    if (heap_pos + size > sizeof(heap)) {
-        return NULL;
-    }
+    /* Lock-free bump: callers may run on several CPUs at once */
+    uint32_t pos = atomic_load32(&heap_pos);
+    do {
+        if (pos + size > sizeof(heap)) {
+            return NULL;
+        }
+    } while (!atomic_try_cmpxchg32(&heap_pos, &pos, pos + size));
+
+    stat_inc(STAT_ALLOCS);
+    stat_add(STAT_ALLOC_BYTES, size);
 
-    void *ptr = &heap[heap_pos];
-    heap_pos += size;
-    return ptr;
+    return &heap[pos];
 }
 
 void kfree(void *ptr) {
@@ -37,10 +46,23 @@ void kfree(void *ptr) {
     (void)ptr;
 }
 
+/* Z-ordered window list (last = front). Read on every frame and mouse
+ * event without locks via RCU; writers copy the list, modify the copy
+ * and publish it, and the old list is recycled after a grace period. */
+typedef struct gui_window_list {
+    uint32_t count;
+    gui_widget_t *windows[MAX_WINDOWS];
+    rcu_head_t rcu;
+} gui_window_list_t;
+
+#define GUI_WINDOW_LISTS 8
+
+static gui_window_list_t gui_window_lists[GUI_WINDOW_LISTS];
+static uint32_t gui_window_lists_free;  /* bitmask of spare lists */
+
 /* Global GUI state */
 static struct {
-    gui_widget_t *windows[MAX_WINDOWS];
-    uint32_t window_count;
+    gui_window_list_t *windows;    /* RCU-protected */
     gui_widget_t *focused_widget;
     gui_widget_t *hovered_widget;
 
@@ -51,6 +73,47 @@ static struct {
     uint32_t next_widget_id;
 } gui_state = {0};
 
+/* Serializes window list writers and guards gui_window_lists_free. The
+ * event queue is also filled from input interrupt handlers, hence the
+ * irqsave spinlock. */
+static spinlock_t gui_windows_lock = SPINLOCK_INIT("gui_windows");
+static spinlock_t gui_events_lock = SPINLOCK_INIT("gui_events");
+
+static void gui_window_list_release(rcu_head_t *head) {
+    gui_window_list_t *list = rcu_container_of(head, gui_window_list_t, rcu);
+    spin_lock(&gui_windows_lock);
+    gui_window_lists_free |= 1u << (list - gui_window_lists);
+    spin_unlock(&gui_windows_lock);
+}
+
+/* Take gui_windows_lock and return a private copy of the window list */
+static gui_window_list_t *gui_windows_begin_update(void) {
+    for (;;) {
+        spin_lock(&gui_windows_lock);
+        if (gui_window_lists_free) {
+            uint32_t idx = (uint32_t)__builtin_ctz(gui_window_lists_free);
+            gui_window_lists_free &= ~(1u << idx);
+            gui_window_list_t *copy = &gui_window_lists[idx];
+            *copy = *gui_state.windows;
+            return copy;
+        }
+        spin_unlock(&gui_windows_lock);
+
+        /* Every spare list still has readers: wait them out (without the
+         * lock, other CPUs may need it to finish) and reclaim */
+        synchronize_rcu();
+        rcu_process_callbacks();
+    }
+}
+
+/* Publish the modified copy, drop the lock, recycle the old list later */
+static void gui_windows_end_update(gui_window_list_t *copy) {
+    gui_window_list_t *old = gui_state.windows;
+    rcu_assign_pointer(gui_state.windows, copy);
+    spin_unlock(&gui_windows_lock);
+    call_rcu(&old->rcu, gui_window_list_release);
+}
+
 /* ============================================
  * Widget Initialization
  * ============================================ */
@@ -58,6 +121,10 @@ static struct {
 void gui_init(void) {
     memset(&gui_state, 0, sizeof(gui_state));
     gui_state.next_widget_id = 1000;
+
+    gui_window_lists[0].count = 0;
+    gui_window_lists_free = ((1u << GUI_WINDOW_LISTS) - 1) & ~1u;
+    gui_state.windows = &gui_window_lists[0];
 }
 
 /* ============================================
@@ -70,7 +137,7 @@ gui_widget_t *gui_widget_create(widget_type_t type, const char *id) {
 
     memset(w, 0, sizeof(gui_widget_t));
 
-    w->id = gui_state.next_widget_id++;
+    w->id = atomic_fetch_add32(&gui_state.next_widget_id, 1);
     w->type = type;
     w->flags = WIDGET_VISIBLE | WIDGET_ENABLED;
     w->background_color = DEFAULT_BG_COLOR;
@@ -106,8 +173,10 @@ void gui_widget_add_child(gui_widget_t *parent, gui_widget_t *child) {
     if (!parent || !child) return;
     if (parent->child_count >= MAX_WIDGETS_PER_WINDOW) return;
 
-    parent->children[parent->child_count++] = child;
+    /* Store the child before publishing the new count to hit testing */
     child->parent = parent;
+    rcu_assign_pointer(parent->children[parent->child_count], child);
+    atomic_store32_release(&parent->child_count, parent->child_count + 1);
     gui_widget_invalidate(parent);
 }
 
@@ -202,9 +271,10 @@ gui_widget_t *gui_widget_hit_test(gui_widget_t *w, int32_t x, int32_t y) {
         return NULL;
     }
 
-    /* Check children in reverse order (top-most first) */
-    for (int32_t i = w->child_count - 1; i >= 0; i--) {
-        gui_widget_t *hit = gui_widget_hit_test(w->children[i], x, y);
+    /* Check children in reverse order (top-most first). Lock-free: a
+     * concurrent removal may briefly show a child twice, never a freed one */
+    for (int32_t i = (int32_t)atomic_load32_acquire(&w->child_count) - 1; i >= 0; i--) {
+        gui_widget_t *hit = gui_widget_hit_test(rcu_dereference(w->children[i]), x, y);
         if (hit) return hit;
     }
 
@@ -336,9 +406,11 @@ gui_widget_t *gui_window_create(const char *title,
     gui_widget_set_bounds(w, x, y, width, height);
 
     /* Add to window list */
-    if (gui_state.window_count < MAX_WINDOWS) {
-        gui_state.windows[gui_state.window_count++] = w;
+    gui_window_list_t *list = gui_windows_begin_update();
+    if (list->count < MAX_WINDOWS) {
+        list->windows[list->count++] = w;
     }
+    gui_windows_end_update(list);
 
     return w;
 }
@@ -357,17 +429,24 @@ void gui_window_bring_to_front(gui_widget_t *window) {
     if (!window || window->type != WIDGET_WINDOW) return;
 
     /* Find and remove window from list */
-    for (uint32_t i = 0; i < gui_state.window_count; i++) {
-        if (gui_state.windows[i] == window) {
+    bool found = false;
+    gui_window_list_t *list = gui_windows_begin_update();
+    for (uint32_t i = 0; i < list->count; i++) {
+        if (list->windows[i] == window) {
             /* Move to end (front) */
-            for (uint32_t j = i; j < gui_state.window_count - 1; j++) {
-                gui_state.windows[j] = gui_state.windows[j + 1];
+            for (uint32_t j = i; j < list->count - 1; j++) {
+                list->windows[j] = list->windows[j + 1];
             }
-            gui_state.windows[gui_state.window_count - 1] = window;
-            gui_widget_invalidate(window);
-            return;
+            list->windows[list->count - 1] = window;
+            found = true;
+            break;
         }
     }
+    gui_windows_end_update(list);
+
+    if (found) {
+        gui_widget_invalidate(window);
+    }
 }
 
 void gui_window_minimize(gui_widget_t *window) {
@@ -384,21 +463,28 @@ void gui_window_maximize(gui_widget_t *window) {
     gui_widget_set_bounds(window, 0, 0, screen_width, screen_height);
 }
 
+static void gui_window_free(rcu_head_t *head) {
+    gui_widget_destroy(rcu_container_of(head, gui_widget_t, rcu));
+}
+
 void gui_window_close(gui_widget_t *window) {
     if (!window || window->type != WIDGET_WINDOW) return;
 
     /* Remove from window list */
-    for (uint32_t i = 0; i < gui_state.window_count; i++) {
-        if (gui_state.windows[i] == window) {
-            for (uint32_t j = i; j < gui_state.window_count - 1; j++) {
-                gui_state.windows[j] = gui_state.windows[j + 1];
+    gui_window_list_t *list = gui_windows_begin_update();
+    for (uint32_t i = 0; i < list->count; i++) {
+        if (list->windows[i] == window) {
+            for (uint32_t j = i; j < list->count - 1; j++) {
+                list->windows[j] = list->windows[j + 1];
             }
-            gui_state.window_count--;
+            list->count--;
             break;
         }
     }
+    gui_windows_end_update(list);
 
-    gui_widget_destroy(window);
+    /* Renderer or hit testing on another CPU may still hold the window */
+    call_rcu(&window->rcu, gui_window_free);
 }
 
 /* ============================================
@@ -554,31 +640,44 @@ void gui_label_set_text(gui_widget_t *label, const char *text) {
  * ============================================ */
 
 void gui_process_events(void) {
-    while (gui_state.event_head != gui_state.event_tail) {
-        gui_event_t *event = &gui_state.event_queue[gui_state.event_head];
+    for (;;) {
+        /* Copy the event out: handlers run without the lock held and
+         * the slot may be reused by an interrupt in the meantime */
+        gui_event_t event;
+        arch_irqflags_t flags = spin_lock_irqsave(&gui_events_lock);
+        if (gui_state.event_head == gui_state.event_tail) {
+            spin_unlock_irqrestore(&gui_events_lock, flags);
+            break;
+        }
+        event = gui_state.event_queue[gui_state.event_head];
         gui_state.event_head = (gui_state.event_head + 1) % 256;
+        spin_unlock_irqrestore(&gui_events_lock, flags);
 
-        if (event->target) {
-            gui_widget_handle_event(event->target, event);
+        if (event.target) {
+            gui_widget_handle_event(event.target, &event);
         }
     }
 }
 
 void gui_render(void) {
     /* Draw all windows */
-    for (uint32_t i = 0; i < gui_state.window_count; i++) {
-        gui_widget_paint(gui_state.windows[i]);
+    rcu_read_lock();
+    gui_window_list_t *list = rcu_dereference(gui_state.windows);
+    for (uint32_t i = 0; i < list->count; i++) {
+        gui_widget_paint(list->windows[i]);
     }
+    rcu_read_unlock();
 }
 
 void gui_post_event(gui_event_t *event) {
+    arch_irqflags_t flags = spin_lock_irqsave(&gui_events_lock);
     uint32_t next_tail = (gui_state.event_tail + 1) % 256;
-    if (next_tail == gui_state.event_head) {
-        return;  /* Queue full */
+    if (next_tail != gui_state.event_head) {
+        gui_state.event_queue[gui_state.event_tail] = *event;
+        gui_state.event_tail = next_tail;
     }
-
-    gui_state.event_queue[gui_state.event_tail] = *event;
-    gui_state.event_tail = next_tail;
+    /* else: queue full, event dropped */
+    spin_unlock_irqrestore(&gui_events_lock, flags);
 }
 
 void gui_inject_mouse_event(int32_t x, int32_t y,
@@ -590,15 +689,18 @@ void gui_inject_mouse_event(int32_t x, int32_t y,
     event.data.mouse.y = y;
     event.data.mouse.button = button;
 
-    /* Find window under cursor */
+    /* Find window under cursor, front to back */
     event.target = NULL;
-    for (uint32_t i = gui_state.window_count - 1; i > 0; i--) {
-        gui_widget_t *hit = gui_widget_hit_test(gui_state.windows[i], x, y);
+    rcu_read_lock();
+    gui_window_list_t *list = rcu_dereference(gui_state.windows);
+    for (uint32_t i = list->count; i-- > 0;) {
+        gui_widget_t *hit = gui_widget_hit_test(list->windows[i], x, y);
         if (hit) {
             event.target = hit;
             break;
         }
     }
+    rcu_read_unlock();
 
     if (event.target) {
         gui_post_event(&event);
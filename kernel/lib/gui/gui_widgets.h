@@ -9,6 +9,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "../graphics/graphics.h"
+#include "../sync/rcu.h"
 
 /* Maximum widgets per window */
 #define MAX_WIDGETS_PER_WINDOW 32
@@ -124,7 +125,9 @@ typedef struct gui_widget {
 
     struct gui_widget *parent;     /* Parent window/container */
     struct gui_widget *children[MAX_WIDGETS_PER_WINDOW];
-    uint32_t child_count;
+    uint32_t child_count;          /* Published with release: hit testing reads lock-free */
+
+    rcu_head_t rcu;                /* Deferred destruction after window close */
 
     /* Event handlers */
     void (*on_click)(struct gui_widget *w, int32_t x, int32_t y);
@@ -0,0 +1,197 @@
+// ioring.c — кольца отправки и завершений: SQE в bio, завершения в CQE
+#include "ioring.h"
+
+#include <stddef.h>
+
+static int is_pow2(uint32_t x) {
+    return x && !(x & (x - 1));
+}
+
+int ioring_setup(ioring_t *ring, ioring_sqe_t *sqes, uint32_t sq_entries,
+                 ioring_cqe_t *cqes, uint32_t cq_entries) {
+    if (!is_pow2(sq_entries) || !is_pow2(cq_entries) || cq_entries < sq_entries) return -1;
+
+    ring->sqes = sqes;
+    ring->sq_entries = sq_entries;
+    ring->sq_mask = sq_entries - 1;
+    ring->sq_head = ring->sq_tail = ring->sqe_tail = 0;
+
+    ring->cqes = cqes;
+    ring->cq_entries = cq_entries;
+    ring->cq_mask = cq_entries - 1;
+    ring->cq_head = ring->cq_tail = 0;
+
+    for (int i = 0; i < IORING_MAX_DEVS; i++) {
+        ring->devs[i] = NULL;
+    }
+    spin_lock_init(&ring->lock, "ioring");
+    ring->ops_free = NULL;
+    for (int i = IORING_MAX_INFLIGHT - 1; i >= 0; i--) {
+        ring->ops[i].next = ring->ops_free;
+        ring->ops_free = &ring->ops[i];
+    }
+    ring->inflight = 0;
+    wait_queue_init(&ring->cq_wait);
+    return 0;
+}
+
+int ioring_register_dev(ioring_t *ring, block_device_t *dev) {
+    if (!dev) return -1;
+    arch_irqflags_t flags = spin_lock_irqsave(&ring->lock);
+    for (int i = 0; i < IORING_MAX_DEVS; i++) {
+        if (!ring->devs[i] || ring->devs[i] == dev) {
+            ring->devs[i] = dev;
+            spin_unlock_irqrestore(&ring->lock, flags);
+            return i;
+        }
+    }
+    spin_unlock_irqrestore(&ring->lock, flags);
+    return -1;
+}
+
+// ---------------------------------------------------------------
+// Завершение
+// ---------------------------------------------------------------
+
+static void ioring_complete(ioring_op_t *op) {
+    ioring_t *ring = op->ring;
+
+    // Место в кольце зарезервировано при приёме SQE
+    arch_irqflags_t flags = spin_lock_irqsave(&ring->lock);
+    uint32_t tail = ring->cq_tail;
+    ioring_cqe_t *cqe = &ring->cqes[tail & ring->cq_mask];
+    cqe->user_data = op->user_data;
+    cqe->res = op->res;
+    cqe->flags = 0;
+    atomic_store32_release(&ring->cq_tail, tail + 1);
+
+    op->next = ring->ops_free;
+    ring->ops_free = op;
+    ring->inflight--;
+    spin_unlock_irqrestore(&ring->lock, flags);
+
+    wake_up_all(&ring->cq_wait);
+}
+
+static void ioring_fail(ioring_op_t *op) {
+    op->res = -1;
+    ioring_complete(op);
+}
+
+static void ioring_end_bio(bio_t *bio) {
+    ioring_op_t *op = (ioring_op_t *)bio->private;
+    if (bio->status) op->res = -1;
+    if (atomic_fetch_sub32(&op->pending, 1) == 1) ioring_complete(op);
+}
+
+// ---------------------------------------------------------------
+// Отправка
+// ---------------------------------------------------------------
+
+// later — операций этой пачки после op: они уже учтены в inflight, но
+// ещё не отправлены
+static void ioring_issue(ioring_t *ring, blk_plug_t *plug, ioring_op_t *op, uint32_t later) {
+    const ioring_sqe_t *sqe = &op->sqe;
+    op->user_data = sqe->user_data;
+    op->res = 0;
+    block_device_t *dev = sqe->fd < IORING_MAX_DEVS ? ring->devs[sqe->fd] : NULL;
+
+    switch (sqe->opcode) {
+    case IORING_OP_NOP:
+        ioring_complete(op);
+        return;
+    case IORING_OP_FLUSH:
+        // Барьер: сначала дождаться всех операций, поставленных раньше
+        blk_finish_plug(plug);
+        wait_event(&ring->cq_wait, atomic_load32(&ring->inflight) == later + 1);
+        blk_start_plug(plug);
+        if (!dev || block_flush(dev) != 0) op->res = -1;
+        ioring_complete(op);
+        return;
+    case IORING_OP_READ:
+    case IORING_OP_WRITE:
+        break;
+    default:
+        ioring_fail(op);
+        return;
+    }
+
+    if (!dev) {
+        ioring_fail(op);
+        return;
+    }
+    uint32_t ss = dev->sector_size;
+    uint32_t sectors = sqe->len / ss;
+    uint32_t nbios = (sectors + dev->max_transfer - 1) / dev->max_transfer;
+    if (!sectors || sqe->len % ss || sqe->off % ss || nbios > IORING_OP_BIOS) {
+        ioring_fail(op);
+        return;
+    }
+
+    op->res = (int32_t)sqe->len;
+    op->pending = nbios;
+    uint64_t lba = sqe->off / ss;
+    uint8_t *buf = (uint8_t *)(uintptr_t)sqe->addr;
+    for (uint32_t i = 0; i < nbios; i++) {
+        uint32_t n = sectors < dev->max_transfer ? sectors : dev->max_transfer;
+        bio_t *bio = &op->bios[i];
+        bio->dev = dev;
+        bio->lba = lba;
+        bio->sectors = n;
+        bio->buf = buf;
+        bio->write = sqe->opcode == IORING_OP_WRITE;
+        bio->end_io = ioring_end_bio;
+        bio->private = op;
+        submit_bio(plug, bio);
+        lba += n;
+        buf += (uint64_t)n * ss;
+        sectors -= n;
+    }
+}
+
+uint32_t ioring_enter(ioring_t *ring, uint32_t min_complete) {
+    ioring_op_t *ops = NULL, **link = &ops;
+    uint32_t taken = 0;
+
+    // SQE копируются в операции: как только head сдвинут, отправитель
+    // может писать в эти элементы снова. Принимается не больше, чем
+    // осталось места под CQE.
+    arch_irqflags_t flags = spin_lock_irqsave(&ring->lock);
+    uint32_t head = ring->sq_head;
+    uint32_t tail = atomic_load32_acquire(&ring->sq_tail);
+    while (head != tail && ring->ops_free &&
+           ring->cq_tail - atomic_load32(&ring->cq_head) + ring->inflight < ring->cq_entries) {
+        ioring_op_t *op = ring->ops_free;
+        ring->ops_free = op->next;
+        op->ring = ring;
+        op->sqe = ring->sqes[head & ring->sq_mask];
+        op->next = NULL;
+        *link = op;
+        link = &op->next;
+        ring->inflight++;
+        taken++;
+        head++;
+    }
+    atomic_store32_release(&ring->sq_head, head);
+    spin_unlock_irqrestore(&ring->lock, flags);
+
+    // Пачка уходит в блочный слой сразу. blk_finish_plug() возвращается,
+    // поставив на диск до его глубины очереди; остальное выдают
+    // завершения из обработчика прерывания.
+    blk_plug_t plug;
+    blk_start_plug(&plug);
+    uint32_t later = taken;
+    while (ops) {
+        ioring_op_t *next = ops->next;
+        ioring_issue(ring, &plug, ops, --later);
+        ops = next;
+    }
+    blk_finish_plug(&plug);
+
+    if (min_complete > ring->cq_entries) min_complete = ring->cq_entries;
+    if (min_complete) {
+        wait_event(&ring->cq_wait, atomic_load32_acquire(&ring->cq_tail) -
+                                   atomic_load32(&ring->cq_head) >= min_complete);
+    }
+    return taken;
+}
@@ -0,0 +1,166 @@
+// ioring.h — асинхронный ввод-вывод через кольца отправки и завершений
+//
+// Вместо вызова на каждую операцию отправитель кладёт описания
+// операций (SQE) в кольцо отправки в общей памяти и одним вызовом
+// ioring_enter() отдаёт ядру всю пачку; результаты (CQE) ядро кладёт в
+// кольцо завершений, откуда их забирают без вызовов — опросом
+// ioring_peek_cqe().
+//
+// ioring_enter() забирает SQE и сразу отправляет операции в блочный
+// слой. Драйвер с submit получает до своей глубины очереди команд, и
+// enter возвращается, не дожидаясь диска: в полёте остаётся до
+// IORING_MAX_INFLIGHT операций, а CQE пишут завершения из обработчика
+// прерывания. Диск без submit (ATA) выполняет команды по одной, и enter
+// возвращается, когда они выполнены. FLUSH — барьер: enter ждёт
+// завершения всех операций, поставленных до него.
+//
+// Каждое кольцо — массив степени двойки и пара свободно бегущих
+// индексов head/tail. В кольце отправки tail двигает отправитель, head
+// — ядро; в кольце завершений наоборот. Память колец даёт вызывающий,
+// поэтому её можно отобразить в пользовательский процесс, когда они
+// появятся: вспомогательные функции ниже (get_sqe, prep_*, peek/seen)
+// только читают и пишут кольца и сработают и там. Отправитель у кольца
+// один: enter из нескольких потоков сразу не вызывают.
+//
+// Операции пачки уходят в блочный слой под одним plug, так что
+// соседние чтения сливаются в одну команду. Ядро не принимает больше
+// операций, чем осталось места в кольце завершений, поэтому оно не
+// переполняется: ioring_enter() возвращает, сколько SQE забрано.
+#ifndef IORING_H
+#define IORING_H
+
+#include <stdint.h>
+#include "../../drivers/bio.h"
+#include "../sync/spinlock.h"
+#include "../sync/wait.h"
+#include "../../include/atomic.h"
+
+// Устройств в таблице кольца (sqe->fd — индекс в ней)
+#define IORING_MAX_DEVS     8
+
+// Операций в полёте на кольцо и bio на одну операцию
+#define IORING_MAX_INFLIGHT 64
+#define IORING_OP_BIOS      4
+
+enum {
+    IORING_OP_NOP,
+    IORING_OP_READ,
+    IORING_OP_WRITE,
+    IORING_OP_FLUSH,
+};
+
+// Операция. off и len — в байтах, кратны размеру сектора устройства.
+typedef struct ioring_sqe {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t fd;
+    uint64_t off;
+    uint64_t addr;
+    uint32_t len;
+    uint32_t reserved2;
+    uint64_t user_data;        // возвращается в CQE как есть
+} ioring_sqe_t;
+
+// Результат: res — байт передано или -1
+typedef struct ioring_cqe {
+    uint64_t user_data;
+    int32_t res;
+    uint32_t flags;
+} ioring_cqe_t;
+
+struct ioring;
+
+// Операция в полёте (ядро)
+typedef struct ioring_op {
+    struct ioring *ring;
+    ioring_sqe_t sqe;          // копия: элемент кольца освобождается сразу
+    uint64_t user_data;
+    int32_t res;
+    volatile uint32_t pending;          // незавершённых bio
+    bio_t bios[IORING_OP_BIOS];
+    struct ioring_op *next;
+} ioring_op_t;
+
+typedef struct ioring {
+    // Общая память: кольца
+    ioring_sqe_t *sqes;
+    uint32_t sq_entries, sq_mask;
+    volatile uint32_t sq_head, sq_tail;
+    uint32_t sqe_tail;         // отправителя: следующий SQE, ещё не опубликован
+
+    ioring_cqe_t *cqes;
+    uint32_t cq_entries, cq_mask;
+    volatile uint32_t cq_head, cq_tail;
+
+    // Ядро
+    block_device_t *devs[IORING_MAX_DEVS];
+    // sq_head, ops_free, inflight, запись CQE; берёт и завершение bio
+    // из обработчика прерывания
+    spinlock_t lock;
+    ioring_op_t ops[IORING_MAX_INFLIGHT];
+    ioring_op_t *ops_free;
+    volatile uint32_t inflight;         // забраны, CQE ещё нет
+    wait_queue_t cq_wait;
+} ioring_t;
+
+// Подготовить кольцо над массивами вызывающего. Размеры — степени
+// двойки, cq_entries не меньше sq_entries. 0 — успех.
+int ioring_setup(ioring_t *ring, ioring_sqe_t *sqes, uint32_t sq_entries,
+                 ioring_cqe_t *cqes, uint32_t cq_entries);
+
+// Занести устройство в таблицу кольца. Индекс для sqe->fd или -1.
+int ioring_register_dev(ioring_t *ring, block_device_t *dev);
+
+// Забрать поставленные SQE и отправить их в блочный слой; затем,
+// если min_complete, ждать, пока в кольце завершений не наберётся
+// столько CQE. Возвращает число забранных SQE.
+uint32_t ioring_enter(ioring_t *ring, uint32_t min_complete);
+
+// ---------------------------------------------------------------
+// Сторона отправителя: только кольца
+// ---------------------------------------------------------------
+
+// Свободный SQE (станет виден ядру после ioring_submit) или NULL
+static inline ioring_sqe_t *ioring_get_sqe(ioring_t *ring) {
+    uint32_t head = atomic_load32_acquire(&ring->sq_head);
+    if (ring->sqe_tail - head >= ring->sq_entries) return NULL;
+    return &ring->sqes[ring->sqe_tail++ & ring->sq_mask];
+}
+
+// Опубликовать подготовленные SQE и отдать их ядру; wait — сколько
+// CQE дождаться
+static inline uint32_t ioring_submit_and_wait(ioring_t *ring, uint32_t wait) {
+    atomic_store32_release(&ring->sq_tail, ring->sqe_tail);
+    return ioring_enter(ring, wait);
+}
+
+static inline uint32_t ioring_submit(ioring_t *ring) {
+    return ioring_submit_and_wait(ring, 0);
+}
+
+static inline void ioring_prep_rw(ioring_sqe_t *sqe, uint8_t opcode, uint32_t fd, void *buf,
+                                  uint32_t len, uint64_t off, uint64_t user_data) {
+    sqe->opcode = opcode;
+    sqe->flags = 0;
+    sqe->reserved = 0;
+    sqe->fd = fd;
+    sqe->off = off;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->reserved2 = 0;
+    sqe->user_data = user_data;
+}
+
+// Следующий CQE или NULL; после обработки — ioring_cqe_seen
+static inline ioring_cqe_t *ioring_peek_cqe(ioring_t *ring) {
+    uint32_t head = ring->cq_head;
+    if (head == atomic_load32_acquire(&ring->cq_tail)) return NULL;
+    return &ring->cqes[head & ring->cq_mask];
+}
+
+static inline void ioring_cqe_seen(ioring_t *ring) {
+    atomic_store32_release(&ring->cq_head, ring->cq_head + 1);
+}
+
+#endif // IORING_H
@@ -0,0 +1,350 @@
+// tlb.c — пакеты сброса TLB, рассылка по cpumask адресного пространства,
+// ленивый TLB и поколения
+#include "tlb.h"
+#include "../../include/arch.h"
+#include "../../include/atomic.h"
+
+// Запрос на сброс от одного CPU-отправителя. Отправитель ждёт, пока
+// pending не обнулится, поэтому у каждого CPU один запрос.
+typedef struct tlb_request {
+    mm_t *mm;
+    uint64_t gen;                   // поколение mm, которое даёт этот сброс
+    uint32_t nr;
+    uint32_t full;
+    uintptr_t addrs[TLB_BATCH_MAX];
+    volatile cpumask_t pending;     // получатели, ещё не выполнившие сброс
+} __cacheline_aligned tlb_request_t;
+
+typedef struct tlb_cpu {
+    // Меняются только своим CPU, внутри tlb_enter/tlb_exit
+    mm_t *active_mm;
+    volatile uint64_t loaded_gen;   // до какого поколения active_mm TLB актуален
+    volatile uint32_t busy;         // обработчик IPI откладывает работу
+    volatile uint32_t lazy;
+
+    // Пакет
+    mm_t *batch_mm;
+    uint32_t batch_nr;
+    uint32_t batch_full;
+    uint32_t batch_tables;
+    uintptr_t batch_addrs[TLB_BATCH_MAX];
+
+    volatile cpumask_t requests __cacheline_aligned;  // отправители, ждущие нас
+    tlb_stats_t stats;
+} __cacheline_aligned tlb_cpu_t;
+
+static tlb_cpu_t tlb_cpus[SMP_MAX_CPUS];
+static tlb_request_t tlb_requests[SMP_MAX_CPUS];
+
+// CPU в ленивом режиме: рассылки пользовательских mm их пропускают
+static volatile cpumask_t lazy_mask __cacheline_aligned;
+
+mm_t kernel_mm;
+
+// ---------------------------------------------------------------
+// Архитектурные хуки
+// ---------------------------------------------------------------
+
+__attribute__((weak)) void arch_tlb_flush_local_page(uintptr_t addr) {
+    arch_invalidate_tlb_page(addr);
+}
+
+__attribute__((weak)) void arch_tlb_flush_local_all(void) {
+    arch_invalidate_tlb();
+}
+
+__attribute__((weak)) void arch_tlb_load_root(uintptr_t root) {
+#ifdef ARCH_X86_64
+    x86_64_write_cr(3, root);
+#elif defined(ARCH_ARM64)
+    asm volatile("msr ttbr0_el1, %0; isb" : : "r"(root) : "memory");
+    arm64_invalidate_tlb();
+#elif defined(ARCH_RISCV64)
+    asm volatile("csrw satp, %0; sfence.vma" : : "r"(root) : "memory");
+#endif
+}
+
+__attribute__((weak)) uintptr_t arch_tlb_read_root(void) {
+    uintptr_t root;
+#ifdef ARCH_X86_64
+    root = x86_64_read_cr(3);
+#elif defined(ARCH_ARM64)
+    asm volatile("mrs %0, ttbr0_el1" : "=r"(root));
+#elif defined(ARCH_RISCV64)
+    asm volatile("csrr %0, satp" : "=r"(root));
+#endif
+    return root;
+}
+
+// ---------------------------------------------------------------
+// Применение сбросов на своём CPU
+// ---------------------------------------------------------------
+
+// Вместо запрета прерываний: пока busy, обработчик IPI только оставляет
+// запросы в requests, их разберёт tlb_exit
+static inline void tlb_enter(tlb_cpu_t *c) {
+    c->busy = 1;
+    barrier();
+}
+
+static void tlb_process_requests(tlb_cpu_t *c, uint32_t self);
+
+static inline void tlb_exit(tlb_cpu_t *c, uint32_t self) {
+    barrier();
+    c->busy = 0;
+    barrier();
+    if (atomic_load64(&c->requests)) {
+        tlb_process_requests(c, self);
+    }
+}
+
+static void tlb_flush_full(tlb_cpu_t *c) {
+    arch_tlb_flush_local_all();
+    c->stats.full_flushes++;
+}
+
+// Выполнить сброс поколения gen. Частичный сброс годится, только если
+// TLB актуален ровно до предыдущего поколения; иначе какие-то запросы
+// были пропущены или придут позже — сбрасываем всё.
+static void tlb_apply(tlb_cpu_t *c, mm_t *mm, uint64_t gen,
+                      const uintptr_t *addrs, uint32_t nr, uint32_t full) {
+    if (mm == &kernel_mm) {
+        // Ядро загружено всегда, поколения не ведутся
+        if (full) {
+            tlb_flush_full(c);
+        } else {
+            for (uint32_t i = 0; i < nr; i++) arch_tlb_flush_local_page(addrs[i]);
+            c->stats.pages += nr;
+        }
+        return;
+    }
+    if (c->active_mm != mm) return;  // успели переключиться: записей mm нет
+
+    uint64_t local = c->loaded_gen;
+    if (local >= gen) return;        // уже покрыто полным сбросом
+
+    if (!full && gen == local + 1) {
+        for (uint32_t i = 0; i < nr; i++) arch_tlb_flush_local_page(addrs[i]);
+        c->stats.pages += nr;
+        c->loaded_gen = gen;
+    } else {
+        uint64_t now = atomic_load64(&mm->tlb_gen);
+        tlb_flush_full(c);
+        c->loaded_gen = now;
+    }
+}
+
+static void tlb_process_requests(tlb_cpu_t *c, uint32_t self) {
+    for (;;) {
+        tlb_enter(c);
+        cpumask_t senders = atomic_xchg64(&c->requests, 0);
+        while (senders) {
+            uint32_t sender = (uint32_t)__builtin_ctzll(senders);
+            senders &= senders - 1;
+
+            tlb_request_t *req = &tlb_requests[sender];
+            tlb_apply(c, req->mm, req->gen, req->addrs, req->nr, req->full);
+            // Полный барьер: сброс выполнен до того, как отправитель
+            // увидит наш бит снятым
+            atomic_and64(&req->pending, ~CPUMASK_CPU(self));
+        }
+        c->busy = 0;
+        barrier();
+        if (!atomic_load64(&c->requests)) break;
+    }
+}
+
+static void tlb_ipi_handler(void) {
+    uint32_t self = smp_cpu_id();
+    tlb_cpu_t *c = &tlb_cpus[self];
+    c->stats.ipis_received++;
+    if (c->busy) return;  // прервали сам CPU посреди tlb_*: разберёт tlb_exit
+    tlb_process_requests(c, self);
+}
+
+void tlb_init(void) {
+    kernel_mm.root = arch_tlb_read_root();
+    kernel_mm.cpumask = CPUMASK_ALL;
+    kernel_mm.tlb_gen = 0;
+    lazy_mask = 0;
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        tlb_cpu_t *c = &tlb_cpus[cpu];
+        c->active_mm = &kernel_mm;
+        c->loaded_gen = 0;
+        c->busy = 0;
+        c->lazy = 0;
+        c->batch_mm = NULL;
+        c->batch_nr = c->batch_full = c->batch_tables = 0;
+        c->requests = 0;
+        c->stats = (tlb_stats_t){0};
+    }
+    smp_register_ipi_handler(IPI_TLB_FLUSH, tlb_ipi_handler);
+}
+
+// ---------------------------------------------------------------
+// Переключение адресных пространств и ленивый режим
+// ---------------------------------------------------------------
+
+void mm_switch(mm_t *next) {
+    uint32_t self = smp_cpu_id();
+    tlb_cpu_t *c = &tlb_cpus[self];
+
+    tlb_enter(c);
+    mm_t *prev = c->active_mm;
+    if (c->lazy) {
+        c->lazy = 0;
+        atomic_and64(&lazy_mask, ~CPUMASK_CPU(self));
+    }
+
+    if (prev == next) {
+        // Возврат из ленивого режима: рассылки нас пропускали
+        uint64_t gen = atomic_load64(&next->tlb_gen);
+        if (c->loaded_gen < gen) {
+            tlb_flush_full(c);
+            c->loaded_gen = gen;
+        }
+    } else {
+        if (next != &kernel_mm) {
+            // Бит ставится до чтения поколения: рассылка, начатая после,
+            // нас уже не пропустит
+            atomic_or64(&next->cpumask, CPUMASK_CPU(self));
+        }
+        uint64_t gen = atomic_load64(&next->tlb_gen);
+        arch_tlb_load_root(next->root);  // новый корень — TLB mm чист
+        c->active_mm = next;
+        c->loaded_gen = gen;
+        if (prev != &kernel_mm) {
+            atomic_and64(&prev->cpumask, ~CPUMASK_CPU(self));
+        }
+    }
+    tlb_exit(c, self);
+}
+
+void mm_enter_lazy(void) {
+    uint32_t self = smp_cpu_id();
+    tlb_cpu_t *c = &tlb_cpus[self];
+    if (c->lazy || c->active_mm == &kernel_mm) return;
+
+    c->lazy = 1;
+    atomic_or64(&lazy_mask, CPUMASK_CPU(self));
+}
+
+// ---------------------------------------------------------------
+// Пакеты и рассылка
+// ---------------------------------------------------------------
+
+static void tlb_batch_start(tlb_cpu_t *c, mm_t *mm) {
+    if (c->batch_mm && c->batch_mm != mm) {
+        tlb_batch_flush();
+    }
+    c->batch_mm = mm;
+}
+
+void tlb_batch_add(mm_t *mm, uintptr_t addr) {
+    tlb_cpu_t *c = &tlb_cpus[smp_cpu_id()];
+    tlb_batch_start(c, mm);
+    if (c->batch_full) return;
+    if (c->batch_nr == TLB_BATCH_MAX) {
+        c->batch_full = 1;  // дешевле сбросить всё, чем по странице
+        return;
+    }
+    c->batch_addrs[c->batch_nr++] = addr & ~(uintptr_t)(ARCH_PAGE_SIZE - 1);
+}
+
+void tlb_batch_add_range(mm_t *mm, uintptr_t start, uintptr_t end) {
+    tlb_cpu_t *c = &tlb_cpus[smp_cpu_id()];
+    start &= ~(uintptr_t)(ARCH_PAGE_SIZE - 1);
+    if (end <= start) return;
+
+    tlb_batch_start(c, mm);
+    if ((end - start) / ARCH_PAGE_SIZE > TLB_BATCH_MAX - c->batch_nr) {
+        c->batch_full = 1;
+        return;
+    }
+    for (uintptr_t a = start; a < end; a += ARCH_PAGE_SIZE) {
+        tlb_batch_add(mm, a);
+    }
+}
+
+void tlb_batch_freed_tables(mm_t *mm) {
+    tlb_cpu_t *c = &tlb_cpus[smp_cpu_id()];
+    tlb_batch_start(c, mm);
+    c->batch_tables = 1;
+}
+
+void tlb_batch_flush(void) {
+    uint32_t self = smp_cpu_id();
+    tlb_cpu_t *c = &tlb_cpus[self];
+    mm_t *mm = c->batch_mm;
+    if (!mm || (!c->batch_nr && !c->batch_full && !c->batch_tables)) {
+        c->batch_mm = NULL;
+        return;
+    }
+
+    tlb_request_t *req = &tlb_requests[self];
+    req->mm = mm;
+    req->nr = c->batch_nr;
+    req->full = c->batch_full || c->batch_tables;
+    for (uint32_t i = 0; i < req->nr; i++) req->addrs[i] = c->batch_addrs[i];
+    c->batch_mm = NULL;
+    c->batch_nr = c->batch_full = 0;
+    uint32_t tables = c->batch_tables;
+    c->batch_tables = 0;
+
+    // Новое поколение — до выбора получателей: CPU, который выйдет из
+    // ленивого режима позже, увидит его и сбросит TLB сам
+    req->gen = atomic_fetch_add64(&mm->tlb_gen, 1) + 1;
+
+    tlb_enter(c);
+    tlb_apply(c, mm, req->gen, req->addrs, req->nr, req->full);
+    tlb_exit(c, self);
+
+#ifdef ARCH_ARM64
+    // TLBI Inner Shareable доходит до всех CPU без IPI
+    if (req->full) {
+        arm64_invalidate_tlb_all_cpus();
+    } else {
+        for (uint32_t i = 0; i < req->nr; i++) {
+            arm64_invalidate_tlb_page_all_cpus(req->addrs[i]);
+        }
+    }
+    c->stats.flushes++;
+    return;
+#endif
+
+    cpumask_t targets = atomic_load64(&mm->cpumask) & smp_online_mask() & ~CPUMASK_CPU(self);
+    if (mm != &kernel_mm && !tables) {
+        cpumask_t lazy = targets & atomic_load64(&lazy_mask);
+        c->stats.lazy_skipped += (uint64_t)__builtin_popcountll(lazy);
+        targets &= ~lazy;
+    }
+    if (!targets) return;
+
+    // Полный барьер: запрос заполнен до того, как получатели увидят бит
+    atomic_store64(&req->pending, targets);
+    smp_mb();
+    cpumask_t t = targets;
+    while (t) {
+        uint32_t cpu = (uint32_t)__builtin_ctzll(t);
+        t &= t - 1;
+        atomic_or64(&tlb_cpus[cpu].requests, CPUMASK_CPU(self));
+        smp_send_ipi(cpu, IPI_TLB_FLUSH);
+        c->stats.ipis_sent++;
+    }
+    c->stats.flushes++;
+
+    // Ждём подтверждений, разбирая встречные запросы: иначе два CPU,
+    // одновременно рассылающие сброс, ждали бы друг друга вечно
+    while (atomic_load64_acquire(&req->pending)) {
+        if (atomic_load64(&c->requests)) {
+            tlb_process_requests(c, self);
+        }
+        cpu_relax();
+    }
+}
+
+void tlb_get_stats(uint32_t cpu, tlb_stats_t *stats) {
+    if (cpu < SMP_MAX_CPUS) {
+        *stats = tlb_cpus[cpu].stats;
+    }
+}
@@ -0,0 +1,92 @@
+// tlb.h — адресные пространства и пакетная рассылка сброса TLB
+//
+// arch_invalidate_tlb*() сбрасывают TLB только своего CPU. Когда
+// отображение удаляется, устаревшие записи могут остаться на всех CPU,
+// где адресное пространство загружено, поэтому им рассылается запрос
+// на сброс (TLB shootdown).
+//
+// Сброс копится в пакете текущего CPU (tlb_batch_add*) и отправляется
+// одним IPI на каждый нужный CPU в tlb_batch_flush(): выгрузка
+// диапазона из N страниц стоит одной рассылки, а не N. Получатели —
+// только CPU из cpumask адресного пространства.
+//
+// Ленивый TLB: задачи ядра не переключают адресное пространство, а
+// продолжают работать на последнем загруженном (mm_enter_lazy). Такой
+// CPU не обращается к пользовательским адресам, поэтому рассылка его
+// пропускает; вернувшись к этому mm (mm_switch), он сравнивает
+// поколение TLB и при необходимости сбрасывает TLB целиком. Освобождение
+// таблиц страниц (freed_tables) доходит и до ленивых CPU: иначе
+// аппаратный обход мог бы прочитать освобождённую таблицу.
+//
+// Нельзя вызывать tlb_batch_flush() из обработчиков прерываний и с
+// запрещёнными прерываниями: получатели ждут IPI.
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../../include/smp.h"
+
+// Страниц в пакете; больше — дешевле сбросить TLB целиком
+#define TLB_BATCH_MAX 32
+
+typedef struct mm {
+    uintptr_t root;                // корень таблиц страниц (CR3/TTBR0/satp)
+    volatile cpumask_t cpumask;    // CPU, на которых mm загружен
+    volatile uint64_t tlb_gen;     // поколение: растёт с каждой рассылкой
+} mm_t;
+
+// Адресное пространство ядра: отображения общие для всех CPU, сброс
+// рассылается всем запущенным CPU
+extern mm_t kernel_mm;
+
+typedef struct tlb_stats {
+    uint64_t flushes;        // рассылок (tlb_batch_flush с целями)
+    uint64_t ipis_sent;
+    uint64_t ipis_received;
+    uint64_t pages;          // страниц сброшено по запросам
+    uint64_t full_flushes;   // полных сбросов (переполнение пакета, поколение)
+    uint64_t lazy_skipped;   // ленивых CPU, пропущенных рассылкой
+} tlb_stats_t;
+
+static inline void mm_init(mm_t *mm, uintptr_t root) {
+    mm->root = root;
+    mm->cpumask = 0;
+    mm->tlb_gen = 0;
+}
+
+// Вызывается до smp_init: kernel_mm получает текущий корень таблиц
+void tlb_init(void);
+
+// Загрузить mm на текущем CPU; выйти из ленивого режима
+void mm_switch(mm_t *next);
+
+// Задача ядра: оставить текущий mm загруженным, но не получать его рассылки
+void mm_enter_lazy(void);
+
+// Добавить в пакет страницу / диапазон [start, end). Пакет другого mm
+// сначала отправляется.
+void tlb_batch_add(mm_t *mm, uintptr_t addr);
+void tlb_batch_add_range(mm_t *mm, uintptr_t start, uintptr_t end);
+
+// Пакет освобождает таблицы страниц: сброс дойдёт и до ленивых CPU
+void tlb_batch_freed_tables(mm_t *mm);
+
+// Сбросить пакет локально и на остальных CPU mm, дождаться их
+void tlb_batch_flush(void);
+
+// Без пакета: одна страница, сразу
+static inline void tlb_flush_page(mm_t *mm, uintptr_t addr) {
+    tlb_batch_add(mm, addr);
+    tlb_batch_flush();
+}
+
+void tlb_get_stats(uint32_t cpu, tlb_stats_t *stats);
+
+// Архитектурные хуки локального сброса (по умолчанию — arch.h)
+void arch_tlb_flush_local_page(uintptr_t addr);
+void arch_tlb_flush_local_all(void);
+void arch_tlb_load_root(uintptr_t root);
+uintptr_t arch_tlb_read_root(void);
+
+#endif // TLB_H
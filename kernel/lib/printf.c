@@ -47,58 +47,80 @@ static void itoa(unsigned long value, char* str, int base) {
     }
 }
 
-// Основная функция printf
-void printf(const char* format, ...) {
-    va_list args;
-    va_start(args, format);
-
+// Форматирование в произвольный приёмник символов (VGA или COM-порт).
+// Модификатор 'l' (%ld, %lu, %lx) читает 64-битный аргумент.
+static void vformat(void (*out)(char), const char* format, va_list args) {
     const char* traverse;
     char buffer[32];
 
     for (traverse = format; *traverse != '\0'; traverse++) {
         if (*traverse != '%') {
-            put_char(*traverse);
+            out(*traverse);
             continue;
         }
         traverse++;
+        int is_long = 0;
+        if (*traverse == 'l') {
+            is_long = 1;
+            traverse++;
+        }
         // Спецификатор:
         switch (*traverse) {
             case 'c': {
                 char c = (char)va_arg(args, int);
-                put_char(c);
+                out(c);
             } break;
             case 'd': {
-                int i = va_arg(args, int);
+                long i = is_long ? va_arg(args, long) : va_arg(args, int);
+                unsigned long u = (unsigned long)i;
                 if (i < 0) {
-                    put_char('-');
-                    i = -i;
+                    out('-');
+                    u = -u;
                 }
-                itoa(i, buffer, 10);
-                for (char* p = buffer; *p; p++) put_char(*p);
+                itoa(u, buffer, 10);
+                for (char* p = buffer; *p; p++) out(*p);
             } break;
             case 'u': {
-                unsigned int u = va_arg(args, unsigned int);
+                unsigned long u = is_long ? va_arg(args, unsigned long) : va_arg(args, unsigned int);
                 itoa(u, buffer, 10);
-                for (char* p = buffer; *p; p++) put_char(*p);
+                for (char* p = buffer; *p; p++) out(*p);
             } break;
             case 'x': {
-                unsigned int x = va_arg(args, unsigned int);
+                unsigned long x = is_long ? va_arg(args, unsigned long) : va_arg(args, unsigned int);
                 itoa(x, buffer, 16);
-                for (char* p = buffer; *p; p++) put_char(*p);
+                for (char* p = buffer; *p; p++) out(*p);
             } break;
             case 's': {
                 const char* s = va_arg(args, const char*);
-                for (size_t i = 0; s[i]; i++) put_char(s[i]);
+                for (size_t i = 0; s[i]; i++) out(s[i]);
             } break;
             case '%': {
-                put_char('%');
+                out('%');
             } break;
             default: {
-                put_char('%');
-                put_char(*traverse);
+                out('%');
+                out(*traverse);
             } break;
         }
     }
+}
 
+// Основная функция printf
+void printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vformat(put_char, format, args);
+    va_end(args);
+}
+
+static void serial_put_char(char c) {
+    serial_write_char(c);
+}
+
+// printf в COM-порт: отладочные дампы, которые не должны затирать экран
+void serial_printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vformat(serial_put_char, format, args);
     va_end(args);
-}
\ No newline at end of file
+}
@@ -7,4 +7,7 @@
 
 void printf(const char* format, ...);
 
+// То же, но вывод в COM-порт (serial)
+void serial_printf(const char* format, ...);
+
 #endif // PRINTF_H
\ No newline at end of file
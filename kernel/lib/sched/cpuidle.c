@@ -0,0 +1,299 @@
+// cpuidle.c — опрос, hlt/wfi и MONITOR/MWAIT в простое; QoS задержки
+#include "cpuidle.h"
+#include "../sync/spinlock.h"
+#include "../printf.h"
+#include "../../include/arch.h"
+#include "../../include/atomic.h"
+
+#include <stddef.h>
+
+// Индексы в таблице: чем больше, тем глубже
+enum {
+    STATE_POLL,
+    STATE_HALT,
+    STATE_MWAIT_C1,
+    STATE_MWAIT_C2,
+};
+
+static cpuidle_state_t states[CPUIDLE_MAX_STATES] = {
+    [STATE_POLL]     = { "POLL",     0,  0,  0,    CPUIDLE_KIND_POLL,  1 },
+    [STATE_HALT]     = { "HALT",     2,  2,  0,    CPUIDLE_KIND_HALT,  1 },
+    [STATE_MWAIT_C1] = { "MWAIT-C1", 2,  2,  0x00, CPUIDLE_KIND_MWAIT, 0 },
+    [STATE_MWAIT_C2] = { "MWAIT-C2", 20, 80, 0x10, CPUIDLE_KIND_MWAIT, 0 },
+};
+
+typedef struct idle_cpu {
+    // Строка, за которой следит MWAIT: пишут только будящие
+    volatile uint32_t wake_seq;
+    volatile uint32_t state;        // индекс состояния или CPUIDLE_RUNNING
+    volatile uint64_t kick_stamp;   // arch_cycles() первого kick, 0 — нет
+    volatile uint64_t kicks;
+    volatile uint64_t kick_ipis;
+
+    // Дальше — только сам CPU
+    uint64_t predicted __cacheline_aligned;  // ожидаемый простой, такты
+    cpuidle_state_stats_t stats[CPUIDLE_MAX_STATES];
+} __cacheline_aligned idle_cpu_t;
+
+static idle_cpu_t idle_cpus[SMP_MAX_CPUS];
+
+static volatile uint32_t qos_limit_us = CPUIDLE_QOS_NONE;
+static cpuidle_qos_req_t *qos_head;
+
+// Запросы QoS меняются редко и не из обработчиков прерываний
+static spinlock_t qos_lock = SPINLOCK_INIT("cpuidle_qos");
+
+void cpuidle_init(void) {
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        idle_cpus[cpu].state = CPUIDLE_RUNNING;
+    }
+
+#ifdef ARCH_X86_64
+    uint32_t regs[4];
+    x86_64_cpuid(0, regs);
+    uint32_t max_leaf = regs[0];
+
+    x86_64_cpuid(1, regs);
+    if (!(regs[2] & (1u << 3))) return;   // MONITOR/MWAIT
+    states[STATE_MWAIT_C1].available = 1;
+
+    if (max_leaf >= 5) {
+        x86_64_cpuid(5, regs);
+        // ECX[0] — перечисление подсостояний; EDX[11:8] — подсостояния C2
+        if ((regs[2] & 1u) && ((regs[3] >> 8) & 0xF)) {
+            states[STATE_MWAIT_C2].available = 1;
+        }
+    }
+#endif
+}
+
+const cpuidle_state_t *cpuidle_get_state(int index) {
+    if (index < 0 || index >= CPUIDLE_MAX_STATES) return NULL;
+    return &states[index];
+}
+
+int cpuidle_select(uint64_t predicted_us) {
+    uint32_t limit = atomic_load32(&qos_limit_us);
+    int best = STATE_POLL;
+
+    // Самое мелкое из разрешённых QoS берётся всегда: опрос уже был.
+    // Глубже — только если простой окупит вход.
+    for (int i = STATE_POLL + 1; i < CPUIDLE_MAX_STATES; i++) {
+        const cpuidle_state_t *s = &states[i];
+        if (!s->available || s->exit_latency_us > limit) continue;
+        if (best == STATE_POLL || s->target_residency_us <= predicted_us) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static int idle_woken(idle_cpu_t *c, uint32_t seq, uint32_t cpu,
+                      int (*should_exit)(uint32_t)) {
+    return atomic_load32(&c->wake_seq) != seq || should_exit(cpu);
+}
+
+static void idle_account(idle_cpu_t *c, int index, uint64_t cycles) {
+    c->stats[index].entries++;
+    c->stats[index].residency += cycles;
+}
+
+static void idle_record_wakeup(idle_cpu_t *c, int index, uint64_t lat, uint64_t per_us) {
+    cpuidle_state_stats_t *s = &c->stats[index];
+    uint64_t us = lat / per_us;
+    uint32_t bucket = us ? 64 - (uint32_t)__builtin_clzll(us) : 0;
+    if (bucket >= CPUIDLE_LAT_BUCKETS) bucket = CPUIDLE_LAT_BUCKETS - 1;
+
+    s->wakeups++;
+    s->lat_sum += lat;
+    if (lat > s->lat_max) s->lat_max = lat;
+    s->lat_hist[bucket]++;
+}
+
+void cpuidle_enter(uint32_t cpu, int (*should_exit)(uint32_t cpu)) {
+    idle_cpu_t *c = &idle_cpus[cpu];
+    uint64_t per_us = arch_cycles_per_us();
+
+    // Отметка kick, пришедшего, пока CPU работал, к этому простою не относится
+    atomic_store64(&c->kick_stamp, 0);
+    uint32_t seq = atomic_load32(&c->wake_seq);
+    uint64_t start = arch_cycles();
+
+    // Опрос с разрешёнными прерываниями. Пара с cpuidle_kick():
+    // «state → перечитать wake_seq» против «wake_seq → прочитать state»
+    atomic_store32(&c->state, STATE_POLL);
+    smp_mb();
+    arch_enable_interrupts();
+
+    int index = STATE_POLL;
+    uint64_t poll_end = start + CPUIDLE_POLL_US * per_us;
+    while (!idle_woken(c, seq, cpu, should_exit)) {
+        if (arch_cycles() >= poll_end) {
+            index = cpuidle_select(c->predicted / per_us);
+            if (index != STATE_POLL) break;
+            // QoS запрещает остановку: опрашиваем дальше, изредка
+            // перепроверяя предел
+            poll_end += CPUIDLE_POLL_US * per_us;
+        }
+        cpu_relax();
+    }
+
+    uint64_t now = arch_cycles();
+    idle_account(c, STATE_POLL, now - start);
+
+    if (index != STATE_POLL) {
+        const cpuidle_state_t *s = &states[index];
+        arch_disable_interrupts();
+        atomic_store32(&c->state, (uint32_t)index);
+        smp_mb();
+        if (idle_woken(c, seq, cpu, should_exit)) {
+            arch_enable_interrupts();
+        } else if (s->kind == CPUIDLE_KIND_MWAIT) {
+#ifdef ARCH_X86_64
+            // Запись в wake_seq после monitor разбудит mwait; до него —
+            // видна в перепроверке
+            x86_64_monitor(&c->wake_seq);
+            if (atomic_load32(&c->wake_seq) == seq) {
+                x86_64_sti_mwait(s->mwait_hint);
+            } else {
+                arch_enable_interrupts();
+            }
+#endif
+        } else {
+            arch_safe_halt();
+        }
+        uint64_t end = arch_cycles();
+        idle_account(c, index, end - now);
+        now = end;
+    }
+
+    atomic_store32(&c->state, CPUIDLE_RUNNING);
+
+    uint64_t stamp = atomic_xchg64(&c->kick_stamp, 0);
+    if (stamp && now > stamp) {
+        idle_record_wakeup(c, index, now - stamp, per_us);
+    }
+
+    // Скользящее среднее с весом 1/8
+    uint64_t idle = now - start;
+    c->predicted = c->predicted ? (c->predicted * 7 + idle) / 8 : idle;
+}
+
+void cpuidle_kick(uint32_t cpu) {
+    if (cpu >= SMP_MAX_CPUS || cpu == smp_cpu_id()) return;
+    idle_cpu_t *c = &idle_cpus[cpu];
+
+    atomic_cmpxchg64(&c->kick_stamp, 0, arch_cycles());
+    atomic_fetch_add64_relaxed(&c->kicks, 1);
+
+    // Полный барьер: работа и wake_seq видны до чтения состояния
+    atomic_fetch_add32(&c->wake_seq, 1);
+    uint32_t state = atomic_load32(&c->state);
+    if (state < CPUIDLE_MAX_STATES &&
+        states[state].kind != CPUIDLE_KIND_HALT) {
+        return;   // опрашивает или ждёт в MWAIT: увидит запись сам
+    }
+    atomic_fetch_add64_relaxed(&c->kick_ipis, 1);
+    smp_send_ipi(cpu, IPI_RESCHEDULE);
+}
+
+// ---------------------------------------------------------------
+// QoS задержки
+// ---------------------------------------------------------------
+
+static void qos_recompute(void) {
+    uint32_t limit = CPUIDLE_QOS_NONE;
+    for (cpuidle_qos_req_t *r = qos_head; r; r = r->next) {
+        if (r->latency_us < limit) limit = r->latency_us;
+    }
+    atomic_store32(&qos_limit_us, limit);
+}
+
+void cpuidle_qos_add(cpuidle_qos_req_t *req, uint32_t latency_us) {
+    spin_lock(&qos_lock);
+    if (!req->active) {
+        req->latency_us = latency_us;
+        req->active = 1;
+        req->next = qos_head;
+        qos_head = req;
+        qos_recompute();
+    }
+    spin_unlock(&qos_lock);
+}
+
+void cpuidle_qos_update(cpuidle_qos_req_t *req, uint32_t latency_us) {
+    spin_lock(&qos_lock);
+    req->latency_us = latency_us;
+    if (req->active) qos_recompute();
+    spin_unlock(&qos_lock);
+}
+
+void cpuidle_qos_remove(cpuidle_qos_req_t *req) {
+    spin_lock(&qos_lock);
+    if (req->active) {
+        cpuidle_qos_req_t **link = &qos_head;
+        while (*link && *link != req) link = &(*link)->next;
+        if (*link) *link = req->next;
+        req->active = 0;
+        req->next = NULL;
+        qos_recompute();
+    }
+    spin_unlock(&qos_lock);
+}
+
+uint32_t cpuidle_qos_limit(void) {
+    return atomic_load32(&qos_limit_us);
+}
+
+void cpuidle_get_stats(uint32_t cpu, cpuidle_stats_t *stats) {
+    if (cpu >= SMP_MAX_CPUS) return;
+    idle_cpu_t *c = &idle_cpus[cpu];
+    for (int i = 0; i < CPUIDLE_MAX_STATES; i++) {
+        stats->states[i] = c->stats[i];
+    }
+    stats->kicks = atomic_load64(&c->kicks);
+    stats->kick_ipis = atomic_load64(&c->kick_ipis);
+}
+
+void cpuidle_dump(void) {
+    uint64_t per_us = arch_cycles_per_us();
+    cpumask_t online = smp_online_mask();
+    uint32_t limit = cpuidle_qos_limit();
+
+    serial_printf("=== cpuidle (us) ===\n");
+    if (limit == CPUIDLE_QOS_NONE) {
+        serial_printf("qos: none\n");
+    } else {
+        serial_printf("qos: %u\n", limit);
+    }
+    serial_printf("states:");
+    for (int i = 0; i < CPUIDLE_MAX_STATES; i++) {
+        if (states[i].available) {
+            serial_printf(" %s %u/%u", states[i].name,
+                          states[i].exit_latency_us, states[i].target_residency_us);
+        }
+    }
+    serial_printf("\n");
+
+    serial_printf("cpu/state: entries residency wakeups lat_avg lat_max\n");
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        if (!(online & CPUMASK_CPU(cpu))) continue;
+        idle_cpu_t *c = &idle_cpus[cpu];
+        serial_printf("%u: kicks %lu ipis %lu\n", cpu,
+                      atomic_load64(&c->kicks), atomic_load64(&c->kick_ipis));
+        for (int i = 0; i < CPUIDLE_MAX_STATES; i++) {
+            const cpuidle_state_stats_t *s = &c->stats[i];
+            if (!s->entries) continue;
+            serial_printf("%u/%s: %lu %lu %lu %lu %lu\n", cpu, states[i].name,
+                          s->entries, s->residency / per_us, s->wakeups,
+                          s->wakeups ? s->lat_sum / s->wakeups / per_us : 0,
+                          s->lat_max / per_us);
+            if (!s->wakeups) continue;
+            serial_printf("%u/%s hist:", cpu, states[i].name);
+            for (int b = 0; b < CPUIDLE_LAT_BUCKETS; b++) {
+                serial_printf(" %u", s->lat_hist[b]);
+            }
+            serial_printf("\n");
+        }
+    }
+}
@@ -0,0 +1,107 @@
+// cpuidle.h — состояния простоя CPU, пробуждение без IPI и QoS задержки
+//
+// Простаивающий CPU сначала короткое время опрашивает очереди (POLL):
+// если работа появится сразу, пробуждение ничего не стоит. Затем он
+// уходит в более глубокое состояние, выбранное по двум ограничениям:
+//   - задержка выхода не больше предела QoS (cpuidle_qos_*): код,
+//     которому важна реакция (ввод GUI), запрещает глубокие состояния;
+//   - ожидаемое время простоя (скользящее среднее прошлых простоев) не
+//     меньше target_residency: короткий простой в глубоком состоянии
+//     обходится дороже, чем экономит.
+//
+// На x86 с MONITOR/MWAIT CPU останавливается на строке кэша wake_seq.
+// cpuidle_kick() пишет в неё, и CPU просыпается без IPI. IPI уходит
+// только CPU, остановленному hlt/wfi или занятому чем-то ещё.
+//
+// Время от cpuidle_kick() до выхода из простоя копится по состояниям
+// (среднее, максимум, гистограмма по степеням двойки микросекунд).
+#ifndef CPUIDLE_H
+#define CPUIDLE_H
+
+#include <stdint.h>
+#include "../../include/smp.h"
+
+// Опрос перед остановкой, мкс
+#define CPUIDLE_POLL_US 10
+
+#define CPUIDLE_MAX_STATES 4
+
+// Корзины гистограммы задержки: 0 — меньше 1 мкс, k — [2^(k-1), 2^k)
+#define CPUIDLE_LAT_BUCKETS 16
+
+// Предел QoS не задан
+#define CPUIDLE_QOS_NONE 0xFFFFFFFFu
+
+enum {
+    CPUIDLE_RUNNING = 0xFF,   // не в простое: будить только IPI
+};
+
+typedef struct cpuidle_state {
+    const char *name;
+    uint32_t exit_latency_us;      // задержка выхода
+    uint32_t target_residency_us;  // минимальный выгодный простой
+    uint32_t mwait_hint;           // подсказка MWAIT (только для MWAIT)
+    uint8_t kind;                  // CPUIDLE_KIND_*
+    uint8_t available;
+} cpuidle_state_t;
+
+enum {
+    CPUIDLE_KIND_POLL,
+    CPUIDLE_KIND_HALT,
+    CPUIDLE_KIND_MWAIT,
+};
+
+typedef struct cpuidle_state_stats {
+    uint64_t entries;
+    uint64_t residency;       // тактов в состоянии
+    uint64_t wakeups;         // выходов по cpuidle_kick()
+    uint64_t lat_sum;         // задержка пробуждения, такты
+    uint64_t lat_max;
+    uint32_t lat_hist[CPUIDLE_LAT_BUCKETS];
+} cpuidle_state_stats_t;
+
+typedef struct cpuidle_stats {
+    cpuidle_state_stats_t states[CPUIDLE_MAX_STATES];
+    uint64_t kicks;           // cpuidle_kick() этому CPU
+    uint64_t kick_ipis;       // из них потребовали IPI
+} cpuidle_stats_t;
+
+// Запрос QoS: пока он добавлен, ни один CPU не уходит в состояние с
+// задержкой выхода больше latency_us. Действует минимум всех запросов.
+typedef struct cpuidle_qos_req {
+    uint32_t latency_us;
+    int active;
+    struct cpuidle_qos_req *next;
+} cpuidle_qos_req_t;
+
+// Определить доступные состояния (CPUID на x86). До smp_init.
+void cpuidle_init(void);
+
+// Простой текущего CPU. Вызывается с запрещёнными прерываниями после
+// проверки «работы нет»; возвращается с разрешёнными. should_exit(cpu)
+// опрашивается во время POLL и перед остановкой и должна покрывать все
+// причины выйти: cpuidle_kick() только будит CPU, но сам не является
+// признаком работы.
+void cpuidle_enter(uint32_t cpu, int (*should_exit)(uint32_t cpu));
+
+// Разбудить CPU после публикации работы для него. IPI — только если
+// CPU не опрашивает и не ждёт в MWAIT.
+void cpuidle_kick(uint32_t cpu);
+
+// Номер состояния для простоя ожидаемой длины predicted_us при
+// текущем пределе QoS
+int cpuidle_select(uint64_t predicted_us);
+
+const cpuidle_state_t *cpuidle_get_state(int index);
+
+void cpuidle_qos_add(cpuidle_qos_req_t *req, uint32_t latency_us);
+void cpuidle_qos_update(cpuidle_qos_req_t *req, uint32_t latency_us);
+void cpuidle_qos_remove(cpuidle_qos_req_t *req);
+uint32_t cpuidle_qos_limit(void);
+
+void cpuidle_get_stats(uint32_t cpu, cpuidle_stats_t *stats);
+
+// Состояния и задержки пробуждения по CPU в COM-порт
+void cpuidle_dump(void);
+
+#endif // CPUIDLE_H
@@ -0,0 +1,217 @@
+// deadline.c — EDF-класс: выпуск экземпляров, выбор по сроку, учёт промахов
+#include "deadline.h"
+#include "cpuidle.h"
+#include "../sync/spinlock.h"
+#include "../printf.h"
+#include "../../include/atomic.h"
+#include "../../include/smp.h"
+
+#include <stddef.h>
+
+typedef struct sched_dl {
+    task_func func;
+    void *arg;
+    sched_dl_params_t params;
+    uint32_t util;           // доля CPU, 1/SCHED_DL_UTIL_ONE
+
+    // Меняет только CPU-владелец
+    uint64_t release;        // момент следующего выпуска
+    uint64_t abs_deadline;   // срок текущего экземпляра
+    sched_dl_stats_t stats;
+} sched_dl_t;
+
+typedef struct dl_cpu {
+    volatile uint32_t active;   // занятые слоты; публикуются с полным барьером
+    volatile uint32_t dying;    // снятые работы: слот освобождает владелец
+    uint32_t util;              // суммарная доля (под dl_lock)
+    uint32_t running;           // экземпляр выполняется (вложенный запуск
+                                // из parallel_for не выбирает его снова)
+    sched_dl_t slots[SCHED_DL_MAX_PER_CPU];
+} __cacheline_aligned dl_cpu_t;
+
+static dl_cpu_t dl_cpus[SMP_MAX_CPUS];
+
+// Создание и снятие редки: одна блокировка на всё. Из обработчиков
+// прерываний они не вызываются, поэтому без irqsave.
+static spinlock_t dl_lock = SPINLOCK_INIT("sched_dl");
+
+static uint32_t dl_util(const sched_dl_params_t *p) {
+    uint64_t window = p->deadline < p->period ? p->deadline : p->period;
+    // Округляем вверх: допуск не должен занижать загрузку
+    return (uint32_t)((p->runtime * SCHED_DL_UTIL_ONE + window - 1) / window);
+}
+
+static uint32_t dl_used_slots(dl_cpu_t *c) {
+    return atomic_load32(&c->active) | atomic_load32(&c->dying);
+}
+
+int sched_dl_create(task_func func, void *arg, const sched_dl_params_t *params) {
+    if (!func || !params || params->runtime == 0 ||
+        params->runtime > params->deadline || params->deadline > params->period) {
+        return -1;
+    }
+    uint32_t util = dl_util(params);
+    if (util > SCHED_DL_MAX_UTIL) return -1;
+
+    spin_lock(&dl_lock);
+
+    // Worst fit: наименее загруженный CPU, куда работа помещается
+    cpumask_t online = smp_online_mask();
+    dl_cpu_t *best = NULL;
+    uint32_t best_cpu = 0;
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        dl_cpu_t *c = &dl_cpus[cpu];
+        if (!(online & CPUMASK_CPU(cpu))) continue;
+        if (c->util + util > SCHED_DL_MAX_UTIL) continue;
+        if (dl_used_slots(c) == (1u << SCHED_DL_MAX_PER_CPU) - 1) continue;
+        if (!best || c->util < best->util) {
+            best = c;
+            best_cpu = cpu;
+        }
+    }
+    if (!best) {
+        spin_unlock(&dl_lock);
+        return -1;
+    }
+
+    uint32_t slot = (uint32_t)__builtin_ctz(~dl_used_slots(best));
+    sched_dl_t *dl = &best->slots[slot];
+    dl->func = func;
+    dl->arg = arg;
+    dl->params = *params;
+    dl->util = util;
+    dl->release = arch_cycles();
+    dl->abs_deadline = dl->release + params->deadline;
+    dl->stats = (sched_dl_stats_t){0};
+    best->util += util;
+
+    // Полный барьер: владелец видит заполненный слот
+    atomic_or32(&best->active, 1u << slot);
+    spin_unlock(&dl_lock);
+
+    // Владелец может простаивать
+    if (best_cpu != smp_cpu_id()) {
+        cpuidle_kick(best_cpu);
+    }
+    return (int)(best_cpu * SCHED_DL_MAX_PER_CPU + slot);
+}
+
+void sched_dl_destroy(int id) {
+    if (id < 0 || id >= SMP_MAX_CPUS * SCHED_DL_MAX_PER_CPU) return;
+    dl_cpu_t *c = &dl_cpus[id / SCHED_DL_MAX_PER_CPU];
+    uint32_t bit = 1u << (id % SCHED_DL_MAX_PER_CPU);
+
+    spin_lock(&dl_lock);
+    if ((atomic_load32(&c->active) & bit) && !(atomic_load32(&c->dying) & bit)) {
+        c->util -= c->slots[id % SCHED_DL_MAX_PER_CPU].util;
+        atomic_or32(&c->dying, bit);
+    }
+    spin_unlock(&dl_lock);
+}
+
+void sched_dl_get_stats(int id, sched_dl_stats_t *stats) {
+    if (id < 0 || id >= SMP_MAX_CPUS * SCHED_DL_MAX_PER_CPU) return;
+    *stats = dl_cpus[id / SCHED_DL_MAX_PER_CPU].slots[id % SCHED_DL_MAX_PER_CPU].stats;
+}
+
+int sched_dl_pending(uint32_t cpu) {
+    dl_cpu_t *c = &dl_cpus[cpu];
+    return (atomic_load32(&c->active) & ~atomic_load32(&c->dying)) != 0;
+}
+
+uint64_t sched_dl_next_release(uint32_t cpu) {
+    dl_cpu_t *c = &dl_cpus[cpu];
+    uint32_t active = atomic_load32(&c->active) & ~atomic_load32(&c->dying);
+    uint64_t next = SCHED_DL_NO_RELEASE;
+    while (active) {
+        sched_dl_t *dl = &c->slots[__builtin_ctz(active)];
+        active &= active - 1;
+        if (dl->release < next) next = dl->release;
+    }
+    return next;
+}
+
+// Учёт завершённого экземпляра и выпуск следующего
+static void dl_account(sched_dl_t *dl, uint64_t start, uint64_t end) {
+    sched_dl_stats_t *st = &dl->stats;
+    uint64_t exec = end - start;
+
+    st->runs++;
+    if (exec > st->max_exec) st->max_exec = exec;
+    if (exec > dl->params.runtime) st->overruns++;
+    if (end > dl->abs_deadline) {
+        uint64_t late = end - dl->abs_deadline;
+        st->misses++;
+        if (late > st->max_lateness) st->max_lateness = late;
+    }
+
+    // Отстали больше чем на период — пропущенные экземпляры не
+    // выпускаем пачкой, а отбрасываем
+    uint64_t period = dl->params.period;
+    uint64_t next = dl->release + period;
+    if (next + period <= end) {
+        uint64_t skip = (end - next) / period;
+        st->dropped += skip;
+        next += skip * period;
+    }
+    dl->release = next;
+    dl->abs_deadline = next + dl->params.deadline;
+}
+
+int sched_dl_run(uint32_t cpu) {
+    dl_cpu_t *c = &dl_cpus[cpu];
+    uint32_t active = atomic_load32(&c->active);
+    if (!active || c->running) return 0;
+
+    // Снятые работы: освобождаем слоты (мы их сейчас не выполняем)
+    uint32_t dying = atomic_load32(&c->dying);
+    if (dying) {
+        atomic_and32(&c->active, ~dying);
+        atomic_and32(&c->dying, ~dying);
+        active &= ~dying;
+    }
+
+    uint64_t now = arch_cycles();
+    sched_dl_t *best = NULL;
+    while (active) {
+        sched_dl_t *dl = &c->slots[__builtin_ctz(active)];
+        active &= active - 1;
+        if (dl->release > now) continue;
+        if (!best || dl->abs_deadline < best->abs_deadline) {
+            best = dl;
+        }
+    }
+    if (!best) return 0;
+
+    uint64_t start = arch_cycles();
+    c->running = 1;
+    best->func(best->arg);
+    c->running = 0;
+    dl_account(best, start, arch_cycles());
+    return 1;
+}
+
+void sched_dl_dump(void) {
+    uint64_t per_us = arch_cycles_per_us();
+
+    serial_printf("=== deadline class (us) ===\n");
+    serial_printf("cpu/slot: runtime deadline period runs misses overruns dropped max_late max_exec\n");
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        dl_cpu_t *c = &dl_cpus[cpu];
+        uint32_t active = atomic_load32(&c->active) & ~atomic_load32(&c->dying);
+        while (active) {
+            uint32_t slot = (uint32_t)__builtin_ctz(active);
+            active &= active - 1;
+            sched_dl_t *dl = &c->slots[slot];
+            serial_printf("%u/%u: %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
+                          cpu, slot,
+                          dl->params.runtime / per_us,
+                          dl->params.deadline / per_us,
+                          dl->params.period / per_us,
+                          dl->stats.runs, dl->stats.misses, dl->stats.overruns,
+                          dl->stats.dropped,
+                          dl->stats.max_lateness / per_us,
+                          dl->stats.max_exec / per_us);
+        }
+    }
+}
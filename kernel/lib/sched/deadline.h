@@ -0,0 +1,74 @@
+// deadline.h — класс планирования по крайним срокам (EDF)
+//
+// Периодическая работа с параметрами (runtime, deadline, period):
+// каждые period тактов выпускается новый экземпляр, который должен
+// выполниться не дольше runtime и закончиться не позже deadline от
+// момента выпуска. Среди выпущенных экземпляров CPU выбирает тот, чей
+// срок ближе (Earliest Deadline First), и выполняет его раньше обычных
+// задач.
+//
+// Классы разделены по CPU (partitioned EDF): при создании работа
+// закрепляется за CPU, на котором хватает пропускной способности
+// (admission control: сумма runtime / min(deadline, period) не больше
+// SCHED_DL_MAX_UTIL). Задачи ядра не вытесняются, поэтому обычная
+// задача, занявшая CPU, задерживает экземпляр до своего окончания —
+// такие опоздания видны в статистике промахов.
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <stdint.h>
+#include "task.h"
+#include "../../include/arch.h"
+
+// Работ с крайним сроком на один CPU
+#define SCHED_DL_MAX_PER_CPU 8
+
+// Предельная загрузка CPU работами с крайним сроком, 1/1024 долей:
+// остаток гарантированно достаётся обычным задачам
+#define SCHED_DL_UTIL_ONE  1024
+#define SCHED_DL_MAX_UTIL  (SCHED_DL_UTIL_ONE * 95 / 100)
+
+// Все времена — в тактах arch_cycles()
+typedef struct sched_dl_params {
+    uint64_t runtime;   // бюджет одного экземпляра
+    uint64_t deadline;  // относительный срок от выпуска
+    uint64_t period;    // интервал между выпусками
+} sched_dl_params_t;
+
+typedef struct sched_dl_stats {
+    uint64_t runs;          // выполнено экземпляров
+    uint64_t misses;        // закончились позже срока
+    uint64_t overruns;      // выполнялись дольше runtime
+    uint64_t dropped;       // не выпущены: отстали больше чем на период
+    uint64_t max_lateness;  // наибольшее опоздание
+    uint64_t max_exec;      // наибольшее время выполнения
+} sched_dl_stats_t;
+
+// Создать работу: func(arg) вызывается раз в period. Возвращает номер
+// (>= 0) или -1, если ни на одном CPU нет свободной пропускной
+// способности или параметры неверны (нужно runtime <= deadline <= period).
+int sched_dl_create(task_func func, void *arg, const sched_dl_params_t *params);
+
+// Снять работу. Экземпляр, который выполняется прямо сейчас, доработает.
+void sched_dl_destroy(int id);
+
+void sched_dl_get_stats(int id, sched_dl_stats_t *stats);
+
+// Таблица работ и их промахов в COM-порт
+void sched_dl_dump(void);
+
+// Для планировщика: выполнить выпущенный экземпляр с ближайшим сроком
+// (1 — выполнен) и узнать, ждёт ли CPU следующего выпуска
+int sched_dl_run(uint32_t cpu);
+int sched_dl_pending(uint32_t cpu);
+
+// Ближайший выпуск на CPU (такты arch_cycles) или SCHED_DL_NO_RELEASE:
+// до него CPU может спать
+#define SCHED_DL_NO_RELEASE UINT64_MAX
+uint64_t sched_dl_next_release(uint32_t cpu);
+
+static inline uint64_t sched_dl_us(uint64_t us) {
+    return us * arch_cycles_per_us();
+}
+
+#endif // DEADLINE_H
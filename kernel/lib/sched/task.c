@@ -0,0 +1,406 @@
+// task.c — планировщик задач: per-CPU деки Чейза–Лева, кража работы,
+// входящие очереди для задач с привязкой к CPU и периодическая балансировка
+#include "task.h"
+#include "wsdeque.h"
+#include "deadline.h"
+#include "cpuidle.h"
+#include "../sync/rcu.h"
+#include "../stats/stat.h"
+#include "../../include/arch.h"
+#include "../../include/atomic.h"
+
+// Размер per-CPU кэша свободных task_t и порция обмена с общим пулом
+#define TASK_CACHE_SIZE  64
+#define TASK_CACHE_BATCH 16
+
+// Пустой индекс в общем списке свободных задач
+#define TASK_NIL 0xFFFFFFFFu
+
+typedef struct runqueue {
+    wsdeque_t deque;                       // задачи, которые можно красть
+
+    // Входящая очередь (MPSC): сюда кладут задачи с привязкой к CPU
+    // и задачи, не поместившиеся в дек. Другие CPU только добавляют.
+    task_t *volatile inbox __cacheline_aligned;
+
+    // Дальше — поля, которые трогает только сам CPU
+    task_t *pinned_head __cacheline_aligned;  // входящие в порядке FIFO
+    task_t *pinned_tail;
+    task_t *free_cache[TASK_CACHE_SIZE];
+    uint32_t free_count;
+    uint32_t rand_state;
+    uint32_t loops;
+    sched_stats_t stats;
+} __cacheline_aligned runqueue_t;
+
+static runqueue_t runqueues[SMP_MAX_CPUS];
+static task_t task_pool[SCHED_MAX_TASKS];
+
+// Общий список свободных задач: стек Трайбера по индексам. Старшие
+// 32 бита головы — счётчик версий против ABA.
+static volatile uint64_t free_head __cacheline_aligned;
+
+// Маска простаивающих CPU (меняется только при входе/выходе из простоя)
+static volatile cpumask_t idle_mask __cacheline_aligned;
+
+static void sched_ipi_reschedule(void) {
+    // Само прерывание вывело CPU из hlt/wfi — sched_loop перепроверит очереди
+}
+
+void tasking_init(void) {
+    for (uint32_t i = 0; i < SCHED_MAX_TASKS; i++) {
+        task_pool[i].next = (i + 1 < SCHED_MAX_TASKS) ? &task_pool[i + 1] : NULL;
+    }
+    free_head = 0;  // индекс 0, версия 0
+
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        runqueue_t *rq = &runqueues[cpu];
+        wsdeque_init(&rq->deque);
+        rq->inbox = NULL;
+        rq->pinned_head = rq->pinned_tail = NULL;
+        rq->free_count = 0;
+        rq->rand_state = 2463534242u + cpu * 7919u;
+        rq->loops = 0;
+    }
+    idle_mask = 0;
+
+    smp_register_ipi_handler(IPI_RESCHEDULE, sched_ipi_reschedule);
+}
+
+// ---------------------------------------------------------------
+// Пул task_t
+// ---------------------------------------------------------------
+
+static task_t *pool_pop(void) {
+    uint64_t head = atomic_load64_acquire(&free_head);
+    for (;;) {
+        uint32_t idx = (uint32_t)head;
+        if (idx == TASK_NIL) return NULL;
+
+        task_t *t = &task_pool[idx];
+        task_t *next = atomic_load_ptr(&t->next);
+        uint32_t next_idx = next ? (uint32_t)(next - task_pool) : TASK_NIL;
+        uint64_t new_head = ((head >> 32) + 1) << 32 | next_idx;
+
+        if (atomic_try_cmpxchg64(&free_head, &head, new_head)) {
+            return t;
+        }
+    }
+}
+
+static void pool_push(task_t *t) {
+    uint64_t head = atomic_load64(&free_head);
+    uint32_t idx = (uint32_t)(t - task_pool);
+    for (;;) {
+        uint32_t head_idx = (uint32_t)head;
+        atomic_store_ptr(&t->next, head_idx == TASK_NIL ? NULL : &task_pool[head_idx]);
+        uint64_t new_head = ((head >> 32) + 1) << 32 | idx;
+        if (atomic_try_cmpxchg64(&free_head, &head, new_head)) {
+            return;
+        }
+    }
+}
+
+static task_t *task_alloc(runqueue_t *rq) {
+    if (rq->free_count == 0) {
+        while (rq->free_count < TASK_CACHE_BATCH) {
+            task_t *t = pool_pop();
+            if (!t) break;
+            rq->free_cache[rq->free_count++] = t;
+        }
+        if (rq->free_count == 0) return NULL;
+    }
+    return rq->free_cache[--rq->free_count];
+}
+
+static void task_free(runqueue_t *rq, task_t *t) {
+    if (rq->free_count == TASK_CACHE_SIZE) {
+        // Задачи мигрируют между CPU, поэтому излишки возвращаются в пул
+        for (uint32_t i = 0; i < TASK_CACHE_BATCH; i++) {
+            pool_push(rq->free_cache[--rq->free_count]);
+        }
+    }
+    rq->free_cache[rq->free_count++] = t;
+}
+
+// ---------------------------------------------------------------
+// Очереди
+// ---------------------------------------------------------------
+
+static void inbox_push(runqueue_t *rq, task_t *t) {
+    task_t *head = atomic_load_ptr(&rq->inbox);
+    for (;;) {
+        t->next = head;
+        task_t *prev = atomic_cmpxchg_ptr(&rq->inbox, head, t);
+        if (prev == head) break;
+        head = prev;
+    }
+}
+
+// Забрать всю входящую очередь и дописать её к локальному FIFO
+static void inbox_drain(runqueue_t *rq) {
+    if (!atomic_load_ptr(&rq->inbox)) return;
+
+    task_t *list = atomic_xchg_ptr(&rq->inbox, NULL);
+    task_t *fifo = NULL;
+    while (list) {
+        // Стек → FIFO
+        task_t *next = list->next;
+        list->next = fifo;
+        fifo = list;
+        list = next;
+    }
+    if (!fifo) return;
+
+    task_t *tail = fifo;
+    while (tail->next) tail = tail->next;
+    if (rq->pinned_tail) {
+        rq->pinned_tail->next = fifo;
+    } else {
+        rq->pinned_head = fifo;
+    }
+    rq->pinned_tail = tail;
+}
+
+static task_t *pinned_pop(runqueue_t *rq) {
+    task_t *t = rq->pinned_head;
+    if (t) {
+        rq->pinned_head = t->next;
+        if (!rq->pinned_head) rq->pinned_tail = NULL;
+    }
+    return t;
+}
+
+// Разбудить один простаивающий CPU из маски allowed (кроме себя)
+static void kick_idle_cpu(uint32_t self, cpumask_t allowed) {
+    cpumask_t idle = atomic_load64(&idle_mask) & allowed & ~CPUMASK_CPU(self);
+    if (idle) {
+        uint32_t cpu = (uint32_t)__builtin_ctzll(idle);
+        atomic_and64(&idle_mask, ~CPUMASK_CPU(cpu));
+        cpuidle_kick(cpu);
+    }
+}
+
+int task_create_affinity(task_func func, void *arg, cpumask_t affinity) {
+    uint32_t self = smp_cpu_id();
+    runqueue_t *rq = &runqueues[self];
+
+    affinity &= CPUMASK_ALL;
+    if (!func || !affinity) return -1;
+
+    task_t *t = task_alloc(rq);
+    if (!t) return -1;
+    t->func = func;
+    t->arg = arg;
+    t->affinity = affinity;
+
+    if (affinity == CPUMASK_ALL && wsdeque_push(&rq->deque, t) == 0) {
+        // Порядок «опубликовать задачу → прочитать idle_mask» парный
+        // с «отметиться в idle_mask → перепроверить очереди» в sched_loop
+        smp_mb();
+        kick_idle_cpu(self, CPUMASK_ALL);
+        return 0;
+    }
+
+    // Привязанная задача (или дек полон): во входящую очередь CPU из маски
+    uint32_t target = (affinity & CPUMASK_CPU(self)) ? self : (uint32_t)__builtin_ctzll(affinity);
+    inbox_push(&runqueues[target], t);
+    smp_mb();
+    if (target != self && (atomic_load64(&idle_mask) & CPUMASK_CPU(target))) {
+        atomic_and64(&idle_mask, ~CPUMASK_CPU(target));
+        cpuidle_kick(target);
+    }
+    return 0;
+}
+
+int task_create(task_func func, void *arg) {
+    return task_create_affinity(func, arg, CPUMASK_ALL);
+}
+
+static uint32_t next_random(runqueue_t *rq) {
+    // xorshift32: дешёвый выбор жертвы без общих данных
+    uint32_t x = rq->rand_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rq->rand_state = x;
+    return x;
+}
+
+// Попытаться украсть задачу у других CPU, начиная со случайной жертвы
+static task_t *steal_task(uint32_t self, runqueue_t *rq) {
+    uint32_t ncpus = SMP_MAX_CPUS;
+    cpumask_t online = smp_online_mask();
+    uint32_t start = next_random(rq) % ncpus;
+
+    for (uint32_t i = 0; i < ncpus; i++) {
+        uint32_t victim = (start + i) % ncpus;
+        if (victim == self || !(online & CPUMASK_CPU(victim))) continue;
+
+        rq->stats.steal_attempts++;
+        void *item;
+        do {
+            item = wsdeque_steal(&runqueues[victim].deque);
+        } while (item == WSDEQUE_ABORT);
+
+        if (item) {
+            rq->stats.stolen++;
+            return (task_t *)item;
+        }
+    }
+    return NULL;
+}
+
+// quiescent: после задачи отметить состояние покоя RCU. Вложенный запуск
+// (задача ждёт parallel_for) — не состояние покоя: внешний код может
+// быть внутри секции читателя.
+static int task_run(int quiescent) {
+    uint32_t self = smp_cpu_id();
+    runqueue_t *rq = &runqueues[self];
+
+    if (++rq->loops % SCHED_BALANCE_INTERVAL == 0) {
+        sched_balance();
+    }
+
+    // Выпущенные экземпляры класса крайних сроков — раньше обычных задач
+    if (sched_dl_run(self)) {
+        rq->stats.executed++;
+        stat_inc(STAT_TASK_SWITCHES);
+        if (quiescent) {
+            rcu_quiescent_state();
+        }
+        return 1;
+    }
+
+    inbox_drain(rq);
+    task_t *t = pinned_pop(rq);
+    if (!t) t = (task_t *)wsdeque_pop(&rq->deque);
+    if (!t) t = steal_task(self, rq);
+    if (!t) return 0;
+
+    // Копируем аргументы и освобождаем task_t до вызова: задача может
+    // сразу порождать новые, и горячая структура вернётся к ним
+    task_func func = t->func;
+    void *arg = t->arg;
+    task_free(rq, t);
+
+    func(arg);
+    rq->stats.executed++;
+    stat_inc(STAT_TASK_SWITCHES);
+
+    // Между задачами CPU не держит указателей RCU
+    if (quiescent) {
+        rcu_quiescent_state();
+    }
+    return 1;
+}
+
+int task_run_once(void) {
+    return task_run(1);
+}
+
+int task_run_nested(void) {
+    return task_run(0);
+}
+
+void sched_balance(void) {
+    uint32_t self = smp_cpu_id();
+    runqueue_t *rq = &runqueues[self];
+    cpumask_t idle = atomic_load64(&idle_mask) & ~CPUMASK_CPU(self);
+    if (!idle) return;
+
+    // Перегружен дек: будим простаивающие CPU, они украдут задачи сами
+    int64_t excess = wsdeque_size(&rq->deque) - SCHED_BALANCE_THRESHOLD;
+    while (excess > 0 && idle) {
+        kick_idle_cpu(self, CPUMASK_ALL);
+        idle = atomic_load64(&idle_mask) & ~CPUMASK_CPU(self);
+        excess -= SCHED_BALANCE_THRESHOLD;
+    }
+
+    // Привязанные задачи не крадутся: если задаче разрешён другой,
+    // простаивающий CPU, передаём её туда явно
+    inbox_drain(rq);
+    task_t *prev = NULL;
+    task_t *t = rq->pinned_head;
+    while (t && idle) {
+        task_t *next = t->next;
+        cpumask_t target_mask = t->affinity & idle;
+        if (target_mask) {
+            uint32_t target = (uint32_t)__builtin_ctzll(target_mask);
+            if (prev) prev->next = next; else rq->pinned_head = next;
+            if (rq->pinned_tail == t) rq->pinned_tail = prev;
+            inbox_push(&runqueues[target], t);
+            atomic_and64(&idle_mask, ~CPUMASK_CPU(target));
+            cpuidle_kick(target);
+            idle &= ~CPUMASK_CPU(target);
+            rq->stats.migrated++;
+        } else {
+            prev = t;
+        }
+        t = next;
+    }
+}
+
+static int has_local_work(runqueue_t *rq) {
+    return rq->pinned_head || atomic_load_ptr(&rq->inbox) ||
+           wsdeque_size(&rq->deque) > 0;
+}
+
+static int has_stealable_work(uint32_t self) {
+    cpumask_t online = smp_online_mask();
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        if (cpu != self && (online & CPUMASK_CPU(cpu)) &&
+            wsdeque_size(&runqueues[cpu].deque) > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Выйти из простоя: появилась работа, нас разбудили через idle_mask
+// или выпущен экземпляр работы с крайним сроком
+static int idle_should_exit(uint32_t cpu) {
+    return !(atomic_load64(&idle_mask) & CPUMASK_CPU(cpu)) ||
+           has_local_work(&runqueues[cpu]) || has_stealable_work(cpu) ||
+           sched_dl_next_release(cpu) <= arch_cycles();
+}
+
+void sched_loop(void) {
+    uint32_t self = smp_cpu_id();
+    runqueue_t *rq = &runqueues[self];
+
+    for (;;) {
+        if (task_run_once()) continue;
+
+        // Работы нет: отмечаемся простаивающими и перепроверяем очереди,
+        // иначе можно пропустить задачу, поставленную между проверками
+        arch_disable_interrupts();
+        atomic_or64(&idle_mask, CPUMASK_CPU(self));
+        if (has_local_work(rq) || has_stealable_work(self)) {
+            atomic_and64(&idle_mask, ~CPUMASK_CPU(self));
+            arch_enable_interrupts();
+            continue;
+        }
+        // Ждём выпуска следующего экземпляра: таймер разбудит CPU к
+        // сроку. Без таймера остановиться нельзя — опрашиваем
+        uint64_t release = sched_dl_next_release(self);
+        if (release != SCHED_DL_NO_RELEASE && arch_timer_wake_at(release) != 0) {
+            atomic_and64(&idle_mask, ~CPUMASK_CPU(self));
+            arch_enable_interrupts();
+            rcu_quiescent_state();
+            cpu_relax();
+            continue;
+        }
+        rq->stats.idle_halts++;
+        rcu_idle_enter();
+        cpuidle_enter(self, idle_should_exit);
+        rcu_idle_exit();
+        atomic_and64(&idle_mask, ~CPUMASK_CPU(self));
+    }
+}
+
+void sched_get_stats(uint32_t cpu, sched_stats_t *stats) {
+    if (cpu < SMP_MAX_CPUS) {
+        *stats = runqueues[cpu].stats;
+    }
+}
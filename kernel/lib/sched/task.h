@@ -0,0 +1,64 @@
+// task.h — задачи ядра и планировщик с per-CPU очередями и work stealing
+#ifndef TASK_H
+#define TASK_H
+
+#include <stdint.h>
+#include "../../include/smp.h"
+
+// Общее число структур task_t (задачи в очередях + выполняющиеся)
+#define SCHED_MAX_TASKS 4096
+
+// Раз в столько итераций планировщика CPU выполняет балансировку
+#define SCHED_BALANCE_INTERVAL 64
+
+// Сколько задач в локальном деке считается перегрузкой
+#define SCHED_BALANCE_THRESHOLD 4
+
+typedef void (*task_func)(void *arg);
+
+typedef struct task {
+    task_func func;
+    void *arg;
+    cpumask_t affinity;   // на каких CPU задаче разрешено выполняться
+    struct task *next;    // связь во входящей очереди / кэше свободных
+} task_t;
+
+// Статистика одного CPU
+typedef struct sched_stats {
+    uint64_t executed;       // выполнено задач
+    uint64_t stolen;         // из них украдено у других CPU
+    uint64_t steal_attempts; // попыток кражи
+    uint64_t migrated;       // задач передано на простаивающие CPU
+    uint64_t idle_halts;     // уходов в простой
+} sched_stats_t;
+
+// Инициализация (до smp_init: вторичные CPU сразу входят в sched_loop)
+void tasking_init(void);
+
+// Поставить задачу в очередь текущего CPU; её может украсть любой CPU.
+// 0 — успех, -1 — закончились свободные task_t.
+int task_create(task_func func, void *arg);
+
+// То же с маской допустимых CPU. Задачи с ограниченной маской не
+// попадают в дек для кражи, а ставятся во входящую очередь CPU из маски.
+int task_create_affinity(task_func func, void *arg, cpumask_t affinity);
+
+// Выполнить одну задачу: свою, из входящей очереди или украденную.
+// Возвращает 1, если задача была выполнена.
+int task_run_once(void);
+
+// То же для кода, который ждёт других задач посреди своей работы
+// (parallel_for): не отмечает состояние покоя RCU
+int task_run_nested(void);
+
+// Периодическая балансировка: будит простаивающие CPU и передаёт им
+// задачи, если локальная очередь перегружена
+void sched_balance(void);
+
+// Основной цикл планировщика CPU: выполняет задачи, при их отсутствии
+// останавливает CPU до прерывания. Не возвращается.
+void sched_loop(void) __attribute__((noreturn));
+
+void sched_get_stats(uint32_t cpu, sched_stats_t *stats);
+
+#endif // TASK_H
@@ -0,0 +1,89 @@
+// workpool.c — parallel_for: помощники-задачи разбирают порции общего задания
+#include "workpool.h"
+#include "task.h"
+#include "../../include/atomic.h"
+
+#include <stddef.h>
+
+typedef struct parallel_job {
+    parallel_fn fn;
+    void *arg;
+    uint64_t begin;
+    uint64_t end;
+    uint64_t grain;
+    uint64_t nchunks;
+    volatile uint64_t next_chunk __cacheline_aligned;  // общий счётчик порций
+    volatile uint32_t helpers_left __cacheline_aligned; // помощники в работе
+} parallel_job_t;
+
+// Разбирать порции, пока они есть
+static void parallel_run_chunks(parallel_job_t *job) {
+    for (;;) {
+        uint64_t chunk = atomic_fetch_add64_relaxed(&job->next_chunk, 1);
+        if (chunk >= job->nchunks) break;
+
+        uint64_t lo = job->begin + chunk * job->grain;
+        uint64_t hi = lo + job->grain;
+        if (hi > job->end) hi = job->end;
+        job->fn(lo, hi, job->arg);
+    }
+}
+
+static void parallel_helper(void *arg) {
+    parallel_job_t *job = (parallel_job_t *)arg;
+    parallel_run_chunks(job);
+    // release: результаты порций видны вызывающему до снятия счётчика
+    atomic_fetch_sub32(&job->helpers_left, 1);
+}
+
+void parallel_for(uint64_t begin, uint64_t end, uint64_t grain,
+                  parallel_fn fn, void *arg) {
+    if (end <= begin || !fn) return;
+
+    uint64_t range = end - begin;
+    uint32_t ncpus = smp_num_cpus();
+    if (ncpus == 0) ncpus = 1;
+    if (grain == 0) {
+        grain = range / ((uint64_t)ncpus * PARALLEL_CHUNKS_PER_CPU);
+        if (grain == 0) grain = 1;
+    }
+
+    uint64_t nchunks = (range + grain - 1) / grain;
+    if (nchunks == 1 || ncpus == 1) {
+        fn(begin, end, arg);
+        return;
+    }
+
+    // Задание живёт на стеке: выходим только когда все помощники закончили
+    parallel_job_t job = {
+        .fn = fn,
+        .arg = arg,
+        .begin = begin,
+        .end = end,
+        .grain = grain,
+        .nchunks = nchunks,
+        .next_chunk = 0,
+        .helpers_left = 0,
+    };
+
+    uint64_t want = nchunks - 1;
+    if (want > ncpus - 1) want = ncpus - 1;
+    for (uint64_t i = 0; i < want; i++) {
+        atomic_fetch_add32(&job.helpers_left, 1);
+        if (task_create(parallel_helper, &job) != 0) {
+            // Нет свободных task_t — справимся меньшим числом CPU
+            atomic_fetch_sub32(&job.helpers_left, 1);
+            break;
+        }
+    }
+
+    parallel_run_chunks(&job);
+
+    // Помощник мог ещё не начаться (лежит в нашем деке) — выполняем
+    // задачи сами, пока ждём, чтобы не зависнуть на одном CPU
+    while (atomic_load32_acquire(&job.helpers_left)) {
+        if (!task_run_nested()) {
+            cpu_relax();
+        }
+    }
+}
@@ -0,0 +1,25 @@
+// workpool.h — параллельные циклы поверх планировщика задач
+//
+// parallel_for делит диапазон [begin, end) на порции по grain итераций
+// и раздаёт их CPU. Порции разбираются динамически через один атомарный
+// счётчик, поэтому неравномерная работа балансируется сама. Вызывающий
+// CPU тоже выполняет порции и возвращается, когда готовы все.
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <stdint.h>
+
+// Обработать итерации [begin, end)
+typedef void (*parallel_fn)(uint64_t begin, uint64_t end, void *arg);
+
+// Порция по умолчанию: столько порций на CPU (grain == 0)
+#define PARALLEL_CHUNKS_PER_CPU 4
+
+// Выполнить fn над [begin, end) на всех CPU. Порядок порций не
+// определён, fn может выполняться одновременно на разных CPU.
+// Малые диапазоны (одна порция) и один CPU — без диспетчеризации.
+// Пока ждёт помощников, вызывающий CPU выполняет другие задачи.
+void parallel_for(uint64_t begin, uint64_t end, uint64_t grain,
+                  parallel_fn fn, void *arg);
+
+#endif // WORKPOOL_H
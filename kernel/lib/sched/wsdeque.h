@@ -0,0 +1,99 @@
+// wsdeque.h — дек Чейза–Лева (Chase-Lev) для work stealing
+//
+// Владелец (свой CPU) кладёт и забирает задачи с «дна» (LIFO — горячий
+// кэш), остальные CPU крадут с «вершины» (FIFO — самые старые задачи).
+// Владелец синхронизируется с ворами только когда в деке остаётся одна
+// задача. Порядок памяти — по Lê et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models" (PPoPP'13).
+#ifndef WSDEQUE_H
+#define WSDEQUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../../include/smp.h"
+#include "../../include/atomic.h"
+
+// Ёмкость дека (степень двойки). При переполнении задача уходит
+// в очередь входящих CPU (см. task.c).
+#define WSDEQUE_SIZE 1024
+#define WSDEQUE_MASK (WSDEQUE_SIZE - 1)
+
+// Результат кражи, отличный от «пусто»: проиграли гонку другому вору
+#define WSDEQUE_ABORT ((void *)1)
+
+// Индексы хранятся как uint64_t (для atomic_*64) и сравниваются
+// со знаком: bottom может временно стать на единицу меньше top
+typedef struct wsdeque {
+    volatile uint64_t top __cacheline_aligned;     // пишут воры (CAS)
+    volatile uint64_t bottom __cacheline_aligned;  // пишет только владелец
+    void *volatile buf[WSDEQUE_SIZE] __cacheline_aligned;
+} wsdeque_t;
+
+static inline void wsdeque_init(wsdeque_t *q) {
+    q->top = 0;
+    q->bottom = 0;
+}
+
+// Приблизительный размер (точен только для владельца)
+static inline int64_t wsdeque_size(wsdeque_t *q) {
+    int64_t b = (int64_t)atomic_load64(&q->bottom);
+    int64_t t = (int64_t)atomic_load64(&q->top);
+    return b > t ? b - t : 0;
+}
+
+// Положить элемент (только владелец). 0 — успех, -1 — дек полон.
+static inline int wsdeque_push(wsdeque_t *q, void *item) {
+    int64_t b = (int64_t)atomic_load64(&q->bottom);
+    int64_t t = (int64_t)atomic_load64_acquire(&q->top);
+    if (b - t >= WSDEQUE_SIZE) {
+        return -1;
+    }
+    atomic_store_ptr(&q->buf[b & WSDEQUE_MASK], item);
+    // release: вор, увидевший новый bottom, увидит и элемент
+    atomic_store64_release(&q->bottom, (uint64_t)(b + 1));
+    return 0;
+}
+
+// Забрать элемент с дна (только владелец). NULL — дек пуст.
+static inline void *wsdeque_pop(wsdeque_t *q) {
+    int64_t b = (int64_t)atomic_load64(&q->bottom) - 1;
+    atomic_store64(&q->bottom, (uint64_t)b);
+    smp_mb();  // store bottom → load top: единственное место, где нужен полный барьер
+    int64_t t = (int64_t)atomic_load64(&q->top);
+
+    if (t > b) {
+        // Дек был пуст
+        atomic_store64(&q->bottom, (uint64_t)(b + 1));
+        return NULL;
+    }
+
+    void *item = atomic_load_ptr(&q->buf[b & WSDEQUE_MASK]);
+    if (t == b) {
+        // Последний элемент: соревнуемся с ворами за top
+        if (atomic_cmpxchg64(&q->top, (uint64_t)t, (uint64_t)(t + 1)) != (uint64_t)t) {
+            item = NULL;
+        }
+        atomic_store64(&q->bottom, (uint64_t)(b + 1));
+    }
+    return item;
+}
+
+// Украсть элемент с вершины (любой CPU).
+// NULL — пусто, WSDEQUE_ABORT — проиграли гонку, можно повторить.
+static inline void *wsdeque_steal(wsdeque_t *q) {
+    int64_t t = (int64_t)atomic_load64_acquire(&q->top);
+    smp_mb();  // парный барьеру в wsdeque_pop
+    int64_t b = (int64_t)atomic_load64_acquire(&q->bottom);
+
+    if (t >= b) {
+        return NULL;
+    }
+
+    void *item = atomic_load_ptr(&q->buf[t & WSDEQUE_MASK]);
+    if (atomic_cmpxchg64(&q->top, (uint64_t)t, (uint64_t)(t + 1)) != (uint64_t)t) {
+        return WSDEQUE_ABORT;
+    }
+    return item;
+}
+
+#endif // WSDEQUE_H
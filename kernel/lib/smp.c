@@ -0,0 +1,99 @@
+// smp.c — общая часть SMP: таблица CPU и диспетчеризация IPI
+#include "../include/smp.h"
+#include "../include/arch.h"
+#include "../include/atomic.h"
+#include "sched/task.h"
+
+cpu_info_t smp_cpus[SMP_MAX_CPUS];
+
+// Маска CPU, которые отметились как запущенные
+static volatile cpumask_t online_mask;
+
+static ipi_handler_t ipi_handlers[IPI_MAX];
+
+// Отметить CPU как запущенный (вызывается самим CPU)
+static void smp_mark_online(cpu_info_t *cpu) {
+    atomic_store32_release(&cpu->online, 1);
+    atomic_or64(&online_mask, CPUMASK_CPU(cpu->id));
+}
+
+void smp_init(void) {
+    cpu_info_t *boot = smp_this_cpu();
+    smp_mark_online(boot);
+    arch_smp_boot_secondaries();
+}
+
+// Однопроцессорные реализации по умолчанию. Архитектуры с поддержкой
+// SMP (RISC-V) переопределяют их в arch/<arch>/smp.c.
+__attribute__((weak)) uint32_t smp_cpu_id(void) {
+    return 0;
+}
+
+__attribute__((weak)) cpu_info_t *smp_this_cpu(void) {
+    return &smp_cpus[smp_cpu_id()];
+}
+
+__attribute__((weak)) void arch_smp_boot_secondaries(void) {
+}
+
+__attribute__((weak)) void arch_smp_send_ipi(uint32_t hwid) {
+    (void)hwid;
+}
+
+uint32_t smp_num_cpus(void) {
+    return (uint32_t)__builtin_popcountll(smp_online_mask());
+}
+
+cpumask_t smp_online_mask(void) {
+    return atomic_load64_acquire(&online_mask);
+}
+
+void smp_register_ipi_handler(uint32_t reason, ipi_handler_t handler) {
+    if (reason < IPI_MAX) {
+        ipi_handlers[reason] = handler;
+    }
+}
+
+void smp_send_ipi(uint32_t cpu, uint32_t reason) {
+    if (cpu >= SMP_MAX_CPUS || !smp_cpus[cpu].online) return;
+
+    // Причина публикуется до самого прерывания: получатель читает маску
+    // в обработчике и не может увидеть IPI без причины
+    atomic_or32(&smp_cpus[cpu].ipi_pending, 1u << reason);
+    arch_smp_send_ipi(smp_cpus[cpu].hwid);
+}
+
+void smp_send_ipi_mask(cpumask_t mask, uint32_t reason) {
+    mask &= smp_online_mask();
+    while (mask) {
+        uint32_t cpu = (uint32_t)__builtin_ctzll(mask);
+        mask &= mask - 1;
+        smp_send_ipi(cpu, reason);
+    }
+}
+
+void smp_handle_ipi(void) {
+    cpu_info_t *cpu = smp_this_cpu();
+    uint32_t pending = atomic_xchg32(&cpu->ipi_pending, 0);
+
+    while (pending) {
+        uint32_t reason = (uint32_t)__builtin_ctz(pending);
+        pending &= pending - 1;
+
+        if (reason == IPI_STOP) {
+            arch_disable_interrupts();
+            for (;;) {
+                arch_halt();
+            }
+        }
+        if (ipi_handlers[reason]) {
+            ipi_handlers[reason]();
+        }
+    }
+}
+
+void smp_secondary_idle(void) {
+    smp_mark_online(smp_this_cpu());
+    arch_enable_interrupts();
+    sched_loop();  // выполняем и крадём задачи, в простое ждём IPI
+}
@@ -0,0 +1,78 @@
+// stat.c — суммирование и экспорт счётчиков по CPU
+#include "stat.h"
+#include "../printf.h"
+
+#include <stddef.h>
+
+stat_cpu_t stat_cpus[SMP_MAX_CPUS];
+
+static const char *const stat_names[STAT_NR_ITEMS] = {
+    [STAT_TASK_SWITCHES] = "task_switches",
+    [STAT_PAGE_FAULTS]   = "page_faults",
+    [STAT_ALLOCS]        = "allocs",
+    [STAT_ALLOC_BYTES]   = "alloc_bytes",
+    [STAT_DRAW_BYTES]    = "draw_bytes",
+};
+
+const char *stat_item_name(stat_item_t item) {
+    return (unsigned)item < STAT_NR_ITEMS ? stat_names[item] : NULL;
+}
+
+uint64_t stat_read_cpu(uint32_t cpu, stat_item_t item) {
+    if (cpu >= SMP_MAX_CPUS || (unsigned)item >= STAT_NR_ITEMS) return 0;
+    return atomic_load64(&stat_cpus[cpu].items[item]);
+}
+
+uint64_t stat_read(stat_item_t item) {
+    uint64_t sum = 0;
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        sum += stat_read_cpu(cpu, item);
+    }
+    return sum;
+}
+
+uint64_t stat_irq_read(uint32_t vector) {
+    uint64_t sum = 0;
+    if (vector >= STAT_NR_VECTORS) return 0;
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        sum += atomic_load64(&stat_cpus[cpu].irqs[vector]);
+    }
+    return sum;
+}
+
+static void stat_dump_row(const uint64_t *vals, uint32_t ncpus) {
+    uint64_t sum = 0;
+    for (uint32_t cpu = 0; cpu < ncpus; cpu++) {
+        sum += vals[cpu];
+    }
+    serial_printf(" %lu", sum);
+    for (uint32_t cpu = 0; cpu < ncpus; cpu++) {
+        serial_printf(" %lu", vals[cpu]);
+    }
+    serial_printf("\n");
+}
+
+void stat_dump(void) {
+    // Столбцы — до старшего запущенного CPU
+    cpumask_t online = smp_online_mask();
+    uint32_t ncpus = online ? 64 - (uint32_t)__builtin_clzll(online) : 1;
+    uint64_t vals[SMP_MAX_CPUS];
+
+    serial_printf("=== per-cpu counters ===\n");
+    serial_printf("name: total cpu0..cpu%u\n", ncpus - 1);
+    for (int i = 0; i < STAT_NR_ITEMS; i++) {
+        for (uint32_t cpu = 0; cpu < ncpus; cpu++) {
+            vals[cpu] = atomic_load64(&stat_cpus[cpu].items[i]);
+        }
+        serial_printf("%s:", stat_names[i]);
+        stat_dump_row(vals, ncpus);
+    }
+    for (uint32_t v = 0; v < STAT_NR_VECTORS; v++) {
+        if (!stat_irq_read(v)) continue;
+        for (uint32_t cpu = 0; cpu < ncpus; cpu++) {
+            vals[cpu] = atomic_load64(&stat_cpus[cpu].irqs[v]);
+        }
+        serial_printf("irq%u:", v);
+        stat_dump_row(vals, ncpus);
+    }
+}
@@ -0,0 +1,73 @@
+// stat.h — постоянно включённые счётчики событий по CPU
+//
+// У каждого CPU свой блок счётчиков на отдельных строках кэша: событие
+// увеличивает счётчик своего CPU одной командой чтения-изменения-записи
+// без lock (x86 — add в память, ARM64/RISC-V — relaxed-атомик), поэтому
+// строки не перебрасываются между CPU, а обновление из обработчика
+// прерывания посреди обновления того же счётчика задачей не теряется.
+// Чтение суммирует блоки всех CPU и может отставать от одновременных
+// обновлений на несколько событий.
+//
+// Задачи ядра не вытесняются и не мигрируют посреди выполнения, так что
+// smp_cpu_id() остаётся верным до конца обновления.
+#ifndef STAT_H
+#define STAT_H
+
+#include <stdint.h>
+#include "../../include/smp.h"
+#include "../../include/atomic.h"
+
+typedef enum stat_item {
+    STAT_TASK_SWITCHES,   // выполнено задач планировщика
+    STAT_PAGE_FAULTS,
+    STAT_ALLOCS,          // вызовов kmalloc
+    STAT_ALLOC_BYTES,
+    STAT_DRAW_BYTES,      // байт, записанных в кадровый буфер
+    STAT_NR_ITEMS
+} stat_item_t;
+
+// Векторов прерываний (x86: исключения 0-31, IRQ 32-47, IPI)
+#define STAT_NR_VECTORS 256
+
+typedef struct stat_cpu {
+    volatile uint64_t items[STAT_NR_ITEMS];
+    volatile uint64_t irqs[STAT_NR_VECTORS];
+} __cacheline_aligned stat_cpu_t;
+
+extern stat_cpu_t stat_cpus[SMP_MAX_CPUS];
+
+static inline void stat_counter_add(volatile uint64_t *p, uint64_t v) {
+#ifdef ARCH_X86_64
+    // Одна команда: прерывание не разорвёт её, lock не нужен — строку
+    // пишет только этот CPU
+    asm volatile("addq %1, %0" : "+m"(*p) : "er"(v));
+#else
+    atomic_fetch_add64_relaxed(p, v);
+#endif
+}
+
+static inline void stat_add(stat_item_t item, uint64_t v) {
+    stat_counter_add(&stat_cpus[smp_cpu_id()].items[item], v);
+}
+
+static inline void stat_inc(stat_item_t item) {
+    stat_add(item, 1);
+}
+
+// Вызывается из обработчика прерывания с номером вектора
+static inline void stat_irq(uint32_t vector) {
+    stat_counter_add(&stat_cpus[smp_cpu_id()].irqs[vector & (STAT_NR_VECTORS - 1)], 1);
+}
+
+// Сумма по всем CPU / значение одного CPU
+uint64_t stat_read(stat_item_t item);
+uint64_t stat_read_cpu(uint32_t cpu, stat_item_t item);
+uint64_t stat_irq_read(uint32_t vector);
+
+const char *stat_item_name(stat_item_t item);
+
+// Экспорт в COM-порт: по строке «имя всего cpu0 cpu1 ...» на счётчик
+// и на каждый вектор, на котором были прерывания
+void stat_dump(void);
+
+#endif // STAT_H
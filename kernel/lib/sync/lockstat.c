@@ -0,0 +1,80 @@
+// lockstat.c — сбор и вывод статистики блокировок
+#include "lockstat.h"
+
+#ifdef ENABLE_LOCK_STATS
+
+#include "../../include/arch.h"
+#include "../../include/atomic.h"
+#include "../printf.h"
+
+// Все блокировки, захваченные хотя бы раз (добавляются без блокировки)
+static lock_stats_t *volatile lockstat_list;
+
+static void lockstat_register(lock_stats_t *s) {
+    if (atomic_load32(&s->registered) || atomic_xchg32(&s->registered, 1)) {
+        return;
+    }
+    lock_stats_t *head = atomic_load_ptr(&lockstat_list);
+    for (;;) {
+        s->next = head;
+        lock_stats_t *prev = atomic_cmpxchg_ptr(&lockstat_list, head, s);
+        if (prev == head) break;
+        head = prev;
+    }
+}
+
+void lockstat_acquired(lock_stats_t *s, uint64_t wait_start, int shared) {
+    uint64_t now = arch_cycles();
+    lockstat_register(s);
+
+    if (shared) {
+        atomic_fetch_add64_relaxed(&s->acquisitions, 1);
+        if (wait_start) {
+            atomic_fetch_add64_relaxed(&s->contended, 1);
+            atomic_fetch_add64_relaxed(&s->wait_cycles, now - wait_start);
+        }
+        return;
+    }
+
+    // Эксклюзивный захват: поля меняет только владелец
+    s->acquisitions++;
+    if (wait_start) {
+        s->contended++;
+        s->wait_cycles += now - wait_start;
+    }
+    s->acquired_at = now;
+}
+
+void lockstat_released(lock_stats_t *s) {
+    uint64_t held = arch_cycles() - s->acquired_at;
+    s->hold_cycles += held;
+    if (held > s->max_hold_cycles) {
+        s->max_hold_cycles = held;
+    }
+}
+
+void lockstat_dump(void) {
+    serial_printf("=== lock statistics (cycles) ===\n");
+    serial_printf("name: acquisitions contended avg_wait avg_hold max_hold\n");
+    for (lock_stats_t *s = atomic_load_ptr_acquire(&lockstat_list); s; s = s->next) {
+        uint64_t acq = s->acquisitions;
+        serial_printf("%s: %lu %lu %lu %lu %lu\n",
+                      s->name ? s->name : "?",
+                      acq, s->contended,
+                      s->contended ? s->wait_cycles / s->contended : 0UL,
+                      acq ? s->hold_cycles / acq : 0UL,
+                      s->max_hold_cycles);
+    }
+}
+
+void lockstat_reset(void) {
+    for (lock_stats_t *s = atomic_load_ptr_acquire(&lockstat_list); s; s = s->next) {
+        s->acquisitions = 0;
+        s->contended = 0;
+        s->wait_cycles = 0;
+        s->hold_cycles = 0;
+        s->max_hold_cycles = 0;
+    }
+}
+
+#endif // ENABLE_LOCK_STATS
@@ -0,0 +1,53 @@
+// lockstat.h — статистика блокировок: число захватов, конкуренция,
+// время ожидания и удержания (в тактах arch_cycles()).
+//
+// Включается сборкой с LOCK_STATS=1 (-DENABLE_LOCK_STATS). Без флага
+// поля статистики и вызовы исчезают, блокировки не платят ничего.
+#ifndef LOCKSTAT_H
+#define LOCKSTAT_H
+
+#include <stdint.h>
+
+#ifdef ENABLE_LOCK_STATS
+
+typedef struct lock_stats {
+    const char *name;
+    uint64_t acquisitions;        // всего захватов
+    uint64_t contended;           // захватов, которым пришлось ждать
+    uint64_t wait_cycles;         // суммарное время ожидания
+    uint64_t hold_cycles;         // суммарное время удержания (эксклюзивного)
+    uint64_t max_hold_cycles;
+    uint64_t acquired_at;         // момент последнего эксклюзивного захвата
+    struct lock_stats *next;      // список всех блокировок для дампа
+    volatile uint32_t registered;
+} lock_stats_t;
+
+#define LOCKSTAT_FIELD lock_stats_t stats;
+#define LOCKSTAT_INIT(lock_name) , .stats = { .name = (lock_name) }
+
+// Вызывается после захвата. wait_start — момент начала ожидания
+// (0, если блокировка была свободна). shared — захват на чтение
+// нескольким владельцам сразу: счётчики обновляются атомарно, время
+// удержания не считается.
+void lockstat_acquired(lock_stats_t *s, uint64_t wait_start, int shared);
+
+// Вызывается перед освобождением эксклюзивной блокировки
+void lockstat_released(lock_stats_t *s);
+
+// Вывести таблицу статистики всех использованных блокировок в COM-порт
+void lockstat_dump(void);
+
+// Обнулить счётчики (имена и список сохраняются)
+void lockstat_reset(void);
+
+#else
+
+#define LOCKSTAT_FIELD
+#define LOCKSTAT_INIT(lock_name)
+
+static inline void lockstat_dump(void) {}
+static inline void lockstat_reset(void) {}
+
+#endif // ENABLE_LOCK_STATS
+
+#endif // LOCKSTAT_H
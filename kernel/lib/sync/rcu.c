@@ -0,0 +1,148 @@
+// rcu.c — периоды отсрочки и отложенное освобождение для RCU (QSBR)
+#include "rcu.h"
+#include "../../include/smp.h"
+#include "../../include/arch.h"
+
+#include <stddef.h>
+
+// Номер последнего начатого периода отсрочки. Меняется редко, поэтому
+// строка кэша почти всегда разделяется в режиме «только чтение».
+static volatile uint64_t rcu_gp_seq __cacheline_aligned;
+
+typedef struct rcu_cpu {
+    volatile uint64_t qs_seq;   // rcu_gp_seq, виденный в последнем состоянии покоя
+    volatile uint32_t idle;     // CPU в простое — считается в покое
+
+    // Новые обратные вызовы ждут начала периода отсрочки,
+    // ожидающие — его окончания (номер wait_seq)
+    rcu_head_t *next_list;
+    rcu_head_t **next_tail;
+    rcu_head_t *wait_list;
+    uint64_t wait_seq;
+} __cacheline_aligned rcu_cpu_t;
+
+static rcu_cpu_t rcu_cpus[SMP_MAX_CPUS];
+
+void rcu_init(void) {
+    rcu_gp_seq = 0;
+    for (uint32_t cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        rcu_cpu_t *c = &rcu_cpus[cpu];
+        c->qs_seq = 0;
+        c->idle = 0;
+        c->next_list = NULL;
+        c->next_tail = &c->next_list;
+        c->wait_list = NULL;
+        c->wait_seq = 0;
+    }
+}
+
+static uint64_t rcu_start_gp(void) {
+    return atomic_fetch_add64(&rcu_gp_seq, 1) + 1;
+}
+
+// Все остальные запущенные CPU прошли состояние покоя после начала
+// периода seq (или простаивают). Текущий CPU вызывающий код сам
+// находится вне секции читателя.
+static int rcu_gp_done(uint64_t seq) {
+    uint32_t self = smp_cpu_id();
+    cpumask_t online = smp_online_mask() & ~CPUMASK_CPU(self);
+
+    while (online) {
+        uint32_t cpu = (uint32_t)__builtin_ctzll(online);
+        online &= online - 1;
+        rcu_cpu_t *c = &rcu_cpus[cpu];
+        if (!atomic_load32_acquire(&c->idle) && atomic_load64_acquire(&c->qs_seq) < seq) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head)) {
+    head->func = func;
+    head->next = NULL;
+
+    arch_irqflags_t flags = arch_irq_save();
+    rcu_cpu_t *c = &rcu_cpus[smp_cpu_id()];
+    *c->next_tail = head;
+    c->next_tail = &head->next;
+    arch_irq_restore(flags);
+}
+
+void rcu_process_callbacks(void) {
+    rcu_cpu_t *c = &rcu_cpus[smp_cpu_id()];
+    rcu_head_t *done = NULL;
+
+    arch_irqflags_t flags = arch_irq_save();
+    if (c->wait_list && rcu_gp_done(c->wait_seq)) {
+        done = c->wait_list;
+        c->wait_list = NULL;
+    }
+    if (!c->wait_list && c->next_list) {
+        // Пачка новых вызовов ждёт следующего периода целиком
+        c->wait_list = c->next_list;
+        c->next_list = NULL;
+        c->next_tail = &c->next_list;
+        c->wait_seq = rcu_start_gp();
+    }
+    arch_irq_restore(flags);
+
+    // Освобождение после периода отсрочки: все читатели, которые могли
+    // видеть старые объекты, уже прошли состояние покоя
+    smp_mb();
+    while (done) {
+        rcu_head_t *next = done->next;
+        done->func(done);
+        done = next;
+    }
+}
+
+void rcu_quiescent_state(void) {
+    rcu_cpu_t *c = &rcu_cpus[smp_cpu_id()];
+    uint64_t seq = atomic_load64(&rcu_gp_seq);
+
+    // Пишем в свою строку кэша, только если период сменился.
+    // release: чтения из прошлых секций завершены до отметки.
+    if (atomic_load64(&c->qs_seq) != seq) {
+        atomic_store64_release(&c->qs_seq, seq);
+    }
+    if (c->wait_list || c->next_list) {
+        rcu_process_callbacks();
+    }
+}
+
+void synchronize_rcu(void) {
+    uint64_t seq = rcu_start_gp();
+    rcu_quiescent_state();
+    while (!rcu_gp_done(seq)) {
+        cpu_relax();
+    }
+    smp_mb();
+}
+
+void rcu_idle_enter(void) {
+    rcu_cpu_t *c = &rcu_cpus[smp_cpu_id()];
+    atomic_store64_release(&c->qs_seq, atomic_load64(&rcu_gp_seq));
+    atomic_store32_release(&c->idle, 1);
+}
+
+void rcu_idle_exit(void) {
+    rcu_cpu_t *c = &rcu_cpus[smp_cpu_id()];
+    atomic_store32(&c->idle, 0);
+    // Последующие чтения читателей не должны обогнать снятие флага:
+    // иначе писатель, увидевший idle, освободит то, что мы читаем
+    smp_mb();
+}
+
+int rcu_irq_enter(void) {
+    rcu_cpu_t *c = &rcu_cpus[smp_cpu_id()];
+    if (!atomic_load32(&c->idle)) return 0;
+    rcu_idle_exit();
+    return 1;
+}
+
+void rcu_irq_exit(int was_idle) {
+    if (was_idle) {
+        rcu_idle_enter();
+    }
+}
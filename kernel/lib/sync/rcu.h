@@ -0,0 +1,68 @@
+// rcu.h — RCU на основе состояний покоя (QSBR)
+//
+// Читатели не берут блокировок и ничего не пишут в общую память:
+// rcu_read_lock()/rcu_read_unlock() — только барьеры компилятора.
+// Правило одно: указатель, полученный через rcu_dereference(), нельзя
+// использовать после состояния покоя (quiescent state). Состояние покоя
+// CPU проходит между задачами планировщика и в простое, поэтому
+// критическая секция читателя — это любой код внутри одной задачи или
+// одного обработчика прерывания, который не ждёт других CPU.
+//
+// Писатель публикует новую версию через rcu_assign_pointer() и
+// освобождает старую только после периода отсрочки (grace period):
+// синхронно — synchronize_rcu(), или отложенно — call_rcu().
+#ifndef RCU_H
+#define RCU_H
+
+#include <stdint.h>
+#include "../../include/atomic.h"
+
+#define rcu_read_lock()   barrier()
+#define rcu_read_unlock() barrier()
+
+// Чтение указателя, защищённого RCU (зависимые загрузки упорядочены
+// на всех поддерживаемых архитектурах, acquire — с запасом)
+#define rcu_dereference(p) atomic_load_ptr_acquire(&(p))
+
+// Публикация: всё, что записано в объект до вызова, видно читателю,
+// получившему указатель
+#define rcu_assign_pointer(p, v) atomic_store_ptr_release(&(p), (v))
+
+typedef struct rcu_head {
+    struct rcu_head *next;
+    void (*func)(struct rcu_head *head);
+} rcu_head_t;
+
+// Получить структуру по указателю на вложенный rcu_head
+#define rcu_container_of(ptr, type, member) \
+    ((type *)((char *)(ptr) - __builtin_offsetof(type, member)))
+
+void rcu_init(void);
+
+// Вызвать func(head) после периода отсрочки. Можно вызывать из
+// прерываний; func выполняется на этом же CPU из цикла планировщика.
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head));
+
+// Дождаться окончания периода отсрочки. Нельзя вызывать внутри
+// секции читателя и с удерживаемой спин-блокировкой, которую могут
+// ждать другие CPU.
+void synchronize_rcu(void);
+
+// Отметить состояние покоя текущего CPU и обработать готовые
+// обратные вызовы (вызывает планировщик между задачами)
+void rcu_quiescent_state(void);
+
+// Простой CPU не участвует в периодах отсрочки: его не нужно ждать
+void rcu_idle_enter(void);
+void rcu_idle_exit(void);
+
+// Обработчик прерывания может быть читателем, даже если прерывание
+// разбудило простаивающий CPU: на время обработчика CPU выходит из
+// простоя. rcu_irq_enter() возвращает значение для rcu_irq_exit().
+int rcu_irq_enter(void);
+void rcu_irq_exit(int was_idle);
+
+// Выполнить готовые обратные вызовы текущего CPU
+void rcu_process_callbacks(void);
+
+#endif // RCU_H
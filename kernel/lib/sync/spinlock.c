@@ -0,0 +1,237 @@
+// spinlock.c — ticket-, MCS- и rw-блокировки
+#include "spinlock.h"
+#include "../../include/atomic.h"
+
+#ifdef ENABLE_LOCK_STATS
+#define STAT_WAIT_START(var)           uint64_t var = 0
+#define STAT_CONTENDED(var)            do { if (!(var)) (var) = arch_cycles(); } while (0)
+#define STAT_ACQUIRED(lock, var, sh)   lockstat_acquired(&(lock)->stats, (var), (sh))
+#define STAT_RELEASED(lock)            lockstat_released(&(lock)->stats)
+#define STAT_SET_NAME(lock, n)         ((lock)->stats = (lock_stats_t){ .name = (n) })
+#else
+#define STAT_WAIT_START(var)           do { } while (0)
+#define STAT_CONTENDED(var)            do { } while (0)
+#define STAT_ACQUIRED(lock, var, sh)   do { } while (0)
+#define STAT_RELEASED(lock)            do { } while (0)
+#define STAT_SET_NAME(lock, n)         ((void)(n))
+#endif
+
+// ---------------------------------------------------------------
+// Ticket-блокировка
+// ---------------------------------------------------------------
+
+void spin_lock_init(spinlock_t *lock, const char *name) {
+    lock->next = 0;
+    lock->owner = 0;
+    STAT_SET_NAME(lock, name);
+}
+
+void spin_lock(spinlock_t *lock) {
+    STAT_WAIT_START(wait);
+    uint32_t ticket = atomic_fetch_add32(&lock->next, 1);
+    uint32_t owner;
+
+    while ((owner = atomic_load32_acquire(&lock->owner)) != ticket) {
+        STAT_CONTENDED(wait);
+        // Пропорциональная пауза: чем дальше наш билет, тем реже
+        // опрашиваем общую строку кэша
+        for (uint32_t i = ticket - owner; i > 0; i--) {
+            cpu_relax();
+        }
+    }
+    STAT_ACQUIRED(lock, wait, 0);
+}
+
+void spin_unlock(spinlock_t *lock) {
+    STAT_RELEASED(lock);
+    // owner пишет только владелец, поэтому атомарное сложение не нужно
+    atomic_store32_release(&lock->owner, lock->owner + 1);
+}
+
+int spin_trylock(spinlock_t *lock) {
+    uint32_t owner = atomic_load32_acquire(&lock->owner);
+    if (atomic_load32(&lock->next) != owner ||
+        atomic_cmpxchg32(&lock->next, owner, owner + 1) != owner) {
+        return 0;
+    }
+    STAT_ACQUIRED(lock, 0, 0);
+    return 1;
+}
+
+int spin_is_locked(spinlock_t *lock) {
+    return atomic_load32(&lock->next) != atomic_load32(&lock->owner);
+}
+
+arch_irqflags_t spin_lock_irqsave(spinlock_t *lock) {
+    arch_irqflags_t flags = arch_irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+void spin_unlock_irqrestore(spinlock_t *lock, arch_irqflags_t flags) {
+    spin_unlock(lock);
+    arch_irq_restore(flags);
+}
+
+// ---------------------------------------------------------------
+// Очередная блокировка (MCS)
+// ---------------------------------------------------------------
+
+// Узлы очереди: узел нужен только пока CPU ждёт, после захвата он
+// свободен, поэтому достаточно глубины вложенности прерываний
+static struct {
+    mcs_node_t nodes[QSPIN_MAX_NESTING];
+    uint32_t depth;
+} __cacheline_aligned qspin_nodes[SMP_MAX_CPUS];
+
+void qspin_lock_init(qspinlock_t *lock, const char *name) {
+    lock->locked = 0;
+    lock->tail = NULL;
+    STAT_SET_NAME(lock, name);
+}
+
+int qspin_trylock(qspinlock_t *lock) {
+    if (atomic_load32(&lock->locked) || atomic_cmpxchg32(&lock->locked, 0, 1) != 0) {
+        return 0;
+    }
+    STAT_ACQUIRED(lock, 0, 0);
+    return 1;
+}
+
+void qspin_lock(qspinlock_t *lock) {
+    // Быстрый путь: очереди нет и блокировка свободна
+    if (!atomic_load_ptr(&lock->tail) && atomic_cmpxchg32(&lock->locked, 0, 1) == 0) {
+        STAT_ACQUIRED(lock, 0, 0);
+        return;
+    }
+
+    STAT_WAIT_START(wait);
+    STAT_CONTENDED(wait);
+
+    uint32_t cpu = smp_cpu_id();
+    uint32_t depth = qspin_nodes[cpu].depth++;
+    mcs_node_t *node = &qspin_nodes[cpu].nodes[depth];
+    node->next = NULL;
+    node->locked = 0;
+
+    // Встаём в хвост; если перед нами кто-то есть — ждём на своём узле
+    mcs_node_t *prev = atomic_xchg_ptr(&lock->tail, node);
+    if (prev) {
+        atomic_store_ptr_release(&prev->next, node);
+        while (!atomic_load32_acquire(&node->locked)) {
+            cpu_relax();
+        }
+    }
+
+    // Мы во главе очереди: ждём освобождения слова блокировки.
+    // Крутится только один CPU, остальные — на своих узлах.
+    for (;;) {
+        while (atomic_load32(&lock->locked)) {
+            cpu_relax();
+        }
+        if (atomic_cmpxchg32(&lock->locked, 0, 1) == 0) break;
+    }
+
+    // Передаём главенство следующему (или убираем очередь)
+    if (atomic_cmpxchg_ptr(&lock->tail, node, NULL) != node) {
+        mcs_node_t *next;
+        while (!(next = atomic_load_ptr_acquire(&node->next))) {
+            cpu_relax();
+        }
+        atomic_store32_release(&next->locked, 1);
+    }
+    qspin_nodes[cpu].depth = depth;
+
+    STAT_ACQUIRED(lock, wait, 0);
+}
+
+void qspin_unlock(qspinlock_t *lock) {
+    STAT_RELEASED(lock);
+    atomic_store32_release(&lock->locked, 0);
+}
+
+arch_irqflags_t qspin_lock_irqsave(qspinlock_t *lock) {
+    arch_irqflags_t flags = arch_irq_save();
+    qspin_lock(lock);
+    return flags;
+}
+
+void qspin_unlock_irqrestore(qspinlock_t *lock, arch_irqflags_t flags) {
+    qspin_unlock(lock);
+    arch_irq_restore(flags);
+}
+
+// ---------------------------------------------------------------
+// Блокировка читателей/писателя
+// ---------------------------------------------------------------
+
+void rwlock_init(rwlock_t *lock, const char *name) {
+    lock->value = 0;
+    STAT_SET_NAME(lock, name);
+}
+
+void read_lock(rwlock_t *lock) {
+    STAT_WAIT_START(wait);
+    uint32_t v = atomic_load32(&lock->value);
+    for (;;) {
+        if (v & (RWLOCK_WRITER | RWLOCK_WAITING)) {
+            STAT_CONTENDED(wait);
+            cpu_relax();
+            v = atomic_load32(&lock->value);
+            continue;
+        }
+        if (atomic_try_cmpxchg32(&lock->value, &v, v + 1)) break;
+    }
+    STAT_ACQUIRED(lock, wait, 1);
+}
+
+void read_unlock(rwlock_t *lock) {
+    atomic_fetch_sub32(&lock->value, 1);
+}
+
+void write_lock(rwlock_t *lock) {
+    STAT_WAIT_START(wait);
+    uint32_t v = atomic_load32(&lock->value);
+    for (;;) {
+        // Свободна (возможно, с флагом ожидания) — забираем, флаг
+        // сбрасывается; другие ждущие писатели выставят его снова
+        if ((v & ~RWLOCK_WAITING) == 0) {
+            if (atomic_try_cmpxchg32(&lock->value, &v, RWLOCK_WRITER)) break;
+            continue;
+        }
+        STAT_CONTENDED(wait);
+        if (!(v & RWLOCK_WAITING)) {
+            atomic_or32(&lock->value, RWLOCK_WAITING);
+        }
+        cpu_relax();
+        v = atomic_load32(&lock->value);
+    }
+    STAT_ACQUIRED(lock, wait, 0);
+}
+
+void write_unlock(rwlock_t *lock) {
+    STAT_RELEASED(lock);
+    atomic_and32(&lock->value, ~RWLOCK_WRITER);
+}
+
+arch_irqflags_t read_lock_irqsave(rwlock_t *lock) {
+    arch_irqflags_t flags = arch_irq_save();
+    read_lock(lock);
+    return flags;
+}
+
+void read_unlock_irqrestore(rwlock_t *lock, arch_irqflags_t flags) {
+    read_unlock(lock);
+    arch_irq_restore(flags);
+}
+
+arch_irqflags_t write_lock_irqsave(rwlock_t *lock) {
+    arch_irqflags_t flags = arch_irq_save();
+    write_lock(lock);
+    return flags;
+}
+
+void write_unlock_irqrestore(rwlock_t *lock, arch_irqflags_t flags) {
+    write_unlock(lock);
+    arch_irq_restore(flags);
+}
@@ -0,0 +1,103 @@
+// spinlock.h — спин-блокировки ядра
+//
+//   spinlock_t  — ticket-блокировка: честная (FIFO), одно слово; для
+//                 коротких секций с небольшой конкуренцией.
+//   qspinlock_t — очередная блокировка в духе MCS/qspinlock: ожидающие
+//                 выстраиваются в очередь и крутятся каждый на своей
+//                 строке кэша, а не на общем слове. Для горячих путей.
+//   rwlock_t    — читатели/писатель; ждущий писатель блокирует новых
+//                 читателей, чтобы не голодать.
+//
+// Варианты *_irqsave запрещают прерывания на время удержания: их нужно
+// использовать, если та же блокировка берётся в обработчике прерывания.
+//
+// Статические блокировки инициализируются макросами *_INIT(имя),
+// динамические — функциями *_init() ровно один раз. При LOCK_STATS=1
+// блокировка попадает в глобальный список статистики и поэтому не
+// должна освобождаться (блокировки на стеке не поддерживаются).
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../../include/arch.h"
+#include "../../include/smp.h"
+#include "lockstat.h"
+
+// ---------------------------------------------------------------
+// Ticket-блокировка
+// ---------------------------------------------------------------
+
+typedef struct spinlock {
+    volatile uint32_t next;   // следующий выдаваемый билет
+    volatile uint32_t owner;  // билет текущего владельца
+    LOCKSTAT_FIELD
+} spinlock_t;
+
+#define SPINLOCK_INIT(lock_name) { .next = 0, .owner = 0 LOCKSTAT_INIT(lock_name) }
+
+void spin_lock_init(spinlock_t *lock, const char *name);
+void spin_lock(spinlock_t *lock);
+void spin_unlock(spinlock_t *lock);
+int spin_trylock(spinlock_t *lock);   // 1 — захвачена
+int spin_is_locked(spinlock_t *lock);
+
+arch_irqflags_t spin_lock_irqsave(spinlock_t *lock);
+void spin_unlock_irqrestore(spinlock_t *lock, arch_irqflags_t flags);
+
+// ---------------------------------------------------------------
+// Очередная блокировка (MCS)
+// ---------------------------------------------------------------
+
+// Узел очереди ожидания. У каждого CPU есть QSPIN_MAX_NESTING узлов:
+// блокировку может взять код задачи, а поверх него — прерывание.
+#define QSPIN_MAX_NESTING 4
+
+typedef struct mcs_node {
+    struct mcs_node *volatile next;
+    volatile uint32_t locked;     // 1 — предшественник передал нам очередь
+} __cacheline_aligned mcs_node_t;
+
+typedef struct qspinlock {
+    volatile uint32_t locked;     // 1 — блокировка захвачена
+    mcs_node_t *volatile tail;    // последний ожидающий или NULL
+    LOCKSTAT_FIELD
+} qspinlock_t;
+
+#define QSPINLOCK_INIT(lock_name) { .locked = 0, .tail = NULL LOCKSTAT_INIT(lock_name) }
+
+void qspin_lock_init(qspinlock_t *lock, const char *name);
+void qspin_lock(qspinlock_t *lock);
+void qspin_unlock(qspinlock_t *lock);
+int qspin_trylock(qspinlock_t *lock);
+
+arch_irqflags_t qspin_lock_irqsave(qspinlock_t *lock);
+void qspin_unlock_irqrestore(qspinlock_t *lock, arch_irqflags_t flags);
+
+// ---------------------------------------------------------------
+// Блокировка читателей/писателя
+// ---------------------------------------------------------------
+
+#define RWLOCK_WRITER   0x80000000u   // захвачена писателем
+#define RWLOCK_WAITING  0x40000000u   // писатель ждёт: новые читатели не входят
+#define RWLOCK_READERS  0x3FFFFFFFu   // число читателей
+
+typedef struct rwlock {
+    volatile uint32_t value;
+    LOCKSTAT_FIELD
+} rwlock_t;
+
+#define RWLOCK_INIT(lock_name) { .value = 0 LOCKSTAT_INIT(lock_name) }
+
+void rwlock_init(rwlock_t *lock, const char *name);
+void read_lock(rwlock_t *lock);
+void read_unlock(rwlock_t *lock);
+void write_lock(rwlock_t *lock);
+void write_unlock(rwlock_t *lock);
+
+arch_irqflags_t read_lock_irqsave(rwlock_t *lock);
+void read_unlock_irqrestore(rwlock_t *lock, arch_irqflags_t flags);
+arch_irqflags_t write_lock_irqsave(rwlock_t *lock);
+void write_unlock_irqrestore(rwlock_t *lock, arch_irqflags_t flags);
+
+#endif // SPINLOCK_H
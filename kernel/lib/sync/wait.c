@@ -0,0 +1,183 @@
+// wait.c — общая таблица ожидающих и сон CPU до пробуждения
+#include "wait.h"
+#include "spinlock.h"
+#include "../sched/cpuidle.h"
+#include "../../include/arch.h"
+#include "../../include/smp.h"
+
+#include <stddef.h>
+
+typedef struct wait_bucket {
+    spinlock_t lock;
+    volatile uint32_t waiters;  // ждущих в корзине (для wake_address)
+    wait_entry_t *head;
+} __cacheline_aligned wait_bucket_t;
+
+static wait_bucket_t wait_table[WAIT_TABLE_SIZE];
+
+void wait_init(void) {
+    for (uint32_t i = 0; i < WAIT_TABLE_SIZE; i++) {
+        spin_lock_init(&wait_table[i].lock, "wait_table");
+        wait_table[i].waiters = 0;
+        wait_table[i].head = NULL;
+    }
+}
+
+static wait_bucket_t *wait_bucket(const volatile void *key) {
+    uint64_t k = (uint64_t)(uintptr_t)key;
+    // Ключи — адреса объектов: младшие биты почти всегда нули
+    k ^= k >> 17;
+    k *= 0x9E3779B97F4A7C15ull;
+    return &wait_table[(k >> 32) & (WAIT_TABLE_SIZE - 1)];
+}
+
+void wait_prepare(const volatile void *key, volatile uint32_t *counter, wait_entry_t *e) {
+    wait_bucket_t *b = wait_bucket(key);
+    e->key = key;
+    e->counter = counter;
+    e->cpu = smp_cpu_id();
+    e->woken = 0;
+
+    arch_irqflags_t flags = spin_lock_irqsave(&b->lock);
+    e->next = b->head;
+    b->head = e;
+    // Полный барьер: счётчик виден будящему раньше, чем мы проверим
+    // условие (пара smp_mb в wake_up_nr)
+    atomic_fetch_add32(counter, 1);
+    spin_unlock_irqrestore(&b->lock, flags);
+}
+
+// Запись, которую ждёт CPU в простое: cpuidle_enter опрашивает её
+// через wait_should_exit. Пробуждение с того же CPU (из обработчика
+// прерывания) не шлёт kick — его видно только по woken.
+static wait_entry_t *volatile wait_idle_entry[SMP_MAX_CPUS];
+
+static int wait_should_exit(uint32_t cpu) {
+    wait_entry_t *e = wait_idle_entry[cpu];
+    return !e || atomic_load32(&e->woken);
+}
+
+void wait_sleep(wait_entry_t *e) {
+    while (!atomic_load32_acquire(&e->woken)) {
+        if (!arch_irqs_enabled()) {
+            // В прерывании или под irqsave-блокировкой сон невозможен
+            cpu_relax();
+            continue;
+        }
+        // Проверка и простой при запрещённых прерываниях: пробуждение
+        // между ними оставит прерывание ожидающим или сдвинет wake_seq,
+        // и cpuidle_enter сразу выйдет. Состояние (опрос, hlt, mwait)
+        // выбирает cpuidle по QoS и ожидаемой длине простоя.
+        arch_disable_interrupts();
+        if (!atomic_load32(&e->woken)) {
+            uint32_t cpu = smp_cpu_id();
+            wait_idle_entry[cpu] = e;
+            cpuidle_enter(cpu, wait_should_exit);
+            wait_idle_entry[cpu] = NULL;
+        } else {
+            arch_enable_interrupts();
+        }
+    }
+}
+
+void wait_finish(wait_entry_t *e) {
+    if (atomic_load32_acquire(&e->woken)) {
+        return;  // будящий уже убрал запись из корзины
+    }
+
+    wait_bucket_t *b = wait_bucket(e->key);
+    arch_irqflags_t flags = spin_lock_irqsave(&b->lock);
+    if (!e->woken) {
+        for (wait_entry_t **link = &b->head; *link; link = &(*link)->next) {
+            if (*link == e) {
+                *link = e->next;
+                atomic_fetch_sub32(e->counter, 1);
+                break;
+            }
+        }
+    }
+    spin_unlock_irqrestore(&b->lock, flags);
+}
+
+int wake_key(const volatile void *key, int count) {
+    wait_bucket_t *b = wait_bucket(key);
+    uint32_t self = smp_cpu_id();
+    int woken = 0;
+
+    arch_irqflags_t flags = spin_lock_irqsave(&b->lock);
+    wait_entry_t **link = &b->head;
+    while (*link && woken < count) {
+        wait_entry_t *e = *link;
+        if (e->key != key) {
+            link = &e->next;
+            continue;
+        }
+        *link = e->next;
+        atomic_fetch_sub32(e->counter, 1);
+
+        // После woken = 1 запись может исчезнуть со стека ждущего
+        uint32_t cpu = e->cpu;
+        atomic_store32_release(&e->woken, 1);
+        if (cpu != self) {
+            cpuidle_kick(cpu);
+        }
+        woken++;
+    }
+    spin_unlock_irqrestore(&b->lock, flags);
+    return woken;
+}
+
+// ---------------------------------------------------------------
+// Completion
+// ---------------------------------------------------------------
+
+void complete(completion_t *c) {
+    uint32_t done = atomic_load32(&c->done);
+    while (done != COMPLETION_ALL &&
+           !atomic_try_cmpxchg32(&c->done, &done, done + 1)) {
+    }
+    wake_up(&c->wait);
+}
+
+void complete_all(completion_t *c) {
+    atomic_xchg32(&c->done, COMPLETION_ALL);
+    wake_up_all(&c->wait);
+}
+
+int try_wait_for_completion(completion_t *c) {
+    uint32_t done = atomic_load32_acquire(&c->done);
+    for (;;) {
+        if (done == 0) return 0;
+        if (done == COMPLETION_ALL) return 1;
+        if (atomic_try_cmpxchg32(&c->done, &done, done - 1)) return 1;
+    }
+}
+
+void wait_for_completion(completion_t *c) {
+    wait_event(&c->wait, try_wait_for_completion(c));
+}
+
+// ---------------------------------------------------------------
+// Ожидание по адресу
+// ---------------------------------------------------------------
+
+int wait_on_address(const volatile uint32_t *addr, uint32_t expected) {
+    wait_bucket_t *b = wait_bucket(addr);
+    wait_entry_t e;
+
+    wait_prepare(addr, &b->waiters, &e);
+    if (atomic_load32(addr) != expected) {
+        wait_finish(&e);
+        return 0;
+    }
+    wait_sleep(&e);
+    wait_finish(&e);
+    return 1;
+}
+
+int wake_address(const volatile uint32_t *addr, int count) {
+    wait_bucket_t *b = wait_bucket(addr);
+    smp_mb();  // новое значение записано до проверки waiters
+    if (!atomic_load32(&b->waiters)) return 0;
+    return wake_key(addr, count);
+}
@@ -0,0 +1,150 @@
+// wait.h — очереди ожидания, completion и ожидание по адресу
+//
+// Задачи ядра выполняются до конца на стеке CPU, поэтому «заснуть»
+// значит: пока событие не наступило, уйти в простой через cpuidle_enter
+// (опрос, hlt или mwait — по QoS и ожидаемой длине простоя). Будит
+// обработчик прерывания (тот же CPU выходит из простоя) или другой
+// CPU (cpuidle_kick: запись wake_seq или IPI_RESCHEDULE ждущему).
+//
+// Чужих задач ждущий CPU не выполняет: ждущий может держать то, что
+// нужно такой задаче, и оба встали бы навсегда. Задачи из очереди
+// ждущего CPU тем временем крадут другие CPU.
+//
+// Ожидающие не хранятся в самих объектах: все очереди разделяют одну
+// хэш-таблицу корзин по адресу ключа (как futex). Поэтому wait_queue_t
+// и completion_t можно держать где угодно, в том числе на стеке.
+//
+// Правила:
+//   - нельзя ждать, удерживая спин-блокировку: другие CPU всё
+//     ожидание крутились бы на ней;
+//   - из задачи нельзя ждать задачу, привязанную только к этому же
+//     CPU: её некому выполнить;
+//   - с запрещёнными прерываниями (в обработчике прерывания) CPU не
+//     засыпает, а опрашивает условие — разбудить его может только
+//     другой CPU;
+//   - ожидание не является состоянием покоя RCU.
+#ifndef WAIT_H
+#define WAIT_H
+
+#include <stdint.h>
+#include "../../include/atomic.h"
+
+// Корзин в общей таблице ожидающих (степень двойки)
+#define WAIT_TABLE_SIZE 64
+
+// wake_*(): разбудить всех
+#define WAKE_ALL 0x7fffffff
+
+typedef struct wait_queue {
+    volatile uint32_t waiters;  // ждущих сейчас: wake_up без них ничего не трогает
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT { .waiters = 0 }
+
+// Запись ожидающего. Живёт на стеке ждущего, пока тот в очереди.
+typedef struct wait_entry {
+    const volatile void *key;
+    volatile uint32_t *counter;   // счётчик ждущих ключа
+    uint32_t cpu;
+    volatile uint32_t woken;
+    struct wait_entry *next;
+} wait_entry_t;
+
+void wait_init(void);
+
+static inline void wait_queue_init(wait_queue_t *wq) {
+    wq->waiters = 0;
+}
+
+// Низкоуровневые шаги ожидания (их использует wait_event):
+// встать в очередь ключа, заснуть до пробуждения, выйти из очереди
+void wait_prepare(const volatile void *key, volatile uint32_t *counter, wait_entry_t *e);
+void wait_sleep(wait_entry_t *e);
+void wait_finish(wait_entry_t *e);
+
+// Разбудить до count ожидающих ключа. Возвращает число разбуженных.
+int wake_key(const volatile void *key, int count);
+
+// Ждать, пока cond не станет истинным. cond проверяется после
+// постановки в очередь, поэтому пробуждение между проверкой и сном не
+// теряется: тот, кто делает cond истинным, должен затем вызвать wake_up.
+#define wait_event(wq, cond)                                        \
+    do {                                                            \
+        wait_entry_t __we;                                          \
+        while (!(cond)) {                                           \
+            wait_prepare((wq), &(wq)->waiters, &__we);              \
+            if (!(cond)) {                                          \
+                wait_sleep(&__we);                                  \
+            }                                                       \
+            wait_finish(&__we);                                     \
+        }                                                           \
+    } while (0)
+
+// Разбудить ожидающих очереди. Без ждущих — одна загрузка.
+static inline int wake_up_nr(wait_queue_t *wq, int count) {
+    smp_mb();  // условие записано до проверки waiters (пара fetch_add в wait_prepare)
+    if (!atomic_load32(&wq->waiters)) return 0;
+    return wake_key(wq, count);
+}
+
+static inline int wake_up(wait_queue_t *wq) {
+    return wake_up_nr(wq, 1);
+}
+
+static inline int wake_up_all(wait_queue_t *wq) {
+    return wake_up_nr(wq, WAKE_ALL);
+}
+
+// ---------------------------------------------------------------
+// Completion: «дождаться, пока кто-то скажет, что готово»
+// ---------------------------------------------------------------
+
+typedef struct completion {
+    volatile uint32_t done;  // непотреблённые complete(); COMPLETION_ALL — навсегда
+    wait_queue_t wait;
+} completion_t;
+
+#define COMPLETION_ALL 0x80000000u
+
+#define COMPLETION_INIT { .done = 0, .wait = WAIT_QUEUE_INIT }
+
+static inline void init_completion(completion_t *c) {
+    c->done = 0;
+    wait_queue_init(&c->wait);
+}
+
+// Повторное использование после того, как все ожидания закончились
+static inline void reinit_completion(completion_t *c) {
+    atomic_store32(&c->done, 0);
+}
+
+// Разбудить одного ожидающего (или дать пройти следующему wait).
+// Можно вызывать из обработчика прерывания.
+void complete(completion_t *c);
+
+// Разбудить всех: все текущие и будущие wait проходят сразу
+void complete_all(completion_t *c);
+
+void wait_for_completion(completion_t *c);
+
+// Потребить complete() без ожидания: 1 — получилось
+int try_wait_for_completion(completion_t *c);
+
+static inline int completion_done(completion_t *c) {
+    return atomic_load32_acquire(&c->done) != 0;
+}
+
+// ---------------------------------------------------------------
+// Ожидание по адресу (как futex)
+// ---------------------------------------------------------------
+
+// Спать, пока *addr == expected и никто не вызвал wake_address(addr).
+// 1 — спали и были разбужены, 0 — значение уже отличалось.
+// Пробуждение может быть и без смены значения: вызывающий
+// перепроверяет своё условие сам.
+int wait_on_address(const volatile uint32_t *addr, uint32_t expected);
+
+// Разбудить до count ждущих на addr. Возвращает число разбуженных.
+int wake_address(const volatile uint32_t *addr, int count);
+
+#endif // WAIT_H
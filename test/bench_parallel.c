@@ -0,0 +1,152 @@
+// bench_parallel.c — заливка кадра 1920x1080 через parallel_for при 1..8 CPU
+// в сравнении с последовательным циклом. workpool.c и планировщик ядра
+// собираются как есть, CPU моделируются потоками pthread.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <sched.h>
+#include "../kernel/lib/sched/task.h"
+#include "../kernel/lib/sched/workpool.h"
+#include "../kernel/lib/sync/rcu.h"
+
+#define FB_WIDTH   1920
+#define FB_HEIGHT  1080
+#define FB_PIXELS  ((uint64_t)FB_WIDTH * FB_HEIGHT)
+#define FILL_GRAIN (16 * 1024)  // как VESA_CLEAR_GRAIN в graphics_vesa.c
+#define FRAMES     200
+
+// ---------------------------------------------------------------
+// Заглушки SMP: логический CPU = поток
+// ---------------------------------------------------------------
+
+static __thread uint32_t this_cpu;
+static cpumask_t bench_online;
+static uint32_t bench_ncpus;
+
+uint32_t smp_cpu_id(void) { return this_cpu; }
+uint32_t smp_num_cpus(void) { return bench_ncpus; }
+cpumask_t smp_online_mask(void) { return bench_online; }
+void smp_send_ipi(uint32_t cpu, uint32_t reason) { (void)cpu; (void)reason; }
+void smp_register_ipi_handler(uint32_t reason, ipi_handler_t handler) { (void)reason; (void)handler; }
+uint64_t x86_64_tsc_per_us(void) { return 1000; }
+int x86_64_timer_wake_at(uint64_t tsc) { (void)tsc; return -1; }
+void serial_printf(const char *format, ...) { (void)format; }
+
+// ---------------------------------------------------------------
+// Нагрузка
+// ---------------------------------------------------------------
+
+static uint32_t *fb;
+
+typedef struct {
+    uint32_t *fb;
+    uint32_t color;
+} fill_ctx_t;
+
+// noinline: иначе компилятор выбросит заливку всех кадров, кроме последнего
+static __attribute__((noinline)) void fill_span(uint64_t begin, uint64_t end, void *arg) {
+    fill_ctx_t *ctx = arg;
+    uint32_t *dst = ctx->fb;
+    uint32_t color = ctx->color;
+    for (uint64_t i = begin; i < end; i++) dst[i] = color;
+}
+
+static double elapsed(struct timespec *t0, struct timespec *t1) {
+    return (t1->tv_sec - t0->tv_sec) + (t1->tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static int check_frame(uint32_t color) {
+    for (uint64_t i = 0; i < FB_PIXELS; i++) {
+        if (fb[i] != color) return 0;
+    }
+    return 1;
+}
+
+static double run_serial(void) {
+    struct timespec t0, t1;
+    fill_ctx_t ctx = {.fb = fb};
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t f = 0; f < FRAMES; f++) {
+        ctx.color = f;
+        fill_span(0, FB_PIXELS, &ctx);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return elapsed(&t0, &t1);
+}
+
+static volatile int bench_done;
+
+// Вторичные CPU: как sched_loop, но с выходом по окончании замера
+static void *helper_cpu(void *p) {
+    this_cpu = (uint32_t)(uintptr_t)p;
+    while (!__atomic_load_n(&bench_done, __ATOMIC_ACQUIRE)) {
+        if (!task_run_once()) sched_yield();
+    }
+    return NULL;
+}
+
+static double run_parallel(uint32_t ncpus, int *ok) {
+    pthread_t th[SMP_MAX_CPUS];
+    struct timespec t0, t1;
+    fill_ctx_t ctx = {.fb = fb};
+
+    rcu_init();
+    tasking_init();
+    bench_ncpus = ncpus;
+    bench_online = (ncpus == SMP_MAX_CPUS) ? CPUMASK_ALL : ((1ULL << ncpus) - 1);
+    bench_done = 0;
+    this_cpu = 0;
+    for (uint32_t i = 1; i < ncpus; i++) {
+        pthread_create(&th[i], NULL, helper_cpu, (void *)(uintptr_t)i);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t f = 0; f < FRAMES; f++) {
+        ctx.color = f;
+        parallel_for(0, FB_PIXELS, FILL_GRAIN, fill_span, &ctx);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    __atomic_store_n(&bench_done, 1, __ATOMIC_RELEASE);
+    for (uint32_t i = 1; i < ncpus; i++) pthread_join(th[i], NULL);
+
+    *ok = check_frame(FRAMES - 1);
+    return elapsed(&t0, &t1);
+}
+
+int main(void) {
+    fb = malloc(FB_PIXELS * sizeof(uint32_t));
+    if (!fb) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    // Первое касание страниц — вне замеров
+    memset(fb, 0, FB_PIXELS * sizeof(uint32_t));
+
+    double mb = FB_PIXELS * sizeof(uint32_t) * (double)FRAMES / (1024.0 * 1024.0);
+
+    printf("=== parallel_for framebuffer fill benchmark ===\n");
+    printf("%ux%u, %u frames, grain %u pixels\n\n", FB_WIDTH, FB_HEIGHT, FRAMES, FILL_GRAIN);
+
+    double serial = run_serial();
+    printf("  serial: %8.1f MB/s  (%.3f s)\n", mb / serial, serial);
+
+    int failed = 0;
+    for (uint32_t n = 1; n <= SMP_MAX_CPUS; n *= 2) {
+        int ok;
+        double sec = run_parallel(n, &ok);
+        printf("  %u CPU:  %8.1f MB/s  (%.3f s, speedup %.2fx)%s\n",
+               n, mb / sec, sec, serial / sec, ok ? "" : "  FRAME MISMATCH");
+        if (!ok) failed = 1;
+    }
+
+    free(fb);
+    printf("\n=== parallel_for benchmark completed ===\n");
+    return failed;
+}
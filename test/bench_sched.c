@@ -0,0 +1,144 @@
+// bench_sched.c — пропускная способность планировщика на коротких задачах
+// при 1..8 CPU. Планировщик ядра (kernel/lib/sched/task.c) собирается как
+// есть, CPU моделируются потоками pthread.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <sched.h>
+#include "../kernel/lib/sched/task.h"
+#include "../kernel/lib/sync/rcu.h"
+
+#define FLAT_TASKS  2000000   // задачи, порождаемые одним CPU
+#define TREE_DEPTH  20        // дерево fork-join: 2^21 - 1 задач
+#define TASK_WORK   64        // итераций «полезной работы» в задаче
+
+// ---------------------------------------------------------------
+// Заглушки SMP: логический CPU = поток
+// ---------------------------------------------------------------
+
+static __thread uint32_t this_cpu;
+static cpumask_t bench_online;
+
+uint32_t smp_cpu_id(void) { return this_cpu; }
+cpumask_t smp_online_mask(void) { return bench_online; }
+void smp_send_ipi(uint32_t cpu, uint32_t reason) { (void)cpu; (void)reason; }
+void smp_register_ipi_handler(uint32_t reason, ipi_handler_t handler) { (void)reason; (void)handler; }
+uint64_t x86_64_tsc_per_us(void) { return 1000; }
+int x86_64_timer_wake_at(uint64_t tsc) { (void)tsc; return -1; }
+void serial_printf(const char *format, ...) { (void)format; }
+
+// ---------------------------------------------------------------
+// Нагрузка
+// ---------------------------------------------------------------
+
+// Счётчики выполненных задач — свои у каждого CPU, чтобы сам бенчмарк
+// не упирался в одну разделяемую строку кэша
+static struct {
+    volatile uint64_t n;
+} __cacheline_aligned completed[SMP_MAX_CPUS];
+static uint64_t target;
+
+static uint64_t completed_total(void) {
+    uint64_t sum = 0;
+    for (int i = 0; i < SMP_MAX_CPUS; i++) sum += __atomic_load_n(&completed[i].n, __ATOMIC_RELAXED);
+    return sum;
+}
+
+static void short_task(void *arg) {
+    volatile uint32_t x = (uint32_t)(uintptr_t)arg;
+    for (int i = 0; i < TASK_WORK; i++) x = x * 1103515245u + 12345u;
+    __atomic_store_n(&completed[this_cpu].n, completed[this_cpu].n + 1, __ATOMIC_RELAXED);
+}
+
+static void spawn(task_func fn, void *arg) {
+    while (task_create(fn, arg) != 0) {
+        task_run_once();  // пул исчерпан — помогаем разгрести очередь
+    }
+}
+
+static void tree_task(void *arg) {
+    uintptr_t depth = (uintptr_t)arg;
+    if (depth > 0) {
+        spawn(tree_task, (void *)(depth - 1));
+        spawn(tree_task, (void *)(depth - 1));
+    }
+    short_task(arg);
+}
+
+typedef struct {
+    uint32_t cpu;
+    int tree;
+} worker_arg_t;
+
+static pthread_barrier_t start_barrier;
+
+static void *worker(void *p) {
+    worker_arg_t *wa = p;
+    this_cpu = wa->cpu;
+    pthread_barrier_wait(&start_barrier);
+
+    if (this_cpu == 0) {
+        if (wa->tree) {
+            spawn(tree_task, (void *)(uintptr_t)TREE_DEPTH);
+        } else {
+            for (uint32_t i = 0; i < FLAT_TASKS; i++) spawn(short_task, (void *)(uintptr_t)i);
+        }
+    }
+    while (completed_total() < target) {
+        if (!task_run_once()) sched_yield();
+    }
+    return NULL;
+}
+
+static double run(uint32_t ncpus, int tree) {
+    pthread_t th[SMP_MAX_CPUS];
+    worker_arg_t args[SMP_MAX_CPUS];
+    struct timespec t0, t1;
+
+    rcu_init();
+    tasking_init();
+    for (int i = 0; i < SMP_MAX_CPUS; i++) completed[i].n = 0;
+    target = tree ? ((1ULL << (TREE_DEPTH + 1)) - 1) : FLAT_TASKS;
+    bench_online = (ncpus == SMP_MAX_CPUS) ? CPUMASK_ALL : ((1ULL << ncpus) - 1);
+    pthread_barrier_init(&start_barrier, NULL, ncpus + 1);
+
+    for (uint32_t i = 0; i < ncpus; i++) {
+        args[i].cpu = i;
+        args[i].tree = tree;
+        pthread_create(&th[i], NULL, worker, &args[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    pthread_barrier_wait(&start_barrier);
+    for (uint32_t i = 0; i < ncpus; i++) pthread_join(th[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    pthread_barrier_destroy(&start_barrier);
+
+    uint64_t stolen = 0;
+    for (uint32_t i = 0; i < ncpus; i++) {
+        sched_stats_t st;
+        sched_get_stats(i, &st);
+        stolen += st.stolen;
+    }
+
+    double sec = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    double mtps = target / sec / 1e6;
+    printf("  %u CPU: %8.2f Mtasks/s  (%.3f s, stolen %llu)\n",
+           ncpus, mtps, sec, (unsigned long long)stolen);
+    return mtps;
+}
+
+int main(void) {
+    printf("=== Scheduler throughput benchmark ===\n");
+
+    printf("\nFlat: %u tasks spawned by CPU 0\n", FLAT_TASKS);
+    for (uint32_t n = 1; n <= SMP_MAX_CPUS; n *= 2) run(n, 0);
+
+    printf("\nTree: fork-join of depth %u\n", TREE_DEPTH);
+    for (uint32_t n = 1; n <= SMP_MAX_CPUS; n *= 2) run(n, 1);
+
+    printf("\n=== Scheduler benchmark completed ===\n");
+    return 0;
+}
@@ -0,0 +1,134 @@
+// bench_tlb.c — рассылка сброса TLB при частом munmap: по странице
+// против пакетов, с ленивыми CPU и без. lib/mm/tlb.c собирается как
+// есть; CPU моделируются переключением smp_cpu_id(), IPI доставляется
+// синхронно, локальный сброс TLB — счётчик с задержкой.
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "../kernel/lib/mm/tlb.h"
+#include "../kernel/include/atomic.h"
+
+#define NCPUS          8
+#define MUNMAPS        20000
+#define MUNMAP_PAGES   16
+#define IPI_COST_NS    2000   // типичная цена IPI с подтверждением на x86
+#define INVLPG_COST_NS 100
+#define FULL_COST_NS   1000   // перезапись CR3 и повторное заполнение TLB
+
+// ---------------------------------------------------------------
+// Заглушки SMP и архитектуры
+// ---------------------------------------------------------------
+
+static uint32_t this_cpu;
+static ipi_handler_t ipi_handlers[IPI_MAX];
+static uint64_t modeled_ns;
+
+uint32_t smp_cpu_id(void) { return this_cpu; }
+cpumask_t smp_online_mask(void) { return (1ULL << NCPUS) - 1; }
+void smp_register_ipi_handler(uint32_t reason, ipi_handler_t handler) { ipi_handlers[reason] = handler; }
+
+// Доставка IPI: получатель выполняет обработчик «на своём CPU»
+void smp_send_ipi(uint32_t cpu, uint32_t reason) {
+    uint32_t sender = this_cpu;
+    modeled_ns += IPI_COST_NS;
+    this_cpu = cpu;
+    ipi_handlers[reason]();
+    this_cpu = sender;
+}
+
+void arch_tlb_flush_local_page(uintptr_t addr) { (void)addr; modeled_ns += INVLPG_COST_NS; }
+void arch_tlb_flush_local_all(void) { modeled_ns += FULL_COST_NS; }
+void arch_tlb_load_root(uintptr_t root) { (void)root; }
+uintptr_t arch_tlb_read_root(void) { return 0; }
+
+// ---------------------------------------------------------------
+// Нагрузка
+// ---------------------------------------------------------------
+
+static mm_t user_mm;
+
+static void setup(uint32_t lazy_cpus) {
+    tlb_init();
+    mm_init(&user_mm, 0x1000);
+    // Процесс работает на всех CPU; часть из них ушла в задачи ядра
+    for (uint32_t cpu = 0; cpu < NCPUS; cpu++) {
+        this_cpu = cpu;
+        mm_switch(&user_mm);
+        if (cpu != 0 && cpu <= lazy_cpus) mm_enter_lazy();
+    }
+    this_cpu = 0;
+    modeled_ns = 0;
+}
+
+static void munmap_region(uintptr_t base, int batched) {
+    if (batched) {
+        tlb_batch_add_range(&user_mm, base, base + MUNMAP_PAGES * ARCH_PAGE_SIZE);
+        tlb_batch_flush();
+    } else {
+        for (uintptr_t a = base; a < base + MUNMAP_PAGES * ARCH_PAGE_SIZE; a += ARCH_PAGE_SIZE) {
+            tlb_flush_page(&user_mm, a);
+        }
+    }
+}
+
+static void run(const char *name, int batched, uint32_t lazy_cpus) {
+    struct timespec t0, t1;
+    setup(lazy_cpus);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t i = 0; i < MUNMAPS; i++) {
+        munmap_region(0x40000000 + (uintptr_t)(i % 64) * MUNMAP_PAGES * ARCH_PAGE_SIZE, batched);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    tlb_stats_t total = {0};
+    for (uint32_t cpu = 0; cpu < NCPUS; cpu++) {
+        tlb_stats_t st;
+        tlb_get_stats(cpu, &st);
+        total.flushes += st.flushes;
+        total.ipis_sent += st.ipis_sent;
+        total.pages += st.pages;
+        total.full_flushes += st.full_flushes;
+        total.lazy_skipped += st.lazy_skipped;
+    }
+
+    // Ленивые CPU при возврате к mm обязаны сбросить TLB
+    uint64_t before = total.full_flushes;
+    for (uint32_t cpu = 1; cpu <= lazy_cpus && cpu < NCPUS; cpu++) {
+        this_cpu = cpu;
+        mm_switch(&user_mm);
+    }
+    this_cpu = 0;
+    uint64_t catchup = 0;
+    for (uint32_t cpu = 0; cpu < NCPUS; cpu++) {
+        tlb_stats_t st;
+        tlb_get_stats(cpu, &st);
+        catchup += st.full_flushes;
+    }
+    catchup -= before;
+
+    double host_ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / MUNMAPS;
+    printf("  %-22s IPIs/munmap %6.2f  pages flushed %8lu  lazy skips %7lu  "
+           "lazy catch-up flushes %lu  modeled %7.2f us/munmap  (bookkeeping %.0f ns)\n",
+           name, (double)total.ipis_sent / MUNMAPS, (unsigned long)total.pages,
+           (unsigned long)total.lazy_skipped, (unsigned long)catchup,
+           modeled_ns / 1000.0 / MUNMAPS, host_ns);
+}
+
+int main(void) {
+    printf("=== TLB shootdown benchmark: %u CPUs, %u munmaps of %u pages ===\n",
+           NCPUS, MUNMAPS, MUNMAP_PAGES);
+    printf("(modeled cost: IPI %u ns, invlpg %u ns, full flush %u ns)\n\n",
+           IPI_COST_NS, INVLPG_COST_NS, FULL_COST_NS);
+
+    printf("All CPUs running the process:\n");
+    run("per-page shootdown", 0, 0);
+    run("batched", 1, 0);
+
+    printf("\n4 of 7 remote CPUs in lazy TLB (kernel tasks):\n");
+    run("per-page shootdown", 0, 4);
+    run("batched", 1, 4);
+
+    printf("\n=== TLB shootdown benchmark completed ===\n");
+    return 0;
+}
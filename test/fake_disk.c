@@ -0,0 +1,103 @@
+// fake_disk.c - диск в памяти для тестов блочного слоя (см. fake_disk.h)
+#include "fake_disk.h"
+
+#include <string.h>
+
+static int fake_rw_sg(block_device_t *dev, uint64_t lba, const block_seg_t *segs,
+                      uint32_t nsegs, int write) {
+    fake_disk_t *d = (fake_disk_t *)dev;
+    if (d->sg_unsupported && nsegs > 1) return BLOCK_SG_UNSUPPORTED;
+    if (d->fail || (write && d->read_only)) {
+        d->cmds++;
+        return -1;
+    }
+
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < nsegs; i++) {
+        if (d->data) {
+            uint8_t *p = d->data + (lba + total) * BLOCK_SECTOR_SIZE;
+            uint32_t len = segs[i].sectors * BLOCK_SECTOR_SIZE;
+            if (write) memcpy(p, segs[i].buf, len);
+            else memcpy(segs[i].buf, p, len);
+        }
+        total += segs[i].sectors;
+    }
+
+    if (d->cmds < FAKE_DISK_LOG) {
+        fake_cmd_t *c = &d->log[d->cmds];
+        c->lba = lba;
+        c->sectors = total;
+        c->nsegs = nsegs;
+        c->write = write;
+    }
+    d->cmds++;
+    if (write) {
+        d->write_cmds++;
+        d->write_sectors += total;
+    } else {
+        d->read_sectors += total;
+    }
+    if (total > d->max_sectors) d->max_sectors = total;
+    return 0;
+}
+
+static int fake_read(block_device_t *dev, uint64_t lba, uint32_t count, void *buf) {
+    block_seg_t seg = { buf, count };
+    return fake_rw_sg(dev, lba, &seg, 1, 0);
+}
+
+static int fake_write(block_device_t *dev, uint64_t lba, uint32_t count, const void *buf) {
+    block_seg_t seg = { (void *)buf, count };
+    return fake_rw_sg(dev, lba, &seg, 1, 1);
+}
+
+static int fake_flush(block_device_t *dev) {
+    ((fake_disk_t *)dev)->flushes++;
+    return 0;
+}
+
+static int fake_submit(block_device_t *dev, block_cmd_t *cmd) {
+    fake_disk_t *d = (fake_disk_t *)dev;
+    if (d->busy || d->ninflight == dev->queue_depth) return BLOCK_BUSY;
+    int ret = fake_rw_sg(dev, cmd->lba, cmd->segs, cmd->nsegs, cmd->write);
+    if (ret == BLOCK_SG_UNSUPPORTED) return ret;
+    d->inflight[d->ninflight] = cmd;
+    d->inflight_status[d->ninflight] = ret;
+    d->ninflight++;
+    return 0;
+}
+
+void fake_disk_set_async(fake_disk_t *d, uint32_t depth) {
+    d->dev.queue_depth = depth < FAKE_DISK_DEPTH ? depth : FAKE_DISK_DEPTH;
+    d->dev.submit = depth ? fake_submit : NULL;
+}
+
+uint32_t fake_disk_complete(fake_disk_t *d, uint32_t n) {
+    uint32_t done = 0;
+    while (done < n && d->ninflight) {
+        // Снять до done: завершение может поставить следующую команду
+        block_cmd_t *cmd = d->inflight[0];
+        int status = d->inflight_status[0];
+        d->ninflight--;
+        memmove(d->inflight, d->inflight + 1, d->ninflight * sizeof(d->inflight[0]));
+        memmove(d->inflight_status, d->inflight_status + 1,
+                d->ninflight * sizeof(d->inflight_status[0]));
+        cmd->done(cmd, status);
+        done++;
+    }
+    return done;
+}
+
+void fake_disk_init(fake_disk_t *d, const char *name, uint8_t *data, uint64_t sectors,
+                    uint32_t max_transfer) {
+    memset(d, 0, sizeof(*d));
+    strncpy(d->dev.name, name, BLOCK_NAME_MAX - 1);
+    d->dev.sectors = sectors;
+    d->dev.sector_size = BLOCK_SECTOR_SIZE;
+    d->dev.max_transfer = max_transfer;
+    d->dev.read = fake_read;
+    d->dev.write = fake_write;
+    d->dev.flush = fake_flush;
+    d->dev.rw_sg = fake_rw_sg;
+    d->data = data;
+}
@@ -0,0 +1,49 @@
+// fake_disk.h - диск в памяти для тестов блочного слоя: считает команды
+// и сектора, помнит первые команды после сброса cmds. Синхронный; после
+// fake_disk_set_async принимает команды через submit и выполняет их
+// сразу, а завершение (done) вызывает тест — fake_disk_complete.
+#ifndef TEST_FAKE_DISK_H
+#define TEST_FAKE_DISK_H
+
+#include <stdint.h>
+#include "../kernel/drivers/block.h"
+
+#define FAKE_DISK_LOG   64
+#define FAKE_DISK_DEPTH 64
+
+typedef struct {
+    uint64_t lba;
+    uint32_t sectors;
+    uint32_t nsegs;
+    int write;
+} fake_cmd_t;
+
+typedef struct fake_disk {
+    block_device_t dev;        // первым: колбэки получают &dev
+    uint8_t *data;             // NULL — данных нет, команды только считаются
+    int read_only;             // запись — ошибка
+    int fail;                  // любая команда — ошибка диска
+    int sg_unsupported;        // список из нескольких сегментов не принимается
+    int cmds, write_cmds, flushes;
+    uint64_t read_sectors, write_sectors;
+    uint32_t max_sectors;      // самая длинная команда
+    fake_cmd_t log[FAKE_DISK_LOG];
+
+    // submit: команды в полёте по порядку постановки
+    int busy;                  // submit отвечает BLOCK_BUSY
+    block_cmd_t *inflight[FAKE_DISK_DEPTH];
+    int inflight_status[FAKE_DISK_DEPTH];
+    uint32_t ninflight;
+} fake_disk_t;
+
+// Секторы по BLOCK_SECTOR_SIZE; data — sectors * BLOCK_SECTOR_SIZE байт или NULL
+void fake_disk_init(fake_disk_t *d, const char *name, uint8_t *data, uint64_t sectors,
+                    uint32_t max_transfer);
+
+// Принимать команды через submit, до depth в полёте (0 — снова синхронный)
+void fake_disk_set_async(fake_disk_t *d, uint32_t depth);
+
+// Завершить до n самых старых команд в полёте. Возвращает, сколько завершено.
+uint32_t fake_disk_complete(fake_disk_t *d, uint32_t n);
+
+#endif // TEST_FAKE_DISK_H
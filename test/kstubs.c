@@ -0,0 +1,69 @@
+// kstubs.c - заглушки ядра для тестов на хосте (см. kstubs.h)
+#include "kstubs.h"
+#include "../kernel/lib/sync/spinlock.h"
+#include "../kernel/lib/sync/wait.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int kstub_tasks_run;
+int kstub_task_fail;
+int kstub_task_defer;
+task_func kstub_deferred;
+void *kstub_deferred_arg;
+void (*kstub_wait_hook)(const volatile uint32_t *addr);
+
+uint32_t smp_cpu_id(void) { return 0; }
+uint64_t x86_64_tsc_per_us(void) { return 1000; }
+void serial_printf(const char *format, ...) { (void)format; }
+
+void spin_lock_init(spinlock_t *lock, const char *name) {
+    (void)name;
+    lock->next = lock->owner = 0;
+}
+void spin_lock(spinlock_t *lock) {
+    if (lock->next != lock->owner) {
+        fprintf(stderr, "kstubs: spinlock taken twice\n");
+        abort();
+    }
+    lock->next++;
+}
+void spin_unlock(spinlock_t *lock) { lock->owner++; }
+arch_irqflags_t spin_lock_irqsave(spinlock_t *lock) {
+    spin_lock(lock);
+    return 0;
+}
+void spin_unlock_irqrestore(spinlock_t *lock, arch_irqflags_t flags) {
+    (void)flags;
+    spin_unlock(lock);
+}
+
+void wait_prepare(const volatile void *key, volatile uint32_t *counter, wait_entry_t *e) {
+    (void)key; (void)counter; (void)e;
+}
+void wait_sleep(wait_entry_t *e) { (void)e; }
+void wait_finish(wait_entry_t *e) { (void)e; }
+int wake_key(const volatile void *key, int count) { (void)key; (void)count; return 0; }
+
+void complete(completion_t *c) { c->done++; }
+void wait_for_completion(completion_t *c) { c->done--; }
+
+int wait_on_address(const volatile uint32_t *addr, uint32_t expected) {
+    (void)expected;
+    if (kstub_wait_hook) kstub_wait_hook(addr);
+    return 0;
+}
+int wake_address(const volatile uint32_t *addr, int count) { (void)addr; (void)count; return 0; }
+
+int task_create(task_func func, void *arg) {
+    if (kstub_task_fail) return -1;
+    kstub_tasks_run++;
+    if (kstub_task_defer) {
+        kstub_deferred = func;
+        kstub_deferred_arg = arg;
+    } else {
+        func(arg);
+    }
+    return 0;
+}
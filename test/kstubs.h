@@ -0,0 +1,21 @@
+// kstubs.h - заглушки ядра для тестов на хосте: поток один, ожидать нечего —
+// completion считает, wait_on_address сразу возвращается. Спин-блокировки
+// не запрещают прерываний (cli в пользовательском режиме нельзя), а
+// повторный захват — взаимоблокировка в ядре — обрывает тест.
+#ifndef TEST_KSTUBS_H
+#define TEST_KSTUBS_H
+
+#include <stdint.h>
+#include "../kernel/lib/sched/task.h"
+
+// task_create: задача выполняется сразу, если не задано иное
+extern int kstub_tasks_run;            // выполнено или отложено задач
+extern int kstub_task_fail;            // 1 — задач не осталось (-1)
+extern int kstub_task_defer;           // 1 — задача запоминается, тест запускает её сам
+extern task_func kstub_deferred;
+extern void *kstub_deferred_arg;
+
+// Вызывается из wait_on_address: тест может «завершить» то, чего ждут
+extern void (*kstub_wait_hook)(const volatile uint32_t *addr);
+
+#endif // TEST_KSTUBS_H
@@ -0,0 +1,91 @@
+// test_atomic.c - тест атомарных операций ядра (include/atomic.h) на хосте
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "../kernel/include/atomic.h"
+
+#define THREADS 4
+#define ITERS   200000
+
+static volatile uint32_t counter32;
+static volatile uint64_t counter64;
+static volatile uint32_t cas_counter;
+static volatile uint32_t lock_word;
+static uint32_t plain_counter;
+static int failures;
+
+static void check(int ok, const char *name) {
+    if (ok) {
+        printf("✓ %s test passed\n", name);
+    } else {
+        printf("✗ %s test failed\n", name);
+        failures++;
+    }
+}
+
+static void *worker(void *arg) {
+    (void)arg;
+    for (int i = 0; i < ITERS; i++) {
+        atomic_fetch_add32(&counter32, 1);
+        atomic_fetch_add64_relaxed(&counter64, 2);
+
+        uint32_t old = atomic_load32(&cas_counter);
+        while (!atomic_try_cmpxchg32(&cas_counter, &old, old + 1)) {
+            cpu_relax();
+        }
+
+        // Простейший замок на xchg: проверяет acquire/release-семантику
+        while (atomic_xchg32(&lock_word, 1)) {
+            cpu_relax();
+        }
+        plain_counter++;
+        atomic_store32_release(&lock_word, 0);
+    }
+    return NULL;
+}
+
+static void test_single_thread(void) {
+    volatile uint64_t v = 5;
+    int ok = atomic_fetch_add64(&v, 3) == 5 && v == 8;
+    ok &= atomic_fetch_sub64(&v, 8) == 8 && v == 0;
+    ok &= atomic_xchg64(&v, 42) == 0 && v == 42;
+    ok &= atomic_cmpxchg64(&v, 1, 7) == 42 && v == 42;
+    ok &= atomic_cmpxchg64(&v, 42, 7) == 42 && v == 7;
+
+    volatile uint32_t m = 0xF0;
+    atomic_or32(&m, 0x0F);
+    atomic_and32(&m, 0x3C);
+    ok &= m == 0x3C;
+    ok &= arch_atomic_compare_exchange(&m, 0x3C, 1) == 0x3C && m == 1;
+    ok &= arch_atomic_add(&m, 1) == 1 && m == 2;
+
+    int x = 0, y = 0;
+    int *p = &x;
+    ok &= atomic_xchg_ptr(&p, &y) == &x && p == &y;
+    ok &= atomic_cmpxchg_ptr(&p, &y, &x) == &y && atomic_load_ptr_acquire(&p) == &x;
+    check(ok, "atomic single-thread");
+}
+
+static void test_concurrent(void) {
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, worker, NULL);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    check(counter32 == THREADS * ITERS, "atomic_fetch_add32");
+    check(counter64 == 2ULL * THREADS * ITERS, "atomic_fetch_add64_relaxed");
+    check(cas_counter == THREADS * ITERS, "atomic_try_cmpxchg32");
+    check(plain_counter == THREADS * ITERS, "xchg lock");
+}
+
+int main() {
+    printf("=== Atomic Operations Test ===\n\n");
+
+    test_single_thread();
+    test_concurrent();
+
+    printf("\n=== Atomic tests completed ===\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,196 @@
+// test_bcache.c - тест кэша блоков (kernel/fs/bcache.c): попадания, 2Q, отложенная запись
+#include <stdio.h>
+#include <string.h>
+#include "../kernel/fs/bcache.h"
+#include "kstubs.h"
+#include "fake_disk.h"
+
+// Запись «в полёте» у другого: ожидание её завершает
+static volatile uint32_t *inflight_io;
+static int inflight_waits;
+
+static void finish_inflight(const volatile uint32_t *addr) {
+    if (addr == inflight_io) {
+        inflight_waits++;
+        *inflight_io = 0;
+    }
+}
+
+// Диск в памяти: 4096 блоков по 4 КиБ
+#define DISK_BLOCKS 4096
+#define SPB (BCACHE_BLOCK_SIZE / BLOCK_SECTOR_SIZE)
+
+static uint8_t disk_data[DISK_BLOCKS * BCACHE_BLOCK_SIZE];
+static fake_disk_t disk;
+
+// Прочитано блоков с диска
+static int disk_reads(void) { return (int)(disk.read_sectors / SPB); }
+
+// Прочитать блок и сразу отпустить; 1 — данные верны
+static int touch(uint64_t block) {
+    buf_t *b = bcache_read(&disk.dev, block);
+    if (!b) return 0;
+    int ok = b->data[0] == (uint8_t)block && b->data[BCACHE_BLOCK_SIZE - 1] == (uint8_t)(block >> 8);
+    bcache_release(b);
+    return ok;
+}
+
+static int passed = 0;
+static int failed = 0;
+
+#define CHECK(cond, name) do {                       \
+    if (cond) { printf("✓ %s\n", name); passed++; }  \
+    else { printf("✗ %s\n", name); failed++; }       \
+} while (0)
+
+int main() {
+    printf("=== Buffer Cache Test ===\n\n");
+
+    for (uint32_t blk = 0; blk < DISK_BLOCKS; blk++) {
+        disk_data[blk * BCACHE_BLOCK_SIZE] = (uint8_t)blk;
+        disk_data[(blk + 1) * BCACHE_BLOCK_SIZE - 1] = (uint8_t)(blk >> 8);
+    }
+    fake_disk_init(&disk, "mem0", disk_data, (uint64_t)DISK_BLOCKS * SPB, 256);
+    block_register(&disk.dev);
+    kstub_task_defer = 1;
+    kstub_wait_hook = finish_inflight;
+    bcache_init();
+
+    // Промах, затем попадание без обращения к диску
+    CHECK(touch(7) && disk_reads() == 1, "miss reads the block from disk");
+    CHECK(touch(7) && disk_reads() == 1, "second read is served from cache");
+    bcache_stats_t st;
+    bcache_get_stats(&st);
+    CHECK(st.hits == 1 && st.misses == 1, "hit/miss counters");
+
+    CHECK(bcache_read(&disk.dev, DISK_BLOCKS) == NULL, "block past the end is rejected");
+
+    // Изменённый блок на диск попадает только при sync
+    buf_t *b = bcache_read(&disk.dev, 20);
+    b->data[1] = 0xAB;
+    bcache_mark_dirty(b);
+    bcache_release(b);
+    CHECK(disk_data[20 * BCACHE_BLOCK_SIZE + 1] != 0xAB, "dirty block is not written immediately");
+    CHECK(bcache_sync(&disk.dev) == 0 && disk_data[20 * BCACHE_BLOCK_SIZE + 1] == 0xAB,
+          "sync writes the dirty block back");
+
+    // Запись, начатая другим и неудачная: sync ждёт её и повторяет
+    b = bcache_read(&disk.dev, 21);
+    b->data[1] = 0xCD;
+    bcache_mark_dirty(b);
+    b->io = 1;
+    inflight_io = &b->io;
+    bcache_release(b);
+    CHECK(bcache_sync(&disk.dev) == 0 && inflight_waits == 1 &&
+          disk_data[21 * BCACHE_BLOCK_SIZE + 1] == 0xCD, "sync waits for a write-back in flight");
+    inflight_io = NULL;
+
+    // Соседние грязные блоки — одна команда записи
+    disk.write_cmds = 0;
+    for (uint64_t blk = 103; blk >= 100; blk--) {
+        b = bcache_get(&disk.dev, blk);
+        memset(b->data, 0, BCACHE_BLOCK_SIZE);
+        b->data[0] = (uint8_t)blk;
+        b->data[BCACHE_BLOCK_SIZE - 1] = (uint8_t)(blk >> 8);
+        bcache_mark_dirty(b);
+        bcache_release(b);
+    }
+    bcache_sync(&disk.dev);
+    bcache_get_stats(&st);
+    CHECK(disk.write_cmds == 1 && st.dirty == 0, "adjacent dirty blocks merge into one write");
+
+    // 2Q: блок, прочитанный снова после вытеснения из A1in, становится
+    // горячим и переживает длинный однократный проход
+    int reads_before = disk_reads();
+    for (uint64_t blk = 1000; blk < 1000 + BCACHE_BUFFERS; blk++) touch(blk);
+    CHECK(disk_reads() - reads_before == BCACHE_BUFFERS, "scan reads every block once");
+    CHECK(touch(7) && touch(20), "re-read after eviction");
+    bcache_get_stats(&st);
+    CHECK(st.ghost_hits >= 2, "ghost hits promote blocks to Am");
+
+    int ok = 1;
+    for (uint64_t blk = 2000; blk < 2000 + 2 * BCACHE_BUFFERS; blk++) ok &= touch(blk);
+    reads_before = disk_reads();
+    CHECK(ok && touch(7) && touch(20) && disk_reads() == reads_before, "hot blocks survive a scan");
+
+    // Грязные блоки не вытесняются; когда чистых не осталось, промах
+    // сначала записывает их
+    b = bcache_read(&disk.dev, 30);
+    b->data[1] = 0xCD;
+    bcache_mark_dirty(b);
+    bcache_release(b);
+    for (uint64_t blk = 3000; blk < 3000 + BCACHE_BUFFERS - 1; blk++) {
+        b = bcache_read(&disk.dev, blk);
+        bcache_mark_dirty(b);
+        bcache_release(b);
+    }
+    bcache_get_stats(&st);
+    CHECK(st.dirty == BCACHE_BUFFERS, "dirty blocks stay cached");
+    CHECK(touch(1500) && disk_data[30 * BCACHE_BLOCK_SIZE + 1] == 0xCD,
+          "all-dirty cache is written back before eviction");
+    kstub_deferred(kstub_deferred_arg);   // фоновая запись, поставленная по порогу
+    kstub_deferred = NULL;
+
+    // Занятый буфер не вытесняется
+    buf_t *pinned = bcache_read(&disk.dev, 40);
+    for (uint64_t blk = 1000; blk < 1000 + 2 * BCACHE_BUFFERS; blk++) touch(blk);
+    reads_before = disk_reads();
+    buf_t *again = bcache_read(&disk.dev, 40);
+    CHECK(again == pinned && disk_reads() == reads_before, "referenced buffer is not evicted");
+    bcache_release(again);
+    bcache_release(pinned);
+
+    // Много грязных — ставится фоновая запись
+    for (uint64_t blk = 500; blk < 500 + BCACHE_DIRTY_HIGH; blk++) {
+        b = bcache_read(&disk.dev, blk);
+        bcache_mark_dirty(b);
+        bcache_release(b);
+    }
+    CHECK(kstub_deferred != NULL, "dirty threshold schedules background flush");
+    kstub_deferred(kstub_deferred_arg);
+    kstub_deferred = NULL;
+    bcache_get_stats(&st);
+    CHECK(st.dirty == BCACHE_DIRTY_HIGH - BCACHE_WB_BATCH, "background flush writes one batch");
+    b = bcache_read(&disk.dev, 500);
+    bcache_mark_dirty(b);
+    bcache_release(b);
+    CHECK(kstub_deferred == NULL, "dirty below threshold does not reschedule");
+    CHECK(bcache_sync(&disk.dev) == 0, "sync writes the rest");
+
+    // Асинхронный диск: фоновая запись отправляет пачку и возвращается,
+    // завершение пачки разрешает следующую. Чтения на нём ждали бы
+    // завершения, поэтому блоки читаются заранее и держатся.
+    static buf_t *held[BCACHE_DIRTY_HIGH + 1 + BCACHE_WB_BATCH];
+    uint32_t nheld = 0;
+    for (uint64_t blk = 600; blk <= 600 + BCACHE_DIRTY_HIGH; blk++) {
+        held[nheld++] = bcache_read(&disk.dev, blk);
+    }
+    for (uint64_t blk = 800; blk < 800 + BCACHE_WB_BATCH; blk++) {
+        held[nheld++] = bcache_read(&disk.dev, blk);
+    }
+    fake_disk_set_async(&disk, FAKE_DISK_DEPTH);
+    for (uint32_t i = 0; i < BCACHE_DIRTY_HIGH; i++) bcache_mark_dirty(held[i]);
+    CHECK(kstub_deferred != NULL, "dirty threshold schedules flush on async disk");
+    kstub_deferred(kstub_deferred_arg);
+    kstub_deferred = NULL;
+    CHECK(disk.ninflight > 0, "background flush returns with writes in flight");
+    for (uint32_t i = BCACHE_DIRTY_HIGH; i < nheld; i++) bcache_mark_dirty(held[i]);
+    bcache_get_stats(&st);
+    CHECK(st.dirty >= BCACHE_DIRTY_HIGH && kstub_deferred == NULL,
+          "no second flush while a batch is in flight");
+    fake_disk_complete(&disk, FAKE_DISK_DEPTH);
+    CHECK(disk.ninflight == 0, "completion finishes the batch");
+    bcache_mark_dirty(held[nheld - 1]);
+    CHECK(kstub_deferred != NULL, "next dirty block schedules the next batch");
+    kstub_deferred(kstub_deferred_arg);
+    kstub_deferred = NULL;
+    fake_disk_complete(&disk, FAKE_DISK_DEPTH);
+    fake_disk_set_async(&disk, 0);
+    for (uint32_t i = 0; i < nheld; i++) bcache_release(held[i]);
+    CHECK(bcache_sync(&disk.dev) == 0, "sync after background flush");
+    bcache_get_stats(&st);
+    CHECK(st.dirty == 0, "sync cleans the cache");
+
+    printf("\n=== buffer cache tests completed: %d passed, %d failed ===\n", passed, failed);
+    return failed ? 1 : 0;
+}
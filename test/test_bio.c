@@ -0,0 +1,243 @@
+// test_bio.c - тест слияния, plug и планировщиков очереди (kernel/drivers/bio.c) на хосте
+#include <stdio.h>
+#include "../kernel/drivers/bio.h"
+#include "fake_disk.h"
+
+// Диск-пустышка без данных: запоминает команды
+static fake_disk_t disk;
+
+static uint8_t data[256 * BLOCK_SECTOR_SIZE];
+static bio_t bios[64];
+static int ended, end_errors;
+
+static void count_end(bio_t *bio) {
+    ended++;
+    if (bio->status) end_errors++;
+}
+
+static bio_t *make_bio(int i, uint64_t lba, uint32_t sectors, void *buf, int write) {
+    bio_t *b = &bios[i];
+    b->dev = &disk.dev;
+    b->lba = lba;
+    b->sectors = sectors;
+    b->buf = buf;
+    b->write = write;
+    b->end_io = count_end;
+    return b;
+}
+
+static void reset(void) {
+    disk.cmds = 0;
+    ended = 0;
+    end_errors = 0;
+}
+
+static int passed = 0;
+static int failed = 0;
+
+#define CHECK(cond, name) do {                       \
+    if (cond) { printf("✓ %s\n", name); passed++; }  \
+    else { printf("✗ %s\n", name); failed++; }       \
+} while (0)
+
+int main() {
+    printf("=== Block Queue Test ===\n\n");
+
+    fake_disk_init(&disk, "fake0", NULL, 1 << 20, 128);
+    CHECK(block_register(&disk.dev) == 0 && disk.dev.queue != NULL, "register creates a request queue");
+
+    // Последовательное чтение в один буфер: одна команда, один сегмент
+    blk_plug_t plug;
+    reset();
+    blk_start_plug(&plug);
+    for (int i = 0; i < 8; i++) {
+        submit_bio(&plug, make_bio(i, 1000 + i * 8, 8, data + i * 8 * BLOCK_SECTOR_SIZE, 0));
+    }
+    CHECK(disk.cmds == 0, "plugged bios are held");
+    blk_finish_plug(&plug);
+    CHECK(disk.cmds == 1 && disk.log[0].lba == 1000 && disk.log[0].sectors == 64 && disk.log[0].nsegs == 1,
+          "sequential bios merge into one command");
+    CHECK(ended == 8 && end_errors == 0, "end_io called for every merged bio");
+
+    // Слияние спереди, буферы раздельные — два сегмента
+    reset();
+    blk_start_plug(&plug);
+    submit_bio(&plug, make_bio(0, 2016, 8, data, 0));
+    submit_bio(&plug, make_bio(1, 2008, 8, data + 64 * BLOCK_SECTOR_SIZE, 0));
+    blk_finish_plug(&plug);
+    blk_queue_stats_t st;
+    blk_queue_get_stats(&disk.dev, &st);
+    CHECK(disk.cmds == 1 && disk.log[0].lba == 2008 && disk.log[0].sectors == 16 && disk.log[0].nsegs == 2,
+          "front merge with separate buffers");
+    CHECK(st.front_merges == 1 && st.back_merges == 7, "merge counters");
+
+    // Чтение и запись не сливаются
+    reset();
+    blk_start_plug(&plug);
+    submit_bio(&plug, make_bio(0, 3000, 8, data, 0));
+    submit_bio(&plug, make_bio(1, 3008, 8, data + 8 * BLOCK_SECTOR_SIZE, 1));
+    blk_finish_plug(&plug);
+    CHECK(disk.cmds == 2, "reads and writes are not merged");
+
+    // Предел команды
+    reset();
+    blk_start_plug(&plug);
+    for (int i = 0; i < 20; i++) {
+        submit_bio(&plug, make_bio(i, 4000 + i * 8, 8, data + i * 8 * BLOCK_SECTOR_SIZE, 0));
+    }
+    blk_finish_plug(&plug);
+    CHECK(disk.cmds == 2 && disk.log[0].sectors == 128 && disk.log[1].sectors == 32,
+          "merging stops at max_transfer");
+
+    // deadline: по возрастанию LBA
+    reset();
+    blk_start_plug(&plug);
+    submit_bio(&plug, make_bio(0, 300, 8, data, 0));
+    submit_bio(&plug, make_bio(1, 100, 8, data + 16 * BLOCK_SECTOR_SIZE, 0));
+    submit_bio(&plug, make_bio(2, 200, 8, data + 32 * BLOCK_SECTOR_SIZE, 0));
+    blk_finish_plug(&plug);
+    CHECK(disk.cmds == 3 && disk.log[0].lba == 100 && disk.log[1].lba == 200 && disk.log[2].lba == 300,
+          "deadline sorts by LBA");
+
+    // deadline: чтения раньше записей
+    reset();
+    blk_start_plug(&plug);
+    submit_bio(&plug, make_bio(0, 10, 8, data, 1));
+    submit_bio(&plug, make_bio(1, 5000, 8, data + 16 * BLOCK_SECTOR_SIZE, 0));
+    blk_finish_plug(&plug);
+    CHECK(disk.cmds == 2 && !disk.log[0].write && disk.log[1].write, "reads are dispatched before writes");
+
+    // deadline: запись пропускает не больше DEADLINE_WRITES_STARVED пачек
+    // чтений (повторный выбор планировщика сбрасывает текущую пачку)
+    blk_queue_set_elevator(&disk.dev, "deadline");
+    reset();
+    blk_start_plug(&plug);
+    submit_bio(&plug, make_bio(0, 900000, 8, data, 1));
+    for (int i = 1; i < 41; i++) {
+        submit_bio(&plug, make_bio(i, (uint64_t)i * 100, 8, data + 16 * BLOCK_SECTOR_SIZE, 0));
+    }
+    blk_finish_plug(&plug);
+    int write_at = -1;
+    for (int i = 0; i < disk.cmds && i < FAKE_DISK_LOG; i++) {
+        if (disk.log[i].write) write_at = i;
+    }
+    CHECK(disk.cmds == 41 && write_at == DEADLINE_WRITES_STARVED * DEADLINE_FIFO_BATCH,
+          "writes are not starved by reads");
+
+    // noop: порядок поступления
+    CHECK(blk_queue_set_elevator(&disk.dev, "noop") == 0, "switch to noop");
+    CHECK(blk_queue_set_elevator(&disk.dev, "cfq") == -1, "unknown elevator rejected");
+    reset();
+    blk_start_plug(&plug);
+    submit_bio(&plug, make_bio(0, 300, 8, data, 0));
+    submit_bio(&plug, make_bio(1, 100, 8, data + 16 * BLOCK_SECTOR_SIZE, 0));
+    submit_bio(&plug, make_bio(2, 200, 8, data + 32 * BLOCK_SECTOR_SIZE, 0));
+    blk_finish_plug(&plug);
+    CHECK(disk.cmds == 3 && disk.log[0].lba == 300 && disk.log[1].lba == 100 && disk.log[2].lba == 200,
+          "noop keeps submission order");
+
+    // Без plug — сразу
+    reset();
+    submit_bio(NULL, make_bio(0, 50, 8, data, 0));
+    CHECK(disk.cmds == 1 && ended == 1, "unplugged bio is dispatched immediately");
+    CHECK(submit_bio_wait(make_bio(1, 60, 8, data, 1)) == 0 && disk.cmds == 2, "submit_bio_wait");
+
+    // Вне диска — ошибка без команды
+    reset();
+    submit_bio(NULL, make_bio(0, disk.dev.sectors - 4, 8, data, 0));
+    CHECK(disk.cmds == 0 && ended == 1 && end_errors == 1, "out-of-range bio fails");
+
+    // Список, который драйвер не принимает, идёт по сегментам; ошибка
+    // диска не повторяется
+    block_seg_t segs[2] = { { data, 8 }, { data + 16 * BLOCK_SECTOR_SIZE, 8 } };
+    reset();
+    disk.sg_unsupported = 1;
+    CHECK(block_rw_sg(&disk.dev, 70, segs, 2, 0) == 0 && disk.cmds == 2 &&
+          disk.log[1].lba == 78, "unsupported list falls back to segments");
+    disk.sg_unsupported = 0;
+    reset();
+    disk.fail = 1;
+    CHECK(block_rw_sg(&disk.dev, 70, segs, 2, 0) == -1 && disk.cmds == 1,
+          "disk error is not retried per segment");
+    disk.fail = 0;
+
+    // submit: очередь ставит до queue_depth команд и не ждёт их, а
+    // завершение выдаёт следующий запрос
+    fake_disk_set_async(&disk, 4);
+    reset();
+    for (int i = 0; i < 10; i++) {
+        submit_bio(NULL, make_bio(i, 10000 + i * 100, 8, data, 0));
+    }
+    CHECK(disk.cmds == 4 && disk.ninflight == 4 && ended == 0,
+          "async queue issues up to device depth without waiting");
+    fake_disk_complete(&disk, 1);
+    CHECK(ended == 1 && disk.cmds == 5 && disk.ninflight == 4, "completion issues the next request");
+    fake_disk_complete(&disk, FAKE_DISK_DEPTH);
+    CHECK(ended == 10 && end_errors == 0 && disk.cmds == 10 && disk.ninflight == 0,
+          "all async requests complete");
+
+    // Нет слота у драйвера: запрос ждёт blk_queue_kick
+    reset();
+    disk.busy = 1;
+    submit_bio(NULL, make_bio(0, 11000, 8, data, 0));
+    CHECK(disk.cmds == 0 && ended == 0, "busy device holds the request");
+    disk.busy = 0;
+    blk_queue_kick(&disk.dev);
+    CHECK(disk.cmds == 1 && disk.ninflight == 1, "kick issues the held request");
+    fake_disk_complete(&disk, 1);
+    CHECK(ended == 1, "kicked request completes");
+
+    // Неподходящий список — по сегменту, следующий из завершения
+    reset();
+    disk.sg_unsupported = 1;
+    blk_start_plug(&plug);
+    submit_bio(&plug, make_bio(0, 12000, 8, data, 0));
+    submit_bio(&plug, make_bio(1, 12008, 8, data + 64 * BLOCK_SECTOR_SIZE, 0));
+    blk_finish_plug(&plug);
+    CHECK(disk.cmds == 1 && disk.log[0].lba == 12000 && disk.log[0].nsegs == 1,
+          "async unsupported list issues the first segment");
+    fake_disk_complete(&disk, 1);
+    CHECK(disk.cmds == 2 && disk.log[1].lba == 12008 && ended == 0,
+          "next segment is issued from completion");
+    fake_disk_complete(&disk, 1);
+    CHECK(ended == 2 && end_errors == 0, "split request completes once");
+    disk.sg_unsupported = 0;
+
+    reset();
+    disk.fail = 1;
+    submit_bio(NULL, make_bio(0, 13000, 8, data, 1));
+    fake_disk_complete(&disk, 1);
+    CHECK(ended == 1 && end_errors == 1, "async disk error reaches end_io");
+    disk.fail = 0;
+    fake_disk_set_async(&disk, 0);
+
+    // Счётчики ввода-вывода: операции, байты, глубина, гистограмма
+    blk_queue_reset_iostat(&disk.dev);
+    reset();
+    blk_start_plug(&plug);
+    for (int i = 0; i < 6; i++) {
+        submit_bio(&plug, make_bio(i, 5000 + i * 8, 8, data + i * 8 * BLOCK_SECTOR_SIZE, 0));
+    }
+    submit_bio(&plug, make_bio(6, 7000, 16, data, 1));
+    submit_bio(&plug, make_bio(7, disk.dev.sectors, 8, data, 0));
+    blk_finish_plug(&plug);
+    blk_iostat_t io;
+    blk_queue_get_iostat(&disk.dev, &io);
+    CHECK(io.ios[0] == 6 && io.ios[1] == 1 && io.bytes[0] == 6 * 8 * BLOCK_SECTOR_SIZE &&
+          io.bytes[1] == 16 * BLOCK_SECTOR_SIZE, "iostat counts completed bios and bytes");
+    CHECK(io.inflight == 0 && io.max_inflight == 7 && io.queued == 7 && io.depth_sum == 28,
+          "iostat tracks queue depth");
+    uint64_t hist[2] = { 0, 0 };
+    for (int k = 0; k < BLK_LAT_BUCKETS; k++) {
+        hist[0] += io.lat_hist[0][k];
+        hist[1] += io.lat_hist[1][k];
+    }
+    CHECK(hist[0] == 6 && hist[1] == 1 && io.lat_max_us[0] * 6 >= io.lat_sum_us[0],
+          "every completion lands in the latency histogram");
+    blk_queue_reset_iostat(&disk.dev);
+    blk_queue_get_iostat(&disk.dev, &io);
+    CHECK(io.ios[0] == 0 && io.lat_hist[0][0] == 0 && io.queued == 0, "iostat reset");
+
+    printf("\n=== block queue tests completed: %d passed, %d failed ===\n", passed, failed);
+    return failed ? 1 : 0;
+}
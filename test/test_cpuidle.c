@@ -0,0 +1,63 @@
+// test_cpuidle.c - тест выбора состояний, QoS и пробуждения (lib/sched/cpuidle.c) на хосте
+#include <stdio.h>
+#include "../kernel/lib/sched/cpuidle.h"
+
+// Заглушки ядра: текущий CPU — 0, IPI только считаются
+static int ipis_sent;
+
+uint32_t smp_cpu_id(void) { return 0; }
+cpumask_t smp_online_mask(void) { return 3; }
+void smp_send_ipi(uint32_t cpu, uint32_t reason) { (void)cpu; (void)reason; ipis_sent++; }
+uint64_t x86_64_tsc_per_us(void) { return 1000; }
+void serial_printf(const char *format, ...) { (void)format; }
+
+static int passed = 0;
+static int failed = 0;
+
+#define CHECK(cond, name) do {                       \
+    if (cond) { printf("✓ %s\n", name); passed++; }  \
+    else { printf("✗ %s\n", name); failed++; }       \
+} while (0)
+
+int main() {
+    printf("=== CPU Idle Test ===\n\n");
+
+    // Набор состояний зависит от CPUID хоста: опрос и hlt есть всегда
+    cpuidle_init();
+    CHECK(cpuidle_get_state(0)->kind == CPUIDLE_KIND_POLL &&
+          cpuidle_get_state(1)->kind == CPUIDLE_KIND_HALT, "POLL and HALT always available");
+
+    // Без QoS короткий простой — в самое мелкое состояние остановки,
+    // длинный — в самое глубокое доступное
+    int shallow = cpuidle_select(0);
+    int deep = cpuidle_select(1000000);
+    CHECK(shallow != 0 && cpuidle_get_state(shallow)->exit_latency_us <=
+          cpuidle_get_state(deep)->exit_latency_us, "selection follows predicted idle time");
+
+    // Предел QoS — минимум запросов
+    cpuidle_qos_req_t gui = {0}, audio = {0};
+    cpuidle_qos_add(&gui, 50);
+    cpuidle_qos_add(&audio, 10);
+    CHECK(cpuidle_qos_limit() == 10, "QoS limit is the minimum of requests");
+    cpuidle_qos_remove(&audio);
+    CHECK(cpuidle_qos_limit() == 50, "removed request no longer limits");
+
+    int chosen = cpuidle_select(1000000);
+    CHECK(cpuidle_get_state(chosen)->exit_latency_us <= 50, "selected state respects QoS");
+
+    // Предел ниже задержки любой остановки: только опрос
+    cpuidle_qos_update(&gui, 0);
+    CHECK(cpuidle_select(1000000) == 0, "QoS 0 forbids halting");
+    cpuidle_qos_remove(&gui);
+    CHECK(cpuidle_qos_limit() == CPUIDLE_QOS_NONE, "no requests: no limit");
+
+    // CPU вне простоя будится только IPI; себя будить не нужно
+    cpuidle_kick(0);
+    cpuidle_kick(1);
+    cpuidle_stats_t st;
+    cpuidle_get_stats(1, &st);
+    CHECK(ipis_sent == 1 && st.kicks == 1 && st.kick_ipis == 1, "running CPU is kicked with an IPI");
+
+    printf("\n=== cpuidle tests completed: %d passed, %d failed ===\n", passed, failed);
+    return failed ? 1 : 0;
+}
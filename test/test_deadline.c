@@ -0,0 +1,102 @@
+// test_deadline.c - тест класса крайних сроков (lib/sched/deadline.c) на хосте
+#include <stdio.h>
+#include <stdarg.h>
+#include "../kernel/lib/sched/deadline.h"
+
+// Заглушки ядра: один CPU, время — TSC хоста
+uint32_t smp_cpu_id(void) { return 0; }
+cpumask_t smp_online_mask(void) { return 1; }
+void smp_send_ipi(uint32_t cpu, uint32_t reason) { (void)cpu; (void)reason; }
+uint64_t x86_64_tsc_per_us(void) { return 1000; }
+void serial_printf(const char *format, ...) { (void)format; }
+
+static int passed = 0;
+static int failed = 0;
+
+#define CHECK(cond, name) do {                       \
+    if (cond) { printf("✓ %s\n", name); passed++; }  \
+    else { printf("✗ %s\n", name); failed++; }       \
+} while (0)
+
+static char order[8];
+static int order_len;
+
+static void record(void *arg) {
+    order[order_len++] = (char)(uintptr_t)arg;
+}
+
+static uint64_t spin_cycles;
+
+static void busy(void *arg) {
+    (void)arg;
+    uint64_t end = arch_cycles() + spin_cycles;
+    while (arch_cycles() < end) {
+    }
+}
+
+static void wait_cycles(uint64_t n) {
+    uint64_t end = arch_cycles() + n;
+    while (arch_cycles() < end) {
+    }
+}
+
+int main() {
+    printf("=== Deadline Scheduling Test ===\n\n");
+
+    // Неверные параметры и контроль допуска
+    sched_dl_params_t bad = {.runtime = 200, .deadline = 100, .period = 100};
+    CHECK(sched_dl_create(record, 0, &bad) < 0, "runtime > deadline rejected");
+
+    sched_dl_params_t half = {.runtime = 50, .deadline = 100, .period = 100};
+    int a = sched_dl_create(record, 0, &half);
+    int b = sched_dl_create(record, 0, &half);
+    CHECK(a >= 0 && b < 0, "admission control: 50% + 50% > 95% rejected");
+    sched_dl_destroy(a);
+    sched_dl_run(0);  // владелец освобождает снятый слот
+    CHECK(!sched_dl_pending(0), "destroyed job released its slot");
+
+    // EDF: из одновременно выпущенных первым идёт ближний срок
+    sched_dl_params_t late = {.runtime = 1000, .deadline = 50000000, .period = 1000000000};
+    sched_dl_params_t soon = {.runtime = 1000, .deadline = 10000000, .period = 1000000000};
+    int l = sched_dl_create(record, (void *)'L', &late);
+    int s = sched_dl_create(record, (void *)'S', &soon);
+    order_len = 0;
+    while (sched_dl_run(0)) {
+    }
+    CHECK(order_len == 2 && order[0] == 'S' && order[1] == 'L', "earliest deadline runs first");
+    CHECK(sched_dl_pending(0) && !sched_dl_run(0), "next instance waits for its release");
+    uint64_t next = sched_dl_next_release(0);
+    CHECK(next > arch_cycles() && next != SCHED_DL_NO_RELEASE, "next release is in the future");
+    sched_dl_destroy(l);
+    sched_dl_destroy(s);
+    CHECK(sched_dl_next_release(0) == SCHED_DL_NO_RELEASE, "destroyed jobs have no release");
+    sched_dl_run(0);
+
+    // Промах и перерасход: экземпляр работает дольше срока
+    sched_dl_params_t tight = {.runtime = 100000, .deadline = 200000, .period = 100000000};
+    spin_cycles = 1000000;
+    int m = sched_dl_create(busy, 0, &tight);
+    sched_dl_run(0);
+    sched_dl_stats_t st;
+    sched_dl_get_stats(m, &st);
+    CHECK(st.runs == 1 && st.misses == 1 && st.overruns == 1 &&
+          st.max_lateness >= 1000000 - 200000, "deadline miss and overrun counted");
+    sched_dl_destroy(m);
+    sched_dl_run(0);
+
+    // Отставание на несколько периодов: лишние экземпляры отбрасываются
+    sched_dl_params_t fast = {.runtime = 1000, .deadline = 100000, .period = 100000};
+    spin_cycles = 0;
+    int f = sched_dl_create(busy, 0, &fast);
+    wait_cycles(1000000);
+    sched_dl_run(0);
+    // После отставания выполняется только текущий экземпляр
+    int runs = 1;
+    while (sched_dl_run(0) && runs < 10) runs++;
+    sched_dl_get_stats(f, &st);
+    CHECK(runs <= 3 && st.dropped >= 7, "missed periods dropped, not replayed");
+    sched_dl_destroy(f);
+
+    printf("\n=== Deadline tests completed: %d passed, %d failed ===\n", passed, failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,326 @@
+// test_fat32.c - тест FAT32 (kernel/fs/fat32.c): имена VFAT, экстенты, многосекторные чтения
+#include <stdio.h>
+#include <string.h>
+#include "../kernel/fs/fat32.h"
+#include "../kernel/fs/bcache.h"
+#include "kstubs.h"
+#include "fake_disk.h"
+
+// Диск: MBR, раздел FAT32 с PART, кластер — сектор
+#define SECTOR      512
+#define DISK_SECTORS 8192
+#define PART        64
+#define RESERVED    32
+#define FAT_SIZE    16
+#define DATA        (PART + RESERVED + 2 * FAT_SIZE)
+#define CLUSTERS    2048
+
+static uint8_t disk_data[DISK_SECTORS * SECTOR];
+static fake_disk_t disk;
+
+static uint8_t *sector(uint32_t lba) { return disk_data + (uint64_t)lba * SECTOR; }
+static uint8_t *cluster(uint32_t c) { return sector(DATA + c - 2); }
+
+static void put16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put32(uint8_t *p, uint32_t v) { put16(p, (uint16_t)v); put16(p + 2, (uint16_t)(v >> 16)); }
+
+static void set_fat(uint32_t c, uint32_t v) {
+    put32(sector(PART + RESERVED) + c * 4, v);
+    put32(sector(PART + RESERVED + FAT_SIZE) + c * 4, v);
+}
+
+// Цепочка из кластеров chain[0..n), данные файла id
+static uint8_t pattern(uint32_t id, uint64_t off) { return (uint8_t)(off * 7 + id); }
+
+static void put_file(const uint32_t *chain, uint32_t n, uint32_t id, uint32_t size) {
+    for (uint32_t i = 0; i < n; i++) {
+        set_fat(chain[i], i + 1 < n ? chain[i + 1] : 0x0FFFFFFF);
+        for (uint32_t b = 0; b < SECTOR && i * SECTOR + b < size; b++) {
+            cluster(chain[i])[b] = pattern(id, (uint64_t)i * SECTOR + b);
+        }
+    }
+}
+
+// Запись каталога: корень — кластеры 2 и 7, записи подряд
+static uint32_t root_slot;
+
+static uint8_t *root_entry(void) {
+    uint32_t i = root_slot++;
+    return (i < 16 ? cluster(2) : cluster(7)) + (i % 16) * 32;
+}
+
+static uint8_t *short_entry(uint8_t *e, const char *name11, uint8_t attr, uint32_t first,
+                            uint32_t size) {
+    memcpy(e, name11, 11);
+    e[11] = attr;
+    put16(e + 20, (uint16_t)(first >> 16));
+    put16(e + 26, (uint16_t)first);
+    put32(e + 28, size);
+    return e;
+}
+
+static uint8_t checksum(const char *name11) {
+    uint8_t sum = 0;
+    for (int i = 0; i < 11; i++) sum = (uint8_t)(((sum & 1) << 7) + (sum >> 1) + (uint8_t)name11[i]);
+    return sum;
+}
+
+// Длинное имя: записи VFAT в обратном порядке, затем короткая
+static void long_entry(const char *name, const char *name11, uint32_t first, uint32_t size) {
+    static const int offs[13] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+    int len = (int)strlen(name);
+    int parts = (len + 12) / 13;
+    for (int seq = parts; seq >= 1; seq--) {
+        uint8_t *e = root_entry();
+        e[0] = (uint8_t)(seq | (seq == parts ? 0x40 : 0));
+        e[11] = 0x0F;
+        e[13] = checksum(name11);
+        for (int i = 0; i < 13; i++) {
+            int at = (seq - 1) * 13 + i;
+            put16(e + offs[i], at < len ? (uint8_t)name[at] : at == len ? 0 : 0xFFFF);
+        }
+    }
+    short_entry(root_entry(), name11, 0x20, first, size);
+}
+
+#define LONG_SIZE   (40 * SECTOR - 7)
+#define FRAGS       80
+
+static void build_image(void) {
+    // MBR с разделом FAT32 (LBA)
+    uint8_t *mbr = sector(0);
+    mbr[446 + 4] = 0x0C;
+    put32(mbr + 446 + 8, PART);
+    put32(mbr + 446 + 12, DISK_SECTORS - PART);
+    mbr[510] = 0x55;
+    mbr[511] = 0xAA;
+
+    uint8_t *bs = sector(PART);
+    bs[0] = 0xEB;
+    put16(bs + 11, SECTOR);
+    bs[13] = 1;
+    put16(bs + 14, RESERVED);
+    bs[16] = 2;
+    put32(bs + 32, RESERVED + 2 * FAT_SIZE + CLUSTERS);
+    put32(bs + 36, FAT_SIZE);
+    put32(bs + 44, 2);
+    bs[510] = 0x55;
+    bs[511] = 0xAA;
+
+    set_fat(0, 0x0FFFFFF8);
+    set_fat(1, 0x0FFFFFFF);
+    uint32_t root[] = { 2, 7 };
+    put_file(root, 2, 0, 0);
+    memset(cluster(2), 0, SECTOR);
+    memset(cluster(7), 0, SECTOR);
+
+    short_entry(root_entry(), "MYOS LIVE  ", 0x08, 0, 0);
+
+    uint32_t readme[] = { 3 };
+    put_file(readme, 1, 1, 100);
+    short_entry(root_entry(), "README  TXT", 0x20, 3, 100);
+
+    uint32_t lng[40];
+    for (uint32_t i = 0; i < 40; i++) lng[i] = 10 + i;
+    put_file(lng, 40, 2, LONG_SIZE);
+    long_entry("A long file name.txt", "ALONGF~1TXT", 10, LONG_SIZE);
+
+    uint8_t *del = short_entry(root_entry(), "GONE    TXT", 0x20, 3, 100);
+    del[0] = 0xE5;
+
+    uint32_t frag[FRAGS];
+    for (uint32_t i = 0; i < FRAGS; i++) frag[i] = 100 + 2 * i;
+    put_file(frag, FRAGS, 3, FRAGS * SECTOR);
+    short_entry(root_entry(), "FRAG    BIN", 0x20, 100, FRAGS * SECTOR)[12] = 0x18;
+
+    short_entry(root_entry(), "SUBDIR     ", 0x10, 5, 0);
+    uint32_t sub[] = { 5 };
+    put_file(sub, 1, 0, 0);
+    memset(cluster(5), 0, SECTOR);
+    short_entry(cluster(5), ".          ", 0x10, 5, 0);
+    short_entry(cluster(5) + 32, "..         ", 0x10, 0, 0);
+    short_entry(cluster(5) + 64, "INNER   TXT", 0x20, 6, 5);
+    set_fat(6, 0x0FFFFFFF);
+    memcpy(cluster(6), "inner", 5);
+
+    char name11[12];
+    for (int i = 0; i < 20; i++) {
+        snprintf(name11, sizeof(name11), "F%02d        ", i);
+        short_entry(root_entry(), name11, 0x20, 0, 0);
+    }
+}
+
+// Второй диск: том с сектора 0, кластер — 4 КиБ, данные с границы
+// блока кэша; один непрерывный файл BIG.BIN
+#define RA_SPC      8
+#define RA_DATA     48
+#define RA_CLUSTERS 128
+#define RA_FILE     (64 * RA_SPC * SECTOR - 100)
+#define RA_SECTORS  (RA_DATA + RA_CLUSTERS * RA_SPC)
+
+static uint8_t ra_data[RA_SECTORS * SECTOR];
+static fake_disk_t ra_disk;
+
+static void build_ra_image(void) {
+    uint8_t *bs = ra_data;
+    bs[0] = 0xEB;
+    put16(bs + 11, SECTOR);
+    bs[13] = RA_SPC;
+    put16(bs + 14, RESERVED);
+    bs[16] = 2;
+    put32(bs + 32, RA_SECTORS);
+    put32(bs + 36, (RA_DATA - RESERVED) / 2);
+    put32(bs + 44, 2);
+    bs[510] = 0x55;
+    bs[511] = 0xAA;
+
+    uint8_t *fat = ra_data + RESERVED * SECTOR;
+    put32(fat, 0x0FFFFFF8);
+    put32(fat + 4, 0x0FFFFFFF);
+    put32(fat + 8, 0x0FFFFFFF);                 // корень — кластер 2
+    uint32_t n = (RA_FILE + RA_SPC * SECTOR - 1) / (RA_SPC * SECTOR);
+    for (uint32_t i = 0; i < n; i++) put32(fat + (3 + i) * 4, i + 1 < n ? 4 + i : 0x0FFFFFFF);
+
+    uint8_t *data = ra_data + RA_DATA * SECTOR;
+    short_entry(data, "BIG     BIN", 0x20, 3, RA_FILE);
+    for (uint32_t b = 0; b < RA_FILE; b++) data[RA_SPC * SECTOR + b] = pattern(4, b);
+}
+
+static int check_pattern(const uint8_t *p, uint32_t id, uint64_t off, uint64_t len) {
+    for (uint64_t i = 0; i < len; i++) {
+        if (p[i] != pattern(id, off + i)) return 0;
+    }
+    return 1;
+}
+
+static uint8_t buf[FRAGS * SECTOR + 1024];
+
+static int passed = 0;
+static int failed = 0;
+
+#define CHECK(cond, name) do {                       \
+    if (cond) { printf("✓ %s\n", name); passed++; }  \
+    else { printf("✗ %s\n", name); failed++; }       \
+} while (0)
+
+int main() {
+    printf("=== FAT32 Test ===\n\n");
+
+    build_image();
+    fake_disk_init(&disk, "mem0", disk_data, DISK_SECTORS, 1024);
+    disk.read_only = 1;
+    block_register(&disk.dev);
+    blk_queue_set_elevator(&disk.dev, "noop");
+    bcache_init();
+    vfs_init();
+    CHECK(fat32_init() == 0 && vfs_mount("fat32", &disk.dev, NULL, "/") == 0,
+          "mount finds the FAT32 partition in the MBR");
+
+    // Каталоги и имена
+    vfs_file_t *f = vfs_open("/", 0);
+    vfs_dirent_t ent;
+    int names = 0, have_long = 0, have_lower = 0;
+    while (f && vfs_readdir(f, &ent) == 0) {
+        names++;
+        have_long |= !strcmp(ent.name, "A long file name.txt");
+        have_lower |= !strcmp(ent.name, "frag.bin");
+    }
+    vfs_close(f);
+    CHECK(names == 24, "readdir skips label and deleted entries, crosses clusters");
+    CHECK(have_long && have_lower, "long names and lower-case short names");
+
+    vfs_stat_t st;
+    CHECK(vfs_stat("/readme.txt", &st) == 0 && st.type == VFS_FILE && st.size == 100,
+          "lookup ignores case");
+    CHECK(vfs_stat("/F19", &st) == 0 && vfs_stat("/GONE.TXT", &st) == -1,
+          "second root cluster is searched, deleted names are not");
+    char small[8] = { 0 };
+    f = vfs_open("/SUBDIR/inner.txt", 0);
+    CHECK(f && vfs_read(f, small, sizeof(small)) == 5 && !memcmp(small, "inner", 5),
+          "file in a subdirectory");
+    vfs_close(f);
+    CHECK(!vfs_open("/new", VFS_O_CREAT) && vfs_mkdir("/dir") == -1, "volume is read-only");
+
+    // Непрерывный файл: целые сектора — одной командой
+    fat32_stats_t s0, s1;
+    f = vfs_open("/A long file name.txt", 0);
+    fat32_get_stats(&s0);
+    disk.max_sectors = 0;
+    int64_t got = f ? vfs_read(f, buf, sizeof(buf)) : -1;
+    fat32_get_stats(&s1);
+    CHECK(got == LONG_SIZE && check_pattern(buf, 2, 0, LONG_SIZE), "contiguous file reads back");
+    CHECK(s1.data_cmds - s0.data_cmds == 1 && disk.max_sectors == LONG_SIZE / SECTOR &&
+          s1.cached_reads - s0.cached_reads == 1, "contiguous clusters go in one command");
+    vfs_seek(f, 1000);
+    CHECK(vfs_read(f, buf, 3000) == 3000 && check_pattern(buf, 2, 1000, 3000), "unaligned read");
+    vfs_seek(f, 0);
+    fat32_get_stats(&s0);
+    got = vfs_read(f, buf + 1, LONG_SIZE);
+    fat32_get_stats(&s1);
+    CHECK(got == LONG_SIZE && check_pattern(buf + 1, 2, 0, LONG_SIZE) &&
+          s1.data_cmds == s0.data_cmds, "buffer misaligned for DMA goes through the cache");
+    vfs_seek(f, LONG_SIZE - 5);
+    CHECK(vfs_read(f, buf, 100) == 5 && vfs_read(f, buf, 100) == 0, "read stops at end of file");
+    vfs_close(f);
+
+    // Фрагментированный файл: экстенты, за ними — проход по цепочке
+    f = vfs_open("/frag.bin", 0);
+    fat32_get_stats(&s0);
+    got = f ? vfs_read(f, buf, sizeof(buf)) : -1;
+    fat32_get_stats(&s1);
+    CHECK(got == FRAGS * SECTOR && check_pattern(buf, 3, 0, FRAGS * SECTOR),
+          "fragmented file reads back");
+    CHECK(s1.chain_walks > s0.chain_walks, "chain is walked past the extent table");
+
+    // Поиск внутри построенных экстентов FAT не читает
+    fat32_get_stats(&s0);
+    int ok = 1;
+    for (uint32_t k = 0; k < 200; k++) {
+        uint64_t off = (uint64_t)((k * 37) % FAT32_EXTENTS) * SECTOR + k % 300;
+        vfs_seek(f, off);
+        ok &= vfs_read(f, buf, 64) == 64 && check_pattern(buf, 3, off, 64);
+    }
+    fat32_get_stats(&s1);
+    CHECK(ok && s1.fat_reads == s0.fat_reads && s1.extent_hits - s0.extent_hits == 200,
+          "seeks are served from extents");
+    vfs_close(f);
+
+    // Том по явному LBA и испорченный загрузочный сектор
+    uint64_t lba = PART;
+    CHECK(vfs_mount("fat32", &disk.dev, &lba, "/SUBDIR") == 0 &&
+          vfs_stat("/SUBDIR/README.TXT", &st) == 0 && st.size == 100, "mount at an explicit LBA");
+    lba = 0;
+    CHECK(vfs_mount("fat32", &disk.dev, &lba, "/SUBDIR/SUBDIR") == -1, "non-FAT32 sector rejected");
+
+    // Кластеры по блоку кэша: данные — через кэш с чтением вперёд
+    build_ra_image();
+    fake_disk_init(&ra_disk, "mem1", ra_data, RA_SECTORS, 1024);
+    ra_disk.read_only = 1;
+    block_register(&ra_disk.dev);
+    blk_queue_set_elevator(&ra_disk.dev, "noop");
+    CHECK(vfs_mount("fat32", &ra_disk.dev, NULL, "/SUBDIR/SUBDIR") == 0,
+          "mount a volume with block-sized clusters");
+    f = vfs_open("/SUBDIR/SUBDIR/big.bin", 0);
+    fat32_get_stats(&s0);
+    ra_disk.cmds = 0;
+    ok = f != NULL;
+    for (uint64_t off = 0; ok && off < RA_FILE; off += 1000) {
+        uint64_t n = RA_FILE - off < 1000 ? RA_FILE - off : 1000;
+        ok &= vfs_read(f, buf, 1000) == (int64_t)n && check_pattern(buf, 4, off, n);
+    }
+    fat32_get_stats(&s1);
+    bcache_stats_t bst;
+    bcache_get_stats(&bst);
+    CHECK(ok, "stream through the cache reads back");
+    CHECK(s1.ra_blocks > s0.ra_blocks && s1.data_cmds == s0.data_cmds && bst.prefetched >= 64,
+          "data goes through readahead, not direct commands");
+    CHECK(ra_disk.cmds <= 8, "readahead reads the stream in a few large commands");
+    uint64_t sectors = ra_disk.read_sectors;
+    vfs_seek(f, 0);
+    CHECK(vfs_read(f, buf, sizeof(buf)) == sizeof(buf) && check_pattern(buf, 4, 0, sizeof(buf)) &&
+          ra_disk.read_sectors == sectors, "second pass is served from the cache");
+    vfs_close(f);
+
+    printf("\n=== FAT32 tests completed: %d passed, %d failed ===\n", passed, failed);
+    return failed ? 1 : 0;
+}
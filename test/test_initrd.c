@@ -0,0 +1,152 @@
+// test_initrd.c - тест initrd (kernel/fs/initrd.c): индекс tar и cpio, данные без копирования
+#include <stdio.h>
+#include <string.h>
+#include "../kernel/fs/initrd.h"
+#include "kstubs.h"
+
+static uint8_t tar[64 * 1024] __attribute__((aligned(4096)));
+static uint8_t cpio[64 * 1024] __attribute__((aligned(4096)));
+static uint8_t big[3000];
+
+// Запись ustar; prefix может быть NULL
+static size_t tar_add(size_t off, const char *prefix, const char *name, char flag,
+                      const void *data, size_t size) {
+    uint8_t *h = tar + off;
+    memset(h, 0, 512);
+    strcpy((char *)h, name);
+    if (prefix) strcpy((char *)h + 345, prefix);
+    strcpy((char *)h + 100, "0000644");
+    snprintf((char *)h + 124, 12, "%011zo", size);
+    h[156] = (uint8_t)flag;
+    memcpy(h + 257, "ustar", 6);
+    memcpy(h + 263, "00", 2);
+    memset(h + 148, ' ', 8);
+    unsigned sum = 0;
+    for (int i = 0; i < 512; i++) sum += h[i];
+    snprintf((char *)h + 148, 8, "%06o", sum);
+    if (size) memcpy(h + 512, data, size);
+    return off + 512 + (size + 511) / 512 * 512;
+}
+
+// Запись cpio newc
+static size_t cpio_add(size_t off, const char *name, unsigned mode, const void *data, size_t size) {
+    char *h = (char *)cpio + off;
+    size_t namesize = strlen(name) + 1;
+    sprintf(h, "070701%08X%08X%08X%08X%08X%08X%08zX%08X%08X%08X%08X%08zX%08X",
+            1u, mode, 0u, 0u, 1u, 0u, size, 0u, 0u, 0u, 0u, namesize, 0u);
+    memcpy(h + 110, name, namesize);
+    off = (off + 110 + namesize + 3) & ~(size_t)3;
+    if (size) memcpy(cpio + off, data, size);
+    return (off + size + 3) & ~(size_t)3;
+}
+
+static int passed = 0;
+static int failed = 0;
+
+#define CHECK(cond, name) do {                       \
+    if (cond) { printf("✓ %s\n", name); passed++; }  \
+    else { printf("✗ %s\n", name); failed++; }       \
+} while (0)
+
+int main() {
+    printf("=== initrd Test ===\n\n");
+
+    vfs_init();
+    CHECK(initrd_init() == 0, "register initrd");
+
+    for (size_t i = 0; i < sizeof(big); i++) big[i] = (uint8_t)(i * 13 + 5);
+
+    // tar: явный каталог, файл в неявном каталоге, prefix, ссылка
+    size_t off = 0;
+    off = tar_add(off, NULL, "./", '5', NULL, 0);
+    off = tar_add(off, NULL, "./etc/", '5', NULL, 0);
+    off = tar_add(off, NULL, "./etc/motd", '0', "hello\n", 6);
+    off = tar_add(off, NULL, "./bin/sh", '0', big, sizeof(big));
+    off = tar_add(off, "usr/share", "doc/README", '0', "doc", 3);
+    off = tar_add(off, NULL, "./bin/bash", '2', NULL, 0);
+    off = tar_add(off, NULL, "./etc/motd", '0', "bye\n", 4);
+    off += 1024;               // два нулевых блока
+
+    initrd_image_t img = { tar, off };
+    CHECK(vfs_mount("initrd", NULL, &img, "/") == 0, "mount tar image on /");
+
+    vfs_stat_t st;
+    CHECK(vfs_stat("/etc", &st) == 0 && st.type == VFS_DIR, "explicit directory");
+    CHECK(vfs_stat("/bin", &st) == 0 && st.type == VFS_DIR, "implicit directory");
+    CHECK(vfs_stat("/usr/share/doc/README", &st) == 0 && st.size == 3, "ustar prefix joins the path");
+    CHECK(vfs_stat("/bin/bash", &st) == -1, "links are skipped");
+
+    char buf[16] = { 0 };
+    vfs_file_t *f = vfs_open("/etc/motd", 0);
+    CHECK(f && vfs_read(f, buf, sizeof(buf)) == 4 && !memcmp(buf, "bye\n", 4),
+          "later entry replaces the file");
+    vfs_close(f);
+
+    // Без копирования: указатель прямо в образ, весь остаток файла
+    f = vfs_open("/bin/sh", 0);
+    vfs_seek(f, 100);
+    uint64_t n = 1 << 20;
+    const uint8_t *p = vfs_read_map(f, &n);
+    CHECK(p >= tar && p < tar + off && n == sizeof(big) - 100 && !memcmp(p, big + 100, n),
+          "map points into the image");
+    n = 16;
+    CHECK(!vfs_read_map(f, &n), "map stops at end of file");
+    vfs_seek(f, 0);
+    static uint8_t back[sizeof(big)];
+    CHECK(vfs_read(f, back, sizeof(back) + 10) == (int64_t)sizeof(big) &&
+          !memcmp(back, big, sizeof(big)), "read copies the file");
+    CHECK(vfs_write(f, "x", 1) == -1, "files are read-only");
+    vfs_close(f);
+    CHECK(!vfs_open("/etc/new", VFS_O_CREAT) && vfs_mkdir("/tmp") == -1 &&
+          vfs_unlink("/etc/motd") == -1, "no create, mkdir or unlink");
+
+    f = vfs_open("/", 0);
+    vfs_dirent_t ent;
+    char names[64] = "";
+    while (f && vfs_readdir(f, &ent) == 0) {
+        strcat(names, ent.name);
+        strcat(names, " ");
+    }
+    vfs_close(f);
+    CHECK(!strcmp(names, "etc bin usr "), "readdir keeps archive order");
+
+    // cpio поверх /usr: "." — корень, каталоги из путей
+    off = 0;
+    off = cpio_add(off, ".", 0040755, NULL, 0);
+    off = cpio_add(off, "init", 0100755, "#!/bin/sh\n", 10);
+    off = cpio_add(off, "lib/modules/a.ko", 0100644, big, 1001);
+    off = cpio_add(off, "dev/console", 0020600, NULL, 0);
+    size_t trailer = off;
+    off = cpio_add(off, "TRAILER!!!", 0, NULL, 0);
+
+    initrd_image_t cimg = { cpio, off };
+    initrd_stats_t before, after;
+    initrd_get_stats(&before);
+    CHECK(vfs_mount("initrd", NULL, &cimg, "/usr") == 0, "mount cpio image on a directory");
+    CHECK(vfs_stat("/usr/init", &st) == 0 && st.size == 10, "cpio file");
+    CHECK(vfs_stat("/usr/lib/modules/a.ko", &st) == 0 && st.size == 1001 &&
+          vfs_stat("/usr/dev/console", &st) == -1, "cpio paths and skipped devices");
+    f = vfs_open("/usr/lib/modules/a.ko", 0);
+    n = 4096;
+    p = f ? vfs_read_map(f, &n) : NULL;
+    CHECK(p && ((uintptr_t)(p - cpio) & 3) == 0 && n == 1001 && !memcmp(p, big, n),
+          "cpio data is aligned and in place");
+    vfs_close(f);
+    initrd_get_stats(&after);
+    CHECK(after.files - before.files == 2 && after.dirs - before.dirs == 3 &&
+          after.skipped - before.skipped == 1, "index counters");
+
+    // Испорченные образы не монтируются и узлов не оставляют
+    cimg.size = trailer;
+    initrd_get_stats(&before);
+    CHECK(vfs_mount("initrd", NULL, &cimg, "/etc") == -1, "cpio without trailer rejected");
+    tar[148] ^= 1;
+    CHECK(vfs_mount("initrd", NULL, &img, "/etc") == -1, "bad tar checksum rejected");
+    initrd_image_t junk = { big, sizeof(big) };
+    CHECK(vfs_mount("initrd", NULL, &junk, "/etc") == -1, "unknown format rejected");
+    initrd_get_stats(&after);
+    CHECK(after.nodes == before.nodes && vfs_stat("/usr/init", &st) == 0, "failed mount leaves no nodes");
+
+    printf("\n=== initrd tests completed: %d passed, %d failed ===\n", passed, failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+// test_ioring.c - тест колец отправки и завершений (kernel/lib/io/ioring.c) на хосте
+#include <stdio.h>
+#include <string.h>
+#include "../kernel/lib/io/ioring.h"
+#include "kstubs.h"
+#include "fake_disk.h"
+
+// Диск в памяти: 1 МиБ
+#define DISK_BYTES (1024 * 1024)
+
+static uint8_t disk_data[DISK_BYTES];
+static fake_disk_t disk;
+
+static ioring_t ring;
+static ioring_sqe_t sqes[16];
+static ioring_cqe_t cqes[32];
+static uint8_t buf[256 * 1024];
+
+// Забрать все CQE: сколько, сумма user_data, были ли ошибки
+static int reap(uint64_t *sum, int *errors) {
+    int n = 0;
+    ioring_cqe_t *cqe;
+    while ((cqe = ioring_peek_cqe(&ring)) != NULL) {
+        *sum += cqe->user_data;
+        if (cqe->res < 0) (*errors)++;
+        ioring_cqe_seen(&ring);
+        n++;
+    }
+    return n;
+}
+
+static int passed = 0;
+static int failed = 0;
+
+#define CHECK(cond, name) do {                       \
+    if (cond) { printf("✓ %s\n", name); passed++; }  \
+    else { printf("✗ %s\n", name); failed++; }       \
+} while (0)
+
+int main() {
+    printf("=== I/O Ring Test ===\n\n");
+
+    for (uint32_t i = 0; i < DISK_BYTES; i++) disk_data[i] = (uint8_t)(i / 4096);
+    fake_disk_init(&disk, "mem0", disk_data, DISK_BYTES / BLOCK_SECTOR_SIZE, 256);
+    block_register(&disk.dev);
+    blk_queue_set_elevator(&disk.dev, "noop");
+
+    CHECK(ioring_setup(&ring, sqes, 12, cqes, 32) == -1 &&
+          ioring_setup(&ring, sqes, 16, cqes, 8) == -1, "ring sizes are validated");
+    CHECK(ioring_setup(&ring, sqes, 16, cqes, 32) == 0, "setup");
+    int fd = ioring_register_dev(&ring, &disk.dev);
+    CHECK(fd == 0, "device registered");
+
+    // Пачка последовательных чтений: один вызов, одна команда диска
+    for (int i = 0; i < 16; i++) {
+        ioring_sqe_t *sqe = ioring_get_sqe(&ring);
+        ioring_prep_rw(sqe, IORING_OP_READ, fd, buf + i * 4096, 4096, (uint64_t)i * 4096, i + 1);
+    }
+    CHECK(ioring_get_sqe(&ring) == NULL, "full submission ring");
+    disk.cmds = 0;
+    int tasks_before = kstub_tasks_run;
+    uint32_t taken = ioring_submit_and_wait(&ring, 16);
+    uint64_t sum = 0;
+    int errors = 0;
+    int n = reap(&sum, &errors);
+    ioring_cqe_t *cqe;
+    CHECK(taken == 16 && n == 16 && sum == 136 && errors == 0, "batch completes with user_data");
+    CHECK(disk.cmds == 1, "batched reads merge into one command");
+    CHECK(kstub_tasks_run == tasks_before, "batch dispatched inline by enter");
+    CHECK(buf[0] == 0 && buf[5 * 4096] == 5 && buf[15 * 4096 + 4095] == 15, "read data is correct");
+
+    // Запись, затем flush в той же пачке: flush после записи
+    memset(buf, 0xEE, 8192);
+    ioring_prep_rw(ioring_get_sqe(&ring), IORING_OP_WRITE, fd, buf, 8192, 65536, 1);
+    ioring_prep_rw(ioring_get_sqe(&ring), IORING_OP_FLUSH, fd, NULL, 0, 0, 2);
+    ioring_prep_rw(ioring_get_sqe(&ring), IORING_OP_NOP, 0, NULL, 0, 0, 4);
+    ioring_submit(&ring);
+    sum = 0;
+    errors = 0;
+    n = reap(&sum, &errors);
+    CHECK(n == 3 && sum == 7 && errors == 0 && disk.flushes == 1, "write, flush and nop complete");
+    CHECK(disk_data[65536] == 0xEE && disk_data[65536 + 8191] == 0xEE, "written data reaches disk");
+
+    // Большое чтение делится на несколько bio одной операции
+    ioring_prep_rw(ioring_get_sqe(&ring), IORING_OP_READ, fd, buf, 2 * 256 * 512, 0, 1);
+    ioring_submit(&ring);
+    cqe = ioring_peek_cqe(&ring);
+    CHECK(cqe && cqe->res == 2 * 256 * 512, "read larger than max_transfer");
+    ioring_cqe_seen(&ring);
+
+    // Ошибки: неизвестное устройство, невыровненное смещение, за концом
+    ioring_prep_rw(ioring_get_sqe(&ring), IORING_OP_READ, 5, buf, 512, 0, 1);
+    ioring_prep_rw(ioring_get_sqe(&ring), IORING_OP_READ, fd, buf, 512, 100, 2);
+    ioring_prep_rw(ioring_get_sqe(&ring), IORING_OP_READ, fd, buf, 4096, DISK_BYTES, 4);
+    ioring_prep_rw(ioring_get_sqe(&ring), 99, fd, buf, 512, 0, 8);
+    ioring_submit(&ring);
+    sum = 0;
+    errors = 0;
+    n = reap(&sum, &errors);
+    CHECK(n == 4 && errors == 4 && sum == 15, "invalid operations complete with -1");
+
+    // Асинхронный диск: enter возвращается, не дожидаясь команд, и две
+    // пачки держат в полёте 32 операции; CQE приходят с завершениями
+    fake_disk_set_async(&disk, FAKE_DISK_DEPTH);
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < 16; i++) {
+            int k = round * 16 + i;
+            ioring_prep_rw(ioring_get_sqe(&ring), IORING_OP_READ, fd, buf + k * 4096, 4096,
+                           (uint64_t)k * 8192, 1);
+        }
+        ioring_submit(&ring);
+    }
+    CHECK(disk.ninflight == 32 && ioring_peek_cqe(&ring) == NULL,
+          "enter returns with dozens of operations in flight");
+    fake_disk_complete(&disk, 8);
+    sum = 0;
+    errors = 0;
+    n = reap(&sum, &errors);
+    CHECK(n == 8 && errors == 0 && disk.ninflight == 24, "completions post CQEs");
+    fake_disk_complete(&disk, FAKE_DISK_DEPTH);
+    n = reap(&sum, &errors);
+    CHECK(n == 24 && errors == 0 && ring.inflight == 0 && buf[31 * 4096] == 62,
+          "all async operations complete");
+    fake_disk_set_async(&disk, 0);
+
+    // Кольцо завершений не переполняется: пока CQE не забраны,
+    // новые SQE не принимаются
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < 16; i++) {
+            ioring_prep_rw(ioring_get_sqe(&ring), IORING_OP_NOP, 0, NULL, 0, 0, 1);
+        }
+        ioring_submit(&ring);
+    }
+    for (int i = 0; i < 16; i++) {
+        ioring_prep_rw(ioring_get_sqe(&ring), IORING_OP_NOP, 0, NULL, 0, 0, 1);
+    }
+    CHECK(ioring_submit(&ring) == 0, "full completion ring stops submission");
+    sum = 0;
+    errors = 0;
+    n = reap(&sum, &errors);
+    CHECK(n == 32 && ioring_submit(&ring) == 16 && reap(&sum, &errors) == 16,
+          "submission resumes after completions are consumed");
+
+    printf("\n=== I/O ring tests completed: %d passed, %d failed ===\n", passed, failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+// test_ramfs.c - тест ramfs (kernel/fs/ramfs.c) через VFS: каталоги, страницы, чтение без копирования
+#include <stdio.h>
+#include <string.h>
+#include "../kernel/fs/ramfs.h"
+#include "kstubs.h"
+
+#define MANY_FILES 20000
+
+static uint8_t data[3 * RAMFS_PAGE_SIZE + 100];
+static uint8_t back[sizeof(data)];
+
+static int passed = 0;
+static int failed = 0;
+
+#define CHECK(cond, name) do {                       \
+    if (cond) { printf("✓ %s\n", name); passed++; }  \
+    else { printf("✗ %s\n", name); failed++; }       \
+} while (0)
+
+int main() {
+    printf("=== ramfs Test ===\n\n");
+
+    vfs_init();
+    CHECK(ramfs_init() == 0 && vfs_mount("ramfs", NULL, NULL, "/") == 0, "mount ramfs on /");
+
+    // Иерархия
+    CHECK(vfs_mkdir("/usr") == 0 && vfs_mkdir("/usr/share") == 0 &&
+          vfs_mkdir("/usr/share/doc") == 0, "nested directories");
+    vfs_stat_t st;
+    CHECK(vfs_stat("/usr/share/doc", &st) == 0 && st.type == VFS_DIR, "stat directory");
+
+    // Данные через границы страниц
+    for (uint32_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 7 + 1);
+    vfs_file_t *f = vfs_open("/usr/share/doc/big", VFS_O_CREAT);
+    int64_t w1 = f ? vfs_write(f, data, 1000) : -1;
+    int64_t w2 = f ? vfs_write(f, data + 1000, sizeof(data) - 1000) : -1;
+    CHECK(w1 == 1000 && w2 == (int64_t)sizeof(data) - 1000, "appending writes");
+    ramfs_stats_t rs;
+    ramfs_get_stats(&rs);
+    CHECK(rs.pages == 4, "file grows page by page");
+    vfs_seek(f, 0);
+    CHECK(vfs_read(f, back, sizeof(back)) == (int64_t)sizeof(data) &&
+          !memcmp(back, data, sizeof(data)), "read across pages");
+
+    // Без копирования: куски не длиннее страницы, данные на месте
+    vfs_seek(f, 100);
+    uint64_t n = sizeof(data);
+    const uint8_t *p = vfs_read_map(f, &n);
+    CHECK(p && n == RAMFS_PAGE_SIZE - 100 && !memcmp(p, data + 100, n), "map returns the rest of a page");
+    uint64_t total = n;
+    int ok = 1;
+    for (;;) {
+        n = sizeof(data);
+        p = vfs_read_map(f, &n);
+        if (!p) break;
+        ok &= !memcmp(p, data + 100 + total, n);
+        total += n;
+    }
+    CHECK(ok && total == sizeof(data) - 100, "map walks the whole file");
+
+    // Дыра читается нулями
+    vfs_seek(f, 8 * RAMFS_PAGE_SIZE);
+    CHECK(vfs_write(f, "x", 1) == 1, "write past the end");
+    vfs_seek(f, 5 * RAMFS_PAGE_SIZE);
+    memset(back, 0xFF, 16);
+    CHECK(vfs_read(f, back, 16) == 16 && back[0] == 0 && back[15] == 0, "hole reads as zeros");
+    vfs_seek(f, RAMFS_MAX_FILE);
+    CHECK(vfs_write(f, "x", 1) == -1, "file size is bounded");
+
+    // Удаление: страницы возвращаются после закрытия
+    CHECK(vfs_unlink("/usr/share/doc") == -1, "non-empty directory is kept");
+    CHECK(vfs_unlink("/usr/share/doc/big") == 0, "unlink open file");
+    vfs_seek(f, 0);
+    CHECK(vfs_read(f, back, 10) == 10 && !memcmp(back, data, 10), "open file still readable");
+    vfs_close(f);
+    ramfs_get_stats(&rs);
+    CHECK(rs.pages == 0, "pages freed on last close");
+    CHECK(vfs_unlink("/usr/share/doc") == 0, "empty directory removed");
+
+    // Много файлов в одном каталоге
+    char path[32];
+    ramfs_stats_t before;
+    ramfs_get_stats(&before);
+    vfs_mkdir("/many");
+    ok = 1;
+    for (int i = 0; i < MANY_FILES; i++) {
+        snprintf(path, sizeof(path), "/many/file%d", i);
+        vfs_file_t *g = vfs_open(path, VFS_O_CREAT);
+        ok &= g != NULL;
+        if (g) vfs_close(g);
+    }
+    CHECK(ok, "create many files");
+    ok = 1;
+    for (int i = MANY_FILES - 1; i >= 0; i -= 3) {
+        snprintf(path, sizeof(path), "/many/file%d", i);
+        ok &= vfs_stat(path, &st) == 0 && st.type == VFS_FILE;
+    }
+    CHECK(ok && vfs_stat("/many/file20000", &st) == -1, "look up many files");
+
+    f = vfs_open("/many", 0);
+    vfs_dirent_t ent;
+    int listed = 0;
+    while (f && vfs_readdir(f, &ent) == 0) listed++;
+    vfs_close(f);
+    CHECK(listed == MANY_FILES, "readdir lists every file");
+
+    ok = 1;
+    for (int i = 0; i < MANY_FILES; i++) {
+        snprintf(path, sizeof(path), "/many/file%d", i);
+        ok &= vfs_unlink(path) == 0;
+    }
+    ok &= vfs_unlink("/many") == 0;
+    vfs_dcache_stats_t ds;
+    vfs_get_dcache_stats(&ds);
+    ramfs_get_stats(&rs);
+    // Отрицательные dentry inode не держат: узлы свободны сразу
+    CHECK(ok && rs.nodes == before.nodes && ds.evictions > 0, "unlink returns every node");
+
+    printf("\n=== ramfs tests completed: %d passed, %d failed ===\n", passed, failed);
+    return failed ? 1 : 0;
+}
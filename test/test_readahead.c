@@ -0,0 +1,121 @@
+// test_readahead.c - тест чтения вперёд (kernel/fs/readahead.c): поток, рост окна, случайный доступ
+#include <stdio.h>
+#include <string.h>
+#include "../kernel/fs/readahead.h"
+#include "kstubs.h"
+#include "fake_disk.h"
+
+// Диск в памяти только для чтения: первый байт блока — его номер
+#define DISK_BLOCKS 2048
+#define SPB (BCACHE_BLOCK_SIZE / BLOCK_SECTOR_SIZE)
+
+static uint8_t disk_data[DISK_BLOCKS * BCACHE_BLOCK_SIZE];
+static fake_disk_t disk;
+
+// Прочитано блоков с диска
+static int disk_blocks(void) { return (int)(disk.read_sectors / SPB); }
+
+// Файл — участок диска [base, base + blocks)
+typedef struct {
+    uint64_t base;
+    uint64_t blocks;
+} file_t;
+
+static uint64_t file_bmap(void *ctx, uint64_t index) {
+    file_t *f = (file_t *)ctx;
+    return index < f->blocks ? f->base + index : RA_NO_BLOCK;
+}
+
+// Чтение в полёте: ожидание завершает все команды асинхронного диска
+static void finish_inflight(const volatile uint32_t *addr) {
+    (void)addr;
+    fake_disk_complete(&disk, FAKE_DISK_DEPTH);
+}
+
+static int read_block(readahead_t *ra, file_t *f, uint64_t index) {
+    buf_t *b = readahead_read(ra, &disk.dev, file_bmap, f, index);
+    if (!b) return 0;
+    int ok = b->data[0] == (uint8_t)(f->base + index);
+    bcache_release(b);
+    return ok;
+}
+
+static int passed = 0;
+static int failed = 0;
+
+#define CHECK(cond, name) do {                       \
+    if (cond) { printf("✓ %s\n", name); passed++; }  \
+    else { printf("✗ %s\n", name); failed++; }       \
+} while (0)
+
+int main() {
+    printf("=== Readahead Test ===\n\n");
+
+    for (uint32_t blk = 0; blk < DISK_BLOCKS; blk++) {
+        disk_data[blk * BCACHE_BLOCK_SIZE] = (uint8_t)blk;
+    }
+    fake_disk_init(&disk, "mem0", disk_data, (uint64_t)DISK_BLOCKS * SPB, 1024);
+    disk.read_only = 1;
+    block_register(&disk.dev);
+    blk_queue_set_elevator(&disk.dev, "noop");
+    bcache_init();
+
+    // Поток: большие команды, окно растёт до предела
+    readahead_t ra;
+    readahead_init(&ra);
+    file_t big = { .base = 0, .blocks = 256 };
+    int ok = 1;
+    uint32_t max_window = 0;
+    for (uint64_t i = 0; i < big.blocks; i++) {
+        ok &= read_block(&ra, &big, i);
+        if (ra.size > max_window) max_window = ra.size;
+    }
+    CHECK(ok, "sequential stream returns correct data");
+    CHECK(disk_blocks() == 256 && disk.cmds <= 8, "stream is read in a few large commands");
+    CHECK(max_window == RA_MAX_BLOCKS, "window grows up to the cap");
+
+    bcache_stats_t st;
+    bcache_get_stats(&st);
+    CHECK(st.prefetched == 256 && st.misses == 0, "every block is served from cache");
+
+    // Чтение вперёд не выходит за конец файла
+    disk.read_sectors = 0;
+    readahead_init(&ra);
+    file_t small = { .base = 1000, .blocks = 3 };
+    ok = 1;
+    for (uint64_t i = 0; i < small.blocks; i++) ok &= read_block(&ra, &small, i);
+    CHECK(ok && disk_blocks() == 3, "readahead stops at end of file");
+    CHECK(readahead_read(&ra, &disk.dev, file_bmap, &small, 3) == NULL, "read past end fails");
+
+    // Случайный доступ: без чтения вперёд
+    disk.read_sectors = 0;
+    readahead_init(&ra);
+    file_t rnd = { .base = 1200, .blocks = 512 };
+    uint64_t idx[] = { 300, 17, 411, 90, 480, 5 };
+    ok = 1;
+    for (int k = 0; k < 6; k++) ok &= read_block(&ra, &rnd, idx[k]);
+    CHECK(ok && disk_blocks() == 6 && ra.size == 0, "random access does not read ahead");
+
+    // Поток, начатый с середины файла, тоже распознаётся
+    disk.cmds = 0;
+    for (uint64_t i = 100; i < 164; i++) read_block(&ra, &rnd, i);
+    CHECK(disk.cmds <= 7, "stream detected after a seek");
+
+    // Асинхронный диск: окно, начатое на метке, остаётся в полёте, пока
+    // читатель обрабатывает уже прочитанное
+    fake_disk_set_async(&disk, FAKE_DISK_DEPTH);
+    kstub_wait_hook = finish_inflight;
+    readahead_init(&ra);
+    file_t stream = { .base = 1800, .blocks = 64 };
+    ok = read_block(&ra, &stream, 0);
+    ok &= read_block(&ra, &stream, 1);
+    CHECK(ok && disk.ninflight > 0, "next window is read asynchronously");
+    for (uint64_t i = 2; i < stream.blocks; i++) ok &= read_block(&ra, &stream, i);
+    CHECK(ok, "async stream returns correct data");
+    fake_disk_complete(&disk, FAKE_DISK_DEPTH);
+    kstub_wait_hook = NULL;
+    fake_disk_set_async(&disk, 0);
+
+    printf("\n=== readahead tests completed: %d passed, %d failed ===\n", passed, failed);
+    return failed ? 1 : 0;
+}
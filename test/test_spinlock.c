@@ -0,0 +1,115 @@
+// test_spinlock.c - тест спин-блокировок ядра (lib/sync) на хосте
+#include <stdio.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../kernel/lib/sync/spinlock.h"
+
+// Спин-блокировки рассчитаны на то, что владелец не вытесняется: потоков
+// не больше, чем CPU (но минимум два), иначе тест ждёт кванты планировщика
+#define MAX_THREADS 4
+#define ITERS   5000
+
+// Заглушки ядра: номер CPU = номер потока, дамп статистики — в stdout
+static __thread uint32_t this_cpu;
+
+uint32_t smp_cpu_id(void) {
+    return this_cpu;
+}
+
+void serial_printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static spinlock_t ticket = SPINLOCK_INIT("test_ticket");
+static qspinlock_t queued = QSPINLOCK_INIT("test_qspin");
+static rwlock_t rw = RWLOCK_INIT("test_rw");
+
+static uint64_t ticket_counter;
+static uint64_t queued_counter;
+static uint64_t rw_a, rw_b;
+static volatile uint32_t rw_torn;
+static int failures;
+
+static void check(int ok, const char *name) {
+    if (ok) {
+        printf("✓ %s test passed\n", name);
+    } else {
+        printf("✗ %s test failed\n", name);
+        failures++;
+    }
+}
+
+static void *worker(void *arg) {
+    this_cpu = (uint32_t)(uintptr_t)arg;
+    for (int i = 0; i < ITERS; i++) {
+        spin_lock(&ticket);
+        ticket_counter++;
+        spin_unlock(&ticket);
+
+        qspin_lock(&queued);
+        queued_counter++;
+        qspin_unlock(&queued);
+
+        if (i % 8 == 0) {
+            // Писатель меняет два поля; читатель не должен увидеть их разными
+            write_lock(&rw);
+            rw_a++;
+            rw_b++;
+            write_unlock(&rw);
+        } else {
+            read_lock(&rw);
+            if (rw_a != rw_b) rw_torn = 1;
+            read_unlock(&rw);
+        }
+    }
+    return NULL;
+}
+
+// Блокировки со статистикой попадают в общий список, поэтому
+// они должны жить всё время работы (как в ядре) — не на стеке
+static spinlock_t l;
+static qspinlock_t q;
+
+static void test_trylock(void) {
+    spin_lock_init(&l, "trylock");
+    int ok = spin_trylock(&l) && spin_is_locked(&l) && !spin_trylock(&l);
+    spin_unlock(&l);
+    ok &= !spin_is_locked(&l) && spin_trylock(&l);
+    spin_unlock(&l);
+
+    qspin_lock_init(&q, "qtrylock");
+    ok &= qspin_trylock(&q) && !qspin_trylock(&q);
+    qspin_unlock(&q);
+    check(ok, "trylock");
+}
+
+int main() {
+    printf("=== Spinlock Test ===\n\n");
+
+    test_trylock();
+
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = ncpus < 2 ? 2 : (ncpus > MAX_THREADS ? MAX_THREADS : (int)ncpus);
+
+    pthread_t threads[MAX_THREADS];
+    for (int i = 0; i < nthreads; i++) {
+        pthread_create(&threads[i], NULL, worker, (void *)(uintptr_t)i);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    check(ticket_counter == (uint64_t)nthreads * ITERS, "ticket spinlock");
+    check(queued_counter == (uint64_t)nthreads * ITERS, "MCS qspinlock");
+    check(!rw_torn && rw_a == (uint64_t)nthreads * (ITERS / 8), "rwlock");
+
+    printf("\n");
+    lockstat_dump();
+
+    printf("\n=== Spinlock tests completed ===\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,237 @@
+// test_vfs.c - тест VFS (kernel/fs/vfs.c): кэш имён, отрицательные dentry, монтирование
+#include <stdio.h>
+#include <string.h>
+#include "../kernel/fs/vfs.h"
+#include "kstubs.h"
+
+// ФС в памяти: узлы в массиве, поиск перебором — и считается
+#define MEMFS_NODES 2048
+
+typedef struct {
+    char name[VFS_NAME_MAX + 1];
+    uint64_t parent;
+    uint32_t type;
+    int used;
+    uint8_t data[64];
+    uint64_t size;
+} memfs_node_t;
+
+typedef struct {
+    memfs_node_t nodes[MEMFS_NODES];
+} memfs_t;
+
+static memfs_t fs_a, fs_b;
+static int fs_lookups;
+
+static memfs_t *sb_fs(vfs_inode_t *inode) {
+    return (memfs_t *)inode->sb->priv;
+}
+
+static int memfs_read_inode(vfs_inode_t *inode) {
+    memfs_node_t *n = &sb_fs(inode)->nodes[inode->ino];
+    if (!n->used) return -1;
+    inode->type = n->type;
+    inode->size = n->size;
+    return 0;
+}
+
+static int memfs_lookup(vfs_inode_t *dir, const char *name, uint32_t len, uint64_t *ino) {
+    memfs_t *fs = sb_fs(dir);
+    fs_lookups++;
+    for (uint64_t i = 1; i < MEMFS_NODES; i++) {
+        memfs_node_t *n = &fs->nodes[i];
+        if (n->used && n->parent == dir->ino && strlen(n->name) == len &&
+            !memcmp(n->name, name, len)) {
+            *ino = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int memfs_create(vfs_inode_t *dir, const char *name, uint32_t len, uint32_t type,
+                        uint64_t *ino) {
+    memfs_t *fs = sb_fs(dir);
+    for (uint64_t i = 1; i < MEMFS_NODES; i++) {
+        memfs_node_t *n = &fs->nodes[i];
+        if (n->used) continue;
+        memcpy(n->name, name, len);
+        n->name[len] = '\0';
+        n->parent = dir->ino;
+        n->type = type;
+        n->size = 0;
+        n->used = 1;
+        *ino = i;
+        return 0;
+    }
+    return -1;
+}
+
+static int memfs_unlink(vfs_inode_t *dir, const char *name, uint32_t len, vfs_inode_t *inode) {
+    memfs_t *fs = sb_fs(dir);
+    (void)name; (void)len;
+    for (uint64_t i = 1; i < MEMFS_NODES; i++) {
+        if (fs->nodes[i].used && fs->nodes[i].parent == inode->ino) return -1;
+    }
+    fs->nodes[inode->ino].used = 0;
+    return 0;
+}
+
+static int64_t memfs_read(vfs_inode_t *inode, uint64_t off, void *buf, uint64_t len) {
+    memfs_node_t *n = &sb_fs(inode)->nodes[inode->ino];
+    if (off >= n->size) return 0;
+    if (len > n->size - off) len = n->size - off;
+    memcpy(buf, n->data + off, len);
+    return (int64_t)len;
+}
+
+static int64_t memfs_write(vfs_inode_t *inode, uint64_t off, const void *buf, uint64_t len) {
+    memfs_node_t *n = &sb_fs(inode)->nodes[inode->ino];
+    if (off + len > sizeof(n->data)) return -1;
+    memcpy(n->data + off, buf, len);
+    if (off + len > n->size) n->size = off + len;
+    inode->size = n->size;
+    return (int64_t)len;
+}
+
+static int memfs_readdir(vfs_inode_t *dir, uint64_t *pos, vfs_dirent_t *ent) {
+    memfs_t *fs = sb_fs(dir);
+    for (uint64_t i = *pos ? *pos : 1; i < MEMFS_NODES; i++) {
+        memfs_node_t *n = &fs->nodes[i];
+        if (!n->used || n->parent != dir->ino) continue;
+        strcpy(ent->name, n->name);
+        ent->ino = i;
+        ent->type = n->type;
+        *pos = i + 1;
+        return 0;
+    }
+    return -1;
+}
+
+static const vfs_ops_t memfs_ops = {
+    .read_inode = memfs_read_inode,
+    .lookup = memfs_lookup,
+    .create = memfs_create,
+    .unlink = memfs_unlink,
+    .read = memfs_read,
+    .write = memfs_write,
+    .readdir = memfs_readdir,
+};
+
+static int memfs_mount(vfs_sb_t *sb, block_device_t *dev, const void *data) {
+    (void)dev;
+    memfs_t *fs = (memfs_t *)data;
+    fs->nodes[0].used = 1;          // корень
+    fs->nodes[0].type = VFS_DIR;
+    sb->ops = &memfs_ops;
+    sb->root_ino = 0;
+    sb->priv = fs;
+    return 0;
+}
+
+static vfs_fs_type_t memfs_type = { .name = "memfs", .mount = memfs_mount };
+
+static int passed = 0;
+static int failed = 0;
+
+#define CHECK(cond, name) do {                       \
+    if (cond) { printf("✓ %s\n", name); passed++; }  \
+    else { printf("✗ %s\n", name); failed++; }       \
+} while (0)
+
+int main() {
+    printf("=== VFS Test ===\n\n");
+
+    vfs_init();
+    CHECK(vfs_mount("memfs", NULL, &fs_a, "/") == -1, "unknown filesystem type rejected");
+    CHECK(vfs_register_fs(&memfs_type) == 0 && vfs_register_fs(&memfs_type) == -1,
+          "filesystem type registered once");
+    CHECK(vfs_mount("memfs", NULL, &fs_a, "/a") == -1 &&
+          vfs_mount("memfs", NULL, &fs_a, "/") == 0, "first mount goes on /");
+
+    // Создание и чтение
+    vfs_file_t *f = NULL;
+    CHECK(vfs_mkdir("/a") == 0 && vfs_mkdir("/a/b") == 0 && vfs_mkdir("/a") == -1, "mkdir");
+    f = vfs_open("/a/b/f", VFS_O_CREAT);
+    CHECK(f && vfs_write(f, "hello", 5) == 5, "create and write a file");
+    vfs_close(f);
+    char buf[16] = { 0 };
+    f = vfs_open("/a/b/f", 0);
+    CHECK(f && vfs_read(f, buf, sizeof(buf)) == 5 && !memcmp(buf, "hello", 5) &&
+          vfs_read(f, buf, sizeof(buf)) == 0, "read back");
+
+    // Повторный путь — только попадания в кэш
+    vfs_dcache_stats_t st0, st1;
+    vfs_stat_t s;
+    fs_lookups = 0;
+    vfs_get_dcache_stats(&st0);
+    CHECK(vfs_stat("/a/b/f", &s) == 0 && s.type == VFS_FILE && s.size == 5, "stat");
+    vfs_get_dcache_stats(&st1);
+    CHECK(fs_lookups == 0 && st1.hits - st0.hits == 3, "path lookup is one cache hit per component");
+
+    // Отрицательные dentry
+    CHECK(vfs_stat("/a/nope", &s) == -1 && fs_lookups == 1, "missing name asks the filesystem");
+    vfs_get_dcache_stats(&st0);
+    CHECK(vfs_stat("/a/nope", &s) == -1 && fs_lookups == 1, "missing name is cached");
+    vfs_get_dcache_stats(&st1);
+    CHECK(st1.negative_hits - st0.negative_hits == 1, "negative hit counted");
+    vfs_file_t *g = vfs_open("/a/nope", VFS_O_CREAT);
+    CHECK(g && vfs_stat("/a/nope", &s) == 0 && fs_lookups == 1, "create turns a negative entry positive");
+    vfs_close(g);
+
+    // Разбор пути
+    vfs_stat_t sa, sb;
+    CHECK(vfs_stat("/a/b/../b/./f", &s) == 0 && s.size == 5, ". and .. components");
+    CHECK(vfs_stat("//a///b/", &sb) == 0 && sb.type == VFS_DIR, "repeated slashes");
+    CHECK(vfs_stat("/x/y", &s) == -1 && vfs_stat("/a/b/f/g", &s) == -1 &&
+          vfs_stat("a/b", &s) == -1, "bad paths fail");
+
+    // Удаление: открытый файл остаётся читаемым
+    fs_lookups = 0;
+    CHECK(vfs_unlink("/a") == -1, "non-empty directory is not removed");
+    CHECK(vfs_unlink("/a/b/f") == 0 && vfs_stat("/a/b/f", &s) == -1 && fs_lookups == 0,
+          "unlinked name becomes negative");
+    vfs_seek(f, 0);
+    memset(buf, 0, sizeof(buf));
+    CHECK(vfs_read(f, buf, sizeof(buf)) == 5 && !memcmp(buf, "hello", 5), "open file survives unlink");
+    vfs_close(f);
+
+    // Вторая ФС на /a/b; «..» из её корня возвращает в /a
+    CHECK(vfs_mount("memfs", NULL, &fs_b, "/a/b") == 0, "mount on a directory");
+    f = vfs_open("/a/b/inner", VFS_O_CREAT);
+    CHECK(f && fs_b.nodes[1].used && !strcmp(fs_b.nodes[1].name, "inner"), "files go to the mounted fs");
+    vfs_close(f);
+    CHECK(vfs_stat("/a/b/..", &s) == 0 && vfs_stat("/a", &sa) == 0 && s.ino == sa.ino,
+          ".. leaves the mounted fs");
+    CHECK(vfs_unlink("/a/b") == -1, "mount point is busy");
+
+    // readdir
+    f = vfs_open("/a", 0);
+    vfs_dirent_t ent;
+    int names = 0;
+    while (f && vfs_readdir(f, &ent) == 0) names++;
+    vfs_close(f);
+    CHECK(names == 2, "readdir lists the directory");
+
+    // Больше имён, чем dentry и inode в пулах: старые вытесняются
+    vfs_mkdir("/many");
+    int ok = 1;
+    char path[32];
+    for (int i = 0; i < 1500; i++) {
+        snprintf(path, sizeof(path), "/many/f%d", i);
+        vfs_file_t *h = vfs_open(path, VFS_O_CREAT);
+        ok &= h != NULL;
+        if (h) vfs_close(h);
+    }
+    for (int i = 0; i < 1500; i++) {
+        snprintf(path, sizeof(path), "/many/f%d", i);
+        ok &= vfs_stat(path, &s) == 0;
+    }
+    vfs_get_dcache_stats(&st1);
+    CHECK(ok && st1.evictions > 0 && st1.dentries <= VFS_DENTRIES && st1.inodes <= VFS_INODES,
+          "cache reclaims under pressure");
+    CHECK(vfs_stat("/a/b/inner", &s) == 0, "mounted tree survives reclaim");
+
+    printf("\n=== VFS tests completed: %d passed, %d failed ===\n", passed, failed);
+    return failed ? 1 : 0;
+}
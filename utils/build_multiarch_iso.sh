@@ -41,8 +41,15 @@ build_kernel() {
     cd kernel
     make clean
     make ARCH=$arch all
+    local status=$?
+
+    # initrd — модуль GRUB (module /boot/initrd.tar); грузит его только x86_64
+    if [ $status -eq 0 ] && [ "$arch" = "x86_64" ]; then
+        make ARCH=$arch initrd
+        status=$?
+    fi
     
-    if [ $? -ne 0 ]; then
+    if [ $status -ne 0 ]; then
         echo "✗ Ошибка сборки ядра для $arch"
         cd ..
         return 1
@@ -96,6 +103,15 @@ create_iso() {
         return 1
     fi
     
+    # Копируем initrd для пункта "MyOS GUI (initrd)"
+    if [ "$arch" = "x86_64" ]; then
+        if [ -f "kernel/build/initrd.tar" ]; then
+            cp "kernel/build/initrd.tar" "$ISO_ROOT/boot/initrd.tar"
+        else
+            echo "⚠ initrd.tar не найден: пункт с initrd не загрузится"
+        fi
+    fi
+    
     # Копируем конфигурацию GRUB
     cp "boot/grub/grub.cfg" "$ISO_ROOT/boot/grub/grub.cfg"
     
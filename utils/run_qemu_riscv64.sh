@@ -0,0 +1,16 @@
+#!/bin/bash
+# Запуск RISC-V64 ядра под OpenSBI (S-режим) с несколькими hart'ами
+# Использование: ./run_qemu_riscv64.sh [число hart'ов, по умолчанию 4]
+
+KERNEL="$(dirname "$0")/../kernel/build/kernel-riscv64.bin"
+SMP="${1:-4}"
+
+echo "Starting RISC-V64 kernel with $SMP hart(s)..."
+qemu-system-riscv64 \
+    -M virt \
+    -smp "$SMP" \
+    -m 512 \
+    -bios default \
+    -kernel "$KERNEL" \
+    -serial stdio \
+    -display none